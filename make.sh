@@ -110,6 +110,21 @@ if [ $have_pthread -eq 0 ] && [ "$uname" != "Darwin" ]; then
    fi
 fi
 
+if [ "$uname" = "Linux" ] && [ -f /usr/include/liburing.h ]; then
+  CFLAGS="$CFLAGS -DFS_USE_IO_URING"
+  LIBS="$LIBS -luring"
+fi
+
+if [ -f /usr/include/lz4.h ] || [ -f /usr/local/include/lz4.h ]; then
+  CFLAGS="$CFLAGS -DFS_WITH_LZ4"
+  LIBS="$LIBS -llz4"
+fi
+
+if [ -f /usr/include/zstd.h ] || [ -f /usr/local/include/zstd.h ]; then
+  CFLAGS="$CFLAGS -DFS_WITH_ZSTD"
+  LIBS="$LIBS -lzstd"
+fi
+
 sed_replace()
 {
     sed_cmd=$1
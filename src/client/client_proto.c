@@ -115,16 +115,22 @@ int fs_client_proto_slice_read_ex(FSClientContext *client_ctx,
     int hole_len;
     int buff_offet;
     int remain;
+    int max_len;
     int curr_len;
     int bytes;
     int result;
 
+    connection_params = client_ctx->conn_manager.get_connection_params(
+            client_ctx, conn);
+
     proto_header = (FSProtoHeader *)out_buff;
     if (req_cmd == FS_SERVICE_PROTO_SLICE_READ_REQ) {
+        max_len = connection_params->max_read_size;
         body_len = sizeof(FSProtoServiceSliceReadReq);
         sreq = (FSProtoServiceSliceReadReq *)(proto_header + 1);
         proto_bs = &sreq->bs;
     } else {
+        max_len = connection_params->buffer_size;
         body_len = sizeof(FSProtoReplicaSliceReadReq);
         rreq = (FSProtoReplicaSliceReadReq *)(proto_header + 1);
         int2buff(slave_id, rreq->slave_id);
@@ -133,17 +139,14 @@ int fs_client_proto_slice_read_ex(FSClientContext *client_ctx,
     SF_PROTO_SET_HEADER(proto_header, req_cmd, body_len);
     proto_pack_block_key(&bs_key->block, &proto_bs->bkey);
 
-    connection_params = client_ctx->conn_manager.get_connection_params(
-            client_ctx, conn);
-
     result = 0;
     hole_start = buff_offet = 0;
     remain = bs_key->slice.length;
     while (remain > 0) {
-        if (remain <= connection_params->buffer_size) {
+        if (remain <= max_len) {
             curr_len = remain;
         } else {
-            curr_len = connection_params->buffer_size;
+            curr_len = max_len;
         }
 
         int2buff(bs_key->slice.offset + buff_offet,
@@ -359,6 +362,10 @@ int fs_client_proto_join_server(FSClientContext *client_ctx,
         sf_log_network_error(&response, conn, result);
     } else {
         conn_params->buffer_size = buff2int(join_resp.buffer_size);
+        conn_params->max_read_size = buff2int(join_resp.max_read_size);
+        if (conn_params->max_read_size <= 0) {
+            conn_params->max_read_size = conn_params->buffer_size;
+        }
     }
 
     return result;
@@ -726,5 +733,173 @@ int fs_client_proto_service_stat(FSClientContext *client_ctx,
     stat->data.ob_count = buff2long(stat_resp.data.ob_count);
     stat->data.slice_count = buff2long(stat_resp.data.slice_count);
 
+    stat->durability.mode = stat_resp.durability.mode;
+    fs_proto_parse_sync_stat(&stat_resp.durability.trunk,
+            &stat->durability.trunk);
+    fs_proto_parse_sync_stat(&stat_resp.durability.binlog,
+            &stat->durability.binlog);
+
+    stat->read_cache.capacity = buff2long(stat_resp.read_cache.capacity);
+    stat->read_cache.used = buff2long(stat_resp.read_cache.used);
+    stat->read_cache.count = buff2long(stat_resp.read_cache.count);
+    stat->read_cache.hit_count = buff2long(stat_resp.read_cache.hit_count);
+    stat->read_cache.miss_count = buff2long(
+            stat_resp.read_cache.miss_count);
+    stat->read_cache.evict_count = buff2long(
+            stat_resp.read_cache.evict_count);
+
+    stat->index_memory.ob_entries = buff2long(
+            stat_resp.index_memory.ob_entries);
+    stat->index_memory.slice_entries = buff2long(
+            stat_resp.index_memory.slice_entries);
+    stat->index_memory.slice_maps = buff2long(
+            stat_resp.index_memory.slice_maps);
+    stat->index_memory.hashtable = buff2long(
+            stat_resp.index_memory.hashtable);
+
     return 0;
 }
+
+static int parse_io_path_stat(SFResponseInfo *response, char **p,
+        char *body_end, FSClientIOPathStat *path_stat)
+{
+    FSProtoIOStatRespPathPart *path_part;
+    FSProtoIOStatRespThreadPart *thread_part;
+    FSIOThreadStat *thread;
+    FSIOThreadStat *end;
+    int path_len;
+    int i;
+
+    path_part = (FSProtoIOStatRespPathPart *)*p;
+    if (*p + sizeof(FSProtoIOStatRespPathPart) > body_end) {
+        response->error.length = snprintf(response->error.message,
+                sizeof(response->error.message),
+                "response body length: %d is too short",
+                (int)(body_end - *p));
+        return EINVAL;
+    }
+
+    path_stat->stat.thread_count = buff2int(path_part->thread_count);
+    path_len = buff2short(path_part->path_len);
+    if (path_len >= sizeof(path_stat->path) ||
+            path_stat->stat.thread_count < 0 ||
+            path_stat->stat.thread_count > FS_IO_STAT_MAX_THREADS_PER_PATH ||
+            path_part->path + path_len + sizeof(FSProtoIOStatRespThreadPart) *
+            path_stat->stat.thread_count > body_end)
+    {
+        response->error.length = snprintf(response->error.message,
+                sizeof(response->error.message), "invalid path length: "
+                "%d or thread count: %d", path_len,
+                path_stat->stat.thread_count);
+        return EINVAL;
+    }
+
+    for (i=0; i<FS_IO_STAT_TYPE_COUNT; i++) {
+        fs_proto_parse_latency_summary(&path_part->types[i].queue_wait,
+                &path_stat->stat.types[i].queue_wait);
+        fs_proto_parse_latency_summary(&path_part->types[i].service,
+                &path_stat->stat.types[i].service);
+    }
+    memcpy(path_stat->path, path_part->path, path_len);
+    *(path_stat->path + path_len) = '\0';
+
+    thread_part = (FSProtoIOStatRespThreadPart *)(path_part->path + path_len);
+    end = path_stat->stat.threads + path_stat->stat.thread_count;
+    for (thread=path_stat->stat.threads; thread<end;
+            thread++, thread_part++)
+    {
+        thread->role = thread_part->role;
+        thread->queued = buff2int(thread_part->queued);
+        thread->count = buff2long(thread_part->count);
+        thread->busy_time = buff2long(thread_part->busy_time);
+    }
+
+    *p = (char *)thread_part;
+    return 0;
+}
+
+int fs_client_proto_io_stat(FSClientContext *client_ctx,
+        const ConnectionInfo *spec_conn, FSClientIOPathStat *stats,
+        const int size, int *count, int64_t *elapsed_time)
+{
+    char out_buff[sizeof(FSProtoHeader)];
+    FSProtoHeader *proto_header;
+    FSProtoIOStatRespBodyHeader *body_header;
+    ConnectionInfo *conn;
+    SFResponseInfo response;
+    FSClientIOPathStat *ps;
+    FSClientIOPathStat *send;
+    char *in_buff;
+    char *p;
+    int in_size;
+    int body_len;
+    int result;
+
+    *count = 0;
+    in_size = sizeof(FSProtoIOStatRespBodyHeader) + size *
+        (sizeof(FSProtoIOStatRespPathPart) + MAX_PATH_SIZE +
+         sizeof(FSProtoIOStatRespThreadPart) *
+         FS_IO_STAT_MAX_THREADS_PER_PATH);
+    if ((in_buff=(char *)fc_malloc(in_size)) == NULL) {
+        return ENOMEM;
+    }
+
+    if ((conn=client_ctx->conn_manager.get_spec_connection(
+                    client_ctx, spec_conn, &result)) == NULL)
+    {
+        free(in_buff);
+        return result;
+    }
+
+    proto_header = (FSProtoHeader *)out_buff;
+    SF_PROTO_SET_HEADER(proto_header, FS_SERVICE_PROTO_IO_STAT_REQ, 0);
+    response.error.length = 0;
+    do {
+        if ((result=sf_send_and_recv_response_ex1(conn, out_buff,
+                        sizeof(out_buff), &response, client_ctx->
+                        network_timeout, FS_SERVICE_PROTO_IO_STAT_RESP,
+                        in_buff, in_size, &body_len)) != 0)
+        {
+            break;
+        }
+
+        if (body_len < sizeof(FSProtoIOStatRespBodyHeader)) {
+            response.error.length = snprintf(response.error.message,
+                    sizeof(response.error.message), "invalid response "
+                    "body length: %d < %d", body_len,
+                    (int)sizeof(FSProtoIOStatRespBodyHeader));
+            result = EINVAL;
+            break;
+        }
+
+        body_header = (FSProtoIOStatRespBodyHeader *)in_buff;
+        *elapsed_time = buff2long(body_header->elapsed_time);
+        *count = buff2int(body_header->path_count);
+        if (*count > size) {
+            response.error.length = snprintf(response.error.message,
+                    sizeof(response.error.message), "response path "
+                    "count: %d exceeds entry size: %d", *count, size);
+            result = ENOSPC;
+            break;
+        }
+
+        p = (char *)(body_header + 1);
+        send = stats + *count;
+        for (ps=stats; ps<send; ps++) {
+            if ((result=parse_io_path_stat(&response, &p,
+                            in_buff + body_len, ps)) != 0)
+            {
+                break;
+            }
+        }
+    } while (0);
+
+    if (result != 0) {
+        *count = 0;
+        sf_log_network_error(&response, conn, result);
+    }
+    SF_CLIENT_RELEASE_CONNECTION(client_ctx, conn, result);
+
+    free(in_buff);
+    return result;
+}
@@ -41,8 +41,17 @@ typedef struct fs_client_service_stat {
         int64_t slice_count;
     } data;
 
+    FSDurabilityStat durability;
+    FSReadCacheStat read_cache;
+    FSIndexMemoryStat index_memory;
+
 } FSClientServiceStat;
 
+typedef struct fs_client_io_path_stat {
+    char path[MAX_PATH_SIZE];
+    FSIOPathStat stat;
+} FSClientIOPathStat;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -97,6 +106,10 @@ extern "C" {
             const ConnectionInfo *spec_conn, const int data_group_id,
             FSClientServiceStat *stat);
 
+    int fs_client_proto_io_stat(FSClientContext *client_ctx,
+            const ConnectionInfo *spec_conn, FSClientIOPathStat *stats,
+            const int size, int *count, int64_t *elapsed_time);
+
 #ifdef __cplusplus
 }
 #endif
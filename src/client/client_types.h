@@ -49,6 +49,7 @@ typedef const struct fs_connection_parameters * (*fs_get_connection_parameters)(
 
 typedef struct fs_connection_parameters {
     int buffer_size;
+    int max_read_size;  //for the service slice read
     int data_group_id;  //for master cache
     struct idempotency_client_channel *channel;
 } FSConnectionParameters;
@@ -24,16 +24,55 @@
 #include "fastcommon/logger.h"
 #include "faststore/client/fs_client.h"
 
+#define IO_STAT_MAX_PATHS  256
+
 static void usage(char *argv[])
 {
     fprintf(stderr, "Usage: %s [-c config_filename] "
             "[-s server_id] [-g data_group_id=0] "
-            "host[:port]\n", argv[0]);
+            "[-i for disk IO stats] host[:port]\n", argv[0]);
+}
+
+static const char *get_durability_mode_caption(const int mode)
+{
+    switch (mode) {
+        case FS_DURABILITY_MODE_NONE:
+            return "none";
+        case FS_DURABILITY_MODE_PERIODIC:
+            return "periodic";
+        case FS_DURABILITY_MODE_GROUP_COMMIT:
+            return "group_commit";
+        default:
+            return "unknown";
+    }
+}
+
+static void output_sync_stat(const char *caption, FSSyncStat *stat)
+{
+    double avg_batch;
+    int64_t avg_time_us;
+
+    if (stat->count > 0) {
+        avg_batch = (double)stat->total_batch / (double)stat->count;
+        avg_time_us = stat->total_time_us / stat->count;
+    } else {
+        avg_batch = 0.00;
+        avg_time_us = 0;
+    }
+
+    printf("%s: {sync_count: %"PRId64", avg_batch: %.2f, max_batch: %d, "
+            "avg_time: %"PRId64" us, max_time: %d us}", caption,
+            stat->count, avg_batch, stat->max_batch,
+            avg_time_us, stat->max_time_us);
 }
 
 static void output(FSClientServiceStat *stat)
 {
     double avg_slices;
+    double hit_ratio;
+    double bytes_per_slice;
+    int64_t read_count;
+    int64_t index_bytes;
 
     if (stat->data.ob_count > 0) {
         avg_slices = (double)stat->data.slice_count /
@@ -49,7 +88,7 @@ static void output(FSClientServiceStat *stat)
             "writer: {next_version: %"PRId64", total_count: %"PRId64", "
             "waiting_count: %d, max_waitings: %d}}\n"
             "\tdata : {ob_count: %"PRId64", slice_count: %"PRId64", "
-            "avg slices/OB: %.2f}\n\n", stat->server_id,
+            "avg slices/OB: %.2f}\n", stat->server_id,
             stat->is_leader ?  "true" : "false",
             stat->connection.current_count,
             stat->connection.max_count,
@@ -60,6 +99,120 @@ static void output(FSClientServiceStat *stat)
             stat->binlog.writer.max_waitings,
             stat->data.ob_count, stat->data.slice_count,
             avg_slices);
+
+    printf("\tdurability : {mode: %s, ", get_durability_mode_caption(
+                stat->durability.mode));
+    output_sync_stat("trunk", &stat->durability.trunk);
+    printf(", ");
+    output_sync_stat("binlog", &stat->durability.binlog);
+    printf("}\n");
+
+    read_count = stat->read_cache.hit_count + stat->read_cache.miss_count;
+    if (read_count > 0) {
+        hit_ratio = 100.00 * (double)stat->read_cache.hit_count /
+            (double)read_count;
+    } else {
+        hit_ratio = 0.00;
+    }
+    printf("\tread_cache : {capacity: %"PRId64" MB, used: %"PRId64" MB, "
+            "count: %"PRId64", hit_count: %"PRId64", miss_count: %"PRId64", "
+            "hit_ratio: %.2f%%, evict_count: %"PRId64"}\n",
+            stat->read_cache.capacity / (1024 * 1024),
+            stat->read_cache.used / (1024 * 1024),
+            stat->read_cache.count, stat->read_cache.hit_count,
+            stat->read_cache.miss_count, hit_ratio,
+            stat->read_cache.evict_count);
+
+    index_bytes = stat->index_memory.ob_entries +
+        stat->index_memory.slice_entries + stat->index_memory.slice_maps +
+        stat->index_memory.hashtable;
+    if (stat->data.slice_count > 0) {
+        bytes_per_slice = (double)index_bytes /
+            (double)stat->data.slice_count;
+    } else {
+        bytes_per_slice = 0.00;
+    }
+    printf("\tindex_memory : {ob: %"PRId64" MB, slice: %"PRId64" MB, "
+            "slice_map: %"PRId64" MB, hashtable: %"PRId64" MB, "
+            "total: %"PRId64" MB, bytes/slice: %.2f}\n\n",
+            stat->index_memory.ob_entries / (1024 * 1024),
+            stat->index_memory.slice_entries / (1024 * 1024),
+            stat->index_memory.slice_maps / (1024 * 1024),
+            stat->index_memory.hashtable / (1024 * 1024),
+            index_bytes / (1024 * 1024), bytes_per_slice);
+}
+
+static void output_latency(const char *caption, FSLatencySummary *summary)
+{
+    printf("%s: {avg: %"PRId64", p50: %"PRId64", p90: %"PRId64", "
+            "p99: %"PRId64", p999: %"PRId64", max: %"PRId64"}",
+            caption, summary->avg, summary->p50, summary->p90,
+            summary->p99, summary->p999, summary->max);
+}
+
+static void output_io_path_stat(FSClientIOPathStat *ps,
+        const int64_t elapsed_time)
+{
+    const char *type_captions[FS_IO_STAT_TYPE_COUNT] = {
+        "create_trunk", "delete_trunk", "read_slice", "write_slice"};
+    FSIOLatencyStat *latency;
+    FSIOThreadStat *thread;
+    int i;
+
+    printf("\tpath: %s\n", ps->path);
+    for (i=0; i<FS_IO_STAT_TYPE_COUNT; i++) {
+        latency = ps->stat.types + i;
+        if (latency->service.count == 0) {
+            continue;
+        }
+
+        printf("\t\t%s : {count: %"PRId64", ", type_captions[i],
+                latency->service.count);
+        output_latency("queue_wait", &latency->queue_wait);
+        printf(", ");
+        output_latency("service", &latency->service);
+        printf("}\n");
+    }
+
+    //the busy ratio may exceed 100% when io_uring enabled
+    for (i=0; i<ps->stat.thread_count; i++) {
+        thread = ps->stat.threads + i;
+        printf("\t\tthread %d : {role: %s, count: %"PRId64", "
+                "queued: %d, busy: %.2f%%}\n", i + 1,
+                (thread->role == 'W' ? "write" : "read"),
+                thread->count, thread->queued, elapsed_time > 0 ?
+                (double)thread->busy_time * 100.00 / elapsed_time : 0.00);
+    }
+}
+
+static int output_io_stat(const ConnectionInfo *spec_conn)
+{
+    FSClientIOPathStat *stats;
+    int64_t elapsed_time;
+    int count;
+    int result;
+    int i;
+
+    stats = (FSClientIOPathStat *)fc_malloc(sizeof(
+                FSClientIOPathStat) * IO_STAT_MAX_PATHS);
+    if (stats == NULL) {
+        return ENOMEM;
+    }
+
+    if ((result=fs_client_proto_io_stat(&g_fs_client_vars.client_ctx,
+                    spec_conn, stats, IO_STAT_MAX_PATHS, &count,
+                    &elapsed_time)) == 0)
+    {
+        printf("\tdisk IO (the time unit is microsecond, "
+                "elapsed: %"PRId64" s):\n", elapsed_time / 1000000);
+        for (i=0; i<count; i++) {
+            output_io_path_stat(stats + i, elapsed_time);
+        }
+        printf("\n");
+    }
+
+    free(stats);
+    return result;
 }
 
 int main(int argc, char *argv[])
@@ -68,6 +221,7 @@ int main(int argc, char *argv[])
 	int ch;
     int server_id;
     int data_group_id;
+    bool io_stat;
     char *host;
     FCServerInfo *server;
     ConnectionInfo *spec_conn;
@@ -82,7 +236,8 @@ int main(int argc, char *argv[])
 
     server_id = 0;
     data_group_id = 0;
-    while ((ch=getopt(argc, argv, "hc:s:g:")) != -1) {
+    io_stat = false;
+    while ((ch=getopt(argc, argv, "hc:s:g:i")) != -1) {
         switch (ch) {
             case 'h':
                 usage(argv);
@@ -96,6 +251,9 @@ int main(int argc, char *argv[])
             case 'g':
                 data_group_id = strtol(optarg, NULL, 10);
                 break;
+            case 'i':
+                io_stat = true;
+                break;
             default:
                 usage(argv);
                 return 1;
@@ -150,5 +308,8 @@ int main(int argc, char *argv[])
     }
 
     output(&stat);
+    if (io_stat) {
+        return output_io_stat(spec_conn);
+    }
     return 0;
 }
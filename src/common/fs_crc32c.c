@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include <arm_acle.h>
+#endif
+#include "fs_crc32c.h"
+
+#define CRC32C_POLY  0x82F63B78  //reflected Castagnoli polynomial
+
+/* the large buffer is processed by three interleaved streams to hide the
+   latency of the CRC instruction, the streams are combined by GF(2) shift */
+#define CRC32C_STREAM_BLOCK  4096
+
+#if (defined(__x86_64__) || defined(__aarch64__)) && defined(__GNUC__)
+#define CRC32C_HW_SUPPORTED  1
+#endif
+
+typedef uint32_t (*crc32c_update_func)(uint32_t crc,
+        const unsigned char *p, size_t len);
+
+static uint32_t crc32c_table[8][256];
+static uint32_t crc32c_stream_shift;  //x^(8 * CRC32C_STREAM_BLOCK) mod P
+static crc32c_update_func crc32c_update = NULL;
+static const char *crc32c_name = "table";
+
+//multiply a and b modulo P, in reflected bit order
+static uint32_t crc32c_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m;
+    uint32_t p;
+
+    m = (uint32_t)1 << 31;
+    p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+
+//x^(8 * bytes) modulo P
+static uint32_t crc32c_x8nmodp(size_t bytes)
+{
+    uint32_t x2n;   //x^(2^k)
+    uint32_t p;
+    size_t n;
+
+    x2n = (uint32_t)1 << 30;  //x^1
+    p = (uint32_t)1 << 31;    //x^0
+    n = bytes * 8;
+    while (n > 0) {
+        if (n & 1) {
+            p = crc32c_multmodp(x2n, p);
+        }
+        x2n = crc32c_multmodp(x2n, x2n);
+        n >>= 1;
+    }
+    return p;
+}
+
+static void crc32c_init_table()
+{
+    uint32_t crc;
+    int i;
+    int k;
+
+    for (i=0; i<256; i++) {
+        crc = i;
+        for (k=0; k<8; k++) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc32c_table[0][i] = crc;
+    }
+
+    for (i=0; i<256; i++) {
+        crc = crc32c_table[0][i];
+        for (k=1; k<8; k++) {
+            crc = crc32c_table[0][crc & 0xFF] ^ (crc >> 8);
+            crc32c_table[k][i] = crc;
+        }
+    }
+}
+
+//slicing-by-8
+static uint32_t crc32c_update_table(uint32_t crc,
+        const unsigned char *p, size_t len)
+{
+    uint64_t word;
+
+    while (len > 0 && ((uintptr_t)p & 7) != 0) {
+        crc = crc32c_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        len--;
+    }
+
+    while (len >= 8) {
+        memcpy(&word, p, 8);
+        word ^= crc;
+        crc = crc32c_table[7][word & 0xFF] ^
+            crc32c_table[6][(word >> 8) & 0xFF] ^
+            crc32c_table[5][(word >> 16) & 0xFF] ^
+            crc32c_table[4][(word >> 24) & 0xFF] ^
+            crc32c_table[3][(word >> 32) & 0xFF] ^
+            crc32c_table[2][(word >> 40) & 0xFF] ^
+            crc32c_table[1][(word >> 48) & 0xFF] ^
+            crc32c_table[0][word >> 56];
+        p += 8;
+        len -= 8;
+    }
+
+    while (len > 0) {
+        crc = crc32c_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        len--;
+    }
+    return crc;
+}
+
+#ifdef CRC32C_HW_SUPPORTED
+
+#if defined(__x86_64__)
+#define CRC32C_HW_TARGET   __attribute__((target("sse4.2")))
+#define CRC32C_HW_U8(crc, v)   __builtin_ia32_crc32qi(crc, v)
+#define CRC32C_HW_U64(crc, v)  (uint32_t)__builtin_ia32_crc32di(crc, v)
+#else
+#define CRC32C_HW_TARGET   __attribute__((target("+crc")))
+#define CRC32C_HW_U8(crc, v)   __crc32cb(crc, v)
+#define CRC32C_HW_U64(crc, v)  __crc32cd(crc, v)
+#endif
+
+static CRC32C_HW_TARGET uint32_t crc32c_hw_bytes(uint32_t crc,
+        const unsigned char *p, size_t len)
+{
+    uint64_t word;
+
+    while (len >= 8) {
+        memcpy(&word, p, 8);
+        crc = CRC32C_HW_U64(crc, word);
+        p += 8;
+        len -= 8;
+    }
+
+    while (len > 0) {
+        crc = CRC32C_HW_U8(crc, *p++);
+        len--;
+    }
+    return crc;
+}
+
+static CRC32C_HW_TARGET uint32_t crc32c_update_hw(uint32_t crc,
+        const unsigned char *p, size_t len)
+{
+    const unsigned char *end;
+    uint64_t crc0;
+    uint64_t crc1;
+    uint64_t crc2;
+    uint64_t w0;
+    uint64_t w1;
+    uint64_t w2;
+
+    while (len >= 3 * CRC32C_STREAM_BLOCK) {
+        crc0 = crc;
+        crc1 = crc2 = 0;
+        end = p + CRC32C_STREAM_BLOCK;
+        do {
+            memcpy(&w0, p, 8);
+            memcpy(&w1, p + CRC32C_STREAM_BLOCK, 8);
+            memcpy(&w2, p + 2 * CRC32C_STREAM_BLOCK, 8);
+            crc0 = CRC32C_HW_U64(crc0, w0);
+            crc1 = CRC32C_HW_U64(crc1, w1);
+            crc2 = CRC32C_HW_U64(crc2, w2);
+            p += 8;
+        } while (p < end);
+
+        crc = crc32c_multmodp(crc32c_stream_shift, crc0) ^ crc1;
+        crc = crc32c_multmodp(crc32c_stream_shift, crc) ^ crc2;
+        p += 2 * CRC32C_STREAM_BLOCK;
+        len -= 3 * CRC32C_STREAM_BLOCK;
+    }
+
+    return crc32c_hw_bytes(crc, p, len);
+}
+
+static int crc32c_hw_available()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#elif defined(__linux__)
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+    return 0;
+#endif
+}
+
+#endif
+
+void fs_crc32c_init_ex(const bool use_hw)
+{
+    if (crc32c_stream_shift == 0) {
+        crc32c_init_table();
+        crc32c_stream_shift = crc32c_x8nmodp(CRC32C_STREAM_BLOCK);
+    }
+
+#ifdef CRC32C_HW_SUPPORTED
+    if (use_hw && crc32c_hw_available()) {
+#if defined(__x86_64__)
+        crc32c_name = "sse4.2";
+#else
+        crc32c_name = "armv8-crc";
+#endif
+        crc32c_update = crc32c_update_hw;
+        return;
+    }
+#endif
+
+    crc32c_name = "table";
+    crc32c_update = crc32c_update_table;
+}
+
+void fs_crc32c_init()
+{
+    if (crc32c_update != NULL) {
+        return;
+    }
+
+    fs_crc32c_init_ex(true);
+}
+
+const char *fs_crc32c_impl_name()
+{
+    return crc32c_name;
+}
+
+uint32_t fs_crc32c(uint32_t crc, const void *buff, const size_t len)
+{
+    if (crc32c_update == NULL) {
+        fs_crc32c_init();
+    }
+    return ~crc32c_update(~crc, (const unsigned char *)buff, len);
+}
+
+uint32_t fs_crc32c_combine(uint32_t crc1, uint32_t crc2, const size_t len2)
+{
+    return crc32c_multmodp(crc32c_x8nmodp(len2), crc1) ^ crc2;
+}
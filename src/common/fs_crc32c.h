@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fs_crc32c.h
+
+#ifndef _FS_CRC32C_H
+#define _FS_CRC32C_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* select the CRC32C implementation: SSE4.2 or ARMv8 CRC instructions
+       when the CPU supports, the table lookup otherwise */
+    void fs_crc32c_init();
+
+    //use_hw: false for the table lookup, such as for the benchmark
+    void fs_crc32c_init_ex(const bool use_hw);
+
+    //return the implementation name for logging
+    const char *fs_crc32c_impl_name();
+
+    /* calculate the CRC32C (Castagnoli) of the buffer
+       crc: 0 for the first buffer, or the returned crc to continue */
+    uint32_t fs_crc32c(uint32_t crc, const void *buff, const size_t len);
+
+    /* return the CRC32C of the concatenated buffers A and B
+       crc1: the CRC32C of A, crc2: the CRC32C of B, len2: the length of B */
+    uint32_t fs_crc32c_combine(uint32_t crc1, uint32_t crc2,
+            const size_t len2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -64,6 +64,10 @@ const char *fs_get_cmd_caption(const int cmd)
             return "DISK_SPACE_STAT_REQ";
         case FS_SERVICE_PROTO_DISK_SPACE_STAT_RESP:
             return "DISK_SPACE_STAT_RESP";
+        case FS_SERVICE_PROTO_IO_STAT_REQ:
+            return "IO_STAT_REQ";
+        case FS_SERVICE_PROTO_IO_STAT_RESP:
+            return "IO_STAT_RESP";
         case FS_SERVICE_PROTO_SLICE_WRITE_REQ:
             return "SLICE_WRITE_REQ";
         case FS_SERVICE_PROTO_SLICE_WRITE_RESP:
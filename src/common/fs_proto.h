@@ -49,6 +49,8 @@
 #define FS_SERVICE_PROTO_CLUSTER_STAT_RESP       44
 #define FS_SERVICE_PROTO_DISK_SPACE_STAT_REQ     45
 #define FS_SERVICE_PROTO_DISK_SPACE_STAT_RESP    46
+#define FS_SERVICE_PROTO_IO_STAT_REQ             47
+#define FS_SERVICE_PROTO_IO_STAT_RESP            48
 
 #define FS_SERVICE_PROTO_GET_MASTER_REQ           51
 #define FS_SERVICE_PROTO_GET_MASTER_RESP          52
@@ -104,7 +106,7 @@ typedef struct fs_proto_client_join_req {
 
 typedef struct fs_proto_client_join_resp {
     char buffer_size[4];
-    char padding[4];
+    char max_read_size[4];  //the max slice read length, 0 for buffer_size
 } FSProtoClientJoinResp;
 
 typedef struct fs_proto_block_key {
@@ -187,6 +189,14 @@ typedef struct fs_proto_service_stat_req {
     char data_group_id[4];   //0 for slice binlog
 } FSProtoServiceStatReq;
 
+typedef struct fs_proto_sync_stat {
+    char count[8];
+    char total_batch[8];
+    char total_time_us[8];
+    char max_batch[4];
+    char max_time_us[4];
+} FSProtoSyncStat;
+
 typedef struct fs_proto_service_stat_resp {
     char server_id[4];
     char is_leader;
@@ -211,6 +221,29 @@ typedef struct fs_proto_service_stat_resp {
         char slice_count[8];
     } data;
 
+    struct {
+        char mode;
+        char padding[7];
+        FSProtoSyncStat trunk;
+        FSProtoSyncStat binlog;
+    } durability;
+
+    struct {
+        char capacity[8];
+        char used[8];
+        char count[8];
+        char hit_count[8];
+        char miss_count[8];
+        char evict_count[8];
+    } read_cache;
+
+    struct {
+        char ob_entries[8];
+        char slice_entries[8];
+        char slice_maps[8];
+        char hashtable[8];
+    } index_memory;
+
 } FSProtoServiceStatResp;
 
 typedef struct fs_proto_cluster_stat_req {
@@ -251,6 +284,41 @@ typedef struct fs_proto_disk_space_stat_resp_body_part {
     char avail[8];
 } FSProtoDiskSpaceStatRespBodyPart;
 
+typedef struct fs_proto_latency_summary {
+    char count[8];
+    char avg[8];
+    char max[8];
+    char p50[8];
+    char p90[8];
+    char p99[8];
+    char p999[8];
+} FSProtoLatencySummary;
+
+typedef struct fs_proto_io_stat_resp_body_header {
+    char elapsed_time[8];  //in microseconds since the IO threads started
+    char path_count[4];
+    char padding[4];
+} FSProtoIOStatRespBodyHeader;
+
+typedef struct fs_proto_io_stat_resp_path_part {
+    char thread_count[4];
+    char path_len[2];
+    char padding[2];
+    struct {
+        FSProtoLatencySummary queue_wait;
+        FSProtoLatencySummary service;
+    } types[FS_IO_STAT_TYPE_COUNT];
+    char path[0];  //followed by the thread parts
+} FSProtoIOStatRespPathPart;
+
+typedef struct fs_proto_io_stat_resp_thread_part {
+    char role;
+    char padding[3];
+    char queued[4];
+    char count[8];
+    char busy_time[8];
+} FSProtoIOStatRespThreadPart;
+
 typedef struct fs_proto_get_readable_server_req {
     char data_group_id[4];
     char read_rule;
@@ -404,6 +472,50 @@ const char *fs_get_server_status_caption(const int status);
 
 const char *fs_get_cmd_caption(const int cmd);
 
+static inline void fs_proto_pack_sync_stat(const FSSyncStat *stat,
+        FSProtoSyncStat *proto)
+{
+    long2buff(stat->count, proto->count);
+    long2buff(stat->total_batch, proto->total_batch);
+    long2buff(stat->total_time_us, proto->total_time_us);
+    int2buff(stat->max_batch, proto->max_batch);
+    int2buff(stat->max_time_us, proto->max_time_us);
+}
+
+static inline void fs_proto_pack_latency_summary(
+        const FSLatencySummary *summary, FSProtoLatencySummary *proto)
+{
+    long2buff(summary->count, proto->count);
+    long2buff(summary->avg, proto->avg);
+    long2buff(summary->max, proto->max);
+    long2buff(summary->p50, proto->p50);
+    long2buff(summary->p90, proto->p90);
+    long2buff(summary->p99, proto->p99);
+    long2buff(summary->p999, proto->p999);
+}
+
+static inline void fs_proto_parse_latency_summary(
+        const FSProtoLatencySummary *proto, FSLatencySummary *summary)
+{
+    summary->count = buff2long(proto->count);
+    summary->avg = buff2long(proto->avg);
+    summary->max = buff2long(proto->max);
+    summary->p50 = buff2long(proto->p50);
+    summary->p90 = buff2long(proto->p90);
+    summary->p99 = buff2long(proto->p99);
+    summary->p999 = buff2long(proto->p999);
+}
+
+static inline void fs_proto_parse_sync_stat(const FSProtoSyncStat *proto,
+        FSSyncStat *stat)
+{
+    stat->count = buff2long(proto->count);
+    stat->total_batch = buff2long(proto->total_batch);
+    stat->total_time_us = buff2long(proto->total_time_us);
+    stat->max_batch = buff2int(proto->max_batch);
+    stat->max_time_us = buff2int(proto->max_time_us);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -49,6 +49,10 @@
 
 #define FS_CLIENT_JOIN_FLAGS_IDEMPOTENCY_REQUEST    1
 
+#define FS_DURABILITY_MODE_NONE          0
+#define FS_DURABILITY_MODE_PERIODIC      1
+#define FS_DURABILITY_MODE_GROUP_COMMIT  2
+
 #define FS_FILE_BLOCK_ALIGN(offset) \
     (offset & (~(FS_FILE_BLOCK_SIZE - 1)))
 
@@ -97,6 +101,72 @@ typedef struct {
     int max_waitings;
 } FSBinlogWriterStat;
 
+typedef struct {
+    int64_t count;          //sync times
+    int64_t total_batch;    //the total requests covered by the syncs
+    int64_t total_time_us;  //the total sync latency
+    int max_batch;
+    int max_time_us;
+} FSSyncStat;
+
+#define FS_IO_STAT_TYPE_CREATE_TRUNK  0
+#define FS_IO_STAT_TYPE_DELETE_TRUNK  1
+#define FS_IO_STAT_TYPE_READ_SLICE    2
+#define FS_IO_STAT_TYPE_WRITE_SLICE   3
+#define FS_IO_STAT_TYPE_COUNT         4
+
+#define FS_IO_STAT_MAX_THREADS_PER_PATH  64
+
+typedef struct {
+    int64_t count;
+    int64_t avg;   //the time unit is microsecond
+    int64_t max;
+    int64_t p50;
+    int64_t p90;
+    int64_t p99;
+    int64_t p999;
+} FSLatencySummary;
+
+typedef struct {
+    FSLatencySummary queue_wait;  //from push to the IO start
+    FSLatencySummary service;     //from the IO start to done
+} FSIOLatencyStat;
+
+typedef struct {
+    char role;      //'W' for write thread, 'R' for read thread
+    int queued;     //the requests waiting in the queues
+    int64_t count;  //the dealt requests
+    int64_t busy_time;  //the total service time in microseconds
+} FSIOThreadStat;
+
+typedef struct {
+    int thread_count;
+    FSIOLatencyStat types[FS_IO_STAT_TYPE_COUNT];  //FS_IO_STAT_TYPE_xxx
+    FSIOThreadStat threads[FS_IO_STAT_MAX_THREADS_PER_PATH];
+} FSIOPathStat;
+
+typedef struct {
+    int mode;
+    FSSyncStat trunk;   //for the trunk files
+    FSSyncStat binlog;  //for the slice and replica binlogs
+} FSDurabilityStat;
+
+typedef struct {
+    int64_t capacity;  //in bytes, 0 for disabled
+    int64_t used;      //in bytes
+    int64_t count;     //the cached slices
+    int64_t hit_count;
+    int64_t miss_count;
+    int64_t evict_count;
+} FSReadCacheStat;
+
+typedef struct {
+    int64_t ob_entries;     //the allocated object block entries in bytes
+    int64_t slice_entries;  //the allocated slice entries in bytes
+    int64_t slice_maps;     //the slice arrays and the skiplists in bytes
+    int64_t hashtable;      //the buckets or the groups in bytes
+} FSIndexMemoryStat;
+
 typedef SFSpaceStat FSClusterSpaceStat;
 
 #endif
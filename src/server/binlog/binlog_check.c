@@ -199,7 +199,7 @@ static int binlog_parse_buffer(ServerBinlogReader *reader,
     line_start = buff;
     buff_end = buff + length;
     while (line_start < buff_end) {
-        line_end = (char *)memchr(line_start, '\n', buff_end - line_start);
+        line_end = slice_binlog_record_end(line_start, buff_end);
         if (line_end == NULL) {
             result = EINVAL;
             sprintf(error_info, "expect line end char (\\n)");
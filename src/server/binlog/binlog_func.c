@@ -32,6 +32,26 @@
 #include "binlog_loader.h"
 #include "binlog_func.h"
 
+static int unpack_binary_common_fields(const string_t *line,
+        BinlogCommonFields *fields, char *error_info)
+{
+    int result;
+    SliceBinlogFields slice_fields;
+
+    if ((result=slice_binlog_unpack_record(line, &slice_fields,
+                    error_info)) != 0)
+    {
+        return result;
+    }
+
+    fields->timestamp = slice_fields.timestamp;
+    fields->source = slice_fields.source;
+    fields->op_type = slice_fields.op_type;
+    fields->bkey = slice_fields.bkey;
+    fields->data_version = slice_fields.data_version;
+    return 0;
+}
+
 int binlog_unpack_common_fields(const string_t *line,
         BinlogCommonFields *fields, char *error_info)
 {
@@ -39,6 +59,10 @@ int binlog_unpack_common_fields(const string_t *line,
     char *endptr;
     string_t cols[BINLOG_MAX_FIELD_COUNT];
 
+    if (slice_binlog_is_binary_record(line->str)) {
+        return unpack_binary_common_fields(line, fields, error_info);
+    }
+
     count = split_string_ex(line, ' ', cols,
             BINLOG_MAX_FIELD_COUNT, false);
     if (count < BINLOG_MIN_FIELD_COUNT) {
@@ -64,8 +88,19 @@ static int binlog_unpack_timestamp(const string_t *line,
         time_t *timestamp, char *error_info)
 {
     int count;
+    int result;
     char *endptr;
     string_t cols[BINLOG_MAX_FIELD_COUNT];
+    SliceBinlogFields fields;
+
+    if (slice_binlog_is_binary_record(line->str)) {
+        if ((result=slice_binlog_unpack_record(line, &fields,
+                        error_info)) == 0)
+        {
+            *timestamp = fields.timestamp;
+        }
+        return result;
+    }
 
     count = split_string_ex(line, ' ', cols,
             BINLOG_MAX_FIELD_COUNT, false);
@@ -80,22 +115,77 @@ static int binlog_unpack_timestamp(const string_t *line,
     return 0;
 }
 
+/* read the head or the tail of the binlog file, the newline may be
+   within the binary slice record, so the lines are NOT searched here */
+static int read_binlog_part(const char *filename, char *buff,
+        const int size, const bool tail, int64_t *file_size,
+        int *read_bytes)
+{
+    int fd;
+    int result;
+    int64_t offset;
+
+    if ((fd=open(filename, O_RDONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        return result;
+    }
+
+    if ((*file_size=lseek(fd, 0, SEEK_END)) < 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "lseek file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        close(fd);
+        return result;
+    }
+
+    *read_bytes = FC_MIN(*file_size, size);
+    offset = tail ? *file_size - *read_bytes : 0;
+    if (*read_bytes > 0 && pread(fd, buff, *read_bytes,
+                offset) != *read_bytes)
+    {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "read file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        close(fd);
+        return result;
+    }
+
+    close(fd);
+    return 0;
+}
+
 int binlog_get_first_timestamp(const char *filename, time_t *timestamp)
 {
     char buff[FS_BINLOG_MAX_RECORD_SIZE];
     char error_info[256];
     string_t line;
+    char *line_end;
+    int64_t file_size;
+    int read_bytes;
     int result;
 
-    if ((result=fc_get_first_line(filename, buff,
-                    sizeof(buff), &line)) != 0)
+    if ((result=read_binlog_part(filename, buff, sizeof(buff),
+                    false, &file_size, &read_bytes)) != 0)
     {
         return result;
     }
 
+    if (read_bytes == 0 || (line_end=slice_binlog_record_end(
+                    buff, buff + read_bytes)) == NULL)
+    {
+        return ENOENT;
+    }
+
+    line.str = buff;
+    line.len = (line_end + 1) - buff;
     if ((result=binlog_unpack_timestamp(&line, timestamp, error_info)) != 0) {
         logError("file: "__FILE__", line: %d, "
-                "binlog file: %s, unpack last line fail, %s",
+                "binlog file: %s, unpack first line fail, %s",
                 __LINE__, filename, error_info);
     }
 
@@ -104,14 +194,21 @@ int binlog_get_first_timestamp(const char *filename, time_t *timestamp)
 
 int binlog_get_last_timestamp(const char *filename, time_t *timestamp)
 {
-    char buff[FS_BINLOG_MAX_RECORD_SIZE];
+    char buff[4 * FS_BINLOG_MAX_RECORD_SIZE];
     char error_info[256];
     string_t line;
     int64_t file_size;
+    int read_bytes;
     int result;
 
-    if ((result=fc_get_last_line(filename, buff,
-                    sizeof(buff), &file_size, &line)) != 0)
+    if ((result=read_binlog_part(filename, buff, sizeof(buff),
+                    true, &file_size, &read_bytes)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=slice_binlog_get_last_record(buff, read_bytes,
+                    read_bytes == file_size, &line)) != 0)
     {
         return result;
     }
@@ -170,7 +267,7 @@ static int find_timestamp(ServerBinlogReader *reader, const int length,
     line_start = buff;
     buff_end = buff + length;
     while (line_start < buff_end) {
-        line_end = (char *)memchr(line_start, '\n', buff_end - line_start);
+        line_end = slice_binlog_record_end(line_start, buff_end);
         if (line_end == NULL) {
             result = EINVAL;
             sprintf(error_info, "expect line end char (\\n)");
@@ -21,6 +21,7 @@
 #include "sf/sf_func.h"
 #include "sf/sf_binlog_writer.h"
 #include "binlog_types.h"
+#include "slice_binlog_format.h"
 #include "../server_global.h"
 
 #ifdef __cplusplus
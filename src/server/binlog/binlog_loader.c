@@ -20,6 +20,7 @@
 #include "fastcommon/logger.h"
 #include "sf/sf_global.h"
 #include "../server_global.h"
+#include "slice_binlog_format.h"
 #include "binlog_loader.h"
 
 typedef struct {
@@ -41,7 +42,7 @@ static int parse_binlog(BinlogParseContext *ctx)
     line_start = ctx->r->buffer.buff;
     buff_end = ctx->r->buffer.buff + ctx->r->buffer.length;
     while (line_start < buff_end) {
-        line_end = (char *)memchr(line_start, '\n', buff_end - line_start);
+        line_end = slice_binlog_record_end(line_start, buff_end);
         if (line_end == NULL) {
             break;
         }
@@ -61,6 +62,7 @@ static int parse_binlog(BinlogParseContext *ctx)
 
 int binlog_loader_load_ex(const char *subdir_name,
         struct sf_binlog_writer_info *writer,
+        const SFBinlogFilePosition *position,
         binlog_parse_line_func parse_line, void *arg)
 {
     BinlogReadThreadContext read_thread_ctx;
@@ -74,13 +76,20 @@ int binlog_loader_load_ex(const char *subdir_name,
     start_time = get_current_time_ms();
 
     if ((result=binlog_read_thread_init(&read_thread_ctx, subdir_name,
-                    writer, NULL, BINLOG_BUFFER_SIZE)) != 0)
+                    writer, position, BINLOG_BUFFER_SIZE)) != 0)
     {
         return result;
     }
 
-    logInfo("file: "__FILE__", line: %d, "
-            "loading %s data ...", __LINE__, subdir_name);
+    if (position == NULL) {
+        logInfo("file: "__FILE__", line: %d, "
+                "loading %s data ...", __LINE__, subdir_name);
+    } else {
+        logInfo("file: "__FILE__", line: %d, "
+                "loading %s data from binlog index: %d, offset: %"PRId64
+                " ...", __LINE__, subdir_name, position->index,
+                position->offset);
+    }
 
     parse_ctx.parse_line = parse_line;
     parse_ctx.arg = arg;
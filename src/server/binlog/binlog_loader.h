@@ -80,8 +80,10 @@ typedef int (*binlog_parse_line_func)(BinlogReadThreadResult *r, \
 extern "C" {
 #endif
 
+    /* position: the start position, NULL for the first binlog */
     int binlog_loader_load_ex(const char *subdir_name,
             struct sf_binlog_writer_info *writer,
+            const SFBinlogFilePosition *position,
             binlog_parse_line_func parse_line, void *arg);
 
     static inline int binlog_loader_load(const char *subdir_name,
@@ -89,7 +91,7 @@ extern "C" {
             binlog_parse_line_func parse_line)
     {
         return binlog_loader_load_ex(subdir_name,
-                writer, parse_line, NULL);
+                writer, NULL, parse_line, NULL);
     }
 
 #ifdef __cplusplus
@@ -198,6 +198,9 @@ int binlog_reader_integral_read(ServerBinlogReader *reader, char *buff,
 {
     int result;
     int remain_len;
+    char *p;
+    char *buff_end;
+    char *record_end;
     char *line_end;
 
     if ((result=binlog_read_to_buffer(reader, buff, size,
@@ -206,7 +209,17 @@ int binlog_reader_integral_read(ServerBinlogReader *reader, char *buff,
         return result;
     }
 
-    line_end = (char *)fc_memrchr(buff, '\n', *read_bytes);
+    /* the newline may be within the binary slice record,
+       so search the last complete record from the start */
+    line_end = NULL;
+    p = buff;
+    buff_end = buff + *read_bytes;
+    while (p < buff_end && (record_end=slice_binlog_record_end(
+                    p, buff_end)) != NULL)
+    {
+        line_end = record_end;
+        p = record_end + 1;
+    }
     if (line_end == NULL) {
         int64_t line_count;
 
@@ -33,6 +33,7 @@
 #include "binlog_func.h"
 #include "binlog_reader.h"
 #include "slice_binlog.h"
+#include "slice_checkpoint.h"
 #include "replica_binlog.h"
 #include "binlog_repair.h"
 
@@ -325,7 +326,7 @@ static int binlog_filter_buffer(BinlogRepairContext *ctx,
     line_start = buff;
     buff_end = buff + length;
     while (line_start < buff_end) {
-        line_end = (char *)memchr(line_start, '\n', buff_end - line_start);
+        line_end = slice_binlog_record_end(line_start, buff_end);
         if (line_end == NULL) {
             result = EINVAL;
             sprintf(error_info, "expect line end char (\\n)");
@@ -457,6 +458,8 @@ static int binlog_repair_finish(const int data_group_id,
     int result;
 
     if (data_group_id == 0) {
+        //the position of the checkpoint may be truncated
+        slice_checkpoint_discard();
         writer = slice_binlog_get_writer();
         strcpy(subdir_name, FS_SLICE_BINLOG_SUBDIR_NAME);
     } else {
@@ -47,6 +47,7 @@
 #define BINLOG_SOURCE_RPC_MASTER    'C'  //by user call (master side)
 #define BINLOG_SOURCE_RPC_SLAVE     'c'  //by user call (slave side)
 #define BINLOG_SOURCE_REPLAY        'r'  //by binlog replay  (slave side)
+#define BINLOG_SOURCE_MERGE         'G'  //by background slice merge
 
 #define BINLOG_IS_INTERNAL_RECORD(op_type, data_version)  \
     (op_type == BINLOG_OP_TYPE_NO_OP || data_version == 0)
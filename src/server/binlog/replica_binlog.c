@@ -328,6 +328,14 @@ SFBinlogWriterInfo *replica_binlog_get_writer(const int data_group_id)
         binlog_writer_array.base_id];
 }
 
+int replica_binlog_get_writers(SFBinlogWriterInfo ***writers,
+        int *base_id)
+{
+    *writers = binlog_writer_array.writers;
+    *base_id = binlog_writer_array.base_id;
+    return binlog_writer_array.count;
+}
+
 int replica_binlog_get_current_write_index(const int data_group_id)
 {
     SFBinlogWriterInfo *writer;
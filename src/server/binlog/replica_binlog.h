@@ -54,6 +54,11 @@ extern "C" {
     SFBinlogWriterInfo *replica_binlog_get_writer(
             const int data_group_id);
 
+    /* return the count of the writers array, the element is NULL
+       for the data group not belong to me */
+    int replica_binlog_get_writers(SFBinlogWriterInfo ***writers,
+            int *base_id);
+
     int replica_binlog_get_current_write_index(const int data_group_id);
 
     int replica_binlog_get_first_record(const char *filename,
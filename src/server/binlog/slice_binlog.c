@@ -27,6 +27,8 @@
 #include "../storage/storage_allocator.h"
 #include "../storage/trunk_id_info.h"
 #include "slice_loader.h"
+#include "slice_checkpoint.h"
+#include "slice_binlog_format.h"
 #include "slice_binlog.h"
 
 static SFBinlogWriterContext binlog_writer;
@@ -59,13 +61,23 @@ int slice_binlog_get_current_write_index()
 
 int slice_binlog_init()
 {
+    SFBinlogFilePosition position;
     int result;
 
     if ((result=init_binlog_writer()) != 0) {
         return result;
     }
 
-    return slice_loader_load(&binlog_writer.writer);
+    if ((result=slice_checkpoint_load(&position)) == 0) {
+        result = slice_loader_load_ex(&binlog_writer.writer, &position);
+    } else if (result == ENOENT) {
+        result = slice_loader_load(&binlog_writer.writer);
+    }
+    if (result != 0) {
+        return result;
+    }
+
+    return slice_checkpoint_setup_schedule();
 }
 
 void slice_binlog_destroy()
@@ -73,9 +85,8 @@ void slice_binlog_destroy()
     sf_binlog_writer_finish(&binlog_writer.writer);
 }
 
-int slice_binlog_log_add_slice(const OBSliceEntry *slice,
-        const time_t current_time, const uint64_t sn,
-        const uint64_t data_version, const int source)
+static inline int push_to_binlog_queue(const SliceBinlogFields *fields,
+        const uint64_t sn)
 {
     SFBinlogWriterBuffer *wbuffer;
 
@@ -83,65 +94,67 @@ int slice_binlog_log_add_slice(const OBSliceEntry *slice,
         return ENOMEM;
     }
 
-    wbuffer->tag = data_version;
+    wbuffer->tag = fields->data_version;
     SF_BINLOG_BUFFER_SET_VERSION(wbuffer, sn);
-    wbuffer->bf.length = sprintf(wbuffer->bf.buff,
-            "%"PRId64" %"PRId64" %c %c %"PRId64" %"PRId64" %d %d "
-            "%d %"PRId64" %"PRId64" %"PRId64" %"PRId64"\n",
-            (int64_t)current_time, data_version, source,
-            slice->type == OB_SLICE_TYPE_FILE ?
-            SLICE_BINLOG_OP_TYPE_WRITE_SLICE :
-            SLICE_BINLOG_OP_TYPE_ALLOC_SLICE,
-            slice->ob->bkey.oid, slice->ob->bkey.offset,
-            slice->ssize.offset, slice->ssize.length,
-            slice->space.store->index, slice->space.id_info.id,
-            slice->space.id_info.subdir, slice->space.offset,
-            slice->space.size);
+    wbuffer->bf.length = slice_binlog_pack_record(fields,
+            SLICE_BINLOG_FORMAT, wbuffer->bf.buff);
     sf_push_to_binlog_write_queue(&binlog_writer.writer, wbuffer);
     return 0;
 }
 
-int slice_binlog_log_del_slice(const FSBlockSliceKeyInfo *bs_key,
+int slice_binlog_log_add_slice(const OBSliceEntry *slice,
         const time_t current_time, const uint64_t sn,
         const uint64_t data_version, const int source)
 {
-    SFBinlogWriterBuffer *wbuffer;
+    SliceBinlogFields fields;
 
-    if ((wbuffer=sf_binlog_writer_alloc_buffer(&binlog_writer.thread)) == NULL) {
-        return ENOMEM;
-    }
+    fields.timestamp = current_time;
+    fields.data_version = data_version;
+    fields.source = source;
+    fields.op_type = (slice->type == OB_SLICE_TYPE_FILE ?
+            SLICE_BINLOG_OP_TYPE_WRITE_SLICE :
+            SLICE_BINLOG_OP_TYPE_ALLOC_SLICE);
+    fields.bkey = slice->ob->bkey;
+    fields.slice = slice->ssize;
+    fields.space.path_index = slice->space.store->index;
+    fields.space.trunk_id = slice->space.id_info.id;
+    fields.space.subdir = slice->space.id_info.subdir;
+    fields.space.offset = slice->space.offset;
+    fields.space.size = slice->space.size;
+    fields.has_crc = slice->has_crc;
+    fields.crc32 = slice->crc32;
+    fields.compress_type = slice->compress.type;
+    fields.compress_length = slice->compress.length;
+    return push_to_binlog_queue(&fields, sn);
+}
 
-    wbuffer->tag = data_version;
-    SF_BINLOG_BUFFER_SET_VERSION(wbuffer, sn);
-    wbuffer->bf.length = sprintf(wbuffer->bf.buff,
-            "%"PRId64" %"PRId64" %c %c %"PRId64" %"PRId64" %d %d\n",
-            (int64_t)current_time, data_version, source,
-            SLICE_BINLOG_OP_TYPE_DEL_SLICE, bs_key->block.oid,
-            bs_key->block.offset, bs_key->slice.offset,
-            bs_key->slice.length);
-    sf_push_to_binlog_write_queue(&binlog_writer.writer, wbuffer);
-    return 0;
+int slice_binlog_log_del_slice(const FSBlockSliceKeyInfo *bs_key,
+        const time_t current_time, const uint64_t sn,
+        const uint64_t data_version, const int source)
+{
+    SliceBinlogFields fields;
+
+    fields.timestamp = current_time;
+    fields.data_version = data_version;
+    fields.source = source;
+    fields.op_type = SLICE_BINLOG_OP_TYPE_DEL_SLICE;
+    fields.bkey = bs_key->block;
+    fields.slice = bs_key->slice;
+    return push_to_binlog_queue(&fields, sn);
 }
 
 int slice_binlog_log_del_block(const FSBlockKey *bkey,
         const time_t current_time, const uint64_t sn,
         const uint64_t data_version, const int source)
 {
-    SFBinlogWriterBuffer *wbuffer;
-
-    if ((wbuffer=sf_binlog_writer_alloc_buffer(&binlog_writer.thread)) == NULL) {
-        return ENOMEM;
-    }
-
-    wbuffer->tag = data_version;
-    SF_BINLOG_BUFFER_SET_VERSION(wbuffer, sn);
-    wbuffer->bf.length = sprintf(wbuffer->bf.buff,
-            "%"PRId64" %"PRId64" %c %c %"PRId64" %"PRId64"\n",
-            (int64_t)current_time, data_version, source,
-            SLICE_BINLOG_OP_TYPE_DEL_BLOCK,
-            bkey->oid, bkey->offset);
-    sf_push_to_binlog_write_queue(&binlog_writer.writer, wbuffer);
-    return 0;
+    SliceBinlogFields fields;
+
+    fields.timestamp = current_time;
+    fields.data_version = data_version;
+    fields.source = source;
+    fields.op_type = SLICE_BINLOG_OP_TYPE_DEL_BLOCK;
+    fields.bkey = *bkey;
+    return push_to_binlog_queue(&fields, sn);
 }
 
 void slice_binlog_writer_stat(FSBinlogWriterStat *stat)
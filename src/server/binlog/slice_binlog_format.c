@@ -0,0 +1,463 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include "fastcommon/shared_func.h"
+#include "../../common/fs_crc32c.h"
+#include "../storage/storage_types.h"
+#include "slice_binlog_format.h"
+
+#define TEXT_DEL_BLOCK_FIELD_COUNT          6
+#define TEXT_DEL_SLICE_FIELD_COUNT          8
+#define TEXT_ADD_SLICE_FIELD_COUNT         13
+#define TEXT_ADD_SLICE_WITH_CRC_FIELD_COUNT      14
+#define TEXT_ADD_SLICE_WITH_COMPRESS_FIELD_COUNT 16
+#define TEXT_MAX_FIELD_COUNT               16
+
+#define TEXT_FIELD_INDEX_SPACE_PATH_INDEX   8
+#define TEXT_FIELD_INDEX_SPACE_TRUNK_ID     9
+#define TEXT_FIELD_INDEX_SPACE_SUBDIR      10
+#define TEXT_FIELD_INDEX_SPACE_OFFSET      11
+#define TEXT_FIELD_INDEX_SPACE_SIZE        12
+#define TEXT_FIELD_INDEX_CRC32             13
+#define TEXT_FIELD_INDEX_COMPRESS_TYPE     14
+#define TEXT_FIELD_INDEX_COMPRESS_LENGTH   15
+
+#define TEXT_PARSE_INT(var, caption, index, endchr, min_val) \
+    do {   \
+        value = strtoll(cols[index].str, &endptr, 10);  \
+        if (*endptr != endchr || value < min_val) {     \
+            sprintf(error_info, "invalid %s: %.*s",     \
+                    caption, cols[index].len, cols[index].str); \
+            return EINVAL;  \
+        }  \
+        var = value;  \
+    } while (0)
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+#define PUT_LE16(p, v) do { uint16_t n = v; memcpy(p, &n, 2); } while (0)
+#define PUT_LE32(p, v) do { uint32_t n = v; memcpy(p, &n, 4); } while (0)
+#define PUT_LE64(p, v) do { uint64_t n = v; memcpy(p, &n, 8); } while (0)
+
+static inline uint16_t get_le16(const unsigned char *p)
+{
+    uint16_t n;
+    memcpy(&n, p, 2);
+    return n;
+}
+
+static inline uint32_t get_le32(const unsigned char *p)
+{
+    uint32_t n;
+    memcpy(&n, p, 4);
+    return n;
+}
+
+static inline uint64_t get_le64(const unsigned char *p)
+{
+    uint64_t n;
+    memcpy(&n, p, 8);
+    return n;
+}
+
+#else
+
+static inline void put_le(unsigned char *p, uint64_t v, const int bytes)
+{
+    int i;
+
+    for (i=0; i<bytes; i++) {
+        p[i] = (unsigned char)(v >> (8 * i));
+    }
+}
+
+static inline uint64_t get_le(const unsigned char *p, const int bytes)
+{
+    uint64_t v;
+    int i;
+
+    v = 0;
+    for (i=0; i<bytes; i++) {
+        v |= ((uint64_t)p[i]) << (8 * i);
+    }
+    return v;
+}
+
+#define PUT_LE16(p, v) put_le(p, v, 2)
+#define PUT_LE32(p, v) put_le(p, v, 4)
+#define PUT_LE64(p, v) put_le(p, v, 8)
+#define get_le16(p) ((uint16_t)get_le(p, 2))
+#define get_le32(p) ((uint32_t)get_le(p, 4))
+#define get_le64(p) get_le(p, 8)
+
+#endif
+
+static int pack_binary(const SliceBinlogFields *fields, unsigned char *buff)
+{
+    int size;
+    int crc_offset;
+
+    if ((size=slice_binary_record_size(fields->op_type)) == 0) {
+        return 0;
+    }
+
+    buff[0] = SLICE_BINARY_RECORD_MAGIC;
+    buff[1] = SLICE_BINARY_RECORD_VERSION;
+    buff[2] = fields->op_type;
+    buff[3] = fields->source;
+    PUT_LE32(buff + 4, fields->timestamp);
+    PUT_LE64(buff + 8, fields->data_version);
+    PUT_LE64(buff + 16, fields->bkey.oid);
+    PUT_LE64(buff + 24, fields->bkey.offset);
+    if (size > SLICE_BINARY_DEL_BLOCK_SIZE) {
+        PUT_LE32(buff + 32, fields->slice.offset);
+        PUT_LE32(buff + 36, fields->slice.length);
+    }
+    if (size == SLICE_BINARY_ADD_SLICE_SIZE) {
+        PUT_LE16(buff + 40, fields->space.path_index);
+        buff[42] = fields->has_crc ? SLICE_BINARY_FLAGS_HAS_CRC : 0;
+        buff[43] = fields->compress_type;
+        PUT_LE64(buff + 44, fields->space.trunk_id);
+        PUT_LE32(buff + 52, fields->space.subdir);
+        PUT_LE32(buff + 56, fields->space.offset);
+        PUT_LE32(buff + 60, fields->space.size);
+        PUT_LE32(buff + 64, fields->crc32);
+        PUT_LE32(buff + 68, fields->compress_length);
+    }
+
+    crc_offset = size - SLICE_BINARY_TAIL_SIZE;
+    PUT_LE32(buff + crc_offset, fs_crc32c(0, buff, crc_offset));
+    buff[size - 2] = size;
+    buff[size - 1] = '\n';
+    return size;
+}
+
+static int pack_text(const SliceBinlogFields *fields, char *buff)
+{
+    int len;
+
+    switch (fields->op_type) {
+        case BINLOG_OP_TYPE_WRITE_SLICE:
+        case BINLOG_OP_TYPE_ALLOC_SLICE:
+            break;
+        case BINLOG_OP_TYPE_DEL_SLICE:
+            return sprintf(buff, "%"PRId64" %"PRId64" %c %c %"PRId64" "
+                    "%"PRId64" %d %d\n", (int64_t)fields->timestamp,
+                    fields->data_version, fields->source,
+                    fields->op_type, fields->bkey.oid, fields->bkey.offset,
+                    fields->slice.offset, fields->slice.length);
+        case BINLOG_OP_TYPE_DEL_BLOCK:
+            return sprintf(buff, "%"PRId64" %"PRId64" %c %c %"PRId64" "
+                    "%"PRId64"\n", (int64_t)fields->timestamp,
+                    fields->data_version, fields->source,
+                    fields->op_type, fields->bkey.oid,
+                    fields->bkey.offset);
+        default:
+            return 0;
+    }
+
+    len = sprintf(buff, "%"PRId64" %"PRId64" %c %c %"PRId64" %"PRId64" "
+            "%d %d %d %"PRId64" %"PRId64" %"PRId64" %"PRId64,
+            (int64_t)fields->timestamp, fields->data_version,
+            fields->source, fields->op_type, fields->bkey.oid,
+            fields->bkey.offset, fields->slice.offset, fields->slice.length,
+            fields->space.path_index, fields->space.trunk_id,
+            fields->space.subdir, fields->space.offset, fields->space.size);
+    if (fields->compress_type != FS_COMPRESS_TYPE_NONE) {
+        //the optional fields: crc32 (-1 for none), compress type and length
+        len += sprintf(buff + len, " %"PRId64" %d %d", fields->has_crc ?
+                (int64_t)fields->crc32 : -1, fields->compress_type,
+                fields->compress_length);
+    } else if (fields->has_crc) {  //the optional last field
+        len += sprintf(buff + len, " %u", fields->crc32);
+    }
+    *(buff + len++) = '\n';
+    return len;
+}
+
+int slice_binlog_pack_record(const SliceBinlogFields *fields,
+        const int format, char *buff)
+{
+    if (format == SLICE_BINLOG_FORMAT_BINARY) {
+        return pack_binary(fields, (unsigned char *)buff);
+    } else {
+        return pack_text(fields, buff);
+    }
+}
+
+static inline bool check_binary_record(const unsigned char *p, const int size)
+{
+    int crc_offset;
+
+    crc_offset = size - SLICE_BINARY_TAIL_SIZE;
+    return get_le32(p + crc_offset) == fs_crc32c(0, p, crc_offset);
+}
+
+static int unpack_binary(const string_t *record,
+        SliceBinlogFields *fields, char *error_info)
+{
+    const unsigned char *p;
+    int size;
+
+    p = (const unsigned char *)record->str;
+    if (record->len < SLICE_BINARY_HEADER_SIZE) {
+        sprintf(error_info, "binary record length: %d is too short",
+                record->len);
+        return EINVAL;
+    }
+    if (p[1] != SLICE_BINARY_RECORD_VERSION) {
+        sprintf(error_info, "unsupported binary record version: %d",
+                p[1]);
+        return EINVAL;
+    }
+    if ((size=slice_binary_record_size(p[2])) == 0) {
+        sprintf(error_info, "invalid op_type: 0x%02x", p[2]);
+        return EINVAL;
+    }
+
+    //the length may exclude the newline
+    if (!(record->len == size || record->len == size - 1) ||
+            p[size - 2] != size)
+    {
+        sprintf(error_info, "binary record length: %d != %d",
+                record->len, size);
+        return EINVAL;
+    }
+    if (!check_binary_record(p, size)) {
+        sprintf(error_info, "binary record checksum mismatch");
+        return EINVAL;
+    }
+
+    fields->op_type = p[2];
+    fields->source = p[3];
+    fields->timestamp = get_le32(p + 4);
+    fields->data_version = get_le64(p + 8);
+    fields->bkey.oid = get_le64(p + 16);
+    fields->bkey.offset = get_le64(p + 24);
+    if (size > SLICE_BINARY_DEL_BLOCK_SIZE) {
+        fields->slice.offset = get_le32(p + 32);
+        fields->slice.length = get_le32(p + 36);
+    }
+    if (size == SLICE_BINARY_ADD_SLICE_SIZE) {
+        fields->space.path_index = get_le16(p + 40);
+        fields->has_crc = (p[42] & SLICE_BINARY_FLAGS_HAS_CRC) != 0;
+        fields->compress_type = p[43];
+        fields->space.trunk_id = get_le64(p + 44);
+        fields->space.subdir = get_le32(p + 52);
+        fields->space.offset = get_le32(p + 56);
+        fields->space.size = get_le32(p + 60);
+        fields->crc32 = get_le32(p + 64);
+        fields->compress_length = get_le32(p + 68);
+    }
+    return 0;
+}
+
+static int unpack_text_add_slice(string_t *cols, const int count,
+        SliceBinlogFields *fields, char *error_info)
+{
+    char *endptr;
+    int64_t value;
+
+    if (!(count == TEXT_ADD_SLICE_FIELD_COUNT ||
+                count == TEXT_ADD_SLICE_WITH_CRC_FIELD_COUNT ||
+                count == TEXT_ADD_SLICE_WITH_COMPRESS_FIELD_COUNT))
+    {
+        sprintf(error_info, "field count: %d != %d",
+                count, TEXT_ADD_SLICE_FIELD_COUNT);
+        return EINVAL;
+    }
+
+    TEXT_PARSE_INT(fields->slice.offset, "slice offset",
+            BINLOG_COMMON_FIELD_INDEX_SLICE_OFFSET, ' ', 0);
+    TEXT_PARSE_INT(fields->slice.length, "slice length",
+            BINLOG_COMMON_FIELD_INDEX_SLICE_LENGTH, ' ', 1);
+    TEXT_PARSE_INT(fields->space.path_index, "path_index",
+            TEXT_FIELD_INDEX_SPACE_PATH_INDEX, ' ', 0);
+    TEXT_PARSE_INT(fields->space.trunk_id, "trunk_id",
+            TEXT_FIELD_INDEX_SPACE_TRUNK_ID, ' ', 1);
+    TEXT_PARSE_INT(fields->space.subdir, "subdir",
+            TEXT_FIELD_INDEX_SPACE_SUBDIR, ' ', 1);
+    TEXT_PARSE_INT(fields->space.offset, "space offset",
+            TEXT_FIELD_INDEX_SPACE_OFFSET, ' ', 0);
+    fields->compress_type = FS_COMPRESS_TYPE_NONE;
+    fields->compress_length = 0;
+    if (count == TEXT_ADD_SLICE_FIELD_COUNT) {
+        TEXT_PARSE_INT(fields->space.size, "space size",
+                TEXT_FIELD_INDEX_SPACE_SIZE, '\n', 0);
+        fields->has_crc = false;
+        fields->crc32 = 0;
+    } else if (count == TEXT_ADD_SLICE_WITH_CRC_FIELD_COUNT) {
+        TEXT_PARSE_INT(fields->space.size, "space size",
+                TEXT_FIELD_INDEX_SPACE_SIZE, ' ', 0);
+        TEXT_PARSE_INT(fields->crc32, "crc32",
+                TEXT_FIELD_INDEX_CRC32, '\n', 0);
+        fields->has_crc = true;
+    } else {
+        TEXT_PARSE_INT(fields->space.size, "space size",
+                TEXT_FIELD_INDEX_SPACE_SIZE, ' ', 0);
+        TEXT_PARSE_INT(value, "crc32", TEXT_FIELD_INDEX_CRC32, ' ', -1);
+        fields->has_crc = (value >= 0);
+        fields->crc32 = fields->has_crc ? value : 0;
+        TEXT_PARSE_INT(fields->compress_type, "compress type",
+                TEXT_FIELD_INDEX_COMPRESS_TYPE, ' ', FS_COMPRESS_TYPE_LZ4);
+        TEXT_PARSE_INT(fields->compress_length, "compress length",
+                TEXT_FIELD_INDEX_COMPRESS_LENGTH, '\n', 1);
+    }
+    return 0;
+}
+
+static int unpack_text(const string_t *record,
+        SliceBinlogFields *fields, char *error_info)
+{
+    int count;
+    char *endptr;
+    int64_t value;
+    string_t cols[TEXT_MAX_FIELD_COUNT];
+
+    count = split_string_ex(record, ' ', cols,
+            TEXT_MAX_FIELD_COUNT, false);
+    if (count < TEXT_DEL_BLOCK_FIELD_COUNT) {
+        sprintf(error_info, "field count: %d < %d",
+                count, TEXT_DEL_BLOCK_FIELD_COUNT);
+        return EINVAL;
+    }
+
+    TEXT_PARSE_INT(fields->timestamp, "timestamp",
+            BINLOG_COMMON_FIELD_INDEX_TIMESTAMP, ' ', 0);
+    TEXT_PARSE_INT(fields->data_version, "data version",
+            BINLOG_COMMON_FIELD_INDEX_DATA_VERSION, ' ', 0);
+    fields->source = cols[BINLOG_COMMON_FIELD_INDEX_SOURCE].str[0];
+    fields->op_type = cols[BINLOG_COMMON_FIELD_INDEX_OP_TYPE].str[0];
+    TEXT_PARSE_INT(fields->bkey.oid, "object ID",
+            BINLOG_COMMON_FIELD_INDEX_BLOCK_OID, ' ', 1);
+    switch (fields->op_type) {
+        case BINLOG_OP_TYPE_WRITE_SLICE:
+        case BINLOG_OP_TYPE_ALLOC_SLICE:
+            TEXT_PARSE_INT(fields->bkey.offset, "block offset",
+                    BINLOG_COMMON_FIELD_INDEX_BLOCK_OFFSET, ' ', 0);
+            return unpack_text_add_slice(cols, count, fields, error_info);
+        case BINLOG_OP_TYPE_DEL_SLICE:
+            if (count != TEXT_DEL_SLICE_FIELD_COUNT) {
+                sprintf(error_info, "field count: %d != %d",
+                        count, TEXT_DEL_SLICE_FIELD_COUNT);
+                return EINVAL;
+            }
+            TEXT_PARSE_INT(fields->bkey.offset, "block offset",
+                    BINLOG_COMMON_FIELD_INDEX_BLOCK_OFFSET, ' ', 0);
+            TEXT_PARSE_INT(fields->slice.offset, "slice offset",
+                    BINLOG_COMMON_FIELD_INDEX_SLICE_OFFSET, ' ', 0);
+            TEXT_PARSE_INT(fields->slice.length, "slice length",
+                    BINLOG_COMMON_FIELD_INDEX_SLICE_LENGTH, '\n', 1);
+            return 0;
+        case BINLOG_OP_TYPE_DEL_BLOCK:
+            if (count != TEXT_DEL_BLOCK_FIELD_COUNT) {
+                sprintf(error_info, "field count: %d != %d",
+                        count, TEXT_DEL_BLOCK_FIELD_COUNT);
+                return EINVAL;
+            }
+            TEXT_PARSE_INT(fields->bkey.offset, "block offset",
+                    BINLOG_COMMON_FIELD_INDEX_BLOCK_OFFSET, '\n', 0);
+            return 0;
+        default:
+            sprintf(error_info, "invalid op_type: %c (0x%02x)",
+                    fields->op_type, (unsigned char)fields->op_type);
+            return EINVAL;
+    }
+}
+
+int slice_binlog_unpack_record(const string_t *record,
+        SliceBinlogFields *fields, char *error_info)
+{
+    if (record->len > 0 && slice_binlog_is_binary_record(record->str)) {
+        return unpack_binary(record, fields, error_info);
+    } else {
+        return unpack_text(record, fields, error_info);
+    }
+}
+
+/* the text line: begins with the timestamp digit, all printable chars
+   and with the fields of the delete block record at least */
+static bool is_text_line(const char *start, const char *end)
+{
+    const char *p;
+    int spaces;
+
+    if (start == end || !(*start >= '0' && *start <= '9')) {
+        return false;
+    }
+
+    spaces = 0;
+    for (p=start; p<end; p++) {
+        if (*p == ' ') {
+            spaces++;
+        } else if (*p < ' ' || *p > '~') {
+            return false;
+        }
+    }
+    return spaces >= TEXT_DEL_BLOCK_FIELD_COUNT - 1;
+}
+
+int slice_binlog_get_last_record(const char *buff, const int length,
+        const bool at_file_start, string_t *record)
+{
+    const char *p;
+    const char *start;
+    int size;
+
+    for (p=buff + length - 1; p>=buff; p--) {
+        if (*p != '\n') {
+            continue;
+        }
+
+        //the binary record ends here
+        if (p > buff) {
+            size = (unsigned char)p[-1];
+            start = p + 1 - size;
+            if (size > SLICE_BINARY_HEADER_SIZE && start >= buff &&
+                    slice_binlog_is_binary_record(start) &&
+                    start[1] == SLICE_BINARY_RECORD_VERSION &&
+                    slice_binary_record_size(start[2]) == size &&
+                    check_binary_record((const unsigned char *)start, size))
+            {
+                record->str = (char *)start;
+                record->len = size;
+                return 0;
+            }
+        }
+
+        /* the newline within the torn binary record at the file end
+           is NOT a text line end */
+        start = (const char *)fc_memrchr(buff, '\n', p - buff);
+        if (start != NULL) {
+            start++;
+        } else if (at_file_start) {
+            start = buff;
+        } else {
+            break;
+        }
+        if (is_text_line(start, p)) {
+            record->str = (char *)start;
+            record->len = (p + 1) - start;
+            return 0;
+        }
+    }
+
+    return ENOENT;
+}
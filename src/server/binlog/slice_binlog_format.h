@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//slice_binlog_format.h
+
+#ifndef _SLICE_BINLOG_FORMAT_H
+#define _SLICE_BINLOG_FORMAT_H
+
+#include <string.h>
+#include "fastcommon/common_define.h"
+#include "../../common/fs_types.h"
+#include "binlog_types.h"
+
+#define SLICE_BINLOG_FORMAT_TEXT     't'
+#define SLICE_BINLOG_FORMAT_BINARY   'b'
+
+/* the binary record with the fixed-width little-endian fields:
+     magic (1), version (1), op_type (1), source (1),
+     timestamp (4), data_version (8), oid (8), block offset (8),
+     [slice offset (4), slice length (4),]  //for the slice records
+     [path index (2), flags (1), compress type (1), trunk id (8),
+      subdir (4), space offset (4), space size (4), crc32 (4),
+      compress length (4),]                 //for the add slice records
+     CRC32C of the above (4), record size (1), '\n' (1)
+   the text record begins with the timestamp digit, so the text and the
+   binary records can be mixed in one binlog file. the record size before
+   the newline is for the backward search from the file end */
+#define SLICE_BINARY_RECORD_MAGIC    0xFB
+#define SLICE_BINARY_RECORD_VERSION  1
+
+#define SLICE_BINARY_HEADER_SIZE        4
+#define SLICE_BINARY_TAIL_SIZE          6
+#define SLICE_BINARY_DEL_BLOCK_SIZE    38
+#define SLICE_BINARY_DEL_SLICE_SIZE    46
+#define SLICE_BINARY_ADD_SLICE_SIZE    78
+
+#define SLICE_BINARY_FLAGS_HAS_CRC   1
+
+typedef struct slice_binlog_fields {
+    time_t timestamp;
+    int64_t data_version;
+    char source;
+    char op_type;
+    FSBlockKey bkey;    //the hash code is NOT set
+    FSSliceSize slice;  //for the slice records
+    struct {
+        int path_index;
+        int64_t trunk_id;
+        int64_t subdir;
+        int64_t offset;
+        int64_t size;
+    } space;            //for the add slice records
+    bool has_crc;
+    uint32_t crc32;
+    char compress_type;
+    int compress_length;
+} SliceBinlogFields;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    static inline bool slice_binlog_is_binary_record(const char *record)
+    {
+        return (unsigned char)*record == SLICE_BINARY_RECORD_MAGIC;
+    }
+
+    //return 0 for the invalid op type
+    static inline int slice_binary_record_size(const int op_type)
+    {
+        switch (op_type) {
+            case BINLOG_OP_TYPE_WRITE_SLICE:
+            case BINLOG_OP_TYPE_ALLOC_SLICE:
+                return SLICE_BINARY_ADD_SLICE_SIZE;
+            case BINLOG_OP_TYPE_DEL_SLICE:
+                return SLICE_BINARY_DEL_SLICE_SIZE;
+            case BINLOG_OP_TYPE_DEL_BLOCK:
+                return SLICE_BINARY_DEL_BLOCK_SIZE;
+            default:
+                return 0;
+        }
+    }
+
+    /* return the newline of the record which begins at start,
+       NULL when the record is incomplete.
+       the binary record of the unknown version or op type is searched
+       as the text record, then reported by the unpack */
+    static inline char *slice_binlog_record_end(char *start, char *end)
+    {
+        int size;
+
+        if (slice_binlog_is_binary_record(start)) {
+            if (end - start < SLICE_BINARY_HEADER_SIZE) {
+                return NULL;
+            }
+
+            if (start[1] == SLICE_BINARY_RECORD_VERSION &&
+                    (size=slice_binary_record_size(start[2])) > 0)
+            {
+                return (end - start >= size) ? start + size - 1 : NULL;
+            }
+        }
+
+        return (char *)memchr(start, '\n', end - start);
+    }
+
+    /* pack the record to the buffer in the format, the size of the buffer
+       should be FS_SLICE_BINLOG_MAX_RECORD_SIZE at least.
+       return the record length including the newline */
+    int slice_binlog_pack_record(const SliceBinlogFields *fields,
+            const int format, char *buff);
+
+    /* unpack the text or binary record, the record length may exclude the
+       newline which must follow the record in the buffer */
+    int slice_binlog_unpack_record(const string_t *record,
+            SliceBinlogFields *fields, char *error_info);
+
+    /* get the last complete record of the buffer which is the tail of
+       the binlog file, at_file_start: if the buffer is the file start.
+       return ENOENT when no complete record */
+    int slice_binlog_get_last_record(const char *buff, const int length,
+            const bool at_file_start, string_t *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,751 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* the checkpoint is the dump of the slice index tagged with the slice binlog
+   position taken before the dump starts. the dump is fuzzy (one shared
+   context at a time), it is still correct because replaying the slice
+   binlog is last-writer-wins per byte, so replaying the records after
+   the position over the checkpoint gets the same index as the full replay.
+   the file is in the native byte order, it is NOT for another host */
+
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/fast_buffer.h"
+#include "fastcommon/sched_thread.h"
+#include "sf/sf_global.h"
+#include "../../common/fs_func.h"
+#include "../../common/fs_crc32c.h"
+#include "../server_global.h"
+#include "../shared_thread_pool.h"
+#include "../storage/object_block_index.h"
+#include "binlog_reader.h"
+#include "slice_binlog.h"
+#include "slice_binlog_format.h"
+#include "slice_checkpoint.h"
+
+#define SLICE_CHECKPOINT_MAGIC    0x46534350  //FSCP
+#define SLICE_CHECKPOINT_VERSION  1
+
+#define SLICE_CHECKPOINT_IO_BUFFER_SIZE   (1024 * 1024)
+#define SLICE_CHECKPOINT_WRITE_CHUNK_SIZE (256 * 1024)
+#define SLICE_CHECKPOINT_TAIL_READ_SIZE   4096
+#define SLICE_CHECKPOINT_LOAD_BATCH       64
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t binlog_index;
+    int32_t padding;
+    int64_t binlog_offset;
+    int64_t create_time;
+} SliceCheckpointHeader;
+
+typedef struct {
+    int64_t oid;
+    int64_t offset;
+    int64_t slice_count;
+} SliceCheckpointBlock;
+
+typedef struct {
+    int64_t trunk_id;
+    int64_t subdir;
+    int64_t space_offset;
+    int64_t space_size;
+    int32_t path_index;
+    int32_t offset;  //slice offset
+    int32_t length;  //slice length
+    uint32_t crc32;
+    int32_t compress_length;
+    int32_t compress_offset;
+    char type;
+    char has_crc;
+    char compress_type;
+    char padding[5];
+} SliceCheckpointSlice;
+
+typedef struct {
+    int64_t ob_count;
+    int64_t slice_count;
+    uint32_t magic;
+    uint32_t crc32;   //CRC32C of the data before the trailer
+} SliceCheckpointTrailer;
+
+typedef struct {
+    int fd;
+    uint32_t crc32;
+    int64_t written;
+    int64_t start_time_ms;
+    int64_t ob_count;
+    int64_t slice_count;
+    FastBuffer buffer;
+    char filename[PATH_MAX];
+} SliceCheckpointWriter;
+
+typedef struct {
+    int fd;
+    int offset;   //the read offset of the buffer
+    int length;   //the data length of the buffer
+    char *buff;
+    char filename[PATH_MAX];
+} SliceCheckpointReader;
+
+static struct {
+    volatile bool in_progress;
+    volatile bool discarded;
+} checkpoint_ctx = {false, false};
+
+static inline void get_checkpoint_filename(char *filename, const int size)
+{
+    snprintf(filename, size, "%s/%s/%s", DATA_PATH_STR,
+            FS_SLICE_BINLOG_SUBDIR_NAME, SLICE_CHECKPOINT_FILENAME);
+}
+
+/* the position is aligned to the last complete line of
+   the current binlog file, all records before it are in the index */
+static int get_binlog_position(SFBinlogFilePosition *position)
+{
+    char filename[PATH_MAX];
+    char buff[SLICE_CHECKPOINT_TAIL_READ_SIZE];
+    int64_t file_size;
+    int read_size;
+    int fd;
+    int result;
+    string_t record;
+
+    position->index = slice_binlog_get_current_write_index();
+    position->offset = 0;
+    binlog_reader_get_filename(FS_SLICE_BINLOG_SUBDIR_NAME,
+            position->index, filename, sizeof(filename));
+    if ((fd=open(filename, O_RDONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        if (result == ENOENT) {
+            return 0;
+        }
+        logError("file: "__FILE__", line: %d, "
+                "open file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        return result;
+    }
+
+    if ((file_size=lseek(fd, 0, SEEK_END)) < 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "lseek file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        close(fd);
+        return result;
+    }
+
+    read_size = FC_MIN(file_size, sizeof(buff));
+    if (read_size > 0 && pread(fd, buff, read_size,
+                file_size - read_size) != read_size)
+    {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "read file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        close(fd);
+        return result;
+    }
+    close(fd);
+
+    /* the newline may be within the binary record, search the record.
+       no complete record in the tail, replay the whole file is also OK */
+    if (slice_binlog_get_last_record(buff, read_size, read_size ==
+                file_size, &record) == 0)
+    {
+        position->offset = file_size - read_size +
+            (record.str + record.len - buff);
+    }
+
+    return 0;
+}
+
+static int check_binlog_position(const SFBinlogFilePosition *position)
+{
+    char filename[PATH_MAX];
+    struct stat stbuf;
+    int fd;
+    int result;
+    char ch;
+
+    if (position->index > slice_binlog_get_current_write_index()) {
+        logWarning("file: "__FILE__", line: %d, "
+                "checkpoint binlog index: %d > current write index: %d",
+                __LINE__, position->index,
+                slice_binlog_get_current_write_index());
+        return EINVAL;
+    }
+
+    if (position->offset == 0) {
+        return 0;
+    }
+
+    binlog_reader_get_filename(FS_SLICE_BINLOG_SUBDIR_NAME,
+            position->index, filename, sizeof(filename));
+    if ((fd=open(filename, O_RDONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        logWarning("file: "__FILE__", line: %d, "
+                "open file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, filename, result, STRERROR(result));
+        return result;
+    }
+
+    if (fstat(fd, &stbuf) != 0 || stbuf.st_size < position->offset ||
+            pread(fd, &ch, 1, position->offset - 1) != 1 || ch != '\n')
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "binlog file \"%s\" NOT match the checkpoint "
+                "binlog offset: %"PRId64, __LINE__, filename,
+                position->offset);
+        close(fd);
+        return EINVAL;
+    }
+
+    close(fd);
+    return 0;
+}
+
+static int writer_write(SliceCheckpointWriter *writer,
+        const char *data, const int length)
+{
+    const char *p;
+    const char *end;
+    int size;
+    int64_t expect_ms;
+    int64_t elapsed_ms;
+    int result;
+
+    end = data + length;
+    for (p=data; p<end; p+=size) {
+        size = FC_MIN(end - p, SLICE_CHECKPOINT_WRITE_CHUNK_SIZE);
+        if (fc_safe_write(writer->fd, p, size) != size) {
+            result = errno != 0 ? errno : EIO;
+            logError("file: "__FILE__", line: %d, "
+                    "write to file \"%s\" fail, errno: %d, error info: %s",
+                    __LINE__, writer->filename, result, STRERROR(result));
+            return result;
+        }
+
+        writer->crc32 = fs_crc32c(writer->crc32, p, size);
+        writer->written += size;
+        if (SLICE_CHECKPOINT_WRITE_SPEED > 0) {
+            expect_ms = writer->written * 1000 / SLICE_CHECKPOINT_WRITE_SPEED;
+            elapsed_ms = get_current_time_ms() - writer->start_time_ms;
+            if (expect_ms > elapsed_ms) {
+                fc_sleep_ms(expect_ms - elapsed_ms);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int dump_ob_entry(OBEntry *ob, void *args)
+{
+    SliceCheckpointWriter *writer;
+    SliceCheckpointBlock block;
+    SliceCheckpointSlice record;
+    OBSliceMapIterator it;
+    OBSliceEntry *slice;
+    int result;
+
+    if (ob_slice_map_empty(&ob->slices)) {
+        return 0;
+    }
+
+    writer = (SliceCheckpointWriter *)args;
+    block.oid = ob->bkey.oid;
+    block.offset = ob->bkey.offset;
+    block.slice_count = ob->slices.count;
+    if ((result=fast_buffer_append_buff(&writer->buffer,
+                    (char *)&block, sizeof(block))) != 0)
+    {
+        return result;
+    }
+
+    memset(&record, 0, sizeof(record));
+    ob_slice_map_iterator(&ob->slices, &it);
+    while ((slice=ob_slice_map_next(&it)) != NULL) {
+        record.trunk_id = slice->space.id_info.id;
+        record.subdir = slice->space.id_info.subdir;
+        record.space_offset = slice->space.offset;
+        record.space_size = slice->space.size;
+        record.path_index = slice->space.store->index;
+        record.offset = slice->ssize.offset;
+        record.length = slice->ssize.length;
+        record.crc32 = slice->crc32;
+        record.compress_length = slice->compress.length;
+        record.compress_offset = slice->compress.offset;
+        record.type = slice->type;
+        record.has_crc = slice->has_crc;
+        record.compress_type = slice->compress.type;
+        if ((result=fast_buffer_append_buff(&writer->buffer,
+                        (char *)&record, sizeof(record))) != 0)
+        {
+            return result;
+        }
+    }
+
+    writer->ob_count++;
+    writer->slice_count += ob->slices.count;
+    return 0;
+}
+
+static int dump_index(SliceCheckpointWriter *writer)
+{
+    int ctx_count;
+    int ctx_index;
+    int result;
+
+    /* one shared context at a time, the lock is released before
+       writing to the file */
+    ctx_count = ob_index_get_shared_ctx_count();
+    for (ctx_index=0; ctx_index<ctx_count; ctx_index++) {
+        if (checkpoint_ctx.discarded) {
+            return ECANCELED;
+        }
+
+        writer->buffer.length = 0;
+        if ((result=ob_index_walk_shared_ctx(&g_ob_hashtable,
+                        ctx_index, dump_ob_entry, writer)) != 0)
+        {
+            return result;
+        }
+
+        if ((result=writer_write(writer, writer->buffer.data,
+                        writer->buffer.length)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static int write_checkpoint(SliceCheckpointWriter *writer,
+        const SFBinlogFilePosition *position)
+{
+    SliceCheckpointHeader header;
+    SliceCheckpointTrailer trailer;
+    int result;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = SLICE_CHECKPOINT_MAGIC;
+    header.version = SLICE_CHECKPOINT_VERSION;
+    header.binlog_index = position->index;
+    header.binlog_offset = position->offset;
+    header.create_time = g_current_time;
+    if ((result=writer_write(writer, (char *)&header,
+                    sizeof(header))) != 0)
+    {
+        return result;
+    }
+
+    if ((result=dump_index(writer)) != 0) {
+        return result;
+    }
+
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.ob_count = writer->ob_count;
+    trailer.slice_count = writer->slice_count;
+    trailer.magic = SLICE_CHECKPOINT_MAGIC;
+    trailer.crc32 = writer->crc32;
+    if ((result=writer_write(writer, (char *)&trailer,
+                    sizeof(trailer))) != 0)
+    {
+        return result;
+    }
+
+    if (fsync(writer->fd) != 0) {
+        result = errno != 0 ? errno : EIO;
+        logError("file: "__FILE__", line: %d, "
+                "fsync file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, writer->filename, result, STRERROR(result));
+        return result;
+    }
+
+    return 0;
+}
+
+static int save_checkpoint()
+{
+    SliceCheckpointWriter writer;
+    SFBinlogFilePosition position;
+    char filename[PATH_MAX];
+    int result;
+
+    if ((result=get_binlog_position(&position)) != 0) {
+        return result;
+    }
+
+    memset(&writer, 0, sizeof(writer));
+    if ((result=fast_buffer_init_ex(&writer.buffer,
+                    SLICE_CHECKPOINT_IO_BUFFER_SIZE)) != 0)
+    {
+        return result;
+    }
+
+    get_checkpoint_filename(filename, sizeof(filename));
+    snprintf(writer.filename, sizeof(writer.filename), "%s.tmp", filename);
+    if ((writer.fd=open(writer.filename, O_WRONLY | O_CREAT |
+                    O_TRUNC, 0644)) < 0)
+    {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, writer.filename, result, STRERROR(result));
+        fast_buffer_destroy(&writer.buffer);
+        return result;
+    }
+
+    writer.start_time_ms = get_current_time_ms();
+    result = write_checkpoint(&writer, &position);
+    close(writer.fd);
+    fast_buffer_destroy(&writer.buffer);
+
+    if (result == 0 && checkpoint_ctx.discarded) {
+        result = ECANCELED;
+    }
+    if (result != 0) {
+        unlink(writer.filename);
+        return result;
+    }
+
+    if (rename(writer.filename, filename) != 0) {
+        result = errno != 0 ? errno : EPERM;
+        logError("file: "__FILE__", line: %d, "
+                "rename file %s to %s fail, "
+                "errno: %d, error info: %s",
+                __LINE__, writer.filename, filename,
+                result, STRERROR(result));
+        unlink(writer.filename);
+        return result;
+    }
+
+    logInfo("file: "__FILE__", line: %d, "
+            "save slice checkpoint done, binlog index: %d, "
+            "offset: %"PRId64", object block count: %"PRId64", "
+            "slice count: %"PRId64", file size: %"PRId64", "
+            "time used: %"PRId64" ms", __LINE__, position.index,
+            position.offset, writer.ob_count, writer.slice_count,
+            writer.written, get_current_time_ms() - writer.start_time_ms);
+    return 0;
+}
+
+static void save_thread_run(void *arg, void *thread_data)
+{
+    save_checkpoint();
+    checkpoint_ctx.in_progress = false;
+}
+
+static int checkpoint_schedule_func(void *args)
+{
+    if (checkpoint_ctx.discarded) {
+        return 0;
+    }
+
+    if (__sync_bool_compare_and_swap(&checkpoint_ctx.in_progress,
+                false, true))
+    {
+        if (shared_thread_pool_run(save_thread_run, NULL) != 0) {
+            checkpoint_ctx.in_progress = false;
+        }
+    }
+
+    return 0;
+}
+
+int slice_checkpoint_setup_schedule()
+{
+    ScheduleEntry schedule_entry;
+    ScheduleArray schedule_array;
+
+    if (SLICE_CHECKPOINT_INTERVAL <= 0) {
+        return 0;
+    }
+
+    INIT_SCHEDULE_ENTRY(schedule_entry, sched_generate_next_id(),
+            0, 0, 0, SLICE_CHECKPOINT_INTERVAL,
+            checkpoint_schedule_func, NULL);
+    schedule_array.count = 1;
+    schedule_array.entries = &schedule_entry;
+    return sched_add_entries(&schedule_array);
+}
+
+void slice_checkpoint_discard()
+{
+    char filename[PATH_MAX];
+
+    checkpoint_ctx.discarded = true;
+    while (checkpoint_ctx.in_progress) {
+        fc_sleep_ms(100);
+    }
+
+    get_checkpoint_filename(filename, sizeof(filename));
+    if (unlink(filename) != 0 && errno != ENOENT) {
+        logError("file: "__FILE__", line: %d, "
+                "unlink file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, filename, errno, STRERROR(errno));
+    }
+}
+
+static int reader_read(SliceCheckpointReader *reader,
+        void *dest, const int size)
+{
+    int remain;
+    int bytes;
+
+    remain = reader->length - reader->offset;
+    if (remain < size) {
+        if (remain > 0) {
+            memmove(reader->buff, reader->buff + reader->offset, remain);
+        }
+        reader->offset = 0;
+        reader->length = remain;
+        while (reader->length < size) {
+            bytes = read(reader->fd, reader->buff + reader->length,
+                    SLICE_CHECKPOINT_IO_BUFFER_SIZE - reader->length);
+            if (bytes <= 0) {
+                logError("file: "__FILE__", line: %d, "
+                        "read from file \"%s\" fail, errno: %d, "
+                        "error info: %s", __LINE__, reader->filename,
+                        errno != 0 ? errno : EIO,
+                        STRERROR(errno != 0 ? errno : EIO));
+                return bytes == 0 ? ENODATA : (errno != 0 ? errno : EIO);
+            }
+            reader->length += bytes;
+        }
+    }
+
+    memcpy(dest, reader->buff + reader->offset, size);
+    reader->offset += size;
+    return 0;
+}
+
+static int check_checkpoint_file(SliceCheckpointReader *reader,
+        SliceCheckpointHeader *header, SliceCheckpointTrailer *trailer)
+{
+    struct stat stbuf;
+    int64_t remain;
+    int64_t expect_size;
+    uint32_t crc32;
+    int bytes;
+
+    if (fstat(reader->fd, &stbuf) != 0 || stbuf.st_size <
+            (int64_t)(sizeof(*header) + sizeof(*trailer)))
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "checkpoint file \"%s\" is too small",
+                __LINE__, reader->filename);
+        return EINVAL;
+    }
+
+    if (pread(reader->fd, header, sizeof(*header), 0) != sizeof(*header) ||
+            pread(reader->fd, trailer, sizeof(*trailer), stbuf.st_size -
+                sizeof(*trailer)) != sizeof(*trailer))
+    {
+        return errno != 0 ? errno : EIO;
+    }
+
+    expect_size = sizeof(*header) + sizeof(SliceCheckpointBlock) *
+        trailer->ob_count + sizeof(SliceCheckpointSlice) *
+        trailer->slice_count + sizeof(*trailer);
+    if (header->magic != SLICE_CHECKPOINT_MAGIC || header->version !=
+            SLICE_CHECKPOINT_VERSION || trailer->magic !=
+            SLICE_CHECKPOINT_MAGIC || expect_size != stbuf.st_size)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "invalid checkpoint file \"%s\", magic: 0x%08x, "
+                "version: %u, file size: %"PRId64" != expect: %"PRId64,
+                __LINE__, reader->filename, header->magic, header->version,
+                (int64_t)stbuf.st_size, expect_size);
+        return EINVAL;
+    }
+
+    crc32 = 0;
+    remain = stbuf.st_size - sizeof(*trailer);
+    while (remain > 0) {
+        bytes = read(reader->fd, reader->buff, FC_MIN(remain,
+                    SLICE_CHECKPOINT_IO_BUFFER_SIZE));
+        if (bytes <= 0) {
+            return errno != 0 ? errno : EIO;
+        }
+        crc32 = fs_crc32c(crc32, reader->buff, bytes);
+        remain -= bytes;
+    }
+
+    if (crc32 != trailer->crc32) {
+        logWarning("file: "__FILE__", line: %d, "
+                "checkpoint file \"%s\", CRC32C: %08x != expect: %08x",
+                __LINE__, reader->filename, crc32, trailer->crc32);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+static int load_slice(const FSBlockKey *bkey,
+        const SliceCheckpointSlice *record, OBSliceEntry **slice)
+{
+
+    if (record->path_index < 0 || record->path_index >
+            STORAGE_CFG.max_store_path_index ||
+            PATHS_BY_INDEX_PPTR[record->path_index] == NULL)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "checkpoint slice path_index: %d not exist",
+                __LINE__, record->path_index);
+        return ENOENT;
+    }
+
+    if ((*slice=ob_index_alloc_slice(bkey)) == NULL) {
+        return ENOMEM;
+    }
+
+    (*slice)->type = record->type;
+    (*slice)->ssize.offset = record->offset;
+    (*slice)->ssize.length = record->length;
+    (*slice)->space.store = &PATHS_BY_INDEX_PPTR[
+        record->path_index]->store;
+    (*slice)->space.id_info.id = record->trunk_id;
+    (*slice)->space.id_info.subdir = record->subdir;
+    (*slice)->space.offset = record->space_offset;
+    (*slice)->space.size = record->space_size;
+    (*slice)->crc32 = record->crc32;
+    (*slice)->has_crc = record->has_crc;
+    (*slice)->compress.type = record->compress_type;
+    (*slice)->compress.length = record->compress_length;
+    (*slice)->compress.offset = record->compress_offset;
+    return 0;
+}
+
+static int load_index(SliceCheckpointReader *reader,
+        const SliceCheckpointTrailer *trailer)
+{
+    SliceCheckpointBlock block;
+    SliceCheckpointSlice record;
+    FSBlockKey bkey;
+    OBSliceEntry *slices[SLICE_CHECKPOINT_LOAD_BATCH];
+    int64_t ob_index;
+    int64_t i;
+    int count;
+    int result;
+
+    if (lseek(reader->fd, sizeof(SliceCheckpointHeader), SEEK_SET) < 0) {
+        return errno != 0 ? errno : EIO;
+    }
+    reader->offset = reader->length = 0;
+
+    for (ob_index=0; ob_index<trailer->ob_count; ob_index++) {
+        if ((result=reader_read(reader, &block, sizeof(block))) != 0) {
+            return result;
+        }
+
+        bkey.oid = block.oid;
+        bkey.offset = block.offset;
+        fs_calc_block_hashcode(&bkey);
+        count = 0;
+        for (i=0; i<block.slice_count; i++) {
+            if ((result=reader_read(reader, &record,
+                            sizeof(record))) != 0)
+            {
+                return result;
+            }
+            if ((result=load_slice(&bkey, &record,
+                            slices + count)) != 0)
+            {
+                return result;
+            }
+
+            //the slices of the block are added with one lock
+            if (++count == SLICE_CHECKPOINT_LOAD_BATCH) {
+                if ((result=ob_index_add_slices_by_binlog(
+                                slices, count)) != 0)
+                {
+                    return result;
+                }
+                count = 0;
+            }
+        }
+        if ((result=ob_index_add_slices_by_binlog(slices, count)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+int slice_checkpoint_load(SFBinlogFilePosition *position)
+{
+    SliceCheckpointReader reader;
+    SliceCheckpointHeader header;
+    SliceCheckpointTrailer trailer;
+    int64_t start_time;
+    int result;
+
+    get_checkpoint_filename(reader.filename, sizeof(reader.filename));
+    if ((reader.fd=open(reader.filename, O_RDONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        if (result != ENOENT) {
+            logWarning("file: "__FILE__", line: %d, "
+                    "open file \"%s\" fail, errno: %d, error info: %s",
+                    __LINE__, reader.filename, result, STRERROR(result));
+        }
+        return ENOENT;
+    }
+
+    if ((reader.buff=(char *)fc_malloc(
+                    SLICE_CHECKPOINT_IO_BUFFER_SIZE)) == NULL)
+    {
+        close(reader.fd);
+        return ENOMEM;
+    }
+
+    start_time = get_current_time_ms();
+    if ((result=check_checkpoint_file(&reader, &header, &trailer)) == 0) {
+        position->index = header.binlog_index;
+        position->offset = header.binlog_offset;
+        result = check_binlog_position(position);
+    }
+
+    if (result != 0) {
+        logWarning("file: "__FILE__", line: %d, "
+                "ignore the checkpoint file \"%s\", "
+                "load the whole slice binlog", __LINE__, reader.filename);
+        result = ENOENT;
+    } else {
+        /* the index is partly loaded when fail, MUST NOT fall back
+           to the whole binlog loading */
+        if ((result=load_index(&reader, &trailer)) == ENOENT) {
+            result = EINVAL;
+        }
+    }
+
+    free(reader.buff);
+    close(reader.fd);
+    if (result == 0) {
+        logInfo("file: "__FILE__", line: %d, "
+                "load slice checkpoint done, object block count: "
+                "%"PRId64", slice count: %"PRId64", time used: "
+                "%"PRId64" ms", __LINE__, trailer.ob_count,
+                trailer.slice_count, get_current_time_ms() - start_time);
+    }
+    return result;
+}
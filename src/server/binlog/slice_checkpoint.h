@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//slice_checkpoint.h
+
+#ifndef _SLICE_CHECKPOINT_H_
+#define _SLICE_CHECKPOINT_H_
+
+#include "sf/sf_binlog_writer.h"
+#include "binlog_types.h"
+
+#define SLICE_CHECKPOINT_FILENAME  "index_checkpoint.dat"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* load the slice index from the checkpoint file
+       position: return the slice binlog position to replay from
+       return ENOENT when no valid checkpoint, the caller should load
+       the whole slice binlog */
+    int slice_checkpoint_load(SFBinlogFilePosition *position);
+
+    //save the checkpoint every SLICE_CHECKPOINT_INTERVAL seconds
+    int slice_checkpoint_setup_schedule();
+
+    /* remove the checkpoint file and disable the saving of this run,
+       called when the slice binlog is repaired */
+    void slice_checkpoint_discard();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
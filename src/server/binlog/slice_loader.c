@@ -27,32 +27,27 @@
 #include "../storage/storage_allocator.h"
 #include "../storage/trunk_id_info.h"
 #include "binlog_loader.h"
+#include "slice_binlog_format.h"
 #include "slice_binlog.h"
 #include "slice_loader.h"
 
-#define ADD_SLICE_FIELD_INDEX_SPACE_PATH_INDEX 8
-#define ADD_SLICE_FIELD_INDEX_SPACE_TRUNK_ID   9
-#define ADD_SLICE_FIELD_INDEX_SPACE_SUBDIR    10
-#define ADD_SLICE_FIELD_INDEX_SPACE_OFFSET    11
-#define ADD_SLICE_FIELD_INDEX_SPACE_SIZE      12
-#define ADD_SLICE_EXPECT_FIELD_COUNT          13
-
-#define DEL_SLICE_EXPECT_FIELD_COUNT           8
-#define DEL_BLOCK_EXPECT_FIELD_COUNT           6
-
-#define MAX_BINLOG_FIELD_COUNT  16
-#define MIN_EXPECT_FIELD_COUNT  DEL_BLOCK_EXPECT_FIELD_COUNT
+#define SLICE_LOADER_BATCH_SIZE 64   //the max slices added with one lock
 
 typedef struct fs_slice_binlog_record {
     char op_type;
     OBSliceType slice_type;   //add slice only
     FSBlockSliceKeyInfo bs_key;
     FSTrunkSpaceInfo space;   //add slice only
+    uint32_t crc32;           //add slice only
+    bool has_crc;             //add slice only
+    char compress_type;       //add slice only
+    int compress_length;      //add slice only
     struct fs_slice_binlog_record *next;  //for queue
 } FSSliceBinlogRecord;
 
 typedef struct fs_slice_loader_thread_context {
     volatile bool continue_flag;
+    bool after_checkpoint;  //the deletions may be in the checkpoint already
     int64_t total_count;
     volatile int64_t done_count;
     struct fc_queue queue;
@@ -69,199 +64,92 @@ typedef struct fs_slice_loader_thread_ctx_array {
         BINLOG_GET_FILENAME_LINE_COUNT(r, FS_SLICE_BINLOG_SUBDIR_NAME, \
         binlog_filename, line_str, line_count)
 
-#define SLICE_PARSE_INT_EX(var, caption, index, endchr, min_val) \
-    BINLOG_PARSE_INT_EX(FS_SLICE_BINLOG_SUBDIR_NAME, var, caption,  \
-            index, endchr, min_val)
-
-#define SLICE_PARSE_INT(var, index, endchr, min_val)  \
-    BINLOG_PARSE_INT_EX(FS_SLICE_BINLOG_SUBDIR_NAME, var, #var, \
-            index, endchr, min_val)
-
-static inline int add_slice_set_fields(FSSliceBinlogRecord *record,
-        BinlogReadThreadResult *r, string_t *line, string_t *cols,
-        const int count)
+static inline int set_space_fields(FSSliceBinlogRecord *record,
+        const SliceBinlogFields *fields, char *error_info)
 {
-    int64_t line_count;
-    char binlog_filename[PATH_MAX];
-    char *endptr;
-    int path_index;
-
-    if (count != ADD_SLICE_EXPECT_FIELD_COUNT) {
-        SLICE_GET_FILENAME_LINE_COUNT(r, binlog_filename,
-                line->str, line_count);
-        logError("file: "__FILE__", line: %d, "
-                "binlog file %s, line no: %"PRId64", "
-                "field count: %d != %d", __LINE__,
-                binlog_filename, line_count,
-                count, ADD_SLICE_EXPECT_FIELD_COUNT);
+    if (fields->space.path_index > STORAGE_CFG.max_store_path_index) {
+        sprintf(error_info, "invalid path_index: %d > "
+                "max_store_path_index: %d", fields->space.path_index,
+                STORAGE_CFG.max_store_path_index);
         return EINVAL;
     }
 
-    SLICE_PARSE_INT_EX(record->bs_key.slice.offset, "slice offset",
-            BINLOG_COMMON_FIELD_INDEX_SLICE_OFFSET, ' ', 0);
-    SLICE_PARSE_INT_EX(record->bs_key.slice.length, "slice length",
-            BINLOG_COMMON_FIELD_INDEX_SLICE_LENGTH, ' ', 1);
-
-    SLICE_PARSE_INT(path_index, ADD_SLICE_FIELD_INDEX_SPACE_PATH_INDEX, ' ', 0);
-    if (path_index > STORAGE_CFG.max_store_path_index) {
-        SLICE_GET_FILENAME_LINE_COUNT(r, binlog_filename,
-                line->str, line_count);
-        logError("file: "__FILE__", line: %d, "
-                "binlog file %s, line no: %"PRId64", "
-                "invalid path_index: %d > max_store_path_index: %d",
-                __LINE__, binlog_filename, line_count,
-                path_index, STORAGE_CFG.max_store_path_index);
-        return EINVAL;
-    }
-
-    if (PATHS_BY_INDEX_PPTR[path_index] == NULL) {
-        SLICE_GET_FILENAME_LINE_COUNT(r, binlog_filename,
-                line->str, line_count);
-        logError("file: "__FILE__", line: %d, "
-                "binlog file %s, line no: %"PRId64", "
-                "path_index: %d not exist", __LINE__,
-                binlog_filename, line_count, path_index);
+    if (PATHS_BY_INDEX_PPTR[fields->space.path_index] == NULL) {
+        sprintf(error_info, "path_index: %d not exist",
+                fields->space.path_index);
         return ENOENT;
     }
-    record->space.store = &PATHS_BY_INDEX_PPTR[path_index]->store;
-    SLICE_PARSE_INT_EX(record->space.id_info.id, "trunk_id",
-            ADD_SLICE_FIELD_INDEX_SPACE_TRUNK_ID, ' ', 1);
-    SLICE_PARSE_INT_EX(record->space.id_info.subdir, "subdir",
-            ADD_SLICE_FIELD_INDEX_SPACE_SUBDIR, ' ', 1);
-    SLICE_PARSE_INT(record->space.offset,
-            ADD_SLICE_FIELD_INDEX_SPACE_OFFSET, ' ', 0);
-    SLICE_PARSE_INT(record->space.size,
-            ADD_SLICE_FIELD_INDEX_SPACE_SIZE, '\n', 0);
-    return 0;
-}
-
-static inline int del_slice_set_fields(FSSliceBinlogRecord *record,
-        BinlogReadThreadResult *r, string_t *line,
-        string_t *cols, const int count)
-{
-    int64_t line_count;
-    char binlog_filename[PATH_MAX];
-    char *endptr;
-
-    if (count != DEL_SLICE_EXPECT_FIELD_COUNT) {
-        SLICE_GET_FILENAME_LINE_COUNT(r, binlog_filename,
-                line->str, line_count);
-        logError("file: "__FILE__", line: %d, "
-                "binlog file %s, line no: %"PRId64", "
-                "field count: %d != %d", __LINE__,
-                binlog_filename, line_count,
-                count, DEL_SLICE_EXPECT_FIELD_COUNT);
-        return EINVAL;
-    }
-
-    SLICE_PARSE_INT_EX(record->bs_key.slice.offset, "slice offset",
-            BINLOG_COMMON_FIELD_INDEX_SLICE_OFFSET, ' ', 0);
-    SLICE_PARSE_INT_EX(record->bs_key.slice.length, "slice length",
-            BINLOG_COMMON_FIELD_INDEX_SLICE_LENGTH, '\n', 1);
-    return 0;
-}
-
-static inline int del_block_set_fields(FSSliceBinlogRecord *record,
-        BinlogReadThreadResult *r, string_t *line,
-        string_t *cols, const int count)
-{
-    int64_t line_count;
-    char binlog_filename[PATH_MAX];
-
-    if (count != DEL_BLOCK_EXPECT_FIELD_COUNT) {
-        SLICE_GET_FILENAME_LINE_COUNT(r, binlog_filename,
-                line->str, line_count);
-        logError("file: "__FILE__", line: %d, "
-                "binlog file %s, line no: %"PRId64", "
-                "field count: %d != %d", __LINE__,
-                binlog_filename, line_count,
-                count, DEL_BLOCK_EXPECT_FIELD_COUNT);
-        return EINVAL;
-    }
 
+    record->space.store = &PATHS_BY_INDEX_PPTR[
+        fields->space.path_index]->store;
+    record->space.id_info.id = fields->space.trunk_id;
+    record->space.id_info.subdir = fields->space.subdir;
+    record->space.offset = fields->space.offset;
+    record->space.size = fields->space.size;
+    record->crc32 = fields->crc32;
+    record->has_crc = fields->has_crc;
+    record->compress_type = fields->compress_type;
+    record->compress_length = fields->compress_length;
     return 0;
 }
 
+/* the line may be the text line or the binary record */
 static int slice_parse_line(BinlogReadThreadResult *r, string_t *line,
         FSSliceLoaderThreadCtxArray *ctx_array)
 {
-    int count;
     int result;
     int64_t line_count;
-    string_t cols[MAX_BINLOG_FIELD_COUNT];
     char binlog_filename[PATH_MAX];
+    char error_info[256];
     FSSliceLoaderThreadContext *thread_ctx;
     FSSliceBinlogRecord *record;
-    FSBlockKey bkey;
-    char op_type;
-    char *endptr;
+    SliceBinlogFields fields;
 
-    count = split_string_ex(line, ' ', cols,
-            MAX_BINLOG_FIELD_COUNT, false);
-    if (count < MIN_EXPECT_FIELD_COUNT) {
+    if ((result=slice_binlog_unpack_record(line, &fields, error_info)) != 0) {
         SLICE_GET_FILENAME_LINE_COUNT(r, binlog_filename,
                 line->str, line_count);
         logError("file: "__FILE__", line: %d, "
-                "binlog file %s, line no: %"PRId64", "
-                "field count: %d < %d", __LINE__,
-                binlog_filename, line_count,
-                count, MIN_EXPECT_FIELD_COUNT);
-        return EINVAL;
+                "binlog file %s, line no: %"PRId64", %s", __LINE__,
+                binlog_filename, line_count, error_info);
+        return result;
     }
+    fs_calc_block_hashcode(&fields.bkey);
 
-    op_type = cols[BINLOG_COMMON_FIELD_INDEX_OP_TYPE].str[0];
-    SLICE_PARSE_INT_EX(bkey.oid, "object ID",
-            BINLOG_COMMON_FIELD_INDEX_BLOCK_OID, ' ', 1);
-    SLICE_PARSE_INT_EX(bkey.offset, "block offset",
-            BINLOG_COMMON_FIELD_INDEX_BLOCK_OFFSET, ' ', 0);
-    fs_calc_block_hashcode(&bkey);
-
-    thread_ctx = ctx_array->contexts + bkey.hash_code % ctx_array->count;
+    thread_ctx = ctx_array->contexts + fields.bkey.hash_code %
+        ctx_array->count;
     record = (FSSliceBinlogRecord *)fast_mblock_alloc_object(
             &thread_ctx->record_allocator);
     if (record == NULL) {
         return ENOMEM;
     }
 
-    record->op_type = op_type;
-    record->bs_key.block = bkey;
-    switch (op_type) {
+    record->op_type = fields.op_type;
+    record->bs_key.block = fields.bkey;
+    switch (fields.op_type) {
         case SLICE_BINLOG_OP_TYPE_WRITE_SLICE:
-            record->slice_type = OB_SLICE_TYPE_FILE;
-            result = add_slice_set_fields(record, r, line, cols, count);
-            break;
         case SLICE_BINLOG_OP_TYPE_ALLOC_SLICE:
-            record->slice_type = OB_SLICE_TYPE_ALLOC;
-            result = add_slice_set_fields(record, r, line, cols, count);
+            record->slice_type = (fields.op_type ==
+                    SLICE_BINLOG_OP_TYPE_WRITE_SLICE ?
+                    OB_SLICE_TYPE_FILE : OB_SLICE_TYPE_ALLOC);
+            record->bs_key.slice = fields.slice;
+            result = set_space_fields(record, &fields, error_info);
             break;
         case SLICE_BINLOG_OP_TYPE_DEL_SLICE:
-            result = del_slice_set_fields(record, r, line, cols, count);
-            break;
-        case SLICE_BINLOG_OP_TYPE_DEL_BLOCK:
-            result = del_block_set_fields(record, r, line, cols, count);
+            record->bs_key.slice = fields.slice;
+            result = 0;
             break;
         default:
-            SLICE_GET_FILENAME_LINE_COUNT(r, binlog_filename,
-                    line->str, line_count);
-            logError("file: "__FILE__", line: %d, "
-                    "binlog file %s, line no: %"PRId64", "
-                    "invalid op_type: %c (0x%02x)", __LINE__,
-                    binlog_filename, line_count,
-                    op_type, (unsigned char)op_type);
-            result = EINVAL;
+            result = 0;
             break;
     }
 
     if (result != 0) {
-        if (result != EINVAL) {
-            SLICE_GET_FILENAME_LINE_COUNT(r, binlog_filename,
-                    line->str, line_count);
-            logError("file: "__FILE__", line: %d, "
-                    "binlog file %s, line no: %"PRId64", op_type: %c, "
-                    "add to index fail, errno: %d", __LINE__,
-                    binlog_filename, line_count, op_type, result);
-        }
-
+        SLICE_GET_FILENAME_LINE_COUNT(r, binlog_filename,
+                line->str, line_count);
+        logError("file: "__FILE__", line: %d, "
+                "binlog file %s, line no: %"PRId64", %s", __LINE__,
+                binlog_filename, line_count, error_info);
+        fast_mblock_free_object(&thread_ctx->record_allocator, record);
         return result;
     }
 
@@ -270,45 +158,119 @@ static int slice_parse_line(BinlogReadThreadResult *r, string_t *line,
     return 0;
 }
 
-static inline int slice_loader_deal_record(FSSliceBinlogRecord *record)
+typedef struct {
+    int count;
+    OBSliceEntry *slices[SLICE_LOADER_BATCH_SIZE];
+} FSSliceLoaderBatch;
+
+static inline OBSliceEntry *alloc_slice_by_record(
+        const FSSliceBinlogRecord *record)
+{
+    OBSliceEntry *slice;
+
+    if ((slice=ob_index_alloc_slice(&record->bs_key.block)) == NULL) {
+        return NULL;
+    }
+
+    slice->type = record->slice_type;
+    slice->ssize = record->bs_key.slice;
+    slice->space = record->space;
+    slice->crc32 = record->crc32;
+    slice->has_crc = record->has_crc;
+    slice->compress.type = record->compress_type;
+    slice->compress.length = record->compress_length;
+    slice->compress.offset = 0;
+    return slice;
+}
+
+static inline int flush_batch(FSSliceLoaderThreadContext *thread_ctx,
+        FSSliceLoaderBatch *batch)
+{
+    int result;
+
+    if (batch->count == 0) {
+        return 0;
+    }
+
+    result = ob_index_add_slices_by_binlog(batch->slices, batch->count);
+    thread_ctx->done_count += batch->count;
+    batch->count = 0;
+    return result;
+}
+
+static inline int slice_loader_deal_record(FSSliceLoaderThreadContext
+        *thread_ctx, FSSliceLoaderBatch *batch, FSSliceBinlogRecord *record)
 {
     OBSliceEntry *slice;
+    int result;
 
     switch (record->op_type) {
         case SLICE_BINLOG_OP_TYPE_WRITE_SLICE:
         case SLICE_BINLOG_OP_TYPE_ALLOC_SLICE:
-            if ((slice=ob_index_alloc_slice(&record->bs_key.block)) == NULL) {
-                return ENOMEM;
+            /* the consecutive slices of the same block are added
+               with one lock */
+            if (batch->count > 0 && (batch->count == SLICE_LOADER_BATCH_SIZE
+                        || !FS_BLOCK_KEY_EQUAL(batch->slices[0]->ob->bkey,
+                            record->bs_key.block)))
+            {
+                if ((result=flush_batch(thread_ctx, batch)) != 0) {
+                    return result;
+                }
             }
 
-            slice->type = record->slice_type;
-            slice->ssize = record->bs_key.slice;
-            slice->space = record->space;
-            return ob_index_add_slice_by_binlog(slice);
+            if ((slice=alloc_slice_by_record(record)) == NULL) {
+                return ENOMEM;
+            }
+            batch->slices[batch->count++] = slice;
+            return 0;
         case SLICE_BINLOG_OP_TYPE_DEL_SLICE:
-            return ob_index_delete_slices_by_binlog(&record->bs_key);
         case SLICE_BINLOG_OP_TYPE_DEL_BLOCK:
-            return ob_index_delete_block_by_binlog(&record->bs_key.block);
+            if ((result=flush_batch(thread_ctx, batch)) != 0) {
+                return result;
+            }
+
+            if (record->op_type == SLICE_BINLOG_OP_TYPE_DEL_SLICE) {
+                result = ob_index_delete_slices_by_binlog(&record->bs_key);
+            } else {
+                result = ob_index_delete_block_by_binlog(
+                        &record->bs_key.block);
+            }
+            break;
         default:
-            return 0;
+            result = 0;
+            break;
+    }
+
+    if (result == ENOENT && thread_ctx->after_checkpoint) {
+        result = 0;
+    }
+    if (result == 0) {
+        thread_ctx->done_count++;
     }
+    return result;
 }
 
 static inline void deal_records(FSSliceLoaderThreadContext *thread_ctx,
         FSSliceBinlogRecord *head)
 {
+    FSSliceLoaderBatch batch;
     FSSliceBinlogRecord *record;
+
+    batch.count = 0;
     do {
         record = head;
         head = head->next;
 
-        if (slice_loader_deal_record(record) != 0) {
+        if (slice_loader_deal_record(thread_ctx, &batch, record) != 0) {
             SF_G_CONTINUE_FLAG = false;
             return;
         }
         fast_mblock_free_object(&thread_ctx->record_allocator, record);
-        thread_ctx->done_count++;
     } while (head != NULL);
+
+    if (flush_batch(thread_ctx, &batch) != 0) {
+        SF_G_CONTINUE_FLAG = false;
+    }
 }
 
 static void slice_loader_thread_run(FSSliceLoaderThreadContext *thread_ctx,
@@ -353,7 +315,8 @@ static int init_thread_context(FSSliceLoaderThreadContext *thread_ctx)
     return 0;
 }
 
-static int init_thread_ctx_array(FSSliceLoaderThreadCtxArray *ctx_array)
+static int init_thread_ctx_array(FSSliceLoaderThreadCtxArray *ctx_array,
+        const bool after_checkpoint)
 {
     int result;
     int bytes;
@@ -374,6 +337,7 @@ static int init_thread_ctx_array(FSSliceLoaderThreadCtxArray *ctx_array)
         }
 
         ctx->continue_flag = true;
+        ctx->after_checkpoint = after_checkpoint;
         if ((result=shared_thread_pool_run((fc_thread_pool_callback)
                         slice_loader_thread_run, ctx)) != 0)
         {
@@ -433,17 +397,19 @@ static void waiting_threads_finish(FSSliceLoaderThreadCtxArray *ctx_array)
     }
 }
 
-int slice_loader_load(struct sf_binlog_writer_info *slice_writer)
+int slice_loader_load_ex(struct sf_binlog_writer_info *slice_writer,
+        const SFBinlogFilePosition *position)
 {
     int result;
     FSSliceLoaderThreadCtxArray ctx_array;
 
-    if ((result=init_thread_ctx_array(&ctx_array)) != 0) {
+    if ((result=init_thread_ctx_array(&ctx_array, position != NULL)) != 0) {
         return result;
     }
 
-    result = binlog_loader_load_ex(FS_SLICE_BINLOG_SUBDIR_NAME, slice_writer,
-            (binlog_parse_line_func)slice_parse_line, &ctx_array);
+    result = binlog_loader_load_ex(FS_SLICE_BINLOG_SUBDIR_NAME,
+            slice_writer, position, (binlog_parse_line_func)
+            slice_parse_line, &ctx_array);
     if (result == 0) {
         if (!SF_G_CONTINUE_FLAG) {
             result = EINTR;
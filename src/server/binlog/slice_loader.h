@@ -23,7 +23,13 @@
 extern "C" {
 #endif
 
-    int slice_loader_load(struct sf_binlog_writer_info *slice_writer);
+    /* position: the binlog position of the loaded checkpoint,
+       NULL for loading the whole slice binlog */
+    int slice_loader_load_ex(struct sf_binlog_writer_info *slice_writer,
+            const SFBinlogFilePosition *position);
+
+#define slice_loader_load(slice_writer) \
+    slice_loader_load_ex(slice_writer, NULL)
 
 #ifdef __cplusplus
 }
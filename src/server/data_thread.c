@@ -34,6 +34,7 @@
 #include "sf/sf_func.h"
 #include "server_global.h"
 #include "server_replication.h"
+#include "numa_topology.h"
 #include "data_thread.h"
 
 #define DATA_THREAD_RUNNING_COUNT g_data_thread_vars.running_count
@@ -88,6 +89,11 @@ static int init_data_thread_array(FSDataThreadArray *thread_array,
         if ((result=init_thread_ctx(context)) != 0) {
             return result;
         }
+
+        /* the master and slave threads of the same index
+           are on the same node */
+        context->numa_node = numa_topology_data_thread_node(
+                context - thread_array->contexts);
     }
     thread_array->count = count;
 
@@ -299,6 +305,7 @@ static void *data_thread_func(void *arg)
 
     __sync_add_and_fetch(&DATA_THREAD_RUNNING_COUNT, 1);
     thread_ctx = (FSDataThreadContext *)arg;
+    numa_topology_bind_thread(thread_ctx->numa_node);
     while (SF_G_CONTINUE_FLAG) {
         op = (FSDataOperation *)fc_queue_pop_all(&thread_ctx->queue);
         if (op == NULL) {
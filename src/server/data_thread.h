@@ -43,6 +43,7 @@ typedef struct fs_data_operation {
 
 typedef struct fs_data_thread_context {
     bool notify_done;
+    int numa_node;  //the node index to bind, -1 for no binding
     pthread_lock_cond_pair_t lc_pair;
     struct fc_queue queue;
     struct fast_mblock_man allocator;
@@ -42,6 +42,7 @@
 #include "common/fs_proto.h"
 #include "common/fs_func.h"
 #include "binlog/replica_binlog.h"
+#include "storage/durability.h"
 #include "server_replication.h"
 #include "server_global.h"
 #include "server_func.h"
@@ -344,6 +345,17 @@ static void master_data_update_done_notify(FSDataOperation *op)
 
     du_handler_idempotency_request_finish(task, op->ctx->result);
     RESPONSE_STATUS = op->ctx->result;
+    if (op->ctx->result == 0 && STORAGE_CFG.durability.mode ==
+            FS_DURABILITY_MODE_GROUP_COMMIT)
+    {
+        //response after the binlogs synced by the group commit
+        if (durability_wait_commit(task, op->ctx->info.data_group_id,
+                    op->ctx->info.data_version) == 0)
+        {
+            return;
+        }
+    }
+
     sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
     sf_release_task(task);
 }
@@ -647,6 +659,8 @@ int du_handler_deal_client_join(struct fast_task_info *task)
     int2buff(g_sf_global_vars.min_buff_size -
             FS_TASK_BUFFER_FRONT_PADDING_SIZE,
             join_resp->buffer_size);
+    int2buff(STORAGE_CFG.zero_copy_read.enabled ? FS_FILE_BLOCK_SIZE : 0,
+            join_resp->max_read_size);
     RESPONSE.header.body_len = sizeof(FSProtoClientJoinResp);
     RESPONSE.header.cmd = FS_COMMON_PROTO_CLIENT_JOIN_RESP;
     TASK_ARG->context.response_done = true;
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "aligned_buffer_pool.h"
+
+int aligned_buffer_pool_init(AlignedBufferPool *pool, const int align_size,
+        const int max_buffer_size, const int max_cached_per_class)
+{
+    int buffer_size;
+
+    if (align_size <= 0 || (align_size & (align_size - 1)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "invalid align size: %d", __LINE__, align_size);
+        return EINVAL;
+    }
+
+    memset(pool, 0, sizeof(AlignedBufferPool));
+    pool->align_size = align_size;
+    pool->max_buffer_size = max_buffer_size;
+    pool->max_cached_per_class = max_cached_per_class;
+
+    buffer_size = align_size;
+    pool->class_count = 1;
+    while (buffer_size < max_buffer_size) {
+        if (pool->class_count == ALIGNED_BUFFER_POOL_MAX_CLASSES) {
+            logError("file: "__FILE__", line: %d, "
+                    "max buffer size: %d is too large, align size: %d",
+                    __LINE__, max_buffer_size, align_size);
+            return EOVERFLOW;
+        }
+        buffer_size *= 2;
+        pool->class_count++;
+    }
+
+    return 0;
+}
+
+void aligned_buffer_pool_destroy(AlignedBufferPool *pool)
+{
+    AlignedBufferFreelist *freelist;
+    AlignedBufferFreelist *end;
+    AlignedBufferNode *node;
+
+    end = pool->freelists + pool->class_count;
+    for (freelist=pool->freelists; freelist<end; freelist++) {
+        while (freelist->head != NULL) {
+            node = freelist->head;
+            freelist->head = node->next;
+            free(node);
+        }
+        freelist->count = 0;
+    }
+}
+
+static inline int get_class_index(AlignedBufferPool *pool,
+        const int size, int *buffer_size)
+{
+    int index;
+
+    index = 0;
+    *buffer_size = pool->align_size;
+    while (*buffer_size < size) {
+        *buffer_size *= 2;
+        index++;
+    }
+    return index;
+}
+
+char *aligned_buffer_pool_alloc(AlignedBufferPool *pool, const int size)
+{
+    AlignedBufferFreelist *freelist;
+    AlignedBufferNode *node;
+    void *buff;
+    int buffer_size;
+    int index;
+    int result;
+
+    if (size > pool->max_buffer_size) {
+        logError("file: "__FILE__", line: %d, "
+                "alloc size: %d > max buffer size: %d", __LINE__,
+                size, pool->max_buffer_size);
+        return NULL;
+    }
+
+    index = get_class_index(pool, size, &buffer_size);
+    freelist = pool->freelists + index;
+    if (freelist->head != NULL) {
+        node = freelist->head;
+        freelist->head = node->next;
+        freelist->count--;
+        return (char *)node;
+    }
+
+    if ((result=posix_memalign(&buff, pool->align_size, buffer_size)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "posix_memalign %d bytes fail, errno: %d, error info: %s",
+                __LINE__, buffer_size, result, STRERROR(result));
+        return NULL;
+    }
+    return (char *)buff;
+}
+
+void aligned_buffer_pool_free(AlignedBufferPool *pool,
+        char *buff, const int size)
+{
+    AlignedBufferFreelist *freelist;
+    AlignedBufferNode *node;
+    int buffer_size;
+
+    freelist = pool->freelists + get_class_index(pool, size, &buffer_size);
+    if (freelist->count >= pool->max_cached_per_class) {
+        free(buff);
+        return;
+    }
+
+    node = (AlignedBufferNode *)buff;
+    node->next = freelist->head;
+    freelist->head = node;
+    freelist->count++;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _ALIGNED_BUFFER_POOL_H
+#define _ALIGNED_BUFFER_POOL_H
+
+#include "../../common/fs_types.h"
+
+#define ALIGNED_BUFFER_POOL_MAX_CLASSES  24
+
+typedef struct aligned_buffer_node {
+    struct aligned_buffer_node *next;
+} AlignedBufferNode;
+
+typedef struct {
+    int count;
+    AlignedBufferNode *head;
+} AlignedBufferFreelist;
+
+/* NOT thread safe, one pool per thread */
+typedef struct {
+    int align_size;
+    int max_buffer_size;
+    int max_cached_per_class;
+    int class_count;
+    AlignedBufferFreelist freelists[ALIGNED_BUFFER_POOL_MAX_CLASSES];
+} AlignedBufferPool;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* align_size: power of 2 such as 4096
+     * max_buffer_size: the max buffer size to alloc
+     * max_cached_per_class: the max free buffers kept per size class
+     */
+    int aligned_buffer_pool_init(AlignedBufferPool *pool, const int align_size,
+            const int max_buffer_size, const int max_cached_per_class);
+
+    void aligned_buffer_pool_destroy(AlignedBufferPool *pool);
+
+    char *aligned_buffer_pool_alloc(AlignedBufferPool *pool, const int size);
+
+    //the size MUST be same as the size when alloc
+    void aligned_buffer_pool_free(AlignedBufferPool *pool,
+            char *buff, const int size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "latency_histogram.h"
+
+void latency_histogram_merge(LatencyHistogram *dest,
+        const LatencyHistogram *src)
+{
+    int i;
+
+    for (i=0; i<LATENCY_HISTOGRAM_BUCKET_COUNT; i++) {
+        dest->buckets[i] += src->buckets[i];
+    }
+    dest->count += src->count;
+    dest->total += src->total;
+    if (src->max > dest->max) {
+        dest->max = src->max;
+    }
+}
+
+//the max value of the bucket
+static inline int64_t bucket_upper_value(const int index)
+{
+    int shift;
+
+    if (index < LATENCY_HISTOGRAM_SUB_COUNT) {
+        return index;
+    }
+
+    shift = index / LATENCY_HISTOGRAM_SUB_COUNT - 1;
+    return ((int64_t)(LATENCY_HISTOGRAM_SUB_COUNT + index %
+                LATENCY_HISTOGRAM_SUB_COUNT + 1) << shift) - 1;
+}
+
+void latency_histogram_summary(const LatencyHistogram *histogram,
+        FSLatencySummary *summary)
+{
+    struct {
+        double ratio;
+        int64_t *value;
+    } percentiles[4];
+    int64_t count;
+    int64_t target;
+    int64_t value;
+    int p;
+    int i;
+
+    memset(summary, 0, sizeof(*summary));
+    if ((count=histogram->count) <= 0) {
+        return;
+    }
+
+    summary->count = count;
+    summary->avg = histogram->total / count;
+    summary->max = histogram->max;
+
+    percentiles[0].ratio = 0.50;
+    percentiles[0].value = &summary->p50;
+    percentiles[1].ratio = 0.90;
+    percentiles[1].value = &summary->p90;
+    percentiles[2].ratio = 0.99;
+    percentiles[2].value = &summary->p99;
+    percentiles[3].ratio = 0.999;
+    percentiles[3].value = &summary->p999;
+
+    /* the buckets are updated without lock, the sum of the buckets
+       may be a little different from the count */
+    count = 0;
+    p = 0;
+    for (i=0; i<LATENCY_HISTOGRAM_BUCKET_COUNT && p < 4; i++) {
+        count += histogram->buckets[i];
+        value = bucket_upper_value(i);
+        if (value > summary->max) {
+            value = summary->max;
+        }
+        while (p < 4) {
+            target = (int64_t)(percentiles[p].ratio * summary->count);
+            if (target < 1) {
+                target = 1;
+            }
+            if (count < target) {
+                break;
+            }
+            *percentiles[p++].value = value;
+        }
+    }
+
+    while (p < 4) {
+        *percentiles[p++].value = summary->max;
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _LATENCY_HISTOGRAM_H
+#define _LATENCY_HISTOGRAM_H
+
+#include "../../common/fs_types.h"
+
+/* HDR style histogram with log-linear buckets: the values less than
+   LATENCY_HISTOGRAM_SUB_COUNT are exact, and each power of 2 above is
+   split into LATENCY_HISTOGRAM_SUB_COUNT buckets (relative error 12.5%) */
+#define LATENCY_HISTOGRAM_SUB_BITS    3
+#define LATENCY_HISTOGRAM_SUB_COUNT   (1 << LATENCY_HISTOGRAM_SUB_BITS)
+#define LATENCY_HISTOGRAM_MAX_BITS    32  //about 71 minutes in microseconds
+#define LATENCY_HISTOGRAM_MAX_VALUE   ((1LL << LATENCY_HISTOGRAM_MAX_BITS) - 1)
+#define LATENCY_HISTOGRAM_BUCKET_COUNT  ((LATENCY_HISTOGRAM_MAX_BITS - \
+            LATENCY_HISTOGRAM_SUB_BITS + 1) * LATENCY_HISTOGRAM_SUB_COUNT)
+
+//written by one thread only, the readers accept the dirty values
+typedef struct {
+    int64_t count;
+    int64_t total;
+    int64_t max;
+    int64_t buckets[LATENCY_HISTOGRAM_BUCKET_COUNT];
+} LatencyHistogram;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    static inline int latency_histogram_index(int64_t value)
+    {
+        int msb;
+        int shift;
+
+        if (value < LATENCY_HISTOGRAM_SUB_COUNT) {
+            return (value > 0 ? value : 0);
+        }
+        if (value > LATENCY_HISTOGRAM_MAX_VALUE) {
+            value = LATENCY_HISTOGRAM_MAX_VALUE;
+        }
+
+        msb = 63 - __builtin_clzll(value);
+        shift = msb - LATENCY_HISTOGRAM_SUB_BITS;
+        return (shift + 1) * LATENCY_HISTOGRAM_SUB_COUNT +
+            (int)(value >> shift) - LATENCY_HISTOGRAM_SUB_COUNT;
+    }
+
+    static inline void latency_histogram_add(LatencyHistogram *histogram,
+            const int64_t value)
+    {
+        histogram->buckets[latency_histogram_index(value)]++;
+        histogram->count++;
+        histogram->total += value;
+        if (value > histogram->max) {
+            histogram->max = value;
+        }
+    }
+
+    //dest += src
+    void latency_histogram_merge(LatencyHistogram *dest,
+            const LatencyHistogram *src);
+
+    void latency_histogram_summary(const LatencyHistogram *histogram,
+            FSLatencySummary *summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,148 +23,236 @@
 #include "../server_global.h"
 #include "trunk_fd_cache.h"
 
-int trunk_fd_cache_init(TrunkFDCacheContext *cache_ctx, const int capacity)
+static TrunkFDCacheShard fd_cache_shards[TRUNK_FD_CACHE_SHARD_COUNT];
+
+#define TRUNK_FD_CACHE_SHARD(trunk_id) \
+    (fd_cache_shards + (trunk_id) % TRUNK_FD_CACHE_SHARD_COUNT)
+
+#define TRUNK_FD_CACHE_BUCKET(shard, trunk_id) \
+    ((shard)->htable.buckets + ((trunk_id) / TRUNK_FD_CACHE_SHARD_COUNT) \
+     % (shard)->htable.size)
+
+static int init_shard(TrunkFDCacheShard *shard, const int capacity)
 {
     int result;
     int bytes;
-    int alloc_elements_once;
     unsigned int *prime_capacity;
 
     if ((prime_capacity=hash_get_prime_capacity(capacity)) != NULL) {
-        cache_ctx->htable.size = *prime_capacity;
+        shard->htable.size = *prime_capacity;
     } else {
-        cache_ctx->htable.size = capacity;
+        shard->htable.size = capacity;
     }
 
-    bytes = sizeof(TrunkFDCacheEntry *) * cache_ctx->htable.size;
-    cache_ctx->htable.buckets = (TrunkFDCacheEntry **)fc_malloc(bytes);
-    if (cache_ctx->htable.buckets == NULL) {
+    bytes = sizeof(TrunkFDCacheEntry *) * shard->htable.size;
+    shard->htable.buckets = (TrunkFDCacheEntry **)fc_malloc(bytes);
+    if (shard->htable.buckets == NULL) {
         return ENOMEM;
     }
-    memset(cache_ctx->htable.buckets, 0, bytes);
-
-    if (capacity < 1024) {
-        alloc_elements_once = 512;
-    } else if (capacity < 2 * 1024) {
-        alloc_elements_once = 1 * 1024;
-    } else if (capacity < 4 * 1024) {
-        alloc_elements_once = 2 * 1024;
-    } else if (capacity < 8 * 1024) {
-        alloc_elements_once = 4 * 1024;
-    } else {
-        alloc_elements_once = 8 * 1024;
-    }
-    if ((result=fast_mblock_init_ex1(&cache_ctx->allocator,
+    memset(shard->htable.buckets, 0, bytes);
+
+    if ((result=fast_mblock_init_ex1(&shard->allocator,
                     "trunk_fd_cache", sizeof(TrunkFDCacheEntry),
-                    alloc_elements_once, 0, NULL, NULL, false)) != 0)
+                    capacity < 256 ? 256 : capacity, 0,
+                    NULL, NULL, false)) != 0)
     {
         return result;
     }
 
-    cache_ctx->lru.count = 0;
-    cache_ctx->lru.capacity = capacity;
-    FC_INIT_LIST_HEAD(&cache_ctx->lru.head);
+    if ((result=init_pthread_lock(&shard->lock)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "init_pthread_lock fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+
+    shard->lru.count = 0;
+    shard->lru.capacity = capacity;
+    FC_INIT_LIST_HEAD(&shard->lru.head);
     return 0;
 }
 
-int trunk_fd_cache_get(TrunkFDCacheContext *cache_ctx,
-        const int64_t trunk_id)
+int trunk_fd_cache_init(const int capacity)
 {
-    TrunkFDCacheEntry **bucket;
-    TrunkFDCacheEntry *entry;
+    int result;
+    int shard_capacity;
+    TrunkFDCacheShard *shard;
+    TrunkFDCacheShard *end;
 
-    bucket = cache_ctx->htable.buckets + trunk_id % cache_ctx->htable.size;
-    if (*bucket == NULL) {
-        return -1;
+    shard_capacity = (capacity + TRUNK_FD_CACHE_SHARD_COUNT - 1) /
+        TRUNK_FD_CACHE_SHARD_COUNT;
+    end = fd_cache_shards + TRUNK_FD_CACHE_SHARD_COUNT;
+    for (shard=fd_cache_shards; shard<end; shard++) {
+        if ((result=init_shard(shard, shard_capacity)) != 0) {
+            return result;
+        }
     }
-    if ((*bucket)->pair.trunk_id == trunk_id) {
-        entry = *bucket;
-    } else {
-        entry = (*bucket)->next;
-        while (entry != NULL) {
-            if (entry->pair.trunk_id == trunk_id) {
-                break;
-            }
 
-            entry = entry->next;
+    return 0;
+}
+
+static TrunkFDCacheEntry *find_entry(TrunkFDCacheShard *shard,
+        const int64_t trunk_id, TrunkFDCacheEntry **previous)
+{
+    TrunkFDCacheEntry *entry;
+
+    *previous = NULL;
+    entry = *TRUNK_FD_CACHE_BUCKET(shard, trunk_id);
+    while (entry != NULL) {
+        if (entry->pair.trunk_id == trunk_id) {
+            return entry;
         }
+
+        *previous = entry;
+        entry = entry->next;
     }
 
-    if (entry != NULL) {
-        fc_list_move_tail(&entry->dlink, &cache_ctx->lru.head);
-        return entry->pair.fd;
+    return NULL;
+}
+
+static inline void free_entry(TrunkFDCacheEntry *entry)
+{
+    close(entry->pair.fd);
+    entry->pair.fd = -1;
+    fast_mblock_free_object(&entry->shard->allocator, entry);
+}
+
+//remove from the hashtable and the LRU chain
+static void remove_entry(TrunkFDCacheEntry *entry,
+        TrunkFDCacheEntry *previous)
+{
+    TrunkFDCacheShard *shard;
+
+    shard = entry->shard;
+    if (previous == NULL) {
+        *TRUNK_FD_CACHE_BUCKET(shard, entry->pair.trunk_id) = entry->next;
+    } else {
+        previous->next = entry->next;
+    }
+
+    fc_list_del_init(&entry->dlink);
+    shard->lru.count--;
+
+    if (entry->refer == 0) {
+        free_entry(entry);
     } else {
-        return -1;
+        entry->deleted = true;
     }
 }
 
-int trunk_fd_cache_add(TrunkFDCacheContext *cache_ctx,
-        const int64_t trunk_id, const int fd)
+//eliminate the least recently used entries which are not in use
+static void eliminate_entries(TrunkFDCacheShard *shard)
 {
-    TrunkFDCacheEntry **bucket;
     TrunkFDCacheEntry *entry;
+    TrunkFDCacheEntry *next;
+    TrunkFDCacheEntry *previous;
 
-    if (cache_ctx->lru.count >= cache_ctx->lru.capacity) {
-        entry = fc_list_entry(cache_ctx->lru.head.next,
-                TrunkFDCacheEntry, dlink);
-        trunk_fd_cache_delete(cache_ctx, entry->pair.trunk_id);
-    }
+    fc_list_for_each_entry_safe(entry, next, &shard->lru.head, dlink) {
+        if (shard->lru.count < shard->lru.capacity) {
+            break;
+        }
 
-    entry = (TrunkFDCacheEntry *)fast_mblock_alloc_object(
-            &cache_ctx->allocator);
-    if (entry == NULL) {
-        return ENOMEM;
+        if (entry->refer == 0) {
+            find_entry(shard, entry->pair.trunk_id, &previous);
+            remove_entry(entry, previous);
+        }
     }
+}
 
-    entry->pair.trunk_id = trunk_id;
-    entry->pair.fd = fd;
+TrunkFDCacheEntry *trunk_fd_cache_get(const int64_t trunk_id)
+{
+    TrunkFDCacheShard *shard;
+    TrunkFDCacheEntry *entry;
+    TrunkFDCacheEntry *previous;
 
-    bucket = cache_ctx->htable.buckets + trunk_id % cache_ctx->htable.size;
-    entry->next = *bucket;
-    *bucket = entry;
+    shard = TRUNK_FD_CACHE_SHARD(trunk_id);
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    if ((entry=find_entry(shard, trunk_id, &previous)) != NULL) {
+        entry->refer++;
+        fc_list_move_tail(&entry->dlink, &shard->lru.head);
+    }
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
 
-    fc_list_add_tail(&entry->dlink, &cache_ctx->lru.head);
-    cache_ctx->lru.count++;
-    return 0;
+    return entry;
 }
 
-int trunk_fd_cache_delete(TrunkFDCacheContext *cache_ctx,
-        const int64_t trunk_id)
+TrunkFDCacheEntry *trunk_fd_cache_add(const int64_t trunk_id, const int fd)
 {
+    TrunkFDCacheShard *shard;
     TrunkFDCacheEntry **bucket;
-    TrunkFDCacheEntry *previous;
     TrunkFDCacheEntry *entry;
+    TrunkFDCacheEntry *previous;
 
-    bucket = cache_ctx->htable.buckets + trunk_id % cache_ctx->htable.size;
-    if (*bucket == NULL) {
-        return ENOENT;
-    }
+    shard = TRUNK_FD_CACHE_SHARD(trunk_id);
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    do {
+        //opened by another thread
+        if ((entry=find_entry(shard, trunk_id, &previous)) != NULL) {
+            close(fd);
+            entry->refer++;
+            fc_list_move_tail(&entry->dlink, &shard->lru.head);
+            break;
+        }
 
-    previous = NULL;
-    entry = *bucket;
-    while (entry != NULL) {
-        if (entry->pair.trunk_id == trunk_id) {
+        if (shard->lru.count >= shard->lru.capacity) {
+            eliminate_entries(shard);
+        }
+
+        entry = (TrunkFDCacheEntry *)fast_mblock_alloc_object(
+                &shard->allocator);
+        if (entry == NULL) {
             break;
         }
 
-        previous = entry;
-        entry = entry->next;
-    }
-    if (entry == NULL) {
-        return ENOENT;
+        entry->pair.trunk_id = trunk_id;
+        entry->pair.fd = fd;
+        entry->refer = 1;
+        entry->deleted = false;
+        entry->read_ahead.next_offset = -1;
+        entry->read_ahead.window_end = 0;
+        entry->read_ahead.seq_count = 0;
+        entry->shard = shard;
+
+        bucket = TRUNK_FD_CACHE_BUCKET(shard, trunk_id);
+        entry->next = *bucket;
+        *bucket = entry;
+
+        fc_list_add_tail(&entry->dlink, &shard->lru.head);
+        shard->lru.count++;
+    } while (0);
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
+
+    return entry;
+}
+
+void trunk_fd_cache_release(TrunkFDCacheEntry *entry)
+{
+    TrunkFDCacheShard *shard;
+
+    shard = entry->shard;
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    if (--entry->refer == 0 && entry->deleted) {
+        free_entry(entry);
     }
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
+}
 
-    if (previous == NULL) {
-        *bucket = entry->next;
+int trunk_fd_cache_delete(const int64_t trunk_id)
+{
+    TrunkFDCacheShard *shard;
+    TrunkFDCacheEntry *entry;
+    TrunkFDCacheEntry *previous;
+    int result;
+
+    shard = TRUNK_FD_CACHE_SHARD(trunk_id);
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    if ((entry=find_entry(shard, trunk_id, &previous)) != NULL) {
+        remove_entry(entry, previous);
+        result = 0;
     } else {
-        previous->next = entry->next;
+        result = ENOENT;
     }
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
 
-    close(entry->pair.fd);
-    entry->pair.fd = -1;
-
-    fc_list_del_init(&entry->dlink);
-    fast_mblock_free_object(&cache_ctx->allocator, entry);
-    cache_ctx->lru.count--;
-    return 0;
+    return result;
 }
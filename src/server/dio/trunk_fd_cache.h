@@ -13,54 +13,77 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
-
 #ifndef _TRUNK_FD_CACHE_H
 #define _TRUNK_FD_CACHE_H
 
 #include "fastcommon/fc_list.h"
+#include "fastcommon/fast_mblock.h"
 #include "../../common/fs_types.h"
 
+#define TRUNK_FD_CACHE_SHARD_COUNT  64
+
 typedef struct trunk_id_fd_pair {
     int64_t trunk_id;
     int fd;
 } TrunkIdFDPair;
 
+//for sequential read detection
+typedef struct trunk_read_ahead_state {
+    int64_t next_offset;  //the expected offset of the next sequential read
+    int64_t window_end;   //the end offset of the issued read ahead
+    int seq_count;        //the count of continuous sequential reads
+} TrunkReadAheadState;
+
+struct trunk_fd_cache_shard;
+
 typedef struct trunk_fd_cache_entry {
     TrunkIdFDPair pair;
+    int refer;     //protected by the shard lock
+    bool deleted;  //removed from the table, close the fd when refer is 0
+
+    /* updated by the read threads without lock,
+       the race is harmless for the read ahead heuristic */
+    TrunkReadAheadState read_ahead;
+
+    struct trunk_fd_cache_shard *shard;
     struct fc_list_head dlink;
     struct trunk_fd_cache_entry *next;  //for hashtable
 } TrunkFDCacheEntry;
 
-typedef struct {
-    TrunkFDCacheEntry **buckets;
-    unsigned int size;
-} TrunkFDCacheHashtable;
-
-typedef struct {
-    TrunkFDCacheHashtable htable;
+typedef struct trunk_fd_cache_shard {
+    struct {
+        TrunkFDCacheEntry **buckets;
+        unsigned int size;
+    } htable;
     struct {
         int capacity;
         int count;
         struct fc_list_head head;
     } lru;
     struct fast_mblock_man allocator;
-} TrunkFDCacheContext;
+    pthread_mutex_t lock;
+} TrunkFDCacheShard;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-    int trunk_fd_cache_init(TrunkFDCacheContext *cache_ctx, const int capacity);
+    /* the process-wide trunk fd table shared by all disk IO threads,
+       the fd is closed by LRU elimination or trunk_fd_cache_delete */
+    int trunk_fd_cache_init(const int capacity);
+
+    //return the entry with refer increased, NULL for not exist
+    TrunkFDCacheEntry *trunk_fd_cache_get(const int64_t trunk_id);
 
-    //return fd, -1 for not exist
-    int trunk_fd_cache_get(TrunkFDCacheContext *cache_ctx,
-            const int64_t trunk_id);
+    /* add the opened fd and return the entry with refer increased,
+       the fd is closed when the trunk exists already */
+    TrunkFDCacheEntry *trunk_fd_cache_add(const int64_t trunk_id,
+            const int fd);
 
-    int trunk_fd_cache_add(TrunkFDCacheContext *cache_ctx,
-            const int64_t trunk_id, const int fd);
+    void trunk_fd_cache_release(TrunkFDCacheEntry *entry);
 
-    int trunk_fd_cache_delete(TrunkFDCacheContext *cache_ctx,
-            const int64_t trunk_id);
+    //the fd is closed when the last reference released
+    int trunk_fd_cache_delete(const int64_t trunk_id);
 
 #ifdef __cplusplus
 }
@@ -16,29 +16,114 @@
 #include <limits.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#ifdef FS_USE_IO_URING
+#include <liburing.h>
+#endif
 #include "fastcommon/shared_func.h"
 #include "fastcommon/logger.h"
-#include "fastcommon/fast_mblock.h"
 #include "sf/sf_global.h"
 #include "../server_global.h"
 #include "../binlog/trunk_binlog.h"
+#include "../storage/durability.h"
+#include "../numa_topology.h"
 #include "trunk_fd_cache.h"
+#include "aligned_buffer_pool.h"
+#include "latency_histogram.h"
 #include "trunk_io_thread.h"
 
 #define IO_THREAD_ROLE_WRITER   'W'
 #define IO_THREAD_ROLE_READER   'R'
 
-typedef struct trunk_io_thread_context {
+#define IO_MERGE_MAX_IOVS  (IOV_MAX < 1024 ? IOV_MAX : 1024)
+
+#define IOB_CACHE_ALLOC_ELEMENTS_ONCE  64
+
+#define IO_SCHED_BATCH_MAX_COUNT   64
+#define IO_SCHED_BASE_COST       4096  //the cost of one IO besides the bytes
+#define IO_SCHED_WEIGHT_SCALE    1000
+#define IO_SCHED_LIMIT_BURST_US  (100 * 1000)
+
+//the idle reader steals when the queued buffers of the sibling reach
+#define IO_STEAL_MIN_QUEUED_COUNT  2
+
+//for the alignment padding between the merged slices
+static char zero_padding[64];
+
+typedef struct trunk_io_buffer_chunk {
+    struct trunk_io_buffer_chunk *next;
+    TrunkIOBuffer buffers[IOB_CACHE_ALLOC_ELEMENTS_ONCE];
+} TrunkIOBufferChunk;
+
+/* the TrunkIOBuffer cache per producer thread. the buffers are allocated
+   by the producer only and returned by the IO threads after done.
+   the reference count is the buffers in flight plus one of the producer,
+   the cache is freed by the last one of the exited producer and
+   the IO threads returning the buffers */
+typedef struct trunk_io_buffer_cache {
+    TrunkIOBuffer *freelist;           //accessed by the producer only
+    TrunkIOBuffer *volatile returned;  //lock-free stack
+    TrunkIOBufferChunk *chunks;        //for free
+    volatile int ref_count;
+} TrunkIOBufferCache;
+
+typedef struct trunk_io_class_queue {
     TrunkIOBuffer *head;
     TrunkIOBuffer *tail;
-    pthread_mutex_t lock;
+    int64_t vtime;  //the virtual time for weighted fair queueing
+} TrunkIOClassQueue;
+
+/* GCRA rate limiter shared by the IO threads of the same path,
+   the theoretical arrival time in microseconds */
+typedef struct trunk_io_rate_limiter {
+    volatile int64_t bytes_tat;
+    volatile int64_t iops_tat;
+} TrunkIORateLimiter;
+
+typedef struct trunk_io_thread_context {
+    /* lock-free MPSC queue: the producers push to the top of the stack,
+       and the consumer pops all then reverses them to FIFO order */
+    TrunkIOBuffer *volatile top;
+    volatile int waiting;  //if the consumer is parked
+    pthread_mutex_t lock;  //for park only
     pthread_cond_t cond;
-    struct fast_mblock_man mblock;
-    union {
-        TrunkFDCacheContext context;
-        TrunkIdFDPair pair;
-    } fd_cache;
     int role;
+    int numa_node;  //the node index to bind, -1 for no binding
+    bool direct_io;
+    bool group_commit;  //sync the trunk files after each write batch
+    //the readers of the same path for work stealing, NULL for disabled
+    struct trunk_io_thread_context_array *siblings;
+    struct {
+        int64_t count;      //the dealt requests
+        int64_t busy_time;  //the total service time in microseconds
+        struct {
+            LatencyHistogram queue_wait;
+            LatencyHistogram service;
+        } types[FS_IO_STAT_TYPE_COUNT];
+    } stat;  //updated by this thread only
+    struct {
+        int count;      //the queued buffers of all classes
+        int64_t vtime;  //the virtual time of the last picked
+        TrunkIOClassQueue queues[FS_IO_CLASS_COUNT];
+        TrunkIORateLimiter *limiters;  //indexed by io class
+        pthread_mutex_t lock;  //only used when work stealing enabled
+    } sched;
+    AlignedBufferPool buffer_pool;  //for direct IO
+    struct {
+        int alloc;
+        TrunkIOBuffer **iobs;  //the slices of current batch
+        struct iovec *iovs;    //NULL for merge disabled
+        char *gap_buff;        //for the discarded data between merged reads
+    } merge;
+#ifdef FS_USE_IO_URING
+    struct {
+        bool enabled;
+        int depth;     //max in-flight requests
+        int inflight;  //prepared and not completed
+        int pending;   //prepared and not submitted
+        struct io_uring ring;
+    } uring;
+#endif
 } TrunkIOThreadContext;
 
 typedef struct trunk_io_thread_context_array {
@@ -49,6 +134,7 @@ typedef struct trunk_io_thread_context_array {
 typedef struct trunk_io_path_context {
     TrunkIOThreadContextArray writes;
     TrunkIOThreadContextArray reads;
+    TrunkIORateLimiter limiters[FS_IO_CLASS_COUNT];
 } TrunkIOPathContext;
 
 typedef struct trunk_io_path_contexts_array {
@@ -57,8 +143,12 @@ typedef struct trunk_io_path_contexts_array {
 } TrunkIOPathContextArray;
 
 static TrunkIOPathContextArray io_path_context_array = {0, NULL};
+static int64_t io_stat_start_time = 0;
+static __thread TrunkIOBufferCache *iob_cache = NULL;
+static pthread_key_t iob_cache_key;  //for freeing when the producer exits
 
 static void *trunk_io_thread_func(void *arg);
+static void iob_cache_on_thread_exit(void *arg);
 
 static int alloc_path_contexts()
 {
@@ -108,29 +198,68 @@ static int init_thread_context(TrunkIOThreadContext *ctx)
         return result;
     }
 
-    if ((result=fast_mblock_init_ex1(&ctx->mblock, "trunk_io_buffer",
-                    sizeof(TrunkIOBuffer), 1024, 0, NULL, NULL, false)) != 0)
-    {
-        return result;
+    if (ctx->siblings != NULL) {
+        if ((result=init_pthread_lock(&ctx->sched.lock)) != 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "init_pthread_lock fail, errno: %d, error info: %s",
+                    __LINE__, result, STRERROR(result));
+            return result;
+        }
     }
 
-    if (ctx->role == IO_THREAD_ROLE_WRITER) {
-        ctx->fd_cache.pair.trunk_id = 0;
-        ctx->fd_cache.pair.fd = -1;
-    } else {
-        if ((result=trunk_fd_cache_init(&ctx->fd_cache.context,
-                        STORAGE_CFG.fd_cache_capacity_per_read_thread)) != 0)
+    if (ctx->direct_io) {
+        if ((result=aligned_buffer_pool_init(&ctx->buffer_pool,
+                        FS_DIRECT_IO_ALIGN_SIZE, FS_FILE_BLOCK_SIZE +
+                        2 * FS_DIRECT_IO_ALIGN_SIZE, (STORAGE_CFG.
+                            io_uring.enabled ? STORAGE_CFG.io_uring.
+                            queue_depth : 2))) != 0)
         {
             return result;
         }
     }
 
+#ifdef FS_USE_IO_URING
+    if (STORAGE_CFG.io_uring.enabled) {
+        ctx->uring.depth = STORAGE_CFG.io_uring.queue_depth;
+        if ((result=io_uring_queue_init(ctx->uring.depth,
+                        &ctx->uring.ring, 0)) == 0)
+        {
+            ctx->uring.enabled = true;
+        } else {
+            logWarning("file: "__FILE__", line: %d, "
+                    "io_uring_queue_init fail, errno: %d, error info: %s, "
+                    "use pread/pwrite instead", __LINE__,
+                    -1 * result, STRERROR(-1 * result));
+        }
+    }
+#endif
+
+    //the user buffers of direct IO are not merged
+    if (STORAGE_CFG.io_merge_max_size > 0 && !ctx->direct_io) {
+        ctx->merge.iovs = (struct iovec *)fc_malloc(
+                sizeof(struct iovec) * IO_MERGE_MAX_IOVS);
+        if (ctx->merge.iovs == NULL) {
+            return ENOMEM;
+        }
+
+        if (ctx->role == IO_THREAD_ROLE_READER &&
+                STORAGE_CFG.read_merge_gap_size > 0)
+        {
+            ctx->merge.gap_buff = (char *)fc_malloc(
+                    STORAGE_CFG.read_merge_gap_size);
+            if (ctx->merge.gap_buff == NULL) {
+                return ENOMEM;
+            }
+        }
+    }
+
     return fc_create_thread(&tid, trunk_io_thread_func,
             ctx, SF_G_THREAD_STACK_SIZE);
 }
 
-static int init_thread_contexts(TrunkIOThreadContextArray *ctx_array,
-        const int role)
+static int init_thread_contexts(TrunkIOPathContext *path_ctx,
+        TrunkIOThreadContextArray *ctx_array, const int role,
+        const bool direct_io, const int numa_node)
 {
     int result;
     TrunkIOThreadContext *ctx;
@@ -139,6 +268,17 @@ static int init_thread_contexts(TrunkIOThreadContextArray *ctx_array,
     end = ctx_array->contexts + ctx_array->count;
     for (ctx=ctx_array->contexts; ctx<end; ctx++) {
         ctx->role = role;
+        ctx->numa_node = numa_node;
+        ctx->direct_io = direct_io;
+        ctx->sched.limiters = path_ctx->limiters;
+        ctx->group_commit = (role == IO_THREAD_ROLE_WRITER &&
+                STORAGE_CFG.durability.mode ==
+                FS_DURABILITY_MODE_GROUP_COMMIT);
+        if (role == IO_THREAD_ROLE_READER && ctx_array->count > 1 &&
+                STORAGE_CFG.read_work_stealing)
+        {
+            ctx->siblings = ctx_array;
+        }
         if ((result=init_thread_context(ctx)) != 0) {
             return result;
         }
@@ -155,10 +295,12 @@ static int init_path_contexts(FSStoragePathArray *parray)
     TrunkIOPathContext *path_ctx;
     int result;
     int thread_count;
+    int numa_node;
 
     end = parray->paths + parray->count;
     for (p=parray->paths; p<end; p++) {
         path_ctx = io_path_context_array.paths + p->store.index;
+        numa_node = numa_topology_store_path_node(p);
         thread_count = p->write_thread_count + p->read_thread_count;
         if ((thread_ctxs=alloc_thread_contexts(thread_count)) == NULL)
         {
@@ -167,16 +309,18 @@ static int init_path_contexts(FSStoragePathArray *parray)
 
         path_ctx->writes.contexts = thread_ctxs;
         path_ctx->writes.count = p->write_thread_count;
-        if ((result=init_thread_contexts(&path_ctx->writes,
-                        IO_THREAD_ROLE_WRITER)) != 0)
+        if ((result=init_thread_contexts(path_ctx, &path_ctx->writes,
+                        IO_THREAD_ROLE_WRITER, p->direct_io,
+                        numa_node)) != 0)
         {
             return result;
         }
 
         path_ctx->reads.contexts = thread_ctxs + p->write_thread_count;
         path_ctx->reads.count = p->read_thread_count;
-        if ((result=init_thread_contexts(&path_ctx->reads,
-                        IO_THREAD_ROLE_READER)) != 0)
+        if ((result=init_thread_contexts(path_ctx, &path_ctx->reads,
+                        IO_THREAD_ROLE_READER, p->direct_io,
+                        numa_node)) != 0)
         {
             return result;
         }
@@ -189,10 +333,25 @@ int trunk_io_thread_init()
 {
     int result;
 
+    if ((result=trunk_fd_cache_init(STORAGE_CFG.fd_cache_capacity)) != 0) {
+        return result;
+    }
+
+    if ((result=pthread_key_create(&iob_cache_key,
+                    iob_cache_on_thread_exit)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "pthread_key_create fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+
     if ((result=alloc_path_contexts()) != 0) {
         return result;
     }
 
+    io_stat_start_time = get_current_time_us();
+
     if ((result=init_path_contexts(&STORAGE_CFG.write_cache)) != 0) {
         return result;
     }
@@ -208,15 +367,230 @@ void trunk_io_thread_terminate()
 {
 }
 
-int trunk_io_thread_push(const int type, const int path_index,
-        const uint64_t hash_code, void *entry, char *buff,
-        trunk_io_notify_func notify_func, void *notify_arg)
+int64_t trunk_io_thread_get_stat_elapsed_time()
+{
+    return get_current_time_us() - io_stat_start_time;
+}
+
+static void get_thread_stats(TrunkIOThreadContextArray *ctx_array,
+        FSIOPathStat *stat)
+{
+    TrunkIOThreadContext *ctx;
+    TrunkIOThreadContext *end;
+    FSIOThreadStat *thread;
+
+    end = ctx_array->contexts + ctx_array->count;
+    for (ctx=ctx_array->contexts; ctx<end && stat->thread_count <
+            FS_IO_STAT_MAX_THREADS_PER_PATH; ctx++)
+    {
+        thread = stat->threads + stat->thread_count++;
+        thread->role = ctx->role;
+        thread->queued = FC_ATOMIC_GET(ctx->sched.count);
+        thread->count = FC_ATOMIC_GET(ctx->stat.count);
+        thread->busy_time = FC_ATOMIC_GET(ctx->stat.busy_time);
+    }
+}
+
+static void merge_latency_stat(TrunkIOPathContext *path_ctx,
+        const int stat_type, const bool is_service,
+        LatencyHistogram *histogram, FSLatencySummary *summary)
+{
+    TrunkIOThreadContextArray *arrays[2];
+    TrunkIOThreadContext *ctx;
+    TrunkIOThreadContext *end;
+    int i;
+
+    memset(histogram, 0, sizeof(*histogram));
+    arrays[0] = &path_ctx->writes;
+    arrays[1] = &path_ctx->reads;
+    for (i=0; i<2; i++) {
+        end = arrays[i]->contexts + arrays[i]->count;
+        for (ctx=arrays[i]->contexts; ctx<end; ctx++) {
+            latency_histogram_merge(histogram, is_service ?
+                    &ctx->stat.types[stat_type].service :
+                    &ctx->stat.types[stat_type].queue_wait);
+        }
+    }
+    latency_histogram_summary(histogram, summary);
+}
+
+int trunk_io_thread_get_path_stat(const int path_index,
+        FSIOPathStat *stat)
+{
+    TrunkIOPathContext *path_ctx;
+    LatencyHistogram *histogram;
+    int i;
+
+    if (path_index < 0 || path_index >= io_path_context_array.count) {
+        return ENOENT;
+    }
+    path_ctx = io_path_context_array.paths + path_index;
+    if (path_ctx->writes.contexts == NULL) {
+        return ENOENT;
+    }
+
+    if ((histogram=(LatencyHistogram *)fc_malloc(
+                    sizeof(LatencyHistogram))) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    for (i=0; i<FS_IO_STAT_TYPE_COUNT; i++) {
+        merge_latency_stat(path_ctx, i, false, histogram,
+                &stat->types[i].queue_wait);
+        merge_latency_stat(path_ctx, i, true, histogram,
+                &stat->types[i].service);
+    }
+    free(histogram);
+
+    stat->thread_count = 0;
+    get_thread_stats(&path_ctx->writes, stat);
+    get_thread_stats(&path_ctx->reads, stat);
+    return 0;
+}
+
+static inline void iob_stack_push(TrunkIOBuffer *volatile *top,
+        TrunkIOBuffer *first, TrunkIOBuffer *last)
+{
+    TrunkIOBuffer *old;
+
+    do {
+        old = *top;
+        last->next = old;
+    } while (!__sync_bool_compare_and_swap(top, old, first));
+}
+
+static inline TrunkIOBuffer *iob_stack_pop_all(TrunkIOBuffer *volatile *top)
+{
+    return (TrunkIOBuffer *)__sync_lock_test_and_set(top, NULL);
+}
+
+static void iob_cache_release(TrunkIOBufferCache *cache, const int count)
+{
+    TrunkIOBufferChunk *chunk;
+
+    if (__sync_sub_and_fetch(&cache->ref_count, count) != 0) {
+        return;
+    }
+
+    while (cache->chunks != NULL) {
+        chunk = cache->chunks;
+        cache->chunks = chunk->next;
+        free(chunk);
+    }
+    free(cache);
+}
+
+//the destructor of the thread key, the producer thread exits
+static void iob_cache_on_thread_exit(void *arg)
+{
+    iob_cache_release((TrunkIOBufferCache *)arg, 1);
+}
+
+static TrunkIOBuffer *iob_cache_alloc()
+{
+    TrunkIOBufferCache *cache;
+    TrunkIOBufferChunk *chunk;
+    TrunkIOBuffer *iob;
+    TrunkIOBuffer *end;
+
+    if ((cache=iob_cache) == NULL) {
+        cache = (TrunkIOBufferCache *)fc_malloc(sizeof(TrunkIOBufferCache));
+        if (cache == NULL) {
+            return NULL;
+        }
+        cache->freelist = NULL;
+        cache->returned = NULL;
+        cache->chunks = NULL;
+        cache->ref_count = 1;
+        if (pthread_setspecific(iob_cache_key, cache) != 0) {
+            free(cache);
+            return NULL;
+        }
+        iob_cache = cache;
+    }
+
+    if (cache->freelist == NULL) {
+        cache->freelist = iob_stack_pop_all(&cache->returned);
+    }
+    if (cache->freelist == NULL) {
+        chunk = (TrunkIOBufferChunk *)fc_malloc(sizeof(TrunkIOBufferChunk));
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = cache->chunks;
+        cache->chunks = chunk;
+
+        iob = chunk->buffers;
+        end = iob + IOB_CACHE_ALLOC_ELEMENTS_ONCE;
+        cache->freelist = iob;
+        for (; iob<end; iob++) {
+            iob->owner = cache;
+            iob->next = (iob + 1 < end ? iob + 1 : NULL);
+        }
+    }
+
+    iob = cache->freelist;
+    cache->freelist = iob->next;
+    __sync_add_and_fetch(&cache->ref_count, 1);
+    return iob;
+}
+
+//return the buffers to the caches of the producers
+static void iob_cache_free_all(TrunkIOBuffer *head)
+{
+    TrunkIOBufferCache *owner;
+    TrunkIOBuffer *first;
+    TrunkIOBuffer *last;
+    int count;
+
+    while (head != NULL) {
+        first = last = head;
+        owner = first->owner;
+        count = 1;
+        while (last->next != NULL && last->next->owner == owner) {
+            last = last->next;
+            count++;
+        }
+        head = last->next;
+        iob_stack_push(&owner->returned, first, last);
+        iob_cache_release(owner, count);
+    }
+}
+
+static inline void trunk_io_wakeup(TrunkIOThreadContext *ctx)
+{
+    pthread_mutex_lock(&ctx->lock);
+    pthread_cond_signal(&ctx->cond);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+static void wakeup_idle_sibling(TrunkIOThreadContext *busy)
+{
+    TrunkIOThreadContextArray *siblings;
+    TrunkIOThreadContext *ctx;
+    int index;
+    int i;
+
+    siblings = busy->siblings;
+    index = busy - siblings->contexts;
+    for (i=1; i<siblings->count; i++) {
+        ctx = siblings->contexts + (index + i) % siblings->count;
+        if (ctx->waiting) {
+            trunk_io_wakeup(ctx);
+            return;
+        }
+    }
+}
+
+int trunk_io_thread_push(const int type, const int io_class,
+        const int path_index, const uint64_t hash_code, void *entry,
+        char *buff, trunk_io_notify_func notify_func, void *notify_arg)
 {
     TrunkIOPathContext *path_ctx;
     TrunkIOThreadContext *thread_ctx;
     TrunkIOThreadContextArray *ctx_array;
     TrunkIOBuffer *iob;
-    bool notify;
 
     path_ctx = io_path_context_array.paths + path_index;
     if (type == FS_IO_TYPE_READ_SLICE) {
@@ -225,15 +599,13 @@ int trunk_io_thread_push(const int type, const int path_index,
         ctx_array = &path_ctx->writes;
     }
 
-    thread_ctx = ctx_array->contexts + hash_code % ctx_array->count;
-    pthread_mutex_lock(&thread_ctx->lock);
-    iob = (TrunkIOBuffer *)fast_mblock_alloc_object(&thread_ctx->mblock);
-    if (iob == NULL) {
-        pthread_mutex_unlock(&thread_ctx->lock);
+    if ((iob=iob_cache_alloc()) == NULL) {
         return ENOMEM;
     }
 
     iob->type = type;
+    iob->io_class = (io_class >= 0 && io_class < FS_IO_CLASS_COUNT) ?
+        io_class : FS_IO_CLASS_FOREGROUND;
     if (type == FS_IO_TYPE_CREATE_TRUNK || type == FS_IO_TYPE_DELETE_TRUNK) {
         iob->space = *((FSTrunkSpaceInfo *)entry);
     } else {
@@ -246,57 +618,41 @@ int trunk_io_thread_push(const int type, const int path_index,
         iob->data.str = NULL;
     }
     iob->data.len = 0;
+    iob->aligned.buff = NULL;
+    iob->fd_entry = NULL;
     iob->notify.func = notify_func;
     iob->notify.arg = notify_arg;
-    iob->next = NULL;
-
-    if (thread_ctx->tail == NULL) {
-        thread_ctx->head = iob;
-        notify = true;
-    } else {
-        thread_ctx->tail->next = iob;
-        notify = false;
-    }
-    thread_ctx->tail = iob;
-    pthread_mutex_unlock(&thread_ctx->lock);
+    iob->push_time = get_current_time_us();
 
-    if (notify) {
-        pthread_cond_signal(&thread_ctx->cond);
+    thread_ctx = ctx_array->contexts + hash_code % ctx_array->count;
+    iob_stack_push(&thread_ctx->top, iob, iob);
+
+    //the CAS above is a full barrier, wakeup only when the consumer parked
+    if (thread_ctx->waiting) {
+        trunk_io_wakeup(thread_ctx);
+    } else if (thread_ctx->siblings != NULL) {
+        //the reader is busy, let an idle sibling steal it
+        wakeup_idle_sibling(thread_ctx);
     }
     return 0;
 }
 
-static inline void get_trunk_filename(FSTrunkSpaceInfo *space,
-        char *trunk_filename, const int size)
-{
-    snprintf(trunk_filename, size, "%s/%04"PRId64"/%06"PRId64,
-            space->store->path.str, space->id_info.subdir,
-            space->id_info.id);
-}
-
-static inline void clear_write_fd(TrunkIOThreadContext *ctx)
-{
-    if (ctx->fd_cache.pair.fd >= 0) {
-        close(ctx->fd_cache.pair.fd);
-        ctx->fd_cache.pair.fd = -1;
-        ctx->fd_cache.pair.trunk_id = 0;
-    }
-}
-
-static int get_write_fd(TrunkIOThreadContext *ctx,
-        FSTrunkSpaceInfo *space, int *fd)
+/* the trunk fd is shared by the read and write threads,
+   call trunk_fd_cache_release after use */
+static int get_trunk_fd(TrunkIOThreadContext *ctx,
+        FSTrunkSpaceInfo *space, TrunkFDCacheEntry **entry)
 {
     char trunk_filename[PATH_MAX];
+    int fd;
     int result;
 
-    if (space->id_info.id == ctx->fd_cache.pair.trunk_id) {
-        *fd = ctx->fd_cache.pair.fd;
+    if ((*entry=trunk_fd_cache_get(space->id_info.id)) != NULL) {
         return 0;
     }
 
-    get_trunk_filename(space, trunk_filename, sizeof(trunk_filename));
-    *fd = open(trunk_filename, O_WRONLY, 0644);
-    if (*fd < 0) {
+    trunk_io_thread_get_filename(space, trunk_filename, sizeof(trunk_filename));
+    fd = open(trunk_filename, O_RDWR | (ctx->direct_io ? O_DIRECT : 0));
+    if (fd < 0) {
         result = errno != 0 ? errno : EACCES;
         logError("file: "__FILE__", line: %d, "
                 "open file \"%s\" fail, errno: %d, error info: %s",
@@ -304,48 +660,171 @@ static int get_write_fd(TrunkIOThreadContext *ctx,
         return result;
     }
 
-    if (ctx->fd_cache.pair.fd >= 0) {
-        close(ctx->fd_cache.pair.fd);
+    if ((*entry=trunk_fd_cache_add(space->id_info.id, fd)) == NULL) {
+        close(fd);
+        return ENOMEM;
+    }
+    return 0;
+}
+
+#define IOB_IO_BUFF(iob)  ((iob)->aligned.buff != NULL ? \
+        (iob)->aligned.buff : (iob)->data.str)
+#define IOB_IO_OFFSET(iob) ((iob)->aligned.buff != NULL ? \
+        (iob)->aligned.offset : (iob)->slice->space.offset)
+#define IOB_IO_LENGTH(iob) ((iob)->aligned.buff != NULL ? \
+        (iob)->aligned.length : FS_SLICE_IO_LENGTH((iob)->slice))
+
+static inline bool direct_io_need_align(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer *iob)
+{
+    return ctx->direct_io && !(FS_DIRECT_IO_IS_ALIGNED(iob->data.str) &&
+            FS_DIRECT_IO_IS_ALIGNED(iob->slice->space.offset) &&
+            FS_DIRECT_IO_IS_ALIGNED(FS_SLICE_IO_LENGTH(iob->slice)));
+}
+
+static int direct_io_read_block(const int fd, char *buff,
+        const int64_t offset)
+{
+    int bytes;
+    int result;
+
+    while ((bytes=pread(fd, buff, FS_DIRECT_IO_ALIGN_SIZE, offset)) < 0) {
+        result = errno != 0 ? errno : EIO;
+        if (result != EINTR) {
+            logError("file: "__FILE__", line: %d, "
+                    "pread fail, offset: %"PRId64", errno: %d, "
+                    "error info: %s", __LINE__, offset,
+                    result, STRERROR(result));
+            return result;
+        }
     }
 
-    ctx->fd_cache.pair.trunk_id = space->id_info.id;
-    ctx->fd_cache.pair.fd = *fd;
+    if (bytes < FS_DIRECT_IO_ALIGN_SIZE) {  //reach end of file
+        memset(buff + bytes, 0, FS_DIRECT_IO_ALIGN_SIZE - bytes);
+    }
     return 0;
 }
 
-static int get_read_fd(TrunkIOThreadContext *ctx,
-        FSTrunkSpaceInfo *space, int *fd)
+/* use the aligned buffer when the user buffer, the offset or the length
+   is not aligned. for write, read the unaligned head and tail blocks
+   first (read-modify-write) unless the tail is the padding of this slice */
+static int direct_io_prepare(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer *iob, const int fd)
 {
-    char trunk_filename[PATH_MAX];
+    FSTrunkSpaceInfo *space;
+    int64_t data_end;
+    int64_t aligned_end;
+    int head_pad;
     int result;
 
-    if ((*fd=trunk_fd_cache_get(&ctx->fd_cache.context,
-                    space->id_info.id)) >= 0)
+    space = &iob->slice->space;
+    data_end = space->offset + FS_SLICE_IO_LENGTH(iob->slice);
+    aligned_end = FS_DIRECT_IO_ALIGN(data_end);
+    iob->aligned.offset = FS_DIRECT_IO_ALIGN_DOWN(space->offset);
+    iob->aligned.length = aligned_end - iob->aligned.offset;
+    if ((iob->aligned.buff=aligned_buffer_pool_alloc(&ctx->buffer_pool,
+                    iob->aligned.length)) == NULL)
     {
+        return ENOMEM;
+    }
+
+    if (iob->type != FS_IO_TYPE_WRITE_SLICE) {
         return 0;
     }
 
-    get_trunk_filename(space, trunk_filename, sizeof(trunk_filename));
-    *fd = open(trunk_filename, O_RDONLY);
-    if (*fd < 0) {
-        result = errno != 0 ? errno : EACCES;
-        logError("file: "__FILE__", line: %d, "
-                "open file \"%s\" fail, errno: %d, error info: %s",
-                __LINE__, trunk_filename, result, STRERROR(result));
-        return result;
+    head_pad = space->offset - iob->aligned.offset;
+    if (head_pad > 0) {
+        if ((result=direct_io_read_block(fd, iob->aligned.buff,
+                        iob->aligned.offset)) != 0)
+        {
+            return result;
+        }
     }
 
-    trunk_fd_cache_add(&ctx->fd_cache.context, space->id_info.id, *fd);
+    if (aligned_end > data_end) {
+        if (aligned_end > space->offset + space->size) {
+            if (!(head_pad > 0 && iob->aligned.length ==
+                        FS_DIRECT_IO_ALIGN_SIZE))
+            {
+                if ((result=direct_io_read_block(fd, iob->aligned.buff +
+                                iob->aligned.length - FS_DIRECT_IO_ALIGN_SIZE,
+                                aligned_end - FS_DIRECT_IO_ALIGN_SIZE)) != 0)
+                {
+                    return result;
+                }
+            }
+        } else {
+            memset(iob->aligned.buff + (data_end - iob->aligned.offset),
+                    0, aligned_end - data_end);
+        }
+    }
+
+    memcpy(iob->aligned.buff + head_pad, iob->data.str,
+            FS_SLICE_IO_LENGTH(iob->slice));
     return 0;
 }
 
+static void direct_io_finish(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer *iob, const int result)
+{
+    if (iob->aligned.buff == NULL) {
+        return;
+    }
+
+    if (result == 0 && iob->type == FS_IO_TYPE_READ_SLICE) {
+        memcpy(iob->data.str, iob->aligned.buff + (iob->slice->
+                    space.offset - iob->aligned.offset),
+                FS_SLICE_IO_LENGTH(iob->slice));
+    }
+    aligned_buffer_pool_free(&ctx->buffer_pool,
+            iob->aligned.buff, iob->aligned.length);
+    iob->aligned.buff = NULL;
+}
+
+static void read_ahead_check(TrunkIOThreadContext *ctx,
+        TrunkFDCacheEntry *entry, const int64_t offset, const int length)
+{
+#ifdef POSIX_FADV_WILLNEED
+    TrunkReadAheadState *ra;
+    int64_t start;
+
+    if (STORAGE_CFG.read_ahead_size == 0 || ctx->direct_io) {
+        return;
+    }
+
+    ra = &entry->read_ahead;
+    if (offset >= ra->next_offset && offset - ra->next_offset <=
+            STORAGE_CFG.read_merge_gap_size)
+    {
+        ra->seq_count++;
+    } else {
+        ra->seq_count = 0;
+        ra->window_end = 0;
+    }
+    ra->next_offset = offset + length;
+
+    //issue the next window when half of the current window consumed
+    if (ra->seq_count < 2 || ra->window_end - ra->next_offset >
+            STORAGE_CFG.read_ahead_size / 2)
+    {
+        return;
+    }
+
+    start = FC_MAX(ra->window_end, ra->next_offset);
+    ra->window_end = ra->next_offset + STORAGE_CFG.read_ahead_size;
+    posix_fadvise(entry->pair.fd, start, ra->window_end - start,
+            POSIX_FADV_WILLNEED);
+#endif
+}
+
 static int do_create_trunk(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
 {
     char trunk_filename[PATH_MAX];
     int fd;
     int result;
 
-    get_trunk_filename(&iob->space, trunk_filename, sizeof(trunk_filename));
+    trunk_io_thread_get_filename(&iob->space,
+            trunk_filename, sizeof(trunk_filename));
     fd = open(trunk_filename, O_WRONLY | O_CREAT, 0644);
     if (fd < 0) {
         if (errno == ENOENT) {
@@ -398,7 +877,9 @@ static int do_delete_trunk(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
     char trunk_filename[PATH_MAX];
     int result;
 
-    get_trunk_filename(&iob->space, trunk_filename, sizeof(trunk_filename));
+    trunk_fd_cache_delete(iob->space.id_info.id);
+    trunk_io_thread_get_filename(&iob->space,
+            trunk_filename, sizeof(trunk_filename));
     if (unlink(trunk_filename) == 0) {
         result = trunk_binlog_write(FS_IO_TYPE_DELETE_TRUNK,
                 iob->space.store->index, &iob->space.id_info,
@@ -415,19 +896,29 @@ static int do_delete_trunk(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
 
 static int do_write_slice(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
 {
+    TrunkFDCacheEntry *entry;
     int fd;
     int remain;
     int bytes;
     int result;
 
-    if ((result=get_write_fd(ctx, &iob->slice->space, &fd)) != 0) {
+    if ((result=get_trunk_fd(ctx, &iob->slice->space, &entry)) != 0) {
         return result;
     }
 
-    remain = iob->slice->ssize.length;
+    fd = entry->pair.fd;
+    if (direct_io_need_align(ctx, iob)) {
+        if ((result=direct_io_prepare(ctx, iob, fd)) != 0) {
+            direct_io_finish(ctx, iob, result);
+            trunk_fd_cache_release(entry);
+            return result;
+        }
+    }
+
+    remain = IOB_IO_LENGTH(iob);
     while (remain > 0) {
-        if ((bytes=pwrite(fd, iob->data.str + iob->data.len, remain,
-                        iob->slice->space.offset + iob->data.len)) < 0)
+        if ((bytes=pwrite(fd, IOB_IO_BUFF(iob) + iob->data.len, remain,
+                        IOB_IO_OFFSET(iob) + iob->data.len)) < 0)
         {
             char trunk_filename[PATH_MAX];
 
@@ -436,15 +927,17 @@ static int do_write_slice(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
                 continue;
             }
 
-            clear_write_fd(ctx);
+            trunk_fd_cache_delete(iob->slice->space.id_info.id);
 
-            get_trunk_filename(&iob->slice->space, trunk_filename,
+            trunk_io_thread_get_filename(&iob->slice->space, trunk_filename,
                     sizeof(trunk_filename));
             logError("file: "__FILE__", line: %d, "
                     "write to trunk file: %s fail, offset: %"PRId64", "
                     "errno: %d, error info: %s", __LINE__, trunk_filename,
-                    iob->slice->space.offset + iob->data.len,
+                    IOB_IO_OFFSET(iob) + iob->data.len,
                     result, STRERROR(result));
+            direct_io_finish(ctx, iob, result);
+            trunk_fd_cache_release(entry);
             return result;
         }
 
@@ -452,42 +945,59 @@ static int do_write_slice(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
         remain -= bytes;
     }
 
+    direct_io_finish(ctx, iob, 0);
+    trunk_fd_cache_release(entry);
     return 0;
 }
 
 static int do_read_slice(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
 {
+    TrunkFDCacheEntry *entry;
     int fd;
     int remain;
     int bytes;
     int result;
 
-    if ((result=get_read_fd(ctx, &iob->slice->space, &fd)) != 0) {
+    if ((result=get_trunk_fd(ctx, &iob->slice->space, &entry)) != 0) {
         return result;
     }
 
-    remain = iob->slice->ssize.length;
+    fd = entry->pair.fd;
+    if (direct_io_need_align(ctx, iob)) {
+        if ((result=direct_io_prepare(ctx, iob, fd)) != 0) {
+            direct_io_finish(ctx, iob, result);
+            trunk_fd_cache_release(entry);
+            return result;
+        }
+    }
+
+    remain = IOB_IO_LENGTH(iob);
     while (remain > 0) {
-        if ((bytes=pread(fd, iob->data.str + iob->data.len, remain,
-                        iob->slice->space.offset + iob->data.len)) < 0)
+        if ((bytes=pread(fd, IOB_IO_BUFF(iob) + iob->data.len, remain,
+                        IOB_IO_OFFSET(iob) + iob->data.len)) <= 0)
         {
             char trunk_filename[PATH_MAX];
 
-            result = errno != 0 ? errno : EIO;
-            if (result == EINTR) {
-                continue;
+            if (bytes == 0) {  //reach end of file
+                result = ENODATA;
+            } else {
+                result = errno != 0 ? errno : EIO;
+                if (result == EINTR) {
+                    continue;
+                }
             }
 
-            trunk_fd_cache_delete(&ctx->fd_cache.context,
-                    iob->slice->space.id_info.id);
+            trunk_fd_cache_delete(iob->slice->space.id_info.id);
 
-            get_trunk_filename(&iob->slice->space, trunk_filename,
+            trunk_io_thread_get_filename(&iob->slice->space, trunk_filename,
                     sizeof(trunk_filename));
             logError("file: "__FILE__", line: %d, "
                     "read trunk file: %s fail, offset: %"PRId64", "
                     "errno: %d, error info: %s", __LINE__, trunk_filename,
-                    iob->slice->space.offset + iob->data.len,
+                    IOB_IO_OFFSET(iob) + iob->data.len,
                     result, STRERROR(result));
+            direct_io_finish(ctx, iob, result);
+            trunk_fd_cache_release(entry);
             return result;
         }
 
@@ -495,13 +1005,62 @@ static int do_read_slice(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
         remain -= bytes;
     }
 
+    read_ahead_check(ctx, entry, IOB_IO_OFFSET(iob), IOB_IO_LENGTH(iob));
+    direct_io_finish(ctx, iob, 0);
+    trunk_fd_cache_release(entry);
     return 0;
 }
 
+static inline int get_io_stat_type(const int type)
+{
+    switch (type) {
+        case FS_IO_TYPE_CREATE_TRUNK:
+            return FS_IO_STAT_TYPE_CREATE_TRUNK;
+        case FS_IO_TYPE_DELETE_TRUNK:
+            return FS_IO_STAT_TYPE_DELETE_TRUNK;
+        case FS_IO_TYPE_READ_SLICE:
+            return FS_IO_STAT_TYPE_READ_SLICE;
+        default:
+            return FS_IO_STAT_TYPE_WRITE_SLICE;
+    }
+}
+
+//the busy time is added by the caller once for the merged IO
+static inline void trunk_io_stat_add(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer *iob, const int64_t start_time,
+        const int64_t end_time)
+{
+    int stat_type;
+
+    stat_type = get_io_stat_type(iob->type);
+    latency_histogram_add(&ctx->stat.types[stat_type].queue_wait,
+            start_time - iob->push_time);
+    latency_histogram_add(&ctx->stat.types[stat_type].service,
+            end_time - start_time);
+    ctx->stat.count++;
+}
+
+static inline void trunk_io_notify(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer *iob, const int result)
+{
+    //the slice writes are notified after the trunk files synced
+    if (ctx->group_commit && iob->type == FS_IO_TYPE_WRITE_SLICE) {
+        iob->result = result;
+        return;
+    }
+
+    if (iob->notify.func != NULL) {
+        iob->notify.func(iob, result);
+    }
+}
+
 static int trunk_io_deal_buffer(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
 {
+    int64_t start_time;
+    int64_t end_time;
     int result;
 
+    start_time = get_current_time_us();
     switch (iob->type) {
         case FS_IO_TYPE_CREATE_TRUNK:
             result = do_create_trunk(ctx, iob);
@@ -522,51 +1081,1001 @@ static int trunk_io_deal_buffer(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
             break;
     }
 
-    if (iob->notify.func != NULL) {
-        iob->notify.func(iob, result);
-    }
+    end_time = get_current_time_us();
+    trunk_io_stat_add(ctx, iob, start_time, end_time);
+    ctx->stat.busy_time += end_time - start_time;
+
+    trunk_io_notify(ctx, iob, result);
     return result;
 }
 
-static void *trunk_io_thread_func(void *arg)
+static int compare_slice_space(const void *p1, const void *p2)
 {
-    TrunkIOThreadContext *ctx;
-    TrunkIOBuffer *iob;
-    TrunkIOBuffer *iob_ptr;
-    TrunkIOBuffer iob_obj;
-    int result;
+    FSTrunkSpaceInfo *s1;
+    FSTrunkSpaceInfo *s2;
+    int sub;
+
+    s1 = &(*((TrunkIOBuffer **)p1))->slice->space;
+    s2 = &(*((TrunkIOBuffer **)p2))->slice->space;
+    if ((sub=fc_compare_int64(s1->id_info.id, s2->id_info.id)) != 0) {
+        return sub;
+    }
+    return fc_compare_int64(s1->offset, s2->offset);
+}
 
-    ctx = (TrunkIOThreadContext *)arg;
-    while (SF_G_CONTINUE_FLAG) {
-        pthread_mutex_lock(&ctx->lock);
-        if (ctx->head == NULL) {
-            pthread_cond_wait(&ctx->cond, &ctx->lock);
+/* return the hole size between the two slices, -1 for can't merge.
+   the next write slice can be merged when it starts at the data end or
+   in the alignment padding of the previous one, and the next read slice
+   can be merged when the hole is small enough */
+static inline int merge_slice_gap(TrunkIOBuffer *prev, TrunkIOBuffer *iob)
+{
+    FSTrunkSpaceInfo *ps;
+    FSTrunkSpaceInfo *s;
+    int64_t data_end;
+
+    ps = &prev->slice->space;
+    s = &iob->slice->space;
+    if (s->id_info.id != ps->id_info.id) {
+        return -1;
+    }
+
+    data_end = ps->offset + FS_SLICE_IO_LENGTH(prev->slice);
+    if (s->offset < data_end) {  //overlapped reads
+        return -1;
+    }
+
+    if (iob->type == FS_IO_TYPE_WRITE_SLICE) {
+        if (s->offset > ps->offset + ps->size ||
+                s->offset - data_end > sizeof(zero_padding))
+        {
+            return -1;
         }
+    } else if (s->offset - data_end > STORAGE_CFG.read_merge_gap_size) {
+        return -1;
+    }
 
-        if (ctx->head == NULL) {
-            iob_ptr = NULL;
-        } else {
-            iob = ctx->head;
-            ctx->head = ctx->head->next;
-            if (ctx->head == NULL) {
-                ctx->tail = NULL;
-            }
+    return s->offset - data_end;
+}
+
+static int do_merged_io(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer **iobs, const int count)
+{
+    TrunkIOBuffer **pp;
+    TrunkIOBuffer **end;
+    FSTrunkSpaceInfo *space;
+    TrunkFDCacheEntry *entry;
+    struct iovec *iov;
+    char *gap_buff;
+    bool is_write;
+    int64_t offset;
+    int iovcnt;
+    int gap;
+    int bytes;
+    int fd;
+    int result;
 
-            iob_ptr = &iob_obj;
-            iob_obj = *iob;
-            fast_mblock_free_object(&ctx->mblock, iob);
+    space = &iobs[0]->slice->space;
+    is_write = (iobs[0]->type == FS_IO_TYPE_WRITE_SLICE);
+    if ((result=get_trunk_fd(ctx, space, &entry)) != 0) {
+        return result;
+    }
+    fd = entry->pair.fd;
+    gap_buff = (is_write ? zero_padding : ctx->merge.gap_buff);
+
+    iov = ctx->merge.iovs;
+    end = iobs + count;
+    for (pp=iobs; pp<end; pp++) {
+        iov->iov_base = (*pp)->data.str;
+        iov->iov_len = FS_SLICE_IO_LENGTH((*pp)->slice);
+        iov++;
+        if (pp + 1 < end && (gap=merge_slice_gap(*pp, *(pp + 1))) > 0) {
+            iov->iov_base = gap_buff;
+            iov->iov_len = gap;
+            iov++;
         }
-        pthread_mutex_unlock(&ctx->lock);
+    }
 
-        if (iob_ptr == NULL) {
-            continue;
+    iovcnt = iov - ctx->merge.iovs;
+    iov = ctx->merge.iovs;
+    offset = space->offset;
+    while (iovcnt > 0) {
+        if (is_write) {
+            bytes = pwritev(fd, iov, iovcnt, offset);
+        } else {
+            bytes = preadv(fd, iov, iovcnt, offset);
         }
 
-        if ((result=trunk_io_deal_buffer(ctx, iob_ptr)) != 0) {
+        if (bytes <= 0) {
+            char trunk_filename[PATH_MAX];
+
+            if (bytes == 0) {  //reach end of file
+                result = (is_write ? EIO : ENODATA);
+            } else {
+                result = errno != 0 ? errno : EIO;
+                if (result == EINTR) {
+                    continue;
+                }
+            }
+
+            trunk_fd_cache_delete(space->id_info.id);
+            trunk_io_thread_get_filename(space, trunk_filename,
+                    sizeof(trunk_filename));
             logError("file: "__FILE__", line: %d, "
-                    "trunk_io_deal_buffer fail, result: %d",
-                    __LINE__, result);
+                    "%s trunk file: %s fail, offset: %"PRId64", "
+                    "merged slices: %d, errno: %d, error info: %s",
+                    __LINE__, (is_write ? "write to" : "read"),
+                    trunk_filename, offset, count,
+                    result, STRERROR(result));
+            trunk_fd_cache_release(entry);
+            return result;
+        }
+
+        //skip the done iovecs for short read / write
+        offset += bytes;
+        while (iovcnt > 0 && bytes >= iov->iov_len) {
+            bytes -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (bytes > 0) {
+            iov->iov_base = (char *)iov->iov_base + bytes;
+            iov->iov_len -= bytes;
+        }
+    }
+
+    if (!is_write) {
+        read_ahead_check(ctx, entry, space->offset, offset - space->offset);
+    }
+    trunk_fd_cache_release(entry);
+
+    for (pp=iobs; pp<end; pp++) {
+        (*pp)->data.len = FS_SLICE_IO_LENGTH((*pp)->slice);
+    }
+    return 0;
+}
+
+static void deal_merged_slices(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer **iobs, const int count)
+{
+    TrunkIOBuffer **start;
+    TrunkIOBuffer **next;
+    TrunkIOBuffer **pp;
+    TrunkIOBuffer **end;
+    int64_t start_time;
+    int64_t end_time;
+    int merged_bytes;
+    int iovcnt;
+    int gap;
+    int result;
+
+    /* the spaces of the write slices never overlap and the reads
+       are independent, so the slices can be reordered */
+    if (count > 1) {
+        qsort(iobs, count, sizeof(TrunkIOBuffer *), compare_slice_space);
+    }
+
+    end = iobs + count;
+    start = iobs;
+    while (start < end) {
+        merged_bytes = FS_SLICE_IO_LENGTH((*start)->slice);
+        iovcnt = 1;
+        for (next=start + 1; next<end; next++) {
+            if ((gap=merge_slice_gap(*(next - 1), *next)) < 0 ||
+                    merged_bytes + gap + FS_SLICE_IO_LENGTH(
+                        (*next)->slice) >
+                    STORAGE_CFG.io_merge_max_size ||
+                    iovcnt + 2 > IO_MERGE_MAX_IOVS)
+            {
+                break;
+            }
+
+            merged_bytes += gap + FS_SLICE_IO_LENGTH((*next)->slice);
+            iovcnt += (gap > 0 ? 2 : 1);
+        }
+
+        if (next - start == 1) {
+            trunk_io_deal_buffer(ctx, *start);
+        } else {
+            start_time = get_current_time_us();
+            result = do_merged_io(ctx, start, next - start);
+            end_time = get_current_time_us();
+            ctx->stat.busy_time += end_time - start_time;
+            for (pp=start; pp<next; pp++) {
+                trunk_io_stat_add(ctx, *pp, start_time, end_time);
+                trunk_io_notify(ctx, *pp, result);
+            }
+        }
+        start = next;
+    }
+}
+
+static int merge_check_alloc(TrunkIOThreadContext *ctx, const int target)
+{
+    TrunkIOBuffer **iobs;
+    int alloc;
+
+    if (ctx->merge.alloc >= target) {
+        return 0;
+    }
+
+    alloc = (ctx->merge.alloc > 0 ? ctx->merge.alloc * 2 : 256);
+    iobs = (TrunkIOBuffer **)fc_realloc(ctx->merge.iobs,
+            sizeof(TrunkIOBuffer *) * alloc);
+    if (iobs == NULL) {
+        return ENOMEM;
+    }
+
+    ctx->merge.iobs = iobs;
+    ctx->merge.alloc = alloc;
+    return 0;
+}
+
+/* collect the consecutive slice reads / writes between the trunk
+   operations, sort them by trunk id and offset, then merge the
+   contiguous ones */
+static void merge_deal_batch(TrunkIOThreadContext *ctx, TrunkIOBuffer *head)
+{
+    TrunkIOBuffer *iob;
+    int count;
+
+    count = 0;
+    for (iob=head; ; iob=iob->next) {
+        if (iob != NULL && (iob->type == FS_IO_TYPE_WRITE_SLICE ||
+                    iob->type == FS_IO_TYPE_READ_SLICE))
+        {
+            if (merge_check_alloc(ctx, count + 1) == 0) {
+                ctx->merge.iobs[count++] = iob;
+                continue;
+            }
+        }
+
+        if (count > 0) {
+            deal_merged_slices(ctx, ctx->merge.iobs, count);
+            count = 0;
+        }
+        if (iob == NULL) {
+            break;
+        }
+        trunk_io_deal_buffer(ctx, iob);
+    }
+}
+
+#ifdef FS_USE_IO_URING
+static inline int uring_submit(TrunkIOThreadContext *ctx)
+{
+    int result;
+
+    while (ctx->uring.pending > 0) {
+        if ((result=io_uring_submit(&ctx->uring.ring)) < 0) {
+            if (result == -EINTR || result == -EAGAIN) {
+                continue;
+            }
+            return -1 * result;
+        } else if (result == 0) {
+            break;
+        }
+        ctx->uring.pending -= result;
+    }
+
+    return 0;
+}
+
+static int uring_prep_slice(TrunkIOThreadContext *ctx, TrunkIOBuffer *iob)
+{
+    struct io_uring_sqe *sqe;
+    int fd;
+    int result;
+
+    //hold the fd until the request completed
+    if (iob->fd_entry == NULL) {
+        if ((result=get_trunk_fd(ctx, &iob->slice->space,
+                        &iob->fd_entry)) != 0)
+        {
+            return result;
+        }
+    }
+    fd = iob->fd_entry->pair.fd;
+
+    if (iob->data.len == 0 && iob->aligned.buff == NULL &&
+            direct_io_need_align(ctx, iob))
+    {
+        if ((result=direct_io_prepare(ctx, iob, fd)) != 0) {
+            return result;
+        }
+    }
+
+    if ((sqe=io_uring_get_sqe(&ctx->uring.ring)) == NULL) {
+        if ((result=uring_submit(ctx)) != 0) {
+            return result;
+        }
+        if ((sqe=io_uring_get_sqe(&ctx->uring.ring)) == NULL) {
+            return EBUSY;
+        }
+    }
+
+    if (iob->type == FS_IO_TYPE_READ_SLICE && iob->data.len == 0) {
+        read_ahead_check(ctx, iob->fd_entry, IOB_IO_OFFSET(iob),
+                IOB_IO_LENGTH(iob));
+    }
+
+    if (iob->type == FS_IO_TYPE_WRITE_SLICE) {
+        io_uring_prep_write(sqe, fd, IOB_IO_BUFF(iob) + iob->data.len,
+                IOB_IO_LENGTH(iob) - iob->data.len,
+                IOB_IO_OFFSET(iob) + iob->data.len);
+    } else {
+        io_uring_prep_read(sqe, fd, IOB_IO_BUFF(iob) + iob->data.len,
+                IOB_IO_LENGTH(iob) - iob->data.len,
+                IOB_IO_OFFSET(iob) + iob->data.len);
+    }
+    io_uring_sqe_set_data(sqe, iob);
+
+    ctx->uring.pending++;
+    ctx->uring.inflight++;
+    return 0;
+}
+
+static void uring_slice_done(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer *iob, const int result)
+{
+    char trunk_filename[PATH_MAX];
+    int64_t end_time;
+
+    end_time = get_current_time_us();
+    trunk_io_stat_add(ctx, iob, iob->start_time, end_time);
+    ctx->stat.busy_time += end_time - iob->start_time;
+
+    if (result != 0) {
+        trunk_fd_cache_delete(iob->slice->space.id_info.id);
+        trunk_io_thread_get_filename(&iob->slice->space, trunk_filename,
+                sizeof(trunk_filename));
+        logError("file: "__FILE__", line: %d, "
+                "%s trunk file: %s fail, offset: %"PRId64", "
+                "errno: %d, error info: %s", __LINE__,
+                (iob->type == FS_IO_TYPE_WRITE_SLICE ?
+                 "write to" : "read"), trunk_filename,
+                IOB_IO_OFFSET(iob) + iob->data.len,
+                result, STRERROR(result));
+    }
+
+    direct_io_finish(ctx, iob, result);
+    if (iob->fd_entry != NULL) {
+        trunk_fd_cache_release(iob->fd_entry);
+        iob->fd_entry = NULL;
+    }
+    trunk_io_notify(ctx, iob, result);
+}
+
+static void uring_deal_cqe(TrunkIOThreadContext *ctx,
+        struct io_uring_cqe *cqe)
+{
+    TrunkIOBuffer *iob;
+    int result;
+
+    iob = (TrunkIOBuffer *)io_uring_cqe_get_data(cqe);
+    if (cqe->res < 0) {
+        result = -1 * cqe->res;
+    } else if (cqe->res == 0) {
+        result = (iob->type == FS_IO_TYPE_READ_SLICE ? ENODATA : EIO);
+    } else {
+        iob->data.len += cqe->res;
+        result = 0;
+    }
+    io_uring_cqe_seen(&ctx->uring.ring, cqe);
+    ctx->uring.inflight--;
+
+    if (result == EINTR || result == EAGAIN || (result == 0 &&
+                iob->data.len < IOB_IO_LENGTH(iob)))
+    {
+        //resubmit for interrupted or short read / write
+        if ((result=uring_prep_slice(ctx, iob)) == 0) {
+            return;
+        }
+    }
+
+    uring_slice_done(ctx, iob, result);
+}
+
+//reap one completion at least when wait_nr > 0
+static int uring_reap(TrunkIOThreadContext *ctx, const int wait_nr)
+{
+    struct io_uring_cqe *cqe;
+    int result;
+
+    if ((result=uring_submit(ctx)) != 0) {
+        return result;
+    }
+
+    if (wait_nr > 0 && ctx->uring.inflight > 0) {
+        while ((result=io_uring_wait_cqe(&ctx->uring.ring, &cqe)) != 0) {
+            if (result != -EINTR) {
+                return -1 * result;
+            }
+        }
+        uring_deal_cqe(ctx, cqe);
+    }
+
+    while (ctx->uring.inflight > 0 && io_uring_peek_cqe(
+                &ctx->uring.ring, &cqe) == 0)
+    {
+        uring_deal_cqe(ctx, cqe);
+    }
+
+    return uring_submit(ctx);
+}
+
+static int uring_drain(TrunkIOThreadContext *ctx)
+{
+    int result;
+
+    while (ctx->uring.inflight > 0) {
+        if ((result=uring_reap(ctx, 1)) != 0) {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+static void uring_deal_batch(TrunkIOThreadContext *ctx, TrunkIOBuffer *head)
+{
+    TrunkIOBuffer *iob;
+    int result;
+
+    for (iob=head; iob!=NULL; iob=iob->next) {
+        if (!(iob->type == FS_IO_TYPE_WRITE_SLICE ||
+                    iob->type == FS_IO_TYPE_READ_SLICE))
+        {
+            //trunk create / delete must be done in order
+            if ((result=uring_drain(ctx)) != 0) {
+                break;
+            }
+            trunk_io_deal_buffer(ctx, iob);
+            continue;
+        }
+
+        result = 0;
+        while (ctx->uring.inflight >= ctx->uring.depth) {
+            if ((result=uring_reap(ctx, 1)) != 0) {
+                break;
+            }
+        }
+
+        iob->start_time = get_current_time_us();
+        if (result == 0) {
+            result = uring_prep_slice(ctx, iob);
+        }
+        if (result != 0) {
+            uring_slice_done(ctx, iob, result);
+        }
+    }
+
+    if ((result=uring_drain(ctx)) != 0) {
+        logCrit("file: "__FILE__", line: %d, "
+                "io_uring wait completion fail, errno: %d, error info: %s, "
+                "program exit!", __LINE__, result, STRERROR(result));
+        sf_terminate_myself();
+    }
+}
+#endif
+
+static int sync_trunk_file(TrunkIOThreadContext *ctx,
+        FSTrunkSpaceInfo *space)
+{
+    TrunkFDCacheEntry *entry;
+    char trunk_filename[PATH_MAX];
+    int result;
+
+    if ((result=get_trunk_fd(ctx, space, &entry)) != 0) {
+        return result;
+    }
+
+    while (fdatasync(entry->pair.fd) != 0) {
+        result = errno != 0 ? errno : EIO;
+        if (result != EINTR) {
+            break;
+        }
+        result = 0;
+    }
+
+    trunk_fd_cache_release(entry);
+    if (result != 0) {
+        trunk_fd_cache_delete(space->id_info.id);
+        trunk_io_thread_get_filename(space,
+                trunk_filename, sizeof(trunk_filename));
+        logError("file: "__FILE__", line: %d, "
+                "fdatasync trunk file: %s fail, errno: %d, error info: %s",
+                __LINE__, trunk_filename, result, STRERROR(result));
+    }
+    return result;
+}
+
+/* group commit: sync each written trunk file once for the batch,
+   then notify the slice writes */
+static void trunk_io_sync_batch(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer *head)
+{
+    TrunkIOBuffer *iob;
+    TrunkIOBuffer **start;
+    TrunkIOBuffer **next;
+    TrunkIOBuffer **pp;
+    TrunkIOBuffer **end;
+    int64_t start_time;
+    int write_count;
+    int count;
+    int result;
+
+    write_count = 0;
+    for (iob=head; iob!=NULL; iob=iob->next) {
+        if (iob->type == FS_IO_TYPE_WRITE_SLICE) {
+            ++write_count;
+        }
+    }
+    if (write_count == 0) {
+        return;
+    }
+
+    start_time = get_current_time_us();
+    if (merge_check_alloc(ctx, write_count) == 0) {
+        count = 0;
+        for (iob=head; iob!=NULL; iob=iob->next) {
+            if (iob->type == FS_IO_TYPE_WRITE_SLICE && iob->result == 0) {
+                ctx->merge.iobs[count++] = iob;
+            }
+        }
+        if (count > 1) {
+            qsort(ctx->merge.iobs, count, sizeof(TrunkIOBuffer *),
+                    compare_slice_space);
+        }
+
+        end = ctx->merge.iobs + count;
+        for (start=ctx->merge.iobs; start<end; start=next) {
+            for (next=start + 1; next<end && (*next)->slice->space.
+                    id_info.id == (*start)->slice->space.id_info.id;
+                    next++)
+            {
+            }
+
+            if ((result=sync_trunk_file(ctx, &(*start)->
+                            slice->space)) != 0)
+            {
+                for (pp=start; pp<next; pp++) {
+                    (*pp)->result = result;
+                }
+            }
+        }
+    } else {  //no memory to sort, sync one by one
+        for (iob=head; iob!=NULL; iob=iob->next) {
+            if (iob->type == FS_IO_TYPE_WRITE_SLICE && iob->result == 0) {
+                iob->result = sync_trunk_file(ctx, &iob->slice->space);
+            }
+        }
+    }
+    durability_add_trunk_sync_stat(write_count,
+            get_current_time_us() - start_time);
+
+    for (iob=head; iob!=NULL; iob=iob->next) {
+        if (iob->type == FS_IO_TYPE_WRITE_SLICE &&
+                iob->notify.func != NULL)
+        {
+            iob->notify.func(iob, iob->result);
+        }
+    }
+}
+
+static void trunk_io_deal_batch(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer *head)
+{
+    TrunkIOBuffer *iob;
+    int result;
+
+#ifdef FS_USE_IO_URING
+    if (ctx->uring.enabled) {
+        uring_deal_batch(ctx, head);
+    } else
+#endif
+    if (ctx->merge.iovs != NULL) {
+        merge_deal_batch(ctx, head);
+    } else {
+        for (iob=head; iob!=NULL; iob=iob->next) {
+            if ((result=trunk_io_deal_buffer(ctx, iob)) != 0) {
+                logError("file: "__FILE__", line: %d, "
+                        "trunk_io_deal_buffer fail, result: %d",
+                        __LINE__, result);
+            }
+        }
+    }
+
+    if (ctx->group_commit) {
+        trunk_io_sync_batch(ctx, head);
+    }
+}
+
+static inline int64_t sched_iob_cost(TrunkIOBuffer *iob)
+{
+    if (iob->type == FS_IO_TYPE_WRITE_SLICE ||
+            iob->type == FS_IO_TYPE_READ_SLICE)
+    {
+        return IO_SCHED_BASE_COST + FS_SLICE_IO_LENGTH(iob->slice);
+    } else {
+        return IO_SCHED_BASE_COST;
+    }
+}
+
+static void sched_enqueue_all(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer *head)
+{
+    TrunkIOClassQueue *queue;
+    TrunkIOBuffer *iob;
+
+    while (head != NULL) {
+        iob = head;
+        head = head->next;
+        iob->next = NULL;
+
+        queue = ctx->sched.queues + iob->io_class;
+        if (queue->head == NULL) {
+            //the idle class can't accumulate the credit
+            if (queue->vtime < ctx->sched.vtime) {
+                queue->vtime = ctx->sched.vtime;
+            }
+            queue->head = iob;
+        } else {
+            queue->tail->next = iob;
+        }
+        queue->tail = iob;
+        ctx->sched.count++;
+    }
+}
+
+static inline int64_t rate_limit_wait(volatile int64_t *tat,
+        const int64_t now)
+{
+    return FC_ATOMIC_GET(*tat) - now - IO_SCHED_LIMIT_BURST_US;
+}
+
+static inline void rate_limit_consume(volatile int64_t *tat,
+        const int64_t now, const int64_t cost_us)
+{
+    int64_t old;
+    int64_t start;
+
+    do {
+        old = FC_ATOMIC_GET(*tat);
+        start = (old > now ? old : now);
+    } while (!__sync_bool_compare_and_swap(tat, old, start + cost_us));
+}
+
+//return the time to wait in microseconds, <= 0 for no wait
+static int64_t sched_limit_wait(TrunkIOThreadContext *ctx,
+        const int io_class, const int64_t now)
+{
+    TrunkIORateLimiter *limiter;
+    int64_t wait_us;
+    int64_t iops_wait_us;
+
+    limiter = ctx->sched.limiters + io_class;
+    wait_us = 0;
+    if (STORAGE_CFG.io_classes[io_class].max_bandwidth > 0) {
+        wait_us = rate_limit_wait(&limiter->bytes_tat, now);
+    }
+    if (STORAGE_CFG.io_classes[io_class].max_iops > 0) {
+        iops_wait_us = rate_limit_wait(&limiter->iops_tat, now);
+        if (iops_wait_us > wait_us) {
+            wait_us = iops_wait_us;
+        }
+    }
+    return wait_us;
+}
+
+static void sched_limit_consume(TrunkIOThreadContext *ctx,
+        TrunkIOBuffer *iob, const int64_t now)
+{
+    TrunkIORateLimiter *limiter;
+    int64_t max_bandwidth;
+    int max_iops;
+
+    limiter = ctx->sched.limiters + iob->io_class;
+    max_bandwidth = STORAGE_CFG.io_classes[iob->io_class].max_bandwidth;
+    if (max_bandwidth > 0 && (iob->type == FS_IO_TYPE_WRITE_SLICE ||
+                iob->type == FS_IO_TYPE_READ_SLICE))
+    {
+        rate_limit_consume(&limiter->bytes_tat, now, (int64_t)
+                FS_SLICE_IO_LENGTH(iob->slice) * 1000000 / max_bandwidth);
+    }
+
+    max_iops = STORAGE_CFG.io_classes[iob->io_class].max_iops;
+    if (max_iops > 0) {
+        rate_limit_consume(&limiter->iops_tat, now, 1000000 / max_iops);
+    }
+}
+
+/* pick a batch from the class queues by weighted fair queueing, the class
+   with the min virtual time goes first. return NULL when none picked and
+   set the timeout for the next pop: -1 for no queued buffer, otherwise
+   the time to wait for the rate limiters */
+static TrunkIOBuffer *sched_pick_batch(TrunkIOThreadContext *ctx,
+        int64_t *timeout_us)
+{
+    TrunkIOClassQueue *queue;
+    TrunkIOClassQueue *selected;
+    TrunkIOBuffer *head;
+    TrunkIOBuffer *tail;
+    TrunkIOBuffer *iob;
+    int64_t now;
+    int64_t wait_us;
+    int64_t min_wait_us;
+    int io_class;
+    int count;
+    int i;
+
+    if (ctx->sched.count == 0) {
+        *timeout_us = -1;
+        return NULL;
+    }
+
+    now = get_current_time_us();
+    head = tail = NULL;
+    min_wait_us = 0;
+    count = 0;
+    while (count < IO_SCHED_BATCH_MAX_COUNT && ctx->sched.count > 0) {
+        selected = NULL;
+        io_class = 0;
+        for (i=0; i<FS_IO_CLASS_COUNT; i++) {
+            queue = ctx->sched.queues + i;
+            if (queue->head == NULL) {
+                continue;
+            }
+
+            if ((wait_us=sched_limit_wait(ctx, i, now)) > 0) {
+                if (min_wait_us == 0 || wait_us < min_wait_us) {
+                    min_wait_us = wait_us;
+                }
+                continue;
+            }
+
+            if (selected == NULL || queue->vtime < selected->vtime) {
+                selected = queue;
+                io_class = i;
+            }
         }
+        if (selected == NULL) {
+            break;
+        }
+
+        iob = selected->head;
+        if ((selected->head=iob->next) == NULL) {
+            selected->tail = NULL;
+        }
+        iob->next = NULL;
+        ctx->sched.count--;
+
+        ctx->sched.vtime = selected->vtime;
+        selected->vtime += sched_iob_cost(iob) * IO_SCHED_WEIGHT_SCALE /
+            STORAGE_CFG.io_classes[io_class].weight;
+        sched_limit_consume(ctx, iob, now);
+
+        if (head == NULL) {
+            head = iob;
+        } else {
+            tail->next = iob;
+        }
+        tail = iob;
+        ++count;
+    }
+
+    if (head == NULL) {
+        *timeout_us = min_wait_us;
+    }
+    return head;
+}
+
+static inline void get_expire_timespec(const int64_t timeout_us,
+        struct timespec *ts)
+{
+    int64_t nsec;
+
+    clock_gettime(CLOCK_REALTIME, ts);
+    nsec = ts->tv_nsec + timeout_us * 1000;
+    ts->tv_sec += nsec / 1000000000;
+    ts->tv_nsec = nsec % 1000000000;
+}
+
+static inline TrunkIOBuffer *iob_list_reverse(TrunkIOBuffer *iob)
+{
+    TrunkIOBuffer *head;
+    TrunkIOBuffer *next;
+
+    head = NULL;
+    while (iob != NULL) {
+        next = iob->next;
+        iob->next = head;
+        head = iob;
+        iob = next;
+    }
+    return head;
+}
+
+/* timeout_us: 0 for no wait, < 0 for wait until the buffer arrived */
+static TrunkIOBuffer *trunk_io_pop_all(TrunkIOThreadContext *ctx,
+        const int64_t timeout_us)
+{
+    TrunkIOBuffer *head;
+    struct timespec ts;
+
+    if ((head=iob_stack_pop_all(&ctx->top)) == NULL) {
+        if (timeout_us == 0) {
+            return NULL;
+        }
+
+        pthread_mutex_lock(&ctx->lock);
+        ctx->waiting = 1;
+        __sync_synchronize();
+        if ((head=iob_stack_pop_all(&ctx->top)) == NULL) {
+            if (timeout_us < 0) {
+                pthread_cond_wait(&ctx->cond, &ctx->lock);
+            } else {
+                get_expire_timespec(timeout_us, &ts);
+                pthread_cond_timedwait(&ctx->cond, &ctx->lock, &ts);
+            }
+        }
+        ctx->waiting = 0;
+        pthread_mutex_unlock(&ctx->lock);
+
+        if (head == NULL && (head=iob_stack_pop_all(&ctx->top)) == NULL) {
+            return NULL;
+        }
+    }
+
+    return iob_list_reverse(head);
+}
+
+static inline void sched_lock(TrunkIOThreadContext *ctx)
+{
+    if (ctx->siblings != NULL) {
+        pthread_mutex_lock(&ctx->sched.lock);
+    }
+}
+
+static inline void sched_unlock(TrunkIOThreadContext *ctx)
+{
+    if (ctx->siblings != NULL) {
+        pthread_mutex_unlock(&ctx->sched.lock);
+    }
+}
+
+/* steal the older half of the queued buffers in class order, the
+   foreground reads go first */
+static TrunkIOBuffer *steal_queued_buffers(TrunkIOThreadContext *victim)
+{
+    TrunkIOClassQueue *queue;
+    TrunkIOBuffer *head;
+    TrunkIOBuffer *tail;
+    int remain;
+    int i;
+
+    head = tail = NULL;
+    pthread_mutex_lock(&victim->sched.lock);
+    remain = victim->sched.count / 2;
+    for (i=0; i<FS_IO_CLASS_COUNT && remain > 0; i++) {
+        queue = victim->sched.queues + i;
+        while (queue->head != NULL && remain > 0) {
+            if (head == NULL) {
+                head = queue->head;
+            } else {
+                tail->next = queue->head;
+            }
+            tail = queue->head;
+            queue->head = queue->head->next;
+            victim->sched.count--;
+            remain--;
+        }
+        if (queue->head == NULL) {
+            queue->tail = NULL;
+        }
+    }
+    pthread_mutex_unlock(&victim->sched.lock);
+
+    if (tail != NULL) {
+        tail->next = NULL;
+    }
+    return head;
+}
+
+/* the reads have no order requirement, so the idle reader takes the
+   buffers from the busiest sibling: half of its class queues and all
+   of its arrivals which not popped yet */
+static TrunkIOBuffer *steal_from_siblings(TrunkIOThreadContext *ctx)
+{
+    TrunkIOThreadContextArray *siblings;
+    TrunkIOThreadContext *sibling;
+    TrunkIOThreadContext *victim;
+    TrunkIOThreadContext *end;
+    TrunkIOBuffer *head;
+    TrunkIOBuffer *arrivals;
+    TrunkIOBuffer *tail;
+    int queued;
+    int max_queued;
+
+    siblings = ctx->siblings;
+    victim = NULL;
+    max_queued = 0;
+    end = siblings->contexts + siblings->count;
+    for (sibling=siblings->contexts; sibling<end; sibling++) {
+        if (sibling == ctx) {
+            continue;
+        }
+
+        queued = FC_ATOMIC_GET(sibling->sched.count);
+        if (sibling->top != NULL) {
+            queued++;
+        }
+        if (queued > max_queued) {
+            max_queued = queued;
+            victim = sibling;
+        }
+    }
+
+    //the parked sibling deals its arrivals soon
+    if (victim == NULL || (max_queued < IO_STEAL_MIN_QUEUED_COUNT &&
+                victim->waiting))
+    {
+        return NULL;
+    }
+
+    head = steal_queued_buffers(victim);
+    if ((arrivals=iob_stack_pop_all(&victim->top)) != NULL) {
+        arrivals = iob_list_reverse(arrivals);
+        if (head == NULL) {
+            head = arrivals;
+        } else {
+            tail = head;
+            while (tail->next != NULL) {
+                tail = tail->next;
+            }
+            tail->next = arrivals;
+        }
+    }
+
+    return head;
+}
+
+static void *trunk_io_thread_func(void *arg)
+{
+    TrunkIOThreadContext *ctx;
+    TrunkIOBuffer *head;
+    int64_t timeout_us;
+
+    ctx = (TrunkIOThreadContext *)arg;
+    numa_topology_bind_thread(ctx->numa_node);
+    timeout_us = -1;
+    while (SF_G_CONTINUE_FLAG) {
+        //move the arrived buffers to the queues of their IO classes
+        if ((head=trunk_io_pop_all(ctx, timeout_us)) != NULL) {
+            sched_lock(ctx);
+            sched_enqueue_all(ctx, head);
+            sched_unlock(ctx);
+        }
+
+        //the picked buffers are dealt as a batch
+        sched_lock(ctx);
+        head = sched_pick_batch(ctx, &timeout_us);
+        sched_unlock(ctx);
+        if (head == NULL) {
+            //nothing queued, try to steal before park
+            if (timeout_us < 0 && ctx->siblings != NULL &&
+                    (head=steal_from_siblings(ctx)) != NULL)
+            {
+                sched_lock(ctx);
+                sched_enqueue_all(ctx, head);
+                sched_unlock(ctx);
+                timeout_us = 0;
+            }
+            continue;
+        }
+        timeout_us = 0;  //check the new arrivals without waiting
+
+        trunk_io_deal_batch(ctx, head);
+        iob_cache_free_all(head);
     }
 
     return NULL;
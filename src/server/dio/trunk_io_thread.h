@@ -20,6 +20,7 @@
 #include "../../common/fs_types.h"
 #include "../storage/storage_config.h"
 #include "../storage/object_block_index.h"
+#include "trunk_fd_cache.h"
 
 #define FS_IO_TYPE_CREATE_TRUNK   'C'
 #define FS_IO_TYPE_DELETE_TRUNK   'D'
@@ -27,6 +28,7 @@
 #define FS_IO_TYPE_WRITE_SLICE    'W'
 
 struct trunk_io_buffer;
+struct trunk_io_buffer_cache;
 
 //Note: the record can NOT be persisted
 typedef void (*trunk_io_notify_func)(struct trunk_io_buffer *record,
@@ -34,6 +36,7 @@ typedef void (*trunk_io_notify_func)(struct trunk_io_buffer *record,
 
 typedef struct trunk_io_buffer {
     int type;
+    int io_class;  //FS_IO_CLASS_xxx
 
     union {
         FSTrunkSpaceInfo space;  //for trunk op
@@ -41,10 +44,20 @@ typedef struct trunk_io_buffer {
     };
 
     string_t data;
+    struct {
+        char *buff;      //aligned buffer for direct IO, NULL for none
+        int64_t offset;  //aligned offset of the trunk file
+        int length;      //aligned IO length
+    } aligned;
+    TrunkFDCacheEntry *fd_entry;  //hold the trunk fd for async IO
+    int result;  //for the deferred notify of group commit
+    int64_t push_time;   //in microseconds, for the queue wait stat
+    int64_t start_time;  //the start time of the async IO
     struct {
         trunk_io_notify_func func;
         void *arg;
     } notify;
+    struct trunk_io_buffer_cache *owner;  //the cache of the producer thread
     struct trunk_io_buffer *next;
 } TrunkIOBuffer;
 
@@ -55,26 +68,41 @@ extern "C" {
     int trunk_io_thread_init();
     void trunk_io_thread_terminate();
 
-    int trunk_io_thread_push(const int type, const int path_index,
-            const uint64_t hash_code, void *entry, char *buff,
-            trunk_io_notify_func notify_func, void *notify_arg);
+    static inline void trunk_io_thread_get_filename(
+            const FSTrunkSpaceInfo *space, char *trunk_filename,
+            const int size)
+    {
+        snprintf(trunk_filename, size, "%s/%04"PRId64"/%06"PRId64,
+                space->store->path.str, space->id_info.subdir,
+                space->id_info.id);
+    }
+
+    //the elapsed time in microseconds since the IO threads started
+    int64_t trunk_io_thread_get_stat_elapsed_time();
+
+    int trunk_io_thread_get_path_stat(const int path_index,
+            FSIOPathStat *stat);
+
+    int trunk_io_thread_push(const int type, const int io_class,
+            const int path_index, const uint64_t hash_code, void *entry,
+            char *buff, trunk_io_notify_func notify_func, void *notify_arg);
 
     static inline int io_thread_push_trunk_op(const int type,
             const FSTrunkSpaceInfo *space, trunk_io_notify_func
             notify_func, void *notify_arg)
     {
-        return trunk_io_thread_push(type, space->store->index,
-                space->id_info.id, (void *)space, NULL,
-                notify_func, notify_arg);
+        return trunk_io_thread_push(type, FS_IO_CLASS_MAINTENANCE,
+                space->store->index, space->id_info.id, (void *)space,
+                NULL, notify_func, notify_arg);
     }
 
     static inline int io_thread_push_slice_op(const int type,
-            OBSliceEntry *slice, char *buff, trunk_io_notify_func
-            notify_func, void *notify_arg)
+            const int io_class, OBSliceEntry *slice, char *buff,
+            trunk_io_notify_func notify_func, void *notify_arg)
     {
-        return trunk_io_thread_push(type, slice->space.store->index,
-                FS_BLOCK_HASH_CODE(slice->ob->bkey), slice, buff,
-                notify_func, notify_arg);
+        return trunk_io_thread_push(type, io_class,
+                slice->space.store->index, FS_BLOCK_HASH_CODE(
+                    slice->ob->bkey), slice, buff, notify_func, notify_arg);
     }
 
 #ifdef __cplusplus
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fs_compress_bench.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "server_global.h"
+#include "storage/slice_compressor.h"
+
+#define BENCH_DEFAULT_SLICE_SIZE   (1024 * 1024)
+#define BENCH_DEFAULT_SLICE_COUNT  64
+#define BENCH_MIN_SECONDS          1.0
+
+typedef struct {
+    char *data;
+    int slice_size;
+    int slice_count;
+} BenchDataSet;
+
+typedef struct {
+    char *buff;
+    int length;    //0 for the incompressible slice
+} BenchCompressed;
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-s slice_size=%d] [-c slice_count=%d] "
+            "[-l zstd_level=%d] [-f data_filename]\n"
+            "\tthe text like data is generated when no data file, "
+            "the data file is\n\tsplit to the slices and read "
+            "slice_size * slice_count bytes at most\n", argv[0],
+            BENCH_DEFAULT_SLICE_SIZE, BENCH_DEFAULT_SLICE_COUNT,
+            FS_DEFAULT_COMPRESS_ZSTD_LEVEL);
+}
+
+static double get_cpu_seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static double get_wall_seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+//the words with the skewed frequency as the log and the text files
+static void generate_data(BenchDataSet *ds)
+{
+    const char *words[] = {"the", "slice", "block", "offset", "length",
+        "data", "server", "client", "write", "read", "binlog", "trunk",
+        "version", "error", "info", "file", "path", "oid", "=", ":"};
+    const int word_count = sizeof(words) / sizeof(words[0]);
+    char *p;
+    char *end;
+    unsigned int seed;
+    int index;
+    int len;
+
+    seed = 20200101;
+    p = ds->data;
+    end = ds->data + (int64_t)ds->slice_size * ds->slice_count;
+    while (p < end) {
+        seed = seed * 1103515245 + 12345;
+        index = (seed >> 16) % (2 * word_count);
+        if (index >= word_count) {  //the numbers are less compressible
+            len = snprintf(p, end - p, "%u", seed % 1000000);
+        } else {
+            len = snprintf(p, end - p, "%s", words[index]);
+        }
+        if (len >= end - p) {
+            break;
+        }
+        p += len;
+        *p++ = ((seed >> 8) % 16 == 0) ? '\n' : ' ';
+    }
+    while (p < end) {
+        *p++ = ' ';
+    }
+}
+
+static int load_data(BenchDataSet *ds, const char *filename)
+{
+    int64_t file_size;
+    int64_t count;
+    char *content;
+    int result;
+
+    if ((result=getFileContent(filename, &content, &file_size)) != 0) {
+        return result;
+    }
+
+    count = file_size / ds->slice_size;
+    if (count == 0) {
+        fprintf(stderr, "file size: %"PRId64" < slice size: %d\n",
+                file_size, ds->slice_size);
+        free(content);
+        return EINVAL;
+    }
+    if (count < ds->slice_count) {
+        ds->slice_count = count;
+    }
+    memcpy(ds->data, content, (int64_t)ds->slice_size * ds->slice_count);
+    free(content);
+    return 0;
+}
+
+static int bench_codec(BenchDataSet *ds, const int type,
+        BenchCompressed *compressed, char *dest)
+{
+    OBSliceEntry slice;
+    double start_cpu;
+    double start_wall;
+    double compress_cpu;
+    double compress_wall;
+    double decompress_cpu;
+    double decompress_wall;
+    double total_mb;
+    int64_t in_bytes;
+    int64_t out_bytes;
+    int rounds;
+    int incompressible;
+    int result;
+    int i;
+
+    rounds = 0;
+    start_cpu = get_cpu_seconds();
+    start_wall = get_wall_seconds();
+    do {
+        for (i=0; i<ds->slice_count; i++) {
+            if (compressed[i].length > 0) {
+                free(compressed[i].buff);
+                compressed[i].length = 0;
+            }
+            result = slice_compressor_compress(type, ds->data + (int64_t)
+                    i * ds->slice_size, ds->slice_size,
+                    &compressed[i].buff, &compressed[i].length);
+            if (result == ENODATA) {
+                compressed[i].length = 0;
+            } else if (result != 0) {
+                return result;
+            }
+        }
+        rounds++;
+    } while (get_wall_seconds() - start_wall < BENCH_MIN_SECONDS);
+    compress_cpu = get_cpu_seconds() - start_cpu;
+    compress_wall = get_wall_seconds() - start_wall;
+    total_mb = (double)ds->slice_size * ds->slice_count *
+        rounds / (1024 * 1024);
+
+    in_bytes = out_bytes = 0;
+    incompressible = 0;
+    for (i=0; i<ds->slice_count; i++) {
+        in_bytes += ds->slice_size;
+        if (compressed[i].length > 0) {
+            out_bytes += compressed[i].length;
+        } else {
+            out_bytes += ds->slice_size;
+            incompressible++;
+        }
+    }
+
+    printf("%-5s compress   %9.1f MB/s  %8.1f cpu us/MB  ratio: %.3f, "
+            "incompressible slices: %d/%d\n",
+            slice_compressor_get_caption(type), total_mb / compress_wall,
+            compress_cpu * 1000000 / total_mb, (double)in_bytes /
+            out_bytes, incompressible, ds->slice_count);
+    if (incompressible == ds->slice_count) {
+        return 0;
+    }
+
+    memset(&slice, 0, sizeof(slice));
+    slice.compress.type = type;
+    slice.ssize.length = ds->slice_size;
+    rounds = 0;
+    in_bytes = 0;
+    start_cpu = get_cpu_seconds();
+    start_wall = get_wall_seconds();
+    do {
+        for (i=0; i<ds->slice_count; i++) {
+            if (compressed[i].length == 0) {
+                continue;
+            }
+            slice.compress.length = compressed[i].length;
+            if ((result=slice_compressor_decompress(&slice,
+                            compressed[i].buff, dest)) != 0)
+            {
+                return result;
+            }
+            if (rounds == 0 && memcmp(dest, ds->data + (int64_t)i *
+                        ds->slice_size, ds->slice_size) != 0)
+            {
+                fprintf(stderr, "slice %d: the decompressed data "
+                        "is different\n", i);
+                return EIO;
+            }
+            in_bytes += ds->slice_size;
+        }
+        rounds++;
+    } while (get_wall_seconds() - start_wall < BENCH_MIN_SECONDS);
+    decompress_cpu = get_cpu_seconds() - start_cpu;
+    decompress_wall = get_wall_seconds() - start_wall;
+    total_mb = (double)in_bytes / (1024 * 1024);
+
+    printf("%-5s decompress %9.1f MB/s  %8.1f cpu us/MB\n",
+            slice_compressor_get_caption(type), total_mb /
+            decompress_wall, decompress_cpu * 1000000 / total_mb);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *codecs[] = {"lz4", "zstd"};
+    const char *filename = NULL;
+    BenchDataSet ds;
+    BenchCompressed *compressed;
+    char *dest;
+    int type;
+    int ch;
+    int i;
+    int result;
+
+    ds.slice_size = BENCH_DEFAULT_SLICE_SIZE;
+    ds.slice_count = BENCH_DEFAULT_SLICE_COUNT;
+    STORAGE_CFG.compression.zstd_level = FS_DEFAULT_COMPRESS_ZSTD_LEVEL;
+    while ((ch=getopt(argc, argv, "hs:c:l:f:")) != -1) {
+        switch (ch) {
+            case 's':
+                ds.slice_size = strtol(optarg, NULL, 10);
+                break;
+            case 'c':
+                ds.slice_count = strtol(optarg, NULL, 10);
+                break;
+            case 'l':
+                STORAGE_CFG.compression.zstd_level =
+                    strtol(optarg, NULL, 10);
+                break;
+            case 'f':
+                filename = optarg;
+                break;
+            case 'h':
+            default:
+                usage(argv);
+                return EINVAL;
+        }
+    }
+
+    if (ds.slice_size <= 0 || ds.slice_size > FS_FILE_BLOCK_SIZE ||
+            ds.slice_count <= 0)
+    {
+        usage(argv);
+        return EINVAL;
+    }
+
+    log_init();
+    if ((ds.data=fc_malloc((int64_t)ds.slice_size *
+                    ds.slice_count)) == NULL ||
+            (dest=fc_malloc(ds.slice_size)) == NULL ||
+            (compressed=fc_malloc(sizeof(BenchCompressed) *
+                                  ds.slice_count)) == NULL)
+    {
+        return ENOMEM;
+    }
+    memset(compressed, 0, sizeof(BenchCompressed) * ds.slice_count);
+
+    if (filename != NULL) {
+        if ((result=load_data(&ds, filename)) != 0) {
+            return result;
+        }
+    } else {
+        generate_data(&ds);
+    }
+
+    printf("slice size: %d, slice count: %d, zstd level: %d, "
+            "data: %s\n", ds.slice_size, ds.slice_count,
+            STORAGE_CFG.compression.zstd_level,
+            filename != NULL ? filename : "generated");
+    for (i=0; i<sizeof(codecs) / sizeof(codecs[0]); i++) {
+        if ((type=slice_compressor_get_type(codecs[i])) < 0) {
+            printf("%-5s not supported by this build\n", codecs[i]);
+            continue;
+        }
+
+        if ((result=bench_codec(&ds, type, compressed, dest)) != 0) {
+            fprintf(stderr, "%s: bench fail, errno: %d, error info: %s\n",
+                    codecs[i], result, STRERROR(result));
+            return result;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fs_crc32c_bench.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "../common/fs_crc32c.h"
+
+#define BENCH_MAX_BUFFER_SIZE  (4 * 1024 * 1024)
+#define BENCH_MIN_SECONDS      0.5
+
+static const int buffer_sizes[] = {512, 4 * 1024, 64 * 1024,
+    1024 * 1024, BENCH_MAX_BUFFER_SIZE};
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s [-t]\n"
+            "\t-t: the table lookup only, "
+            "skip the CPU instructions\n", argv[0]);
+}
+
+static double get_wall_seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static uint32_t bench_impl(const char *buff, uint32_t *crcs)
+{
+    double start;
+    double seconds;
+    int64_t rounds;
+    uint32_t sum;
+    int size;
+    int i;
+
+    sum = 0;
+    for (i=0; i<sizeof(buffer_sizes) / sizeof(buffer_sizes[0]); i++) {
+        size = buffer_sizes[i];
+        crcs[i] = fs_crc32c(0, buff, size);
+        rounds = 0;
+        start = get_wall_seconds();
+        do {
+            sum ^= fs_crc32c(0, buff, size);
+            rounds++;
+        } while ((seconds=get_wall_seconds() - start) < BENCH_MIN_SECONDS);
+
+        printf("%-9s buffer size: %7d, %8.2f GB/s, %10.3f us/buffer\n",
+                fs_crc32c_impl_name(), size, (double)size * rounds /
+                (seconds * 1024 * 1024 * 1024), seconds * 1000000 / rounds);
+    }
+
+    return sum;  //keep the loops from being optimized out
+}
+
+int main(int argc, char *argv[])
+{
+    const int count = sizeof(buffer_sizes) / sizeof(buffer_sizes[0]);
+    uint32_t hw_crcs[sizeof(buffer_sizes) / sizeof(buffer_sizes[0])];
+    uint32_t table_crcs[sizeof(buffer_sizes) / sizeof(buffer_sizes[0])];
+    bool table_only;
+    uint32_t sum;
+    char *buff;
+    int ch;
+    int i;
+
+    table_only = false;
+    while ((ch=getopt(argc, argv, "ht")) != -1) {
+        switch (ch) {
+            case 't':
+                table_only = true;
+                break;
+            case 'h':
+            default:
+                usage(argv);
+                return EINVAL;
+        }
+    }
+
+    log_init();
+    if ((buff=fc_malloc(BENCH_MAX_BUFFER_SIZE)) == NULL) {
+        return ENOMEM;
+    }
+
+    srand(20200101);
+    for (i=0; i<BENCH_MAX_BUFFER_SIZE; i++) {
+        buff[i] = rand() & 0xFF;
+    }
+
+    sum = 0;
+    if (!table_only) {
+        fs_crc32c_init_ex(true);
+        if (strcmp(fs_crc32c_impl_name(), "table") == 0) {
+            printf("the CPU instructions not supported, "
+                    "the table lookup only\n");
+            table_only = true;
+        } else {
+            sum ^= bench_impl(buff, hw_crcs);
+        }
+    }
+
+    fs_crc32c_init_ex(false);
+    sum ^= bench_impl(buff, table_crcs);
+
+    if (!table_only) {
+        for (i=0; i<count; i++) {
+            if (hw_crcs[i] != table_crcs[i]) {
+                fprintf(stderr, "buffer size: %d, the CRC32C %08x of "
+                        "the CPU instructions != %08x of the table "
+                        "lookup\n", buffer_sizes[i], hw_crcs[i],
+                        table_crcs[i]);
+                return EIO;
+            }
+        }
+    }
+
+    printf("checksum of the rounds: %08x\n", sum);
+    free(buff);
+    return 0;
+}
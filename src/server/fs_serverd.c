@@ -53,8 +53,15 @@
 #include "server_replication.h"
 #include "server_recovery.h"
 #include "storage/slice_op.h"
+#include "storage/durability.h"
+#include "storage/read_cache.h"
+#include "storage/slice_compressor.h"
+#include "zero_copy_sender.h"
+#include "storage/write_cache_migrator.h"
+#include "storage/slice_merge.h"
 #include "dio/trunk_io_thread.h"
 #include "shared_thread_pool.h"
+#include "numa_topology.h"
 
 static bool daemon_mode = true;
 static int setup_server_env(const char *config_filename);
@@ -172,6 +179,10 @@ int main(int argc, char *argv[])
             break;
         }
 
+        if ((result=numa_topology_init()) != 0) {
+            break;
+        }
+
         if ((result=trunk_io_thread_init()) != 0) {
             break;
         }
@@ -201,6 +212,18 @@ int main(int argc, char *argv[])
             break;
         }
 
+        if ((result=read_cache_init()) != 0) {
+            break;
+        }
+
+        if ((result=slice_compressor_init()) != 0) {
+            break;
+        }
+
+        if ((result=zero_copy_sender_init()) != 0) {
+            break;
+        }
+
         if ((result=server_binlog_init()) != 0) {
             break;
         }
@@ -209,6 +232,10 @@ int main(int argc, char *argv[])
             break;
         }
 
+        if ((result=durability_init()) != 0) {
+            break;
+        }
+
         if ((result=storage_allocator_prealloc_trunk_freelists()) != 0) {
             return result;
         }
@@ -221,6 +248,14 @@ int main(int argc, char *argv[])
             return result;
         }
 
+        if ((result=write_cache_migrator_init()) != 0) {
+            return result;
+        }
+
+        if ((result=slice_merge_init()) != 0) {
+            return result;
+        }
+
         fs_proto_init();
         //sched_print_all_entries();
 
@@ -276,6 +311,7 @@ int main(int argc, char *argv[])
     }
 
     trunk_io_thread_terminate();
+    durability_terminate();
     server_binlog_terminate();
     server_replication_terminate();
     server_recovery_terminate();
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//fs_slice_binlog_convert.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "sf/sf_binlog_writer.h"
+#include "../common/fs_crc32c.h"
+#include "server_types.h"
+#include "binlog/slice_binlog_format.h"
+#include "binlog/slice_checkpoint.h"
+
+#define CONVERT_READ_BUFFER_SIZE  (256 * 1024)
+
+typedef struct {
+    const char *filename;
+    int format;
+    int64_t line_count;
+    char *buff;
+    FILE *fp;
+} ConvertContext;
+
+static void usage(char *argv[])
+{
+    fprintf(stderr, "Usage: %s <text | binary> <data_path>\n"
+            "\tconvert the slice binlog files of the data path to the "
+            "format,\n\tthe server MUST be stopped before the convert\n",
+            argv[0]);
+}
+
+static int convert_records(ConvertContext *ctx, char *start,
+        char *end, char **remain)
+{
+    char out[FS_SLICE_BINLOG_MAX_RECORD_SIZE];
+    char error_info[256];
+    SliceBinlogFields fields;
+    string_t record;
+    char *line_end;
+    int len;
+    int result;
+
+    record.str = start;
+    while (record.str < end) {
+        if ((line_end=slice_binlog_record_end(record.str, end)) == NULL) {
+            break;
+        }
+
+        ctx->line_count++;
+        record.len = (line_end + 1) - record.str;
+        if ((result=slice_binlog_unpack_record(&record,
+                        &fields, error_info)) != 0)
+        {
+            fprintf(stderr, "binlog file: %s, line no: %"PRId64", %s\n",
+                    ctx->filename, ctx->line_count, error_info);
+            return result;
+        }
+
+        len = slice_binlog_pack_record(&fields, ctx->format, out);
+        if (fwrite(out, len, 1, ctx->fp) != 1) {
+            result = errno != 0 ? errno : EIO;
+            fprintf(stderr, "write to file %s.tmp fail, "
+                    "errno: %d, error info: %s\n", ctx->filename,
+                    result, STRERROR(result));
+            return result;
+        }
+        record.str = line_end + 1;
+    }
+
+    *remain = record.str;
+    return 0;
+}
+
+static int convert_file(ConvertContext *ctx)
+{
+    char tmp_filename[PATH_MAX];
+    char *remain;
+    int fd;
+    int data_len;
+    int read_bytes;
+    int result;
+
+    if ((fd=open(ctx->filename, O_RDONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        fprintf(stderr, "open file %s fail, errno: %d, error info: %s\n",
+                ctx->filename, result, STRERROR(result));
+        return result;
+    }
+
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", ctx->filename);
+    if ((ctx->fp=fopen(tmp_filename, "wb")) == NULL) {
+        result = errno != 0 ? errno : EACCES;
+        fprintf(stderr, "open file %s fail, errno: %d, error info: %s\n",
+                tmp_filename, result, STRERROR(result));
+        close(fd);
+        return result;
+    }
+
+    ctx->line_count = 0;
+    data_len = 0;
+    result = 0;
+    while ((read_bytes=read(fd, ctx->buff + data_len,
+                    CONVERT_READ_BUFFER_SIZE - data_len)) > 0)
+    {
+        data_len += read_bytes;
+        if ((result=convert_records(ctx, ctx->buff, ctx->buff +
+                        data_len, &remain)) != 0)
+        {
+            break;
+        }
+
+        data_len = (ctx->buff + data_len) - remain;
+        if (data_len > 0) {
+            memmove(ctx->buff, remain, data_len);
+        }
+    }
+
+    if (result == 0 && read_bytes < 0) {
+        result = errno != 0 ? errno : EIO;
+        fprintf(stderr, "read file %s fail, errno: %d, error info: %s\n",
+                ctx->filename, result, STRERROR(result));
+    }
+    close(fd);
+
+    //the torn record at the file end is dropped as the loader does
+    if (result == 0 && data_len > 0) {
+        fprintf(stderr, "binlog file: %s, skip the incomplete record "
+                "of %d bytes at the file end\n", ctx->filename, data_len);
+    }
+
+    if (result == 0) {
+        if (fflush(ctx->fp) != 0 || fsync(fileno(ctx->fp)) != 0) {
+            result = errno != 0 ? errno : EIO;
+            fprintf(stderr, "sync file %s fail, errno: %d, "
+                    "error info: %s\n", tmp_filename,
+                    result, STRERROR(result));
+        }
+    }
+    fclose(ctx->fp);
+
+    if (result == 0) {
+        if (rename(tmp_filename, ctx->filename) != 0) {
+            result = errno != 0 ? errno : EPERM;
+            fprintf(stderr, "rename file %s to %s fail, errno: %d, "
+                    "error info: %s\n", tmp_filename, ctx->filename,
+                    result, STRERROR(result));
+        }
+    } else {
+        unlink(tmp_filename);
+    }
+
+    if (result == 0) {
+        printf("binlog file: %s, converted records: %"PRId64"\n",
+                ctx->filename, ctx->line_count);
+    }
+    return result;
+}
+
+static bool is_binlog_filename(const char *filename)
+{
+    const char *p;
+    int prefix_len;
+
+    prefix_len = strlen(SF_BINLOG_FILE_PREFIX);
+    if (memcmp(filename, SF_BINLOG_FILE_PREFIX, prefix_len) != 0 ||
+            filename[prefix_len] != '.')
+    {
+        return false;
+    }
+
+    p = filename + prefix_len + 1;
+    return (*p != '\0' && strspn(p, "0123456789") == strlen(p));
+}
+
+static int convert_path(const char *slice_path, const int format)
+{
+    char filename[PATH_MAX];
+    ConvertContext ctx;
+    DIR *dir;
+    struct dirent *ent;
+    int count;
+    int result;
+
+    if ((dir=opendir(slice_path)) == NULL) {
+        result = errno != 0 ? errno : ENOENT;
+        fprintf(stderr, "open path %s fail, errno: %d, error info: %s\n",
+                slice_path, result, STRERROR(result));
+        return result;
+    }
+
+    if ((ctx.buff=fc_malloc(CONVERT_READ_BUFFER_SIZE)) == NULL) {
+        closedir(dir);
+        return ENOMEM;
+    }
+
+    ctx.format = format;
+    ctx.filename = filename;
+    count = 0;
+    result = 0;
+    while ((ent=readdir(dir)) != NULL) {
+        if (!is_binlog_filename(ent->d_name)) {
+            continue;
+        }
+
+        snprintf(filename, sizeof(filename), "%s/%s",
+                slice_path, ent->d_name);
+        if ((result=convert_file(&ctx)) != 0) {
+            break;
+        }
+        count++;
+    }
+    closedir(dir);
+    free(ctx.buff);
+
+    if (result != 0) {
+        return result;
+    }
+
+    /* the binlog offsets of the checkpoint are changed,
+       the index is rebuilt from the binlog at the next startup */
+    snprintf(filename, sizeof(filename), "%s/%s",
+            slice_path, SLICE_CHECKPOINT_FILENAME);
+    if (unlink(filename) != 0 && errno != ENOENT) {
+        result = errno != 0 ? errno : EPERM;
+        fprintf(stderr, "unlink file %s fail, errno: %d, "
+                "error info: %s\n", filename, result, STRERROR(result));
+        return result;
+    }
+
+    printf("slice binlog path: %s, converted files: %d\n",
+            slice_path, count);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char slice_path[PATH_MAX];
+    int format;
+
+    if (argc < 3) {
+        usage(argv);
+        return EINVAL;
+    }
+
+    if (strcmp(argv[1], "text") == 0) {
+        format = SLICE_BINLOG_FORMAT_TEXT;
+    } else if (strcmp(argv[1], "binary") == 0) {
+        format = SLICE_BINLOG_FORMAT_BINARY;
+    } else {
+        usage(argv);
+        return EINVAL;
+    }
+
+    log_init();
+    fs_crc32c_init();
+    snprintf(slice_path, sizeof(slice_path), "%s/%s",
+            argv[2], FS_SLICE_BINLOG_SUBDIR_NAME);
+    return convert_path(slice_path, format);
+}
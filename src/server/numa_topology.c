@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#ifdef OS_LINUX
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#endif
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "numa_topology.h"
+
+#define NUMA_SYSFS_NODE_PATH  "/sys/devices/system/node"
+#define NUMA_MAX_NODE_ID      64   //the node ids in one unsigned long mask
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED   1
+#endif
+
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE  3
+#endif
+
+typedef struct {
+    int id;         //the node id of the system
+    int cpu_count;
+#ifdef OS_LINUX
+    cpu_set_t cpus;
+#endif
+    char cpulist[128];  //for log
+} FSNumaNode;
+
+typedef struct {
+    FSNumaNode *nodes;  //sorted by the node id
+    int count;
+    int data_node;      //the node index for the data threads, -1 for spread
+} FSNumaTopology;
+
+static FSNumaTopology numa_topology = {NULL, 0, -1};
+
+#ifdef OS_LINUX
+
+static int read_sysfs_line(const char *filename, char *buff, const int size)
+{
+    int fd;
+    int len;
+
+    if ((fd=open(filename, O_RDONLY)) < 0) {
+        return errno != 0 ? errno : ENOENT;
+    }
+    len = read(fd, buff, size - 1);
+    close(fd);
+    if (len <= 0) {
+        return ENODATA;
+    }
+
+    while (len > 0 && (buff[len - 1] == '\n' || buff[len - 1] == ' ')) {
+        len--;
+    }
+    buff[len] = '\0';
+    return 0;
+}
+
+static int find_node_index(const int node_id)
+{
+    int i;
+
+    for (i=0; i<numa_topology.count; i++) {
+        if (numa_topology.nodes[i].id == node_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//read the node id from the numa_node file, -1 for unknown
+static int read_numa_node_file(const char *filename)
+{
+    char buff[32];
+
+    if (read_sysfs_line(filename, buff, sizeof(buff)) != 0) {
+        return -1;
+    }
+    return find_node_index(strtol(buff, NULL, 10));
+}
+
+//the cpulist format such as: 0-15,32-47
+static int parse_cpulist(FSNumaNode *node)
+{
+    char *p;
+    char *end;
+    long start;
+    long last;
+    long cpu;
+
+    CPU_ZERO(&node->cpus);
+    node->cpu_count = 0;
+    p = node->cpulist;
+    while (*p != '\0') {
+        start = strtol(p, &end, 10);
+        if (end == p) {
+            return EINVAL;
+        }
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p) {
+                return EINVAL;
+            }
+        } else {
+            last = start;
+        }
+
+        for (cpu=start; cpu<=last && cpu<CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, &node->cpus);
+            node->cpu_count++;
+        }
+
+        p = end;
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+static int compare_node_id(const void *p1, const void *p2)
+{
+    return ((FSNumaNode *)p1)->id - ((FSNumaNode *)p2)->id;
+}
+
+static int load_nodes()
+{
+    DIR *dir;
+    struct dirent *ent;
+    FSNumaNode nodes[NUMA_MAX_NODE_ID];
+    char filename[PATH_MAX];
+    char *end;
+    int node_id;
+    int count;
+    int bytes;
+
+    if ((dir=opendir(NUMA_SYSFS_NODE_PATH)) == NULL) {
+        logWarning("file: "__FILE__", line: %d, "
+                "opendir %s fail, errno: %d, error info: %s",
+                __LINE__, NUMA_SYSFS_NODE_PATH, errno, STRERROR(errno));
+        return errno != 0 ? errno : ENOENT;
+    }
+
+    count = 0;
+    while ((ent=readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, "node", 4) != 0) {
+            continue;
+        }
+        node_id = strtol(ent->d_name + 4, &end, 10);
+        if (end == ent->d_name + 4 || *end != '\0') {
+            continue;
+        }
+        if (node_id < 0 || node_id >= NUMA_MAX_NODE_ID) {
+            logWarning("file: "__FILE__", line: %d, "
+                    "NUMA node id: %d out of range, ignore it",
+                    __LINE__, node_id);
+            continue;
+        }
+
+        snprintf(filename, sizeof(filename), "%s/%s/cpulist",
+                NUMA_SYSFS_NODE_PATH, ent->d_name);
+        nodes[count].id = node_id;
+        if (read_sysfs_line(filename, nodes[count].cpulist,
+                    sizeof(nodes[count].cpulist)) != 0 ||
+                parse_cpulist(nodes + count) != 0)
+        {
+            logWarning("file: "__FILE__", line: %d, "
+                    "read cpulist of NUMA node %d fail, ignore it",
+                    __LINE__, node_id);
+            continue;
+        }
+
+        //the memory only nodes have no cpu
+        if (nodes[count].cpu_count > 0) {
+            count++;
+        }
+    }
+    closedir(dir);
+
+    if (count == 0) {
+        return ENOENT;
+    }
+
+    qsort(nodes, count, sizeof(FSNumaNode), compare_node_id);
+    bytes = sizeof(FSNumaNode) * count;
+    if ((numa_topology.nodes=(FSNumaNode *)fc_malloc(bytes)) == NULL) {
+        return ENOMEM;
+    }
+    memcpy(numa_topology.nodes, nodes, bytes);
+    numa_topology.count = count;
+    return 0;
+}
+
+static int get_nic_node(const char *nic)
+{
+    char filename[PATH_MAX];
+
+    snprintf(filename, sizeof(filename),
+            "/sys/class/net/%s/device/numa_node", nic);
+    return read_numa_node_file(filename);
+}
+
+/* the device of the file system: /sys/dev/block/$major:$minor links to
+   the device path, the nearest numa_node file of the ancestors is used */
+static int get_disk_node(const char *path)
+{
+    struct stat st;
+    char filename[PATH_MAX];
+    char device_path[PATH_MAX];
+    char *p;
+    int node;
+
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+
+    snprintf(filename, sizeof(filename), "/sys/dev/block/%u:%u",
+            major(st.st_dev), minor(st.st_dev));
+    if (realpath(filename, device_path) == NULL) {
+        return -1;
+    }
+
+    while ((p=strrchr(device_path, '/')) != NULL && p > device_path) {
+        snprintf(filename, sizeof(filename), "%s/numa_node", device_path);
+        if (access(filename, F_OK) == 0) {
+            if ((node=read_numa_node_file(filename)) >= 0) {
+                return node;
+            }
+        }
+        *p = '\0';
+    }
+
+    return -1;
+}
+
+int numa_topology_init()
+{
+    int result;
+    int i;
+
+    if (!NUMA_CFG.enabled) {
+        return 0;
+    }
+
+    if ((result=load_nodes()) != 0) {
+        logWarning("file: "__FILE__", line: %d, "
+                "load the NUMA nodes fail, disable the NUMA placement",
+                __LINE__);
+        return 0;
+    }
+
+    if (numa_topology.count == 1) {
+        logInfo("file: "__FILE__", line: %d, "
+                "only one NUMA node, disable the NUMA placement", __LINE__);
+        free(numa_topology.nodes);
+        numa_topology.nodes = NULL;
+        numa_topology.count = 0;
+        return 0;
+    }
+
+    for (i=0; i<numa_topology.count; i++) {
+        logInfo("file: "__FILE__", line: %d, "
+                "NUMA node %d, cpu count: %d, cpus: %s", __LINE__,
+                numa_topology.nodes[i].id, numa_topology.nodes[i].cpu_count,
+                numa_topology.nodes[i].cpulist);
+    }
+
+    if (*NUMA_CFG.nic != '\0') {
+        numa_topology.data_node = get_nic_node(NUMA_CFG.nic);
+        if (numa_topology.data_node < 0) {
+            logWarning("file: "__FILE__", line: %d, "
+                    "the NUMA node of the network interface %s "
+                    "is unknown, spread the data threads across "
+                    "the nodes", __LINE__, NUMA_CFG.nic);
+        }
+    }
+
+    if (numa_topology.data_node >= 0) {
+        logInfo("file: "__FILE__", line: %d, "
+                "the data threads and the object block index on "
+                "NUMA node %d of the network interface %s", __LINE__,
+                numa_topology.nodes[numa_topology.data_node].id,
+                NUMA_CFG.nic);
+    } else {
+        logInfo("file: "__FILE__", line: %d, "
+                "the data threads spread across %d NUMA nodes, "
+                "the object block index interleaved", __LINE__,
+                numa_topology.count);
+    }
+
+    return 0;
+}
+
+int numa_topology_data_thread_node(const int thread_index)
+{
+    if (numa_topology.count == 0) {
+        return -1;
+    }
+
+    if (numa_topology.data_node >= 0) {
+        return numa_topology.data_node;
+    } else {
+        return thread_index % numa_topology.count;
+    }
+}
+
+int numa_topology_store_path_node(const FSStoragePathInfo *path)
+{
+    int node;
+    const char *caption;
+
+    if (numa_topology.count == 0) {
+        return -1;
+    }
+
+    if ((node=get_disk_node(path->store.path.str)) >= 0) {
+        caption = "the disk";
+    } else if (numa_topology.data_node >= 0) {
+        node = numa_topology.data_node;
+        caption = "the network interface";
+    } else {
+        node = path->store.index % numa_topology.count;
+        caption = "the path index";
+    }
+
+    logInfo("file: "__FILE__", line: %d, "
+            "the disk IO threads of store path: %s on NUMA node %d "
+            "by %s", __LINE__, path->store.path.str,
+            numa_topology.nodes[node].id, caption);
+    return node;
+}
+
+int numa_topology_bind_thread(const int node)
+{
+    int result;
+
+    if (node < 0 || node >= numa_topology.count) {
+        return 0;
+    }
+
+    if ((result=pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                    &numa_topology.nodes[node].cpus)) != 0)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "bind the thread to NUMA node %d fail, "
+                "errno: %d, error info: %s", __LINE__,
+                numa_topology.nodes[node].id, result, STRERROR(result));
+    }
+    return result;
+}
+
+void numa_topology_bind_index_memory(void *buff, const int64_t bytes)
+{
+    unsigned long nodemask;
+    unsigned long page_size;
+    unsigned long start;
+    unsigned long end;
+    int mode;
+    int i;
+
+    if (numa_topology.count == 0) {
+        return;
+    }
+
+    page_size = getpagesize();
+    start = ((unsigned long)buff + page_size - 1) & ~(page_size - 1);
+    end = ((unsigned long)buff + bytes) & ~(page_size - 1);
+    if (start >= end) {
+        return;
+    }
+
+    if (numa_topology.data_node >= 0) {
+        mode = MPOL_PREFERRED;
+        nodemask = 1UL << numa_topology.nodes[
+            numa_topology.data_node].id;
+    } else {
+        mode = MPOL_INTERLEAVE;
+        nodemask = 0;
+        for (i=0; i<numa_topology.count; i++) {
+            nodemask |= 1UL << numa_topology.nodes[i].id;
+        }
+    }
+
+    if (syscall(SYS_mbind, start, end - start, mode, &nodemask,
+                8 * sizeof(nodemask) + 1, 0) != 0)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "mbind %"PRId64" bytes fail, errno: %d, error info: %s",
+                __LINE__, (int64_t)(end - start), errno, STRERROR(errno));
+    }
+}
+
+#else
+
+int numa_topology_init()
+{
+    if (NUMA_CFG.enabled) {
+        logWarning("file: "__FILE__", line: %d, "
+                "the NUMA placement is supported on Linux only",
+                __LINE__);
+    }
+    return 0;
+}
+
+int numa_topology_data_thread_node(const int thread_index)
+{
+    return -1;
+}
+
+int numa_topology_store_path_node(const FSStoragePathInfo *path)
+{
+    return -1;
+}
+
+int numa_topology_bind_thread(const int node)
+{
+    return 0;
+}
+
+void numa_topology_bind_index_memory(void *buff, const int64_t bytes)
+{
+}
+
+#endif
+
+int numa_topology_node_count()
+{
+    return numa_topology.count;
+}
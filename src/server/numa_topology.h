@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//numa_topology.h
+
+#ifndef _NUMA_TOPOLOGY_H_
+#define _NUMA_TOPOLOGY_H_
+
+#include "server_global.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* discover the NUMA nodes from sysfs when numa_aware is true,
+       the placement is disabled when only one node (or not Linux) */
+    int numa_topology_init();
+
+    //the node count, 0 when the placement is disabled
+    int numa_topology_node_count();
+
+    //return the node index for the data thread, -1 for no binding
+    int numa_topology_data_thread_node(const int thread_index);
+
+    /* return the node index for the disk IO threads of the store path,
+       the node of the disk first, -1 for no binding */
+    int numa_topology_store_path_node(const FSStoragePathInfo *path);
+
+    //bind the current thread to the cpus of the node, -1 for do nothing
+    int numa_topology_bind_thread(const int node);
+
+    /* set the memory policy of the index memory before the first touch:
+       the node of the data threads, or interleaved across the nodes.
+       only the whole pages of the buffer are bound */
+    void numa_topology_bind_index_memory(void *buff, const int64_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -36,6 +36,8 @@
 #include "data_recovery.h"
 #include "binlog_dedup.h"
 
+#define BINLOG_DEDUP_CREATE_BATCH_SIZE  64
+
 typedef struct {
     FILE *fp;
     char filename[PATH_MAX];
@@ -57,6 +59,11 @@ typedef struct {
         int64_t partial_deletes;
     } rstat;  //record stat
 
+    struct {
+        int count;
+        FSSliceSNPair pairs[BINLOG_DEDUP_CREATE_BATCH_SIZE];
+    } create_batch;  //the consecutive slices of the same block to create
+
     struct {
         OBSlicePtrArray slice_array;  //for sort
         BinlogFileWriter writer;
@@ -71,22 +78,79 @@ typedef struct {
 
 static int realloc_slice_ptr_array(OBSlicePtrArray *sarray);
 
-static inline int add_slice(OBHashtable *htable,
+static inline OBSliceEntry *alloc_slice(OBHashtable *htable,
         ReplicaBinlogRecord *record, const OBSliceType stype)
 {
     OBSliceEntry *slice;
-    int inc_alloc;
 
     slice = ob_index_alloc_slice_ex(htable, &record->bs_key.block, 0);
     if (slice == NULL) {
-        return ENOMEM;
+        return NULL;
     }
 
     slice->type = stype;
     slice->ssize = record->bs_key.slice;
+    return slice;
+}
+
+static inline int add_slice(OBHashtable *htable,
+        ReplicaBinlogRecord *record, const OBSliceType stype)
+{
+    OBSliceEntry *slice;
+    int inc_alloc;
+
+    if ((slice=alloc_slice(htable, record, stype)) == NULL) {
+        return ENOMEM;
+    }
     return ob_index_add_slice_ex(htable, slice, NULL, &inc_alloc, false);
 }
 
+static int flush_create_batch(BinlogDedupContext *dedup_ctx)
+{
+    int result;
+    int inc_alloc;
+
+    if (dedup_ctx->create_batch.count == 0) {
+        return 0;
+    }
+
+    if ((result=ob_index_add_slices_ex(&dedup_ctx->htables.create,
+                    dedup_ctx->create_batch.pairs, dedup_ctx->
+                    create_batch.count, false, &inc_alloc, false)) == 0)
+    {
+        dedup_ctx->rstat.create.success += dedup_ctx->create_batch.count;
+    }
+    dedup_ctx->create_batch.count = 0;
+    return result;
+}
+
+/* the consecutive slices of the same block are added with one lock */
+static int batch_create_slice(BinlogDedupContext *dedup_ctx,
+        const OBSliceType stype)
+{
+    OBSliceEntry *slice;
+    int result;
+
+    if (dedup_ctx->create_batch.count > 0 && (dedup_ctx->create_batch.
+                count == BINLOG_DEDUP_CREATE_BATCH_SIZE ||
+                !FS_BLOCK_KEY_EQUAL(dedup_ctx->create_batch.pairs[0].
+                    slice->ob->bkey, dedup_ctx->record.bs_key.block)))
+    {
+        if ((result=flush_create_batch(dedup_ctx)) != 0) {
+            return result;
+        }
+    }
+
+    if ((slice=alloc_slice(&dedup_ctx->htables.create,
+                    &dedup_ctx->record, stype)) == NULL)
+    {
+        return ENOMEM;
+    }
+    dedup_ctx->create_batch.pairs[dedup_ctx->create_batch.
+        count++].slice = slice;
+    return 0;
+}
+
 static int deal_binlog_buffer(BinlogDedupContext *dedup_ctx)
 {
     char *p;
@@ -130,19 +194,19 @@ static int deal_binlog_buffer(BinlogDedupContext *dedup_ctx)
             case REPLICA_BINLOG_OP_TYPE_WRITE_SLICE:
             case REPLICA_BINLOG_OP_TYPE_ALLOC_SLICE:
                 if (op_type == REPLICA_BINLOG_OP_TYPE_WRITE_SLICE) {
-                    result = add_slice(&dedup_ctx->htables.create,
-                            &dedup_ctx->record, OB_SLICE_TYPE_FILE);
+                    result = batch_create_slice(dedup_ctx,
+                            OB_SLICE_TYPE_FILE);
                 } else {
-                    result = add_slice(&dedup_ctx->htables.create,
-                            &dedup_ctx->record, OB_SLICE_TYPE_ALLOC);
+                    result = batch_create_slice(dedup_ctx,
+                            OB_SLICE_TYPE_ALLOC);
                 }
                 dedup_ctx->rstat.create.total++;
-                if (result == 0) {
-                    dedup_ctx->rstat.create.success++;
-                }
                 break;
             case REPLICA_BINLOG_OP_TYPE_DEL_SLICE:
             case REPLICA_BINLOG_OP_TYPE_DEL_BLOCK:
+                if ((result=flush_create_batch(dedup_ctx)) != 0) {
+                    break;
+                }
                 if (op_type == REPLICA_BINLOG_OP_TYPE_DEL_SLICE) {
                     result = ob_index_delete_slices_ex(&dedup_ctx->
                             htables.create, &dedup_ctx->record.bs_key,
@@ -195,6 +259,13 @@ static int deal_binlog_buffer(BinlogDedupContext *dedup_ctx)
         p = line_end;
     }
 
+    if (result == 0 && (result=flush_create_batch(dedup_ctx)) != 0) {
+        snprintf(error_info, sizeof(error_info), "%s fail, errno: %d, "
+                "error info: %s", replica_binlog_get_op_type_caption(
+                    REPLICA_BINLOG_OP_TYPE_WRITE_SLICE),
+                result, STRERROR(result));
+    }
+
     if (result != 0) {
         ServerBinlogReader *reader;
         int64_t offset;
@@ -333,15 +404,15 @@ static inline int add_to_sarray(OBSlicePtrArray *sarray,
 
 static int dump_to_array(BinlogDedupContext *dedup_ctx, const OBEntry *ob)
 {
-    UniqSkiplistIterator it;
+    OBSliceMapIterator it;
     OBSliceEntry *first;
     OBSliceEntry *previous;
     OBSliceEntry *slice;
     int result;
 
-    uniq_skiplist_iterator(ob->slices, &it);
-    first = previous = (OBSliceEntry *)uniq_skiplist_next(&it);
-    while ((slice=(OBSliceEntry *)uniq_skiplist_next(&it)) != NULL) {
+    ob_slice_map_iterator(&ob->slices, &it);
+    first = previous = ob_slice_map_next(&it);
+    while ((slice=ob_slice_map_next(&it)) != NULL) {
         if (!((previous->ssize.offset + previous->ssize.length ==
                         slice->ssize.offset) && (previous->type == slice->type)))
         {
@@ -413,32 +484,24 @@ static int compare_slice(const OBSliceEntry **s1, const OBSliceEntry **s2)
     return (int)(*s1)->ssize.offset - (int)(*s2)->ssize.offset;
 }
 
+static int dump_ob_entry(OBEntry *ob, void *args)
+{
+    if (ob_slice_map_empty(&ob->slices)) {
+        return 0;
+    }
+    return dump_to_array((BinlogDedupContext *)args, ob);
+}
+
 static int htable_dump(BinlogDedupContext *dedup_ctx,
         OBHashtable *htable, int64_t *binlog_count)
 {
-    OBEntry **bucket;
-    OBEntry **end;
-    OBEntry *ob;
     int result;
 
     dedup_ctx->out.slice_array.count = 0;
-    end = htable->buckets + htable->capacity;
-    for (bucket = htable->buckets, result = 0;
-            bucket < end && result == 0; bucket++)
+    if ((result=ob_index_walk_htable(htable, dump_ob_entry,
+                    dedup_ctx)) != 0)
     {
-        if (*bucket == NULL) {
-            continue;
-        }
-
-        ob = *bucket;
-        do {
-            if (!uniq_skiplist_empty(ob->slices)) {
-                if ((result=dump_to_array(dedup_ctx, ob)) != 0) {
-                    return result;
-                }
-            }
-            ob = ob->next;
-        } while (ob != NULL);
+        return result;
     }
 
     *binlog_count = dedup_ctx->out.slice_array.count;
@@ -451,47 +514,37 @@ static int htable_dump(BinlogDedupContext *dedup_ctx,
     return slice_array_to_file(dedup_ctx);
 }
 
-static void htable_reverse_remove(BinlogHashtables *htables)
+static int reverse_remove_ob_entry(OBEntry *ob, void *args)
 {
-    OBEntry **bucket;
-    OBEntry **end;
-    OBEntry *ob;
+    BinlogHashtables *htables;
     OBSliceEntry *slice;
-    UniqSkiplistIterator it;
+    OBSliceMapIterator it;
     FSBlockSliceKeyInfo bs_key;
     int dec_alloc;
 
-    end = htables->create.buckets + htables->create.capacity;
-    for (bucket = htables->create.buckets; bucket < end; bucket++) {
-        if (*bucket == NULL) {
-            continue;
-        }
+    htables = (BinlogHashtables *)args;
+    if (ob_slice_map_empty(&ob->slices)) {
+        return 0;
+    }
 
-        ob = *bucket;
-        do {
-            do {
-                if (uniq_skiplist_empty(ob->slices)) {
-                    break;
-                }
+    if (ob_index_get_ob_entry_ex(&htables->remove, &ob->bkey) == NULL) {
+        return 0;
+    }
 
-                if (ob_index_get_ob_entry_ex(&htables->remove,
-                            &ob->bkey) == NULL)
-                {
-                    break;
-                }
+    ob_slice_map_iterator(&ob->slices, &it);
+    while ((slice=ob_slice_map_next(&it)) != NULL) {
+        bs_key.block = slice->ob->bkey;
+        bs_key.slice = slice->ssize;
+        ob_index_delete_slices_ex(&htables->remove,
+                &bs_key, NULL, &dec_alloc, false);
+    }
 
-                uniq_skiplist_iterator(ob->slices, &it);
-                while ((slice=(OBSliceEntry *)uniq_skiplist_next(&it)) != NULL) {
-                    bs_key.block = slice->ob->bkey;
-                    bs_key.slice = slice->ssize;
-                    ob_index_delete_slices_ex(&htables->remove,
-                            &bs_key, NULL, &dec_alloc, false);
-                }
-            } while (0);
+    return 0;
+}
 
-            ob = ob->next;
-        } while (ob != NULL);
-    }
+static inline void htable_reverse_remove(BinlogHashtables *htables)
+{
+    ob_index_walk_htable(&htables->create, reverse_remove_ob_entry, htables);
 }
 
 static int init_slice_ptr_array(OBSlicePtrArray *slice_ptr_array,
@@ -706,6 +706,7 @@ static int handle_rpc_req(struct fast_task_info *task,
         op_ctx->info.deal_done = false;
         op_ctx->info.is_update = true;
         op_ctx->info.source = BINLOG_SOURCE_RPC_SLAVE;
+        op_ctx->info.io_class = FS_IO_CLASS_REPLICATION;
         op_ctx->info.data_version = buff2long(body_part->data_version);
         if (op_ctx->info.data_version <= 0) {
             RESPONSE.error.length = sprintf(RESPONSE.error.message,
@@ -930,6 +931,7 @@ static int replica_deal_slice_read(struct fast_task_info *task)
 
     sf_hold_task(task);
     OP_CTX_INFO.source = BINLOG_SOURCE_RPC_MASTER;
+    OP_CTX_INFO.io_class = FS_IO_CLASS_RECOVERY;  //for the slave recovery
     OP_CTX_INFO.buff = REQUEST.body;
     if (direct_read) {
         SLICE_OP_CTX.rw_done_callback = (fs_rw_done_callback_func)
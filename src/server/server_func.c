@@ -29,6 +29,7 @@
 #include "server_global.h"
 #include "server_binlog.h"
 #include "server_group_info.h"
+#include "binlog/slice_binlog_format.h"
 #include "server_func.h"
 
 static int get_bytes_item_config(IniContext *ini_context,
@@ -297,6 +298,10 @@ static void server_log_configs()
             "binlog_buffer_size = %d KB, "
             "local_binlog_check_last_seconds = %d s, "
             "slave_binlog_check_last_rows = %d, "
+            "slice_checkpoint_interval = %d s, "
+            "slice_checkpoint_write_speed = %"PRId64" MB, "
+            "slice_binlog_format = %s, "
+            "numa_aware = %d, numa_nic = %s, "
             "cluster server count = %d, "
             "idempotency_max_channel_count: %d",
             CLUSTER_MY_SERVER_ID, DATA_PATH_STR, DATA_THREAD_COUNT,
@@ -306,6 +311,10 @@ static void server_log_configs()
             BINLOG_BUFFER_SIZE / 1024,
             LOCAL_BINLOG_CHECK_LAST_SECONDS,
             SLAVE_BINLOG_CHECK_LAST_ROWS,
+            SLICE_CHECKPOINT_INTERVAL,
+            SLICE_CHECKPOINT_WRITE_SPEED / (1024 * 1024),
+            SLICE_BINLOG_FORMAT == SLICE_BINLOG_FORMAT_BINARY ?
+            "binary" : "text", NUMA_CFG.enabled, NUMA_CFG.nic,
             FC_SID_SERVER_COUNT(SERVER_CONFIG_CTX),
             SF_IDEMPOTENCY_MAX_CHANNEL_COUNT);
 
@@ -343,6 +352,65 @@ static int load_binlog_buffer_size(IniContext *ini_context,
     return 0;
 }
 
+static int load_slice_checkpoint_config(IniContext *ini_context,
+        const char *filename)
+{
+    int result;
+
+    SLICE_CHECKPOINT_INTERVAL = iniGetIntValue(NULL,
+            "slice_checkpoint_interval", ini_context,
+            FS_DEFAULT_SLICE_CHECKPOINT_INTERVAL);
+    if (SLICE_CHECKPOINT_INTERVAL < 0) {
+        SLICE_CHECKPOINT_INTERVAL = 0;
+    }
+
+    if ((result=get_bytes_item_config(ini_context, filename,
+                    "slice_checkpoint_write_speed",
+                    FS_DEFAULT_SLICE_CHECKPOINT_WRITE_SPEED,
+                    &SLICE_CHECKPOINT_WRITE_SPEED)) != 0)
+    {
+        return result;
+    }
+
+    return 0;
+}
+
+static int load_slice_binlog_format(IniContext *ini_context,
+        const char *filename)
+{
+    char *format;
+
+    format = iniGetStrValue(NULL, "slice_binlog_format", ini_context);
+    if (format == NULL || *format == '\0' ||
+            strcasecmp(format, "text") == 0)
+    {
+        SLICE_BINLOG_FORMAT = SLICE_BINLOG_FORMAT_TEXT;
+    } else if (strcasecmp(format, "binary") == 0) {
+        SLICE_BINLOG_FORMAT = SLICE_BINLOG_FORMAT_BINARY;
+    } else {
+        logError("file: "__FILE__", line: %d, "
+                "config file: %s, invalid slice_binlog_format: %s, "
+                "expect: text or binary", __LINE__, filename, format);
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+static void load_numa_config(IniContext *ini_context)
+{
+    char *nic;
+
+    NUMA_CFG.enabled = iniGetBoolValue(NULL, "numa_aware",
+            ini_context, false);
+    nic = iniGetStrValue(NULL, "numa_nic", ini_context);
+    if (nic == NULL) {
+        *NUMA_CFG.nic = '\0';
+    } else {
+        snprintf(NUMA_CFG.nic, sizeof(NUMA_CFG.nic), "%s", nic);
+    }
+}
+
 static int load_storage_cfg(IniContext *ini_context, const char *filename)
 {
     char *storage_config_filename;
@@ -435,10 +503,20 @@ int server_load_config(const char *filename)
             FS_MIN_SLAVE_BINLOG_CHECK_LAST_ROWS,
             FS_MAX_SLAVE_BINLOG_CHECK_LAST_ROWS);
 
+    load_numa_config(&ini_context);
+
     if ((result=load_binlog_buffer_size(&ini_context, filename)) != 0) {
         return result;
     }
 
+    if ((result=load_slice_checkpoint_config(&ini_context, filename)) != 0) {
+        return result;
+    }
+
+    if ((result=load_slice_binlog_format(&ini_context, filename)) != 0) {
+        return result;
+    }
+
     if ((result=load_cluster_config(&ini_context, filename)) != 0) {
         return result;
     }
@@ -59,6 +59,11 @@ typedef struct server_global_vars {
         int local_binlog_check_last_seconds;
         int slave_binlog_check_last_rows;
         volatile uint64_t slice_binlog_sn;  //slice binlog sn
+        char slice_binlog_format;  //SLICE_BINLOG_FORMAT_xxx for the writes
+        struct {
+            int interval;         //in seconds, 0 for disable
+            int64_t write_speed;  //bytes per second, 0 for unlimited
+        } slice_checkpoint;
     } data;
 
     FSStorageConfig storage_cfg;
@@ -73,6 +78,11 @@ typedef struct server_global_vars {
 
     SFSlowLogContext slow_log;
 
+    struct {
+        bool enabled;  //bind the threads and the index to the NUMA nodes
+        char nic[32];  //the network interface for the node of data threads
+    } numa;
+
     FCThreadPool thread_pool;
 
 } FSServerGlobalVars;
@@ -100,12 +110,18 @@ typedef struct server_global_vars {
 
 #define CLUSTER_CURRENT_VERSION   g_server_global_vars.cluster.current_version
 #define SLICE_BINLOG_SN           g_server_global_vars.data.slice_binlog_sn
+#define SLICE_BINLOG_FORMAT       g_server_global_vars.data.slice_binlog_format
 #define LOCAL_BINLOG_CHECK_LAST_SECONDS g_server_global_vars.data. \
     local_binlog_check_last_seconds
 
 #define SLAVE_BINLOG_CHECK_LAST_ROWS    g_server_global_vars.data. \
     slave_binlog_check_last_rows
 
+#define SLICE_CHECKPOINT_INTERVAL    g_server_global_vars.data. \
+    slice_checkpoint.interval
+#define SLICE_CHECKPOINT_WRITE_SPEED g_server_global_vars.data. \
+    slice_checkpoint.write_speed
+
 #define CLUSTER_SF_CTX        g_server_global_vars.cluster.sf_context
 #define REPLICA_SF_CTX        g_server_global_vars.replica.sf_context
 
@@ -123,6 +139,8 @@ typedef struct server_global_vars {
 
 #define THREAD_POOL           g_server_global_vars.thread_pool
 
+#define NUMA_CFG              g_server_global_vars.numa
+
 #define REPLICA_CHANNELS_BETWEEN_TWO_SERVERS  \
     g_server_global_vars.replica.channels_between_two_servers
 
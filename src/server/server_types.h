@@ -81,10 +81,59 @@
 #define FS_MIN_SLAVE_BINLOG_CHECK_LAST_ROWS              0
 #define FS_MAX_SLAVE_BINLOG_CHECK_LAST_ROWS            128
 
+#define FS_DEFAULT_SLICE_CHECKPOINT_INTERVAL          3600
+#define FS_DEFAULT_SLICE_CHECKPOINT_WRITE_SPEED  (64 * 1024 * 1024)
+
 #define FS_DEFAULT_TRUNK_FILE_SIZE  (256 * 1024 * 1024LL)
 #define FS_TRUNK_FILE_MIN_SIZE      ( 64 * 1024 * 1024LL)
 #define FS_TRUNK_FILE_MAX_SIZE      (  4 * 1024 * 1024 * 1024LL)
 
+#define FS_DIRECT_IO_ALIGN_SIZE        4096
+#define FS_DIRECT_IO_ALIGN(n)  (((n) + FS_DIRECT_IO_ALIGN_SIZE - 1) & \
+        (~((int64_t)FS_DIRECT_IO_ALIGN_SIZE - 1)))
+#define FS_DIRECT_IO_ALIGN_DOWN(n)  ((n) & \
+        (~((int64_t)FS_DIRECT_IO_ALIGN_SIZE - 1)))
+#define FS_DIRECT_IO_IS_ALIGNED(n)  \
+    (((int64_t)(n) & (FS_DIRECT_IO_ALIGN_SIZE - 1)) == 0)
+
+#define FS_DEFAULT_IO_DEPTH_PER_THREAD    64
+#define FS_MAX_IO_DEPTH_PER_THREAD      4096
+
+#define FS_DEFAULT_IO_MERGE_MAX_SIZE  (1024 * 1024)
+#define FS_MAX_IO_MERGE_MAX_SIZE      (64 * 1024 * 1024)
+
+#define FS_DEFAULT_READ_MERGE_GAP_SIZE    4096
+#define FS_MAX_READ_MERGE_GAP_SIZE      (256 * 1024)
+
+#define FS_DEFAULT_READ_AHEAD_SIZE    (1024 * 1024)
+#define FS_MAX_READ_AHEAD_SIZE        (64 * 1024 * 1024)
+
+#define FS_DEFAULT_READ_CACHE_SHARD_COUNT   61
+#define FS_MAX_READ_CACHE_SHARD_COUNT     1024
+
+#define FS_DEFAULT_ZERO_COPY_READ_MIN_SIZE  (256 * 1024)
+#define FS_DEFAULT_ZERO_COPY_SEND_THREADS     4
+#define FS_MAX_ZERO_COPY_SEND_THREADS        64
+
+#define FS_DEFAULT_COMPRESS_MIN_SIZE        (16 * 1024)
+#define FS_DEFAULT_COMPRESS_ZSTD_LEVEL        1
+#define FS_DEFAULT_DECOMPRESS_THREADS         4
+#define FS_MAX_DECOMPRESS_THREADS            64
+
+#define FS_DEFAULT_SYNC_INTERVAL_MS          1000
+#define FS_DEFAULT_GROUP_COMMIT_WINDOW_MS       1
+#define FS_MAX_GROUP_COMMIT_WINDOW_MS         100
+
+//the IO classes for the disk IO scheduler
+#define FS_IO_CLASS_FOREGROUND     0  //the reads and writes of the client
+#define FS_IO_CLASS_REPLICATION    1  //the writes replicated from the master
+#define FS_IO_CLASS_RECOVERY       2  //binlog replay and its data fetching
+#define FS_IO_CLASS_RECLAIM        3  //the slice migration of trunk reclaim
+#define FS_IO_CLASS_MAINTENANCE    4  //trunk file create and delete
+#define FS_IO_CLASS_COUNT          5
+
+#define FS_MAX_IO_CLASS_WEIGHT   100
+
 #define FS_DEFAULT_DISCARD_REMAIN_SPACE_SIZE  4096
 #define FS_DISCARD_REMAIN_SPACE_MIN_SIZE       256
 #define FS_DISCARD_REMAIN_SPACE_MAX_SIZE      (256 * 1024)
@@ -43,6 +43,10 @@
 #include "common/fs_proto.h"
 #include "common/fs_func.h"
 #include "binlog/replica_binlog.h"
+#include "storage/durability.h"
+#include "storage/read_cache.h"
+#include "zero_copy_sender.h"
+#include "dio/trunk_io_thread.h"
 #include "replication/replication_common.h"
 #include "server_global.h"
 #include "server_func.h"
@@ -106,6 +110,9 @@ static int service_deal_service_stat(struct fast_task_info *task)
     int64_t ob_count;
     int64_t slice_count;
     FSBinlogWriterStat writer_stat;
+    FSDurabilityStat durability_stat;
+    FSReadCacheStat cache_stat;
+    FSIndexMemoryStat memory_stat;
     FSClusterDataGroupInfo *group;
     FSProtoServiceStatReq *req;
     FSProtoServiceStatResp *stat_resp;
@@ -134,6 +141,9 @@ static int service_deal_service_stat(struct fast_task_info *task)
         replica_binlog_writer_stat(data_group_id, &writer_stat);
     }
     ob_index_get_ob_and_slice_counts(&ob_count, &slice_count);
+    durability_get_stat(&durability_stat);
+    read_cache_get_stat(&cache_stat);
+    ob_index_get_memory_stat(&memory_stat);
 
     stat_resp = (FSProtoServiceStatResp *)REQUEST.body;
     stat_resp->is_leader  = CLUSTER_MYSELF_PTR == CLUSTER_LEADER_PTR ? 1 : 0;
@@ -150,6 +160,25 @@ static int service_deal_service_stat(struct fast_task_info *task)
     long2buff(ob_count, stat_resp->data.ob_count);
     long2buff(slice_count, stat_resp->data.slice_count);
 
+    stat_resp->durability.mode = durability_stat.mode;
+    fs_proto_pack_sync_stat(&durability_stat.trunk,
+            &stat_resp->durability.trunk);
+    fs_proto_pack_sync_stat(&durability_stat.binlog,
+            &stat_resp->durability.binlog);
+
+    long2buff(cache_stat.capacity, stat_resp->read_cache.capacity);
+    long2buff(cache_stat.used, stat_resp->read_cache.used);
+    long2buff(cache_stat.count, stat_resp->read_cache.count);
+    long2buff(cache_stat.hit_count, stat_resp->read_cache.hit_count);
+    long2buff(cache_stat.miss_count, stat_resp->read_cache.miss_count);
+    long2buff(cache_stat.evict_count, stat_resp->read_cache.evict_count);
+
+    long2buff(memory_stat.ob_entries, stat_resp->index_memory.ob_entries);
+    long2buff(memory_stat.slice_entries,
+            stat_resp->index_memory.slice_entries);
+    long2buff(memory_stat.slice_maps, stat_resp->index_memory.slice_maps);
+    long2buff(memory_stat.hashtable, stat_resp->index_memory.hashtable);
+
     RESPONSE.header.body_len = sizeof(FSProtoServiceStatResp);
     RESPONSE.header.cmd = FS_SERVICE_PROTO_SERVICE_STAT_RESP;
     TASK_ARG->context.response_done = true;
@@ -177,6 +206,20 @@ static int service_deal_slice_read(struct fast_task_info *task)
         return result;
     }
 
+    if (zero_copy_sender_can_send(OP_CTX_INFO.bs_key.slice.length,
+                task->size - sizeof(FSProtoHeader)))
+    {
+        sf_hold_task(task);
+        if ((result=zero_copy_sender_push(task)) == 0) {
+            return TASK_STATUS_CONTINUE;
+        }
+
+        sf_release_task(task);
+        if (result != EOPNOTSUPP) {
+            return result;
+        }
+    }
+
     if (OP_CTX_INFO.bs_key.slice.length > task->size - sizeof(FSProtoHeader)) {
         RESPONSE.error.length = sprintf(RESPONSE.error.message,
                 "read slice length: %d > task buffer size: %d",
@@ -187,6 +230,7 @@ static int service_deal_slice_read(struct fast_task_info *task)
 
     sf_hold_task(task);
     OP_CTX_INFO.source = BINLOG_SOURCE_RPC_MASTER;
+    OP_CTX_INFO.io_class = FS_IO_CLASS_FOREGROUND;
     OP_CTX_INFO.buff = REQUEST.body;
     OP_CTX_NOTIFY_FUNC = du_handler_slice_read_done_notify;
     if ((result=push_to_data_thread_queue(DATA_OPERATION_SLICE_READ,
@@ -416,6 +460,100 @@ static int service_deal_disk_space_stat(struct fast_task_info *task)
     return 0;
 }
 
+static int pack_io_path_stat(struct fast_task_info *task,
+        FSStoragePathInfo *path, FSIOPathStat *stat,
+        char **p, char *buff_end)
+{
+    FSProtoIOStatRespPathPart *path_part;
+    FSProtoIOStatRespThreadPart *thread_part;
+    FSIOThreadStat *thread;
+    FSIOThreadStat *end;
+    int i;
+
+    if (*p + sizeof(FSProtoIOStatRespPathPart) + path->store.path.len +
+            sizeof(FSProtoIOStatRespThreadPart) * stat->thread_count >
+            buff_end)
+    {
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "task buffer size: %d is too small", task->size);
+        return EOVERFLOW;
+    }
+
+    path_part = (FSProtoIOStatRespPathPart *)*p;
+    int2buff(stat->thread_count, path_part->thread_count);
+    short2buff(path->store.path.len, path_part->path_len);
+    for (i=0; i<FS_IO_STAT_TYPE_COUNT; i++) {
+        fs_proto_pack_latency_summary(&stat->types[i].queue_wait,
+                &path_part->types[i].queue_wait);
+        fs_proto_pack_latency_summary(&stat->types[i].service,
+                &path_part->types[i].service);
+    }
+    memcpy(path_part->path, path->store.path.str, path->store.path.len);
+
+    thread_part = (FSProtoIOStatRespThreadPart *)(path_part->path +
+            path->store.path.len);
+    end = stat->threads + stat->thread_count;
+    for (thread=stat->threads; thread<end; thread++, thread_part++) {
+        thread_part->role = thread->role;
+        int2buff(thread->queued, thread_part->queued);
+        long2buff(thread->count, thread_part->count);
+        long2buff(thread->busy_time, thread_part->busy_time);
+    }
+
+    *p = (char *)thread_part;
+    return 0;
+}
+
+static int service_deal_io_stat(struct fast_task_info *task)
+{
+    int result;
+    int path_count;
+    int i;
+    FSProtoIOStatRespBodyHeader *body_header;
+    FSStoragePathArray *parrays[2];
+    FSStoragePathInfo *path;
+    FSStoragePathInfo *end;
+    FSIOPathStat stat;
+    char *p;
+    char *buff_end;
+
+    if ((result=server_expect_body_length(task, 0)) != 0) {
+        return result;
+    }
+
+    body_header = (FSProtoIOStatRespBodyHeader *)REQUEST.body;
+    p = (char *)(body_header + 1);
+    buff_end = REQUEST.body + (task->size - sizeof(FSProtoHeader));
+    path_count = 0;
+    parrays[0] = &STORAGE_CFG.write_cache;
+    parrays[1] = &STORAGE_CFG.store_path;
+    for (i=0; i<2; i++) {
+        end = parrays[i]->paths + parrays[i]->count;
+        for (path=parrays[i]->paths; path<end; path++) {
+            if (trunk_io_thread_get_path_stat(path->store.index,
+                        &stat) != 0)
+            {
+                continue;
+            }
+
+            if ((result=pack_io_path_stat(task, path, &stat,
+                            &p, buff_end)) != 0)
+            {
+                return result;
+            }
+            path_count++;
+        }
+    }
+
+    long2buff(trunk_io_thread_get_stat_elapsed_time(),
+            body_header->elapsed_time);
+    int2buff(path_count, body_header->path_count);
+    RESPONSE.header.body_len = p - REQUEST.body;
+    RESPONSE.header.cmd = FS_SERVICE_PROTO_IO_STAT_RESP;
+    TASK_ARG->context.response_done = true;
+    return 0;
+}
+
 static int service_update_prepare_and_check(struct fast_task_info *task,
         const int resp_cmd)
 {
@@ -469,6 +607,7 @@ static int service_update_prepare_and_check(struct fast_task_info *task,
 
     TASK_CTX.which_side = FS_WHICH_SIDE_MASTER;
     OP_CTX_INFO.source = BINLOG_SOURCE_RPC_MASTER;
+    OP_CTX_INFO.io_class = FS_IO_CLASS_FOREGROUND;
     OP_CTX_INFO.data_version = 0;
     SLICE_OP_CTX.update.space_changed = 0;
 
@@ -613,6 +752,9 @@ int service_deal_task(struct fast_task_info *task, const int stage)
             case FS_SERVICE_PROTO_DISK_SPACE_STAT_REQ:
                 result = service_deal_disk_space_stat(task);
                 break;
+            case FS_SERVICE_PROTO_IO_STAT_REQ:
+                result = service_deal_io_stat(task);
+                break;
             case SF_SERVICE_PROTO_SETUP_CHANNEL_REQ:
                 if ((result=sf_server_deal_setup_channel(task,
                                 &SERVER_TASK_TYPE, &IDEMPOTENCY_CHANNEL,
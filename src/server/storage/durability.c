@@ -0,0 +1,488 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/fast_mblock.h"
+#include "fastcommon/fc_queue.h"
+#include "fastcommon/pthread_func.h"
+#include "sf/sf_global.h"
+#include "sf/sf_nio.h"
+#include "sf/sf_binlog_writer.h"
+#include "../server_global.h"
+#include "../binlog/slice_binlog.h"
+#include "../binlog/replica_binlog.h"
+#include "durability.h"
+
+#define BINLOG_WAIT_WRITER_LOG_COUNT  1000  //about 1 second
+
+typedef struct fs_durability_waiting_task {
+    struct fast_task_info *task;
+    int data_group_id;
+    uint64_t data_version;
+    uint64_t slice_sn;
+    struct fs_durability_waiting_task *next;
+} FSDurabilityWaitingTask;
+
+typedef struct {
+    SFBinlogWriterInfo *writer;
+    int index;   //the binlog file index of the fd
+    int fd;
+    bool dirty;   //keep dirty until the sync success
+    int result;   //the result of the last sync for the waiting tasks
+    uint64_t target_version;  //wait for the writer to write this version
+} BinlogSyncEntry;
+
+typedef struct {
+    struct fast_mblock_man allocator;  //element: FSDurabilityWaitingTask
+    struct fc_queue queue;
+    BinlogSyncEntry slice;
+    struct {
+        BinlogSyncEntry *entries;  //indexed by data_group_id - base_id
+        int count;
+        int base_id;
+    } replica;
+    struct {
+        int *fds;  //for syncfs
+        int count;
+    } paths;
+    struct {
+        FSSyncStat trunk;
+        FSSyncStat binlog;
+    } stat;
+} DurabilityContext;
+
+static DurabilityContext durability_ctx;
+
+static void sync_stat_add(FSSyncStat *stat, const int batch_size,
+        const int64_t time_used_us)
+{
+    int old;
+
+    __sync_add_and_fetch(&stat->count, 1);
+    __sync_add_and_fetch(&stat->total_batch, batch_size);
+    __sync_add_and_fetch(&stat->total_time_us, time_used_us);
+
+    while ((old=FC_ATOMIC_GET(stat->max_batch)) < batch_size) {
+        if (__sync_bool_compare_and_swap(&stat->max_batch,
+                    old, batch_size))
+        {
+            break;
+        }
+    }
+    while ((old=FC_ATOMIC_GET(stat->max_time_us)) < time_used_us) {
+        if (__sync_bool_compare_and_swap(&stat->max_time_us,
+                    old, (int)time_used_us))
+        {
+            break;
+        }
+    }
+}
+
+void durability_add_trunk_sync_stat(const int batch_size,
+        const int64_t time_used_us)
+{
+    sync_stat_add(&durability_ctx.stat.trunk, batch_size, time_used_us);
+}
+
+static void get_sync_stat(FSSyncStat *src, FSSyncStat *dest)
+{
+    dest->count = FC_ATOMIC_GET(src->count);
+    dest->total_batch = FC_ATOMIC_GET(src->total_batch);
+    dest->total_time_us = FC_ATOMIC_GET(src->total_time_us);
+    dest->max_batch = FC_ATOMIC_GET(src->max_batch);
+    dest->max_time_us = FC_ATOMIC_GET(src->max_time_us);
+}
+
+void durability_get_stat(FSDurabilityStat *stat)
+{
+    stat->mode = STORAGE_CFG.durability.mode;
+    get_sync_stat(&durability_ctx.stat.trunk, &stat->trunk);
+    get_sync_stat(&durability_ctx.stat.binlog, &stat->binlog);
+}
+
+static int sync_binlog(BinlogSyncEntry *entry)
+{
+    int result;
+    int index;
+    char filename[PATH_MAX];
+
+    index = sf_binlog_get_current_write_index(entry->writer);
+    if (index != entry->index) {
+        if (entry->fd >= 0) {  //the tail of the old binlog file
+            if (fdatasync(entry->fd) != 0) {
+                result = errno != 0 ? errno : EIO;
+                logError("file: "__FILE__", line: %d, "
+                        "fdatasync binlog subdir: %s, index: %d fail, "
+                        "errno: %d, error info: %s", __LINE__,
+                        entry->writer->cfg.subdir_name, entry->index,
+                        result, STRERROR(result));
+                return result;  //keep the old fd to retry the tail
+            }
+            close(entry->fd);
+        }
+
+        sf_binlog_writer_get_filename(entry->writer->cfg.subdir_name,
+                index, filename, sizeof(filename));
+        if ((entry->fd=open(filename, O_WRONLY)) < 0) {
+            result = errno != 0 ? errno : EIO;
+            logError("file: "__FILE__", line: %d, "
+                    "open binlog file %s fail, errno: %d, error info: %s",
+                    __LINE__, filename, result, STRERROR(result));
+            entry->index = -1;
+            return result;
+        }
+        entry->index = index;
+    }
+
+    while (fdatasync(entry->fd) != 0) {
+        result = errno != 0 ? errno : EIO;
+        if (result != EINTR) {
+            logError("file: "__FILE__", line: %d, "
+                    "fdatasync binlog subdir: %s, index: %d fail, "
+                    "errno: %d, error info: %s", __LINE__,
+                    entry->writer->cfg.subdir_name, entry->index,
+                    result, STRERROR(result));
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+/* the binlog writer thread writes the records in the order of the version,
+   wait for the records before the target version wrote to the file.
+   the sync before that can NOT cover the records, so wait until the
+   writer passes the target version, only give up when the server quits */
+static int wait_binlog_writer(BinlogSyncEntry *entry)
+{
+    int count;
+
+    count = 0;
+    while (FC_ATOMIC_GET(entry->writer->version_ctx.next) <=
+            entry->target_version)
+    {
+        if (!SF_G_CONTINUE_FLAG) {
+            return EINTR;
+        }
+
+        if (++count % BINLOG_WAIT_WRITER_LOG_COUNT == 0) {
+            logWarning("file: "__FILE__", line: %d, "
+                    "binlog subdir: %s, waiting for the writer %d ms, "
+                    "target version: %"PRId64", next version: %"PRId64,
+                    __LINE__, entry->writer->cfg.subdir_name, count,
+                    entry->target_version, (int64_t)entry->
+                    writer->version_ctx.next);
+        }
+        fc_sleep_ms(1);
+    }
+
+    return 0;
+}
+
+static inline int sync_dirty_binlog(BinlogSyncEntry *entry)
+{
+    if ((entry->result=wait_binlog_writer(entry)) == 0) {
+        if ((entry->result=sync_binlog(entry)) == 0) {
+            entry->dirty = false;
+        }
+    }
+
+    return entry->result;
+}
+
+static inline void notify_waiting_task(FSDurabilityWaitingTask *wt,
+        const int result)
+{
+    struct fast_task_info *task;
+
+    task = wt->task;
+    if (result != 0) {  //NOT durable, response the error
+        RESPONSE_STATUS = result;
+        RESPONSE.error.length = sprintf(RESPONSE.error.message,
+                "sync binlog fail, errno: %d, error info: %s",
+                result, STRERROR(result));
+    }
+    sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+    sf_release_task(task);
+}
+
+static void group_commit(FSDurabilityWaitingTask *head)
+{
+    FSDurabilityWaitingTask *wt;
+    BinlogSyncEntry *entry;
+    BinlogSyncEntry *end;
+    int64_t start_time;
+    int count;
+    int index;
+    int result;
+
+    start_time = get_current_time_us();
+    count = 0;
+    wt = head;
+    do {
+        ++count;
+        index = wt->data_group_id - durability_ctx.replica.base_id;
+        if (index >= 0 && index < durability_ctx.replica.count &&
+                durability_ctx.replica.entries[index].writer != NULL)
+        {
+            entry = durability_ctx.replica.entries + index;
+            if (!entry->dirty || entry->target_version < wt->data_version) {
+                entry->target_version = wt->data_version;
+            }
+            entry->dirty = true;
+        }
+
+        if (durability_ctx.slice.target_version < wt->slice_sn) {
+            durability_ctx.slice.target_version = wt->slice_sn;
+        }
+    } while ((wt=wt->next) != NULL);
+
+    //the dirty entries of the failed syncs are retried here too
+    sync_dirty_binlog(&durability_ctx.slice);
+    end = durability_ctx.replica.entries + durability_ctx.replica.count;
+    for (entry=durability_ctx.replica.entries; entry<end; entry++) {
+        if (entry->dirty) {
+            sync_dirty_binlog(entry);
+        }
+    }
+    sync_stat_add(&durability_ctx.stat.binlog, count,
+            get_current_time_us() - start_time);
+
+    do {
+        wt = head;
+        head = head->next;
+
+        result = durability_ctx.slice.result;
+        index = wt->data_group_id - durability_ctx.replica.base_id;
+        if (result == 0 && index >= 0 && index <
+                durability_ctx.replica.count)
+        {
+            result = durability_ctx.replica.entries[index].result;
+        }
+        notify_waiting_task(wt, result);
+        fast_mblock_free_object(&durability_ctx.allocator, wt);
+    } while (head != NULL);
+}
+
+static void periodic_sync()
+{
+    BinlogSyncEntry *entry;
+    BinlogSyncEntry *end;
+    int64_t start_time;
+    int i;
+
+    start_time = get_current_time_us();
+#ifdef OS_LINUX
+    for (i=0; i<durability_ctx.paths.count; i++) {
+        if (syncfs(durability_ctx.paths.fds[i]) != 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "syncfs fail, errno: %d, error info: %s",
+                    __LINE__, errno, STRERROR(errno));
+        }
+    }
+#else
+    i = durability_ctx.paths.count;
+    sync();
+#endif
+    sync_stat_add(&durability_ctx.stat.trunk, i,
+            get_current_time_us() - start_time);
+
+    start_time = get_current_time_us();
+    sync_binlog(&durability_ctx.slice);
+    end = durability_ctx.replica.entries + durability_ctx.replica.count;
+    for (entry=durability_ctx.replica.entries; entry<end; entry++) {
+        if (entry->writer != NULL) {
+            sync_binlog(entry);
+        }
+    }
+    sync_stat_add(&durability_ctx.stat.binlog, 1,
+            get_current_time_us() - start_time);
+}
+
+static void *durability_thread_func(void *arg)
+{
+    FSDurabilityWaitingTask *head;
+    FSDurabilityWaitingTask *tail;
+    FSDurabilityWaitingTask *more;
+
+    while (SF_G_CONTINUE_FLAG) {
+        if (STORAGE_CFG.durability.mode == FS_DURABILITY_MODE_PERIODIC) {
+            fc_sleep_ms(STORAGE_CFG.durability.sync_interval_ms);
+            periodic_sync();
+            continue;
+        }
+
+        if ((head=(FSDurabilityWaitingTask *)fc_queue_pop_all(
+                        &durability_ctx.queue)) == NULL)
+        {
+            continue;
+        }
+
+        //wait for more requests to share the sync
+        if (STORAGE_CFG.durability.group_commit_window_ms > 0) {
+            fc_sleep_ms(STORAGE_CFG.durability.group_commit_window_ms);
+            if ((more=(FSDurabilityWaitingTask *)fc_queue_try_pop_all(
+                            &durability_ctx.queue)) != NULL)
+            {
+                tail = head;
+                while (tail->next != NULL) {
+                    tail = tail->next;
+                }
+                tail->next = more;
+            }
+        }
+
+        group_commit(head);
+    }
+
+    return NULL;
+}
+
+int durability_wait_commit(struct fast_task_info *task,
+        const int data_group_id, const uint64_t data_version)
+{
+    FSDurabilityWaitingTask *wt;
+
+    if ((wt=(FSDurabilityWaitingTask *)fast_mblock_alloc_object(
+                    &durability_ctx.allocator)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    wt->task = task;
+    wt->data_group_id = data_group_id;
+    wt->data_version = data_version;
+    wt->slice_sn = FC_ATOMIC_GET(SLICE_BINLOG_SN);
+    fc_queue_push(&durability_ctx.queue, wt);
+    return 0;
+}
+
+static inline void init_sync_entry(BinlogSyncEntry *entry,
+        SFBinlogWriterInfo *writer)
+{
+    entry->writer = writer;
+    entry->index = -1;
+    entry->fd = -1;
+    entry->dirty = false;
+    entry->result = 0;
+    entry->target_version = 0;
+}
+
+static int init_replica_entries()
+{
+    SFBinlogWriterInfo **writers;
+    int bytes;
+    int i;
+
+    durability_ctx.replica.count = replica_binlog_get_writers(
+            &writers, &durability_ctx.replica.base_id);
+    bytes = sizeof(BinlogSyncEntry) * durability_ctx.replica.count;
+    if ((durability_ctx.replica.entries=(BinlogSyncEntry *)
+                fc_malloc(bytes)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    for (i=0; i<durability_ctx.replica.count; i++) {
+        init_sync_entry(durability_ctx.replica.entries + i, writers[i]);
+    }
+    return 0;
+}
+
+static int open_path_array(FSStoragePathArray *parray)
+{
+    FSStoragePathInfo *p;
+    FSStoragePathInfo *end;
+    int result;
+    int fd;
+
+    end = parray->paths + parray->count;
+    for (p=parray->paths; p<end; p++) {
+        if ((fd=open(p->store.path.str, O_RDONLY)) < 0) {
+            result = errno != 0 ? errno : EIO;
+            logError("file: "__FILE__", line: %d, "
+                    "open path %s fail, errno: %d, error info: %s",
+                    __LINE__, p->store.path.str, result, STRERROR(result));
+            return result;
+        }
+        durability_ctx.paths.fds[durability_ctx.paths.count++] = fd;
+    }
+
+    return 0;
+}
+
+static int init_path_fds()
+{
+    int result;
+    int bytes;
+
+    bytes = sizeof(int) * (STORAGE_CFG.write_cache.count +
+            STORAGE_CFG.store_path.count);
+    if ((durability_ctx.paths.fds=(int *)fc_malloc(bytes)) == NULL) {
+        return ENOMEM;
+    }
+
+    durability_ctx.paths.count = 0;
+    if ((result=open_path_array(&STORAGE_CFG.write_cache)) != 0) {
+        return result;
+    }
+    return open_path_array(&STORAGE_CFG.store_path);
+}
+
+int durability_init()
+{
+    int result;
+    pthread_t tid;
+
+    if (STORAGE_CFG.durability.mode == FS_DURABILITY_MODE_NONE) {
+        return 0;
+    }
+
+    if ((result=fast_mblock_init_ex1(&durability_ctx.allocator,
+                    "durability_wtask", sizeof(FSDurabilityWaitingTask),
+                    4 * 1024, 0, NULL, NULL, true)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=fc_queue_init(&durability_ctx.queue, (long)
+                    (&((FSDurabilityWaitingTask *)NULL)->next))) != 0)
+    {
+        return result;
+    }
+
+    init_sync_entry(&durability_ctx.slice, slice_binlog_get_writer());
+    if ((result=init_replica_entries()) != 0) {
+        return result;
+    }
+
+    if (STORAGE_CFG.durability.mode == FS_DURABILITY_MODE_PERIODIC) {
+        if ((result=init_path_fds()) != 0) {
+            return result;
+        }
+    }
+
+    return fc_create_thread(&tid, durability_thread_func,
+            NULL, SF_G_THREAD_STACK_SIZE);
+}
+
+void durability_terminate()
+{
+}
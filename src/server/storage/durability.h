@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FS_DURABILITY_H
+#define _FS_DURABILITY_H
+
+#include "fastcommon/fast_task_queue.h"
+#include "../../common/fs_types.h"
+#include "storage_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int durability_init();
+    void durability_terminate();
+
+    /* for group commit mode: response the task after the slice binlog and
+       the replica binlog of the data group synced,
+       return 0 for success, != 0 for the caller to response directly */
+    int durability_wait_commit(struct fast_task_info *task,
+            const int data_group_id, const uint64_t data_version);
+
+    void durability_add_trunk_sync_stat(const int batch_size,
+            const int64_t time_used_us);
+
+    void durability_get_stat(FSDurabilityStat *stat);
+
+    static inline const char *durability_get_mode_caption(const int mode)
+    {
+        switch (mode) {
+            case FS_DURABILITY_MODE_NONE:
+                return "none";
+            case FS_DURABILITY_MODE_PERIODIC:
+                return "periodic";
+            case FS_DURABILITY_MODE_GROUP_COMMIT:
+                return "group_commit";
+            default:
+                return "unknown";
+        }
+    }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -14,20 +14,68 @@
  */
 
 #include <limits.h>
+#include <stddef.h>
 #include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "fastcommon/shared_func.h"
 #include "fastcommon/logger.h"
 #include "fastcommon/uniq_skiplist.h"
 #include "sf/sf_global.h"
+#include "../../common/fs_crc32c.h"
 #include "../server_global.h"
+#include "../numa_topology.h"
 #include "../binlog/slice_binlog.h"
 #include "storage_allocator.h"
+#include "read_cache.h"
 #include "object_block_index.h"
 
 #define SLICE_ARRAY_FIXED_COUNT  64
 
+/* the slice map of the object block converts to the skiplist when
+   the slice count > OB_SLICE_MAP_MAX_ARRAY_COUNT, and back to the sorted
+   array when the slice count <= OB_SLICE_MAP_MIN_SKIPLIST_COUNT */
+#define OB_SLICE_MAP_INIT_ALLOC          4
+#define OB_SLICE_MAP_MAX_ARRAY_COUNT     256
+#define OB_SLICE_MAP_MIN_SKIPLIST_COUNT  64
+
+/* the open addressing hashtable probes the control bytes by group
+   like the swiss table, the control byte of the used slot is
+   the 7 bits hash tag and the key is compared only when the tag matched */
+#define OB_OPEN_MIN_GROUP_COUNT   2
+#define OB_OPEN_GROUP_MATCH_MASK  ((1U << OB_OPEN_GROUP_SIZE) - 1)
+#define OB_OPEN_CTRL_EMPTY        ((int8_t)-128)
+#define OB_OPEN_CTRL_DELETED      ((int8_t)-2)
+
+/* rehash when the used and deleted slots exceed 7/8 of the capacity */
+#define OB_OPEN_MAX_USED(capacity)  ((capacity) - (capacity) / 8)
+
+#define OB_OPEN_CTRL(shard, index)  (shard)->groups[(index) / \
+    OB_OPEN_GROUP_SIZE].ctrls[(index) % OB_OPEN_GROUP_SIZE]
+#define OB_OPEN_SLOT(shard, index)  (shard)->groups[(index) / \
+    OB_OPEN_GROUP_SIZE].slots[(index) % OB_OPEN_GROUP_SIZE]
+
+/* the buffer freed by the writer, such as the slice array and the groups
+   of the open addressing hashtable, may be still accessed by the lockless
+   readers. the readers count themselves in the slot of the reader epoch,
+   the epoch advances only when the other slot drained, so the buffer
+   retired at epoch E is unreachable when the epoch reaches E + 3 */
+#define OB_RETIRED_BUFFER_GRACE_EPOCHS  3
+
+/* the lockless read falls back to the locked read after these tries */
+#define OB_LOCKLESS_READ_TRIES  3
+
+/* the chain hashtable grows when the object block count exceeds
+   the capacity, the writer migrates a few buckets of its shared context
+   and the schedule task migrates the others by batch */
+#define OB_CHAIN_RESIZE_WRITER_BUCKETS  4
+#define OB_CHAIN_RESIZE_BATCH_BUCKETS   256
+#define OB_CHAIN_RESIZE_TICK_BUCKETS    4096
+
 typedef struct {
     int count;
+    volatile int64_t reader_epoch;
     OBSharedContext *contexts;
 } OBSharedContextArray;
 
@@ -38,107 +86,705 @@ typedef struct {
     OBSliceEntry *fixed[SLICE_ARRAY_FIXED_COUNT];
 } OBSlicePtrSmartArray;
 
-static OBSharedContextArray ob_shared_ctx_array = {0, NULL};
+/* the overlapped slices of a range */
+typedef struct {
+    int start;   //the index of the first overlapped slice for the array
+    int count;
+    OBSliceEntry **slices;
+    OBSlicePtrSmartArray holder;  //for the skiplist
+} OBSliceOverlaps;
+
+/* the retired buffer is linked by itself, so retiring never fails */
+typedef struct ob_retired_buffer {
+    int64_t epoch;
+    struct ob_retired_buffer *next;
+} OBRetiredBuffer;
+
+static OBSharedContextArray ob_shared_ctx_array = {0, 0, NULL};
 
-OBHashtable g_ob_hashtable = {0, 0, NULL};
+OBHashtable g_ob_hashtable;
 
+/* the capacity of the chain hashtable is a multiple of the shared context
+   count, so the buckets of a context keep in the same context after resize.
+   the open addressing hashtable uses one shard per shared context,
+   so the probe never crosses the lock */
 #define OB_INDEX_SET_HASHTABLE_CTX(htable, bkey) \
-    int64_t bucket_index;  \
-    OBSharedContext *ctx;  \
+    OBSharedContext *ctx = ob_shared_ctx_array.contexts + \
+        FS_BLOCK_HASH_CODE(bkey) % ob_shared_ctx_array.count
+
+#define OB_INDEX_CTX_INDEX(ctx) ((ctx) - ob_shared_ctx_array.contexts)
+
+#define OB_SLICE_ALLOCATOR(slice) (&ob_shared_ctx_array.contexts[  \
+        (slice)->ctx_index].slice_allocator)
+
+#define OB_SLICE_MAP_ARRAY_BYTES(alloc)  (sizeof(OBSliceEntry *) * (alloc))
+
+/* the sequence of the shared context is odd while the lock held,
+   the lockless reader retries when the sequence changed */
+#define OB_INDEX_SHARED_CTX_LOCK(htable, ctx)   \
     do {  \
-        bucket_index = FS_BLOCK_HASH_CODE(bkey) % (htable)->capacity; \
-        ctx = ob_shared_ctx_array.contexts + bucket_index %   \
-            ob_shared_ctx_array.count;  \
+        PTHREAD_MUTEX_LOCK(&ctx->lcp.lock);  \
+        __sync_add_and_fetch(&ctx->seq, 1);  \
     } while (0)
 
-#define OB_INDEX_SET_BUCKET_AND_CTX(htable, bkey) \
-    OBEntry **bucket;   \
-    OB_INDEX_SET_HASHTABLE_CTX(htable, bkey);  \
+#define OB_INDEX_SHARED_CTX_UNLOCK(htable, ctx) \
     do {  \
-        bucket = (htable)->buckets + bucket_index; \
+        __sync_add_and_fetch(&ctx->seq, 1);  \
+        PTHREAD_MUTEX_UNLOCK(&ctx->lcp.lock);  \
     } while (0)
 
-#define OB_INDEX_SHARED_CTX_LOCK(htable, ctx)   \
-    PTHREAD_MUTEX_LOCK(&ctx->lcp.lock)
+static void slice_map_destroy(OBSharedContext *ctx, OBSliceMap *map);
 
-#define OB_INDEX_SHARED_CTX_UNLOCK(htable, ctx) \
-    PTHREAD_MUTEX_UNLOCK(&ctx->lcp.lock)
+/* the lockless reader enters before reading the pointers of
+   the context, return the reader slot for leaving */
+static inline int reader_enter(OBSharedContext *ctx)
+{
+    int slot;
+
+    slot = __atomic_load_n(&ob_shared_ctx_array.reader_epoch,
+            __ATOMIC_ACQUIRE) & 1;
+    __atomic_add_fetch(&ctx->readers[slot], 1, __ATOMIC_SEQ_CST);
+    return slot;
+}
 
-static OBEntry *get_ob_entry_ex(OBSharedContext *ctx, OBEntry **bucket,
-        const FSBlockKey *bkey, const bool create_flag, OBEntry **pprev)
+static inline void reader_leave(OBSharedContext *ctx, const int slot)
+{
+    __atomic_sub_fetch(&ctx->readers[slot], 1, __ATOMIC_RELEASE);
+}
+
+/* advance the reader epoch only when no reader stays in the slot
+   of the previous epoch, the new readers enter the current slot */
+static void reader_epoch_try_advance()
+{
+    OBSharedContext *ctx;
+    OBSharedContext *end;
+    int64_t epoch;
+    int slot;
+
+    epoch = __atomic_load_n(&ob_shared_ctx_array.reader_epoch,
+            __ATOMIC_SEQ_CST);
+    slot = (epoch + 1) & 1;
+    end = ob_shared_ctx_array.contexts + ob_shared_ctx_array.count;
+    for (ctx=ob_shared_ctx_array.contexts; ctx<end; ctx++) {
+        if (__atomic_load_n(&ctx->readers[slot], __ATOMIC_SEQ_CST) != 0) {
+            return;
+        }
+    }
+
+    __sync_bool_compare_and_swap(&ob_shared_ctx_array.
+            reader_epoch, epoch, epoch + 1);
+}
+
+static void free_expired_buffers(OBSharedContext *ctx)
+{
+    OBRetiredBuffer *buffer;
+    int64_t epoch;
+
+    if (ctx->retired.head == NULL) {
+        return;
+    }
+
+    reader_epoch_try_advance();
+    epoch = __atomic_load_n(&ob_shared_ctx_array.
+            reader_epoch, __ATOMIC_SEQ_CST);
+    while (ctx->retired.head != NULL && epoch - ctx->retired.
+            head->epoch >= OB_RETIRED_BUFFER_GRACE_EPOCHS)
+    {
+        buffer = ctx->retired.head;
+        ctx->retired.head = buffer->next;
+        free(buffer);
+    }
+    if (ctx->retired.head == NULL) {
+        ctx->retired.tail = NULL;
+    }
+}
+
+/* free the buffer after the grace epochs, the lock of the context
+   MUST be held and the buffer MUST be unpublished before retiring */
+static void retire_buffer(OBSharedContext *ctx, void *ptr)
+{
+    OBRetiredBuffer *buffer;
+
+    buffer = (OBRetiredBuffer *)ptr;
+    buffer->epoch = __atomic_load_n(&ob_shared_ctx_array.
+            reader_epoch, __ATOMIC_SEQ_CST);
+    buffer->next = NULL;
+    if (ctx->retired.tail == NULL) {
+        ctx->retired.head = buffer;
+    } else {
+        ctx->retired.tail->next = buffer;
+    }
+    ctx->retired.tail = buffer;
+
+    free_expired_buffers(ctx);
+}
+
+/* the lockless reader validates the sequence before dereferencing
+   the pointer it read, the buffers of the retired pointers are still
+   accessible until the reader leaves, and the object block and slice
+   entries are never returned to the system by the mblock allocators */
+static inline bool lockless_read_valid(OBSharedContext *ctx,
+        const int64_t seq)
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return ctx->seq == seq;
+}
+
+static OBEntry *new_ob_entry(OBSharedContext *ctx, const FSBlockKey *bkey)
 {
-    const int init_level_count = 2;
-    OBEntry *previous;
     OBEntry *ob;
-    int cmpr;
 
-    if (pprev == NULL) {
-        pprev = &previous;
+    ob = (OBEntry *)fast_mblock_alloc_object(&ctx->ob_allocator);
+    if (ob == NULL) {
+        return NULL;
     }
-    if (*bucket == NULL) {
-        if (!create_flag) {
-            return NULL;
+
+    ob->slices.count = 0;
+    ob->slices.alloc = 0;
+    ob->bkey = *bkey;
+    return ob;
+}
+
+static inline void free_ob_entry(OBSharedContext *ctx, OBEntry *ob)
+{
+    slice_map_destroy(ctx, &ob->slices);
+    fast_mblock_free_object(&ctx->ob_allocator, ob);
+}
+
+/* the bucket is in the new bucket array when it has been migrated,
+   the lock of the context MUST be held */
+static inline OBEntry **chain_get_bucket(OBHashtable *htable,
+        OBSharedContext *ctx, const FSBlockKey *bkey)
+{
+    OBEntry **new_buckets;
+    int64_t index;
+
+    index = FS_BLOCK_HASH_CODE(*bkey) % htable->capacity;
+    new_buckets = __atomic_load_n(&htable->resize.buckets, __ATOMIC_ACQUIRE);
+    if (new_buckets != NULL && index / ob_shared_ctx_array.count <
+            htable->resize.cursors[OB_INDEX_CTX_INDEX(ctx)])
+    {
+        return new_buckets + FS_BLOCK_HASH_CODE(*bkey) %
+            htable->resize.capacity;
+    }
+    return htable->buckets + index;
+}
+
+static inline void chain_insert_ob_entry(OBEntry **bucket, OBEntry *ob)
+{
+    OBEntry *previous;
+    OBEntry *current;
+
+    previous = NULL;
+    for (current=*bucket; current!=NULL; current=current->next) {
+        if (ob_index_compare_block_key(&ob->bkey, &current->bkey) < 0) {
+            break;
         }
-        *pprev = NULL;
+        previous = current;
+    }
+
+    if (previous == NULL) {
+        ob->next = *bucket;
+        *bucket = ob;
     } else {
-        cmpr = ob_index_compare_block_key(bkey, &(*bucket)->bkey);
+        ob->next = previous->next;
+        previous->next = ob;
+    }
+}
+
+/* migrate the buckets of the context to the new bucket array,
+   the lock of the context MUST be held */
+static void chain_migrate_buckets(OBHashtable *htable,
+        OBSharedContext *ctx, const int64_t max_count)
+{
+    OBEntry **bucket;
+    OBEntry *ob;
+    OBEntry *next;
+    int64_t *cursor;
+    int64_t bucket_count;
+    int64_t end;
+    int ctx_index;
+
+    ctx_index = OB_INDEX_CTX_INDEX(ctx);
+    cursor = htable->resize.cursors + ctx_index;
+    bucket_count = htable->capacity / ob_shared_ctx_array.count;
+    if (*cursor >= bucket_count) {
+        return;
+    }
+
+    end = FC_MIN(*cursor + max_count, bucket_count);
+    for (; *cursor<end; (*cursor)++) {
+        bucket = htable->buckets + ctx_index + *cursor *
+            ob_shared_ctx_array.count;
+        for (ob=*bucket; ob!=NULL; ob=next) {
+            next = ob->next;
+            chain_insert_ob_entry(htable->resize.buckets +
+                    FS_BLOCK_HASH_CODE(ob->bkey) %
+                    htable->resize.capacity, ob);
+        }
+        *bucket = NULL;
+    }
+
+    if (*cursor == bucket_count) {
+        __sync_add_and_fetch(&htable->resize.done_count, 1);
+    }
+}
+
+static OBEntry *chain_get_ob_entry(OBHashtable *htable,
+        OBSharedContext *ctx, const FSBlockKey *bkey,
+        const bool create_flag)
+{
+    OBEntry **bucket;
+    OBEntry *previous;
+    OBEntry *ob;
+    int cmpr;
+
+    if (create_flag && __atomic_load_n(&htable->resize.buckets,
+                __ATOMIC_ACQUIRE) != NULL)
+    {
+        chain_migrate_buckets(htable, ctx, OB_CHAIN_RESIZE_WRITER_BUCKETS);
+    }
+
+    bucket = chain_get_bucket(htable, ctx, bkey);
+    previous = NULL;
+    for (ob=*bucket; ob!=NULL; ob=ob->next) {
+        cmpr = ob_index_compare_block_key(bkey, &ob->bkey);
         if (cmpr == 0) {
-            *pprev = NULL;
-            return *bucket;
+            return ob;
         } else if (cmpr < 0) {
-            *pprev = NULL;
-        } else {
-            *pprev = *bucket;
-            while ((*pprev)->next != NULL) {
-                cmpr = ob_index_compare_block_key(bkey, &(*pprev)->next->bkey);
-                if (cmpr == 0) {
-                    return (*pprev)->next;
-                } else if (cmpr < 0) {
-                    break;
-                }
+            break;
+        }
+        previous = ob;
+    }
+
+    if (!create_flag) {
+        return NULL;
+    }
+
+    if ((ob=new_ob_entry(ctx, bkey)) == NULL) {
+        return NULL;
+    }
+    if (previous == NULL) {
+        ob->next = *bucket;
+        *bucket = ob;
+    } else {
+        ob->next = previous->next;
+        previous->next = ob;
+    }
+
+    __sync_add_and_fetch(&htable->count, 1);
+    return ob;
+}
+
+static void chain_delete_ob_entry(OBHashtable *htable,
+        OBSharedContext *ctx, OBEntry *ob)
+{
+    OBEntry **bucket;
+    OBEntry *previous;
+
+    bucket = chain_get_bucket(htable, ctx, &ob->bkey);
+    if (*bucket == ob) {
+        *bucket = ob->next;
+    } else {
+        previous = *bucket;
+        while (previous->next != ob) {
+            previous = previous->next;
+        }
+        previous->next = ob->next;
+    }
+
+    __sync_sub_and_fetch(&htable->count, 1);
+    free_ob_entry(ctx, ob);
+}
+
+static inline uint64_t open_hash_code(const FSBlockKey *bkey)
+{
+    uint64_t h;
+
+    /* FS_BLOCK_HASH_CODE is NOT well distributed for the power of 2
+       group count, mix the key with the finalizer of murmurhash3 */
+    h = (uint64_t)bkey->oid * 0x9E3779B97F4A7C15ULL ^
+        (uint64_t)bkey->offset / FS_FILE_BLOCK_SIZE;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+#define OPEN_HASH_TAG(h)    ((int8_t)((h) & 0x7F))
+#define OPEN_HASH_GROUP(h)  ((h) >> 7)
+
+/* return the bitmask of the slots which control byte equals to ctrl */
+static inline unsigned int open_group_match(const OBOpenGroup *group,
+        const int8_t ctrl)
+{
+#ifdef __SSE2__
+    __m128i ctrls;
+
+    ctrls = _mm_loadl_epi64((const __m128i *)group->ctrls);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrls, _mm_set1_epi8(ctrl))) &
+        OB_OPEN_GROUP_MATCH_MASK;
+#else
+    unsigned int mask;
+    int i;
+
+    mask = 0;
+    for (i=0; i<OB_OPEN_GROUP_SIZE; i++) {
+        if (group->ctrls[i] == ctrl) {
+            mask |= (1U << i);
+        }
+    }
+    return mask;
+#endif
+}
+
+/* return the bitmask of the empty or deleted slots */
+static inline unsigned int open_group_match_free(const OBOpenGroup *group)
+{
+#ifdef __SSE2__
+    return _mm_movemask_epi8(_mm_loadl_epi64((const __m128i *)
+                group->ctrls)) & OB_OPEN_GROUP_MATCH_MASK;
+#else
+    unsigned int mask;
+    int i;
+
+    mask = 0;
+    for (i=0; i<OB_OPEN_GROUP_SIZE; i++) {
+        if (group->ctrls[i] < 0) {
+            mask |= (1U << i);
+        }
+    }
+    return mask;
+#endif
+}
+
+static int open_shard_init(OBOpenShard *shard, const int64_t group_count)
+{
+    int64_t bytes;
+    int64_t i;
+    int result;
+
+    /* the group is aligned by the cache line */
+    bytes = sizeof(OBOpenGroup) * group_count;
+    if ((result=posix_memalign((void **)&shard->groups,
+                    sizeof(OBOpenGroup), bytes)) != 0)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "posix_memalign %"PRId64" bytes fail, "
+                "errno: %d, error info: %s",
+                __LINE__, bytes, result, STRERROR(result));
+        shard->groups = NULL;
+        return result;
+    }
+    numa_topology_bind_index_memory(shard->groups, bytes);
+
+    for (i=0; i<group_count; i++) {
+        memset(shard->groups[i].ctrls, OB_OPEN_CTRL_EMPTY,
+                sizeof(shard->groups[i].ctrls));
+    }
+    shard->group_count = group_count;
+    shard->capacity = group_count * OB_OPEN_GROUP_SIZE;
+    shard->count = 0;
+    shard->deleted = 0;
+    return 0;
+}
+
+/* the probe sequence is triangular over the groups which visits
+   all groups because the group count is power of 2,
+   return the found entry and set *index to the slot index,
+   otherwise return NULL and set *index to the first free slot
+   when index is NOT NULL */
+static inline OBEntry *open_shard_find(OBOpenShard *shard,
+        const FSBlockKey *bkey, const uint64_t hv, int64_t *index)
+{
+    int64_t group_mask;
+    int64_t group;
+    OBOpenGroup *pg;
+    unsigned int mask;
+    int8_t tag;
+    int step;
+    OBEntry *ob;
 
-                *pprev = (*pprev)->next;
+    group_mask = shard->group_count - 1;
+    group = OPEN_HASH_GROUP(hv) & group_mask;
+    tag = OPEN_HASH_TAG(hv);
+    if (index != NULL) {
+        *index = -1;
+    }
+    for (step=1; ; step++) {
+        pg = shard->groups + group;
+        mask = open_group_match(pg, tag);
+        while (mask != 0) {
+            ob = pg->slots[__builtin_ctz(mask)];
+            if (ob->bkey.oid == bkey->oid && ob->bkey.offset == bkey->offset) {
+                if (index != NULL) {
+                    *index = group * OB_OPEN_GROUP_SIZE +
+                        __builtin_ctz(mask);
+                }
+                return ob;
             }
+            mask &= mask - 1;
         }
 
-        if (!create_flag) {
+        if (index != NULL && *index < 0 &&
+                (mask=open_group_match_free(pg)) != 0)
+        {
+            *index = group * OB_OPEN_GROUP_SIZE + __builtin_ctz(mask);
+        }
+        if (open_group_match(pg, OB_OPEN_CTRL_EMPTY) != 0) {
             return NULL;
         }
+        group = (group + step) & group_mask;
     }
+}
 
-    ob = (OBEntry *)fast_mblock_alloc_object(&ctx->ob_allocator);
-    if (ob == NULL) {
-        return NULL;
+static inline void open_shard_set(OBOpenShard *shard, const int64_t index,
+        const uint64_t hv, OBEntry *ob)
+{
+    if (OB_OPEN_CTRL(shard, index) == OB_OPEN_CTRL_DELETED) {
+        shard->deleted--;
+    }
+    OB_OPEN_CTRL(shard, index) = OPEN_HASH_TAG(hv);
+    OB_OPEN_SLOT(shard, index) = ob;
+    shard->count++;
+}
+
+static int open_shard_rehash(OBSharedContext *ctx, OBOpenShard *shard)
+{
+    OBOpenShard new_shard;
+    OBOpenGroup *old_groups;
+    OBEntry *ob;
+    int64_t group_count;
+    int64_t index;
+    int64_t i;
+    uint64_t hv;
+    int result;
+
+    /* double the capacity, or rehash to the same capacity when the most
+       used slots are the tombstones */
+    if (shard->count >= OB_OPEN_MAX_USED(shard->capacity) / 2) {
+        group_count = shard->group_count * 2;
+    } else {
+        group_count = shard->group_count;
+    }
+    if ((result=open_shard_init(&new_shard, group_count)) != 0) {
+        return result;
+    }
+
+    for (i=0; i<shard->capacity; i++) {
+        if (OB_OPEN_CTRL(shard, i) >= 0) {
+            ob = OB_OPEN_SLOT(shard, i);
+            hv = open_hash_code(&ob->bkey);
+            open_shard_find(&new_shard, &ob->bkey, hv, &index);
+            open_shard_set(&new_shard, index, hv, ob);
+        }
+    }
+
+    old_groups = shard->groups;
+    *shard = new_shard;
+    retire_buffer(ctx, old_groups);
+    return 0;
+}
+
+static inline OBEntry *open_get_ob_entry(OBHashtable *htable,
+        OBSharedContext *ctx, const FSBlockKey *bkey,
+        const bool create_flag)
+{
+    OBOpenShard *shard;
+    OBEntry *ob;
+    uint64_t hv;
+    int64_t index;
+
+    shard = htable->shards + (ctx - ob_shared_ctx_array.contexts);
+    hv = open_hash_code(bkey);
+    if (!create_flag) {
+        return open_shard_find(shard, bkey, hv, NULL);
+    }
+
+    if ((ob=open_shard_find(shard, bkey, hv, &index)) != NULL) {
+        return ob;
+    }
+
+    if (shard->count + shard->deleted >= OB_OPEN_MAX_USED(shard->capacity)) {
+        if (open_shard_rehash(ctx, shard) != 0) {
+            return NULL;
+        }
+        open_shard_find(shard, bkey, hv, &index);
     }
-    ob->slices = uniq_skiplist_new(&ctx->factory, init_level_count);
-    if (ob->slices == NULL) {
-        fast_mblock_free_object(&ctx->ob_allocator, ob);
+
+    if ((ob=new_ob_entry(ctx, bkey)) == NULL) {
         return NULL;
     }
+    open_shard_set(shard, index, hv, ob);
+    return ob;
+}
 
-    ob->bkey = *bkey;
-    if (*pprev == NULL) {
-        ob->next = *bucket;
-        *bucket = ob;
+static void open_delete_ob_entry(OBHashtable *htable,
+        OBSharedContext *ctx, OBEntry *ob)
+{
+    OBOpenShard *shard;
+    int64_t index;
+
+    shard = htable->shards + (ctx - ob_shared_ctx_array.contexts);
+    if (open_shard_find(shard, &ob->bkey, open_hash_code(
+                    &ob->bkey), &index) == NULL)
+    {
+        logError("file: "__FILE__", line: %d, "
+                "object block {oid: %"PRId64", offset: %"PRId64"} "
+                "not exist in the hashtable", __LINE__,
+                ob->bkey.oid, ob->bkey.offset);
+        return;
+    }
+
+    /* no probe passed the group which has an empty slot,
+       so the slot can be set to empty instead of tombstone */
+    if (open_group_match(shard->groups + index / OB_OPEN_GROUP_SIZE,
+                OB_OPEN_CTRL_EMPTY) != 0)
+    {
+        OB_OPEN_CTRL(shard, index) = OB_OPEN_CTRL_EMPTY;
     } else {
-        ob->next = (*pprev)->next;
-        (*pprev)->next = ob;
+        OB_OPEN_CTRL(shard, index) = OB_OPEN_CTRL_DELETED;
+        shard->deleted++;
     }
+    shard->count--;
 
-    return ob;
+    free_ob_entry(ctx, ob);
+}
+
+static inline OBEntry *get_ob_entry(OBHashtable *htable,
+        OBSharedContext *ctx, const FSBlockKey *bkey,
+        const bool create_flag)
+{
+    if (htable->type == OB_HASHTABLE_TYPE_CHAIN) {
+        return chain_get_ob_entry(htable, ctx, bkey, create_flag);
+    } else {
+        return open_get_ob_entry(htable, ctx, bkey, create_flag);
+    }
+}
+
+static inline void delete_ob_entry(OBHashtable *htable,
+        OBSharedContext *ctx, OBEntry *ob)
+{
+    if (htable->type == OB_HASHTABLE_TYPE_CHAIN) {
+        chain_delete_ob_entry(htable, ctx, ob);
+    } else {
+        open_delete_ob_entry(htable, ctx, ob);
+    }
 }
 
-#define get_ob_entry(ctx, bucket, bkey, create_flag)  \
-    get_ob_entry_ex(ctx, bucket, bkey, create_flag, NULL)
+/* the lockless version of get_ob_entry,
+   return EAGAIN when the sequence changed */
+static int chain_lockless_get_ob_entry(OBHashtable *htable,
+        OBSharedContext *ctx, const int64_t seq,
+        const FSBlockKey *bkey, OBEntry **ob)
+{
+    OBEntry **buckets;
+    OBEntry **new_buckets;
+    OBEntry *current;
+    int64_t capacity;
+    int64_t new_capacity;
+    int64_t index;
+    int cmpr;
+
+    /* the capacity is read before the bucket array and the bucket array
+       only grows, so the index never exceeds the bucket array read */
+    capacity = __atomic_load_n(&htable->capacity, __ATOMIC_ACQUIRE);
+    buckets = htable->buckets;
+    new_capacity = __atomic_load_n(&htable->resize.capacity,
+            __ATOMIC_ACQUIRE);
+    new_buckets = __atomic_load_n(&htable->resize.buckets, __ATOMIC_ACQUIRE);
+    index = FS_BLOCK_HASH_CODE(*bkey) % capacity;
+    if (new_buckets != NULL && index / ob_shared_ctx_array.count <
+            htable->resize.cursors[OB_INDEX_CTX_INDEX(ctx)])
+    {
+        if (new_capacity == 0) {
+            return EAGAIN;
+        }
+        current = new_buckets[FS_BLOCK_HASH_CODE(*bkey) % new_capacity];
+    } else {
+        current = buckets[index];
+    }
+
+    while (1) {
+        if (!lockless_read_valid(ctx, seq)) {
+            return EAGAIN;
+        }
+        if (current == NULL) {
+            return ENOENT;
+        }
+
+        cmpr = ob_index_compare_block_key(bkey, &current->bkey);
+        if (cmpr == 0) {
+            *ob = current;
+            return 0;
+        } else if (cmpr < 0) {
+            return ENOENT;
+        }
+        current = current->next;
+    }
+}
+
+static int open_lockless_get_ob_entry(OBHashtable *htable,
+        OBSharedContext *ctx, const int64_t seq,
+        const FSBlockKey *bkey, OBEntry **ob)
+{
+    OBOpenShard *shard;
+    OBOpenGroup *groups;
+    OBOpenGroup *pg;
+    OBEntry *current;
+    int64_t group_mask;
+    int64_t group;
+    int64_t step;
+    uint64_t hv;
+    unsigned int mask;
+    int8_t tag;
+
+    shard = htable->shards + (ctx - ob_shared_ctx_array.contexts);
+    groups = shard->groups;
+    group_mask = shard->group_count - 1;
+    if (!lockless_read_valid(ctx, seq)) {
+        return EAGAIN;
+    }
+
+    hv = open_hash_code(bkey);
+    group = OPEN_HASH_GROUP(hv) & group_mask;
+    tag = OPEN_HASH_TAG(hv);
+    for (step=1; step<=group_mask + 1; step++) {
+        pg = groups + group;
+        mask = open_group_match(pg, tag);
+        while (mask != 0) {
+            current = pg->slots[__builtin_ctz(mask)];
+            if (!lockless_read_valid(ctx, seq)) {
+                return EAGAIN;
+            }
+            if (current->bkey.oid == bkey->oid &&
+                    current->bkey.offset == bkey->offset)
+            {
+                *ob = current;
+                return 0;
+            }
+            mask &= mask - 1;
+        }
+
+        if (open_group_match(pg, OB_OPEN_CTRL_EMPTY) != 0) {
+            return lockless_read_valid(ctx, seq) ? ENOENT : EAGAIN;
+        }
+        group = (group + step) & group_mask;
+    }
+
+    return EAGAIN;
+}
 
 OBEntry *ob_index_get_ob_entry_ex(OBHashtable *htable,
         const FSBlockKey *bkey)
 {
     OBEntry *ob;
-    OB_INDEX_SET_BUCKET_AND_CTX(htable, *bkey);
+    OB_INDEX_SET_HASHTABLE_CTX(htable, *bkey);
 
     OB_INDEX_SHARED_CTX_LOCK(htable, ctx);
-    ob = get_ob_entry(ctx, bucket, bkey, false);
+    ob = get_ob_entry(htable, ctx, bkey, false);
     OB_INDEX_SHARED_CTX_UNLOCK(htable, ctx);
 
     return ob;
@@ -148,9 +794,9 @@ OBEntry *ob_index_reclaim_lock(const FSBlockKey *bkey)
 {
     OBEntry *ob;
 
-    OB_INDEX_SET_BUCKET_AND_CTX(&g_ob_hashtable, *bkey);
+    OB_INDEX_SET_HASHTABLE_CTX(&g_ob_hashtable, *bkey);
     OB_INDEX_SHARED_CTX_LOCK(&g_ob_hashtable, ctx);
-    ob = get_ob_entry(ctx, bucket, bkey, false);
+    ob = get_ob_entry(&g_ob_hashtable, ctx, bkey, false);
     if (ob != NULL) {
         ++(ob->reclaiming_count);
     }
@@ -175,9 +821,9 @@ OBSliceEntry *ob_index_alloc_slice_ex(OBHashtable *htable,
     OBEntry *ob;
     OBSliceEntry *slice;
 
-    OB_INDEX_SET_BUCKET_AND_CTX(htable, *bkey);
+    OB_INDEX_SET_HASHTABLE_CTX(htable, *bkey);
     OB_INDEX_SHARED_CTX_LOCK(htable, ctx);
-    ob = get_ob_entry(ctx, bucket, bkey, true);
+    ob = get_ob_entry(htable, ctx, bkey, true);
     OB_INDEX_SHARED_CTX_UNLOCK(htable, ctx);
 
     if (ob == NULL) {
@@ -187,6 +833,8 @@ OBSliceEntry *ob_index_alloc_slice_ex(OBHashtable *htable,
                 &ctx->slice_allocator);
         if (slice != NULL) {
             slice->ob = ob;
+            slice->has_crc = false;
+            slice->compress.type = FS_COMPRESS_TYPE_NONE;
             if (init_refer > 0) {
                 __sync_add_and_fetch(&slice->ref_count, init_refer);
             }
@@ -206,7 +854,7 @@ void ob_index_free_slice(OBSliceEntry *slice)
                 slice->ob->bkey.oid, slice->ob->bkey.offset, ctx);
                 */
 
-        fast_mblock_free_object(slice->allocator, slice);
+        fast_mblock_free_object(OB_SLICE_ALLOCATOR(slice), slice);
     }
 }
 
@@ -229,14 +877,13 @@ static void slice_free_func(void *ptr, const int delay_seconds)
            slice->ob->bkey.oid, slice->ob->bkey.offset, ctx);
          */
 
-        fast_mblock_free_object(slice->allocator, slice);
+        fast_mblock_free_object(OB_SLICE_ALLOCATOR(slice), slice);
     }
 }
 
-static int slice_alloc_init(OBSliceEntry *slice,
-        struct fast_mblock_man *allocator)
+static int slice_alloc_init(OBSliceEntry *slice, OBSharedContext *ctx)
 {
-    slice->allocator = allocator;
+    slice->ctx_index = OB_INDEX_CTX_INDEX(ctx);
     return 0;
 }
 
@@ -245,19 +892,29 @@ static int init_ob_shared_ctx_array()
     int result;
     int bytes;
     const int max_level_count = 8;
-    const int alloc_skiplist_once = 8 * 1024;
+    const int alloc_skiplist_once = 256;  //only for the fragmented blocks
     const int min_alloc_elements_once = 2;
     const int delay_free_seconds = 0;
     const bool bidirection = true;  //need previous link
+    int element_size;
     OBSharedContext *ctx;
     OBSharedContext *end;
 
-    ob_shared_ctx_array.count = STORAGE_CFG.object_block.shared_locks_count;
+    /* the next link is only used by the chain hashtable */
+    if (STORAGE_CFG.object_block.hashtable_type == OB_HASHTABLE_TYPE_CHAIN) {
+        element_size = sizeof(OBEntry);
+    } else {
+        element_size = offsetof(OBEntry, next);
+    }
+
+    ob_shared_ctx_array.count = STORAGE_CFG.object_block.shared_locks_count;
     bytes = sizeof(OBSharedContext) * ob_shared_ctx_array.count;
     ob_shared_ctx_array.contexts = (OBSharedContext *)fc_malloc(bytes);
     if (ob_shared_ctx_array.contexts == NULL) {
         return ENOMEM;
     }
+    numa_topology_bind_index_memory(ob_shared_ctx_array.contexts, bytes);
+    memset(ob_shared_ctx_array.contexts, 0, bytes);
 
     end = ob_shared_ctx_array.contexts + ob_shared_ctx_array.count;
     for (ctx=ob_shared_ctx_array.contexts; ctx<end; ctx++) {
@@ -270,7 +927,7 @@ static int init_ob_shared_ctx_array()
         }
 
         if ((result=fast_mblock_init_ex1(&ctx->ob_allocator,
-                        "ob_entry", sizeof(OBEntry), 4 * 1024,
+                        "ob_entry", element_size, 4 * 1024,
                         0, NULL, NULL, false)) != 0)
         {
             return result;
@@ -279,7 +936,7 @@ static int init_ob_shared_ctx_array()
         if ((result=fast_mblock_init_ex1(&ctx->slice_allocator,
                         "slice_entry", sizeof(OBSliceEntry), 16 * 1024, 0,
                         (fast_mblock_alloc_init_func)slice_alloc_init,
-                        &ctx->slice_allocator, true)) != 0)
+                        ctx, true)) != 0)
         {
             return result;
         }
@@ -292,25 +949,110 @@ static int init_ob_shared_ctx_array()
     return 0;
 }
 
-int ob_index_init_htable_ex(OBHashtable *htable, const int64_t capacity,
-        const bool modify_sallocator)
+static inline int64_t chain_calc_capacity(const int64_t capacity)
+{
+    int64_t bucket_count;
+
+    bucket_count = (capacity + ob_shared_ctx_array.count - 1) /
+        ob_shared_ctx_array.count;
+    return fc_ceil_prime(bucket_count) * ob_shared_ctx_array.count;
+}
+
+static OBEntry **chain_alloc_buckets(const int64_t capacity)
+{
+    OBEntry **buckets;
+    int64_t bytes;
+
+    bytes = sizeof(OBEntry *) * capacity;
+    buckets = (OBEntry **)fc_malloc(bytes);
+    if (buckets != NULL) {
+        numa_topology_bind_index_memory(buckets, bytes);
+        memset(buckets, 0, bytes);
+    }
+    return buckets;
+}
+
+static int chain_init_htable(OBHashtable *htable, const int64_t capacity)
 {
+    int bytes;
+
+    htable->capacity = chain_calc_capacity(capacity);
+    if ((htable->buckets=chain_alloc_buckets(htable->capacity)) == NULL) {
+        return ENOMEM;
+    }
+
+    bytes = sizeof(int64_t) * ob_shared_ctx_array.count;
+    htable->resize.cursors = (int64_t *)fc_malloc(bytes);
+    if (htable->resize.cursors == NULL) {
+        return ENOMEM;
+    }
+    memset(htable->resize.cursors, 0, bytes);
+    return 0;
+}
+
+static int open_init_htable(OBHashtable *htable, const int64_t capacity)
+{
+    int64_t group_count;
     int64_t bytes;
+    int result;
+    int i;
+
+    group_count = OB_OPEN_MIN_GROUP_COUNT;
+    while (OB_OPEN_MAX_USED(group_count * OB_OPEN_GROUP_SIZE) <
+            capacity / ob_shared_ctx_array.count)
+    {
+        group_count *= 2;
+    }
 
-    htable->capacity = fc_ceil_prime(capacity);
-    bytes = sizeof(OBEntry *) * htable->capacity;
-    htable->buckets = (OBEntry **)fc_malloc(bytes);
-    if (htable->buckets == NULL) {
+    bytes = sizeof(OBOpenShard) * ob_shared_ctx_array.count;
+    htable->shards = (OBOpenShard *)fc_malloc(bytes);
+    if (htable->shards == NULL) {
         return ENOMEM;
     }
-    memset(htable->buckets, 0, bytes);
+    memset(htable->shards, 0, bytes);
+
+    for (i=0; i<ob_shared_ctx_array.count; i++) {
+        if ((result=open_shard_init(htable->shards + i,
+                        group_count)) != 0)
+        {
+            return result;
+        }
+    }
+
+    htable->capacity = group_count * OB_OPEN_GROUP_SIZE *
+        ob_shared_ctx_array.count;
+    return 0;
+}
+
+int ob_index_init_htable_ex(OBHashtable *htable, const int64_t capacity,
+        const bool modify_sallocator)
+{
+    int result;
+
+    htable->type = STORAGE_CFG.object_block.hashtable_type;
+    htable->count = 0;
+    htable->buckets = NULL;
+    htable->resize.buckets = NULL;
+    htable->resize.capacity = 0;
+    htable->resize.cursors = NULL;
+    htable->resize.done_count = 0;
+    htable->shards = NULL;
+    if (htable->type == OB_HASHTABLE_TYPE_CHAIN) {
+        result = chain_init_htable(htable, capacity);
+    } else {
+        result = open_init_htable(htable, capacity);
+    }
+    if (result != 0) {
+        return result;
+    }
 
     htable->modify_sallocator = modify_sallocator;
     htable->modify_used_space = false;
     return 0;
 }
 
-void ob_index_destroy_htable(OBHashtable *htable)
+static void chain_free_buckets(OBHashtable *htable,
+        OBEntry **buckets, const int64_t capacity)
 {
     OBEntry **bucket;
     OBEntry **end;
@@ -318,71 +1060,330 @@ void ob_index_destroy_htable(OBHashtable *htable)
     OBEntry *deleted;
     OBSharedContext *ctx;
 
-    end = htable->buckets + htable->capacity;
-    for (bucket=htable->buckets; bucket<end; bucket++) {
+    end = buckets + capacity;
+    for (bucket=buckets; bucket<end; bucket++) {
         if (*bucket == NULL) {
             continue;
         }
 
-        ctx = ob_shared_ctx_array.contexts + (bucket - htable->buckets) %
+        ctx = ob_shared_ctx_array.contexts + (bucket - buckets) %
             ob_shared_ctx_array.count;
-        PTHREAD_MUTEX_LOCK(&ctx->lcp.lock);
+        OB_INDEX_SHARED_CTX_LOCK(htable, ctx);
 
         ob = *bucket;
         do {
-            uniq_skiplist_free(ob->slices);
-
             deleted = ob;
             ob = ob->next;
-            fast_mblock_free_object(&ctx->ob_allocator, deleted);
+            free_ob_entry(ctx, deleted);
         } while (ob != NULL);
+        *bucket = NULL;
 
-        PTHREAD_MUTEX_UNLOCK(&ctx->lcp.lock);
+        OB_INDEX_SHARED_CTX_UNLOCK(htable, ctx);
     }
 
-    free(htable->buckets);
+    free(buckets);
+}
+
+static void chain_destroy_htable(OBHashtable *htable)
+{
+    chain_free_buckets(htable, htable->buckets, htable->capacity);
     htable->buckets = NULL;
+    if (htable->resize.buckets != NULL) {
+        chain_free_buckets(htable, htable->resize.buckets,
+                htable->resize.capacity);
+        htable->resize.buckets = NULL;
+    }
+    free(htable->resize.cursors);
+    htable->resize.cursors = NULL;
 }
 
-int ob_index_init()
+static void open_destroy_htable(OBHashtable *htable)
+{
+    OBOpenShard *shard;
+    OBSharedContext *ctx;
+    int64_t i;
+    int k;
+
+    for (k=0; k<ob_shared_ctx_array.count; k++) {
+        shard = htable->shards + k;
+        ctx = ob_shared_ctx_array.contexts + k;
+        OB_INDEX_SHARED_CTX_LOCK(htable, ctx);
+        for (i=0; i<shard->capacity; i++) {
+            if (OB_OPEN_CTRL(shard, i) >= 0) {
+                free_ob_entry(ctx, OB_OPEN_SLOT(shard, i));
+            }
+        }
+        OB_INDEX_SHARED_CTX_UNLOCK(htable, ctx);
+
+        free(shard->groups);
+    }
+
+    free(htable->shards);
+    htable->shards = NULL;
+}
+
+void ob_index_destroy_htable(OBHashtable *htable)
+{
+    if (htable->type == OB_HASHTABLE_TYPE_CHAIN) {
+        chain_destroy_htable(htable);
+    } else {
+        open_destroy_htable(htable);
+    }
+}
+
+/* the migrated buckets are empty, so walk both bucket arrays
+   when resizing */
+static int chain_walk_buckets(OBEntry **buckets, const int64_t start,
+        const int64_t capacity, const int step,
+        ob_index_walk_callback callback, void *args)
 {
+    OBEntry *ob;
+    OBEntry *current;
+    int64_t i;
     int result;
-    if ((result=init_ob_shared_ctx_array()) != 0) {
-        return result;
+
+    for (i=start; i<capacity; i+=step) {
+        ob = buckets[i];
+        while (ob != NULL) {
+            current = ob;
+            ob = ob->next;
+            if ((result=callback(current, args)) != 0) {
+                return result;
+            }
+        }
     }
 
-    return ob_index_init_htable_ex(&g_ob_hashtable, STORAGE_CFG.
-            object_block.hashtable_capacity, true);
+    return 0;
 }
 
-void ob_index_destroy()
+int ob_index_walk_htable(OBHashtable *htable,
+        ob_index_walk_callback callback, void *args)
+{
+    OBOpenShard *shard;
+    OBOpenShard *send;
+    int64_t i;
+    int result;
+
+    if (htable->type == OB_HASHTABLE_TYPE_CHAIN) {
+        if ((result=chain_walk_buckets(htable->buckets, 0,
+                        htable->capacity, 1, callback, args)) != 0)
+        {
+            return result;
+        }
+        if (htable->resize.buckets != NULL) {
+            return chain_walk_buckets(htable->resize.buckets, 0,
+                    htable->resize.capacity, 1, callback, args);
+        }
+    } else {
+        send = htable->shards + ob_shared_ctx_array.count;
+        for (shard=htable->shards; shard<send; shard++) {
+            for (i=0; i<shard->capacity; i++) {
+                if (OB_OPEN_CTRL(shard, i) < 0) {
+                    continue;
+                }
+                if ((result=callback(OB_OPEN_SLOT(shard, i), args)) != 0) {
+                    return result;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int free_retired_buffers(void *args)
 {
+    OBSharedContext *ctx;
+    OBSharedContext *end;
+
+    end = ob_shared_ctx_array.contexts + ob_shared_ctx_array.count;
+    for (ctx=ob_shared_ctx_array.contexts; ctx<end; ctx++) {
+        if (ctx->retired.head != NULL) {
+            OB_INDEX_SHARED_CTX_LOCK(&g_ob_hashtable, ctx);
+            free_expired_buffers(ctx);
+            OB_INDEX_SHARED_CTX_UNLOCK(&g_ob_hashtable, ctx);
+        }
+    }
+
+    return 0;
 }
 
-static inline int do_delete_slice(OBHashtable *htable,
-        OBEntry *ob, OBSliceEntry *slice)
+static int chain_resize_start(OBHashtable *htable)
 {
-    if (htable->modify_sallocator) {
-        storage_allocator_delete_slice(slice,
-                htable->modify_used_space);
+    OBEntry **buckets;
+    int64_t capacity;
+
+    capacity = chain_calc_capacity(htable->capacity * 2);
+    if ((buckets=chain_alloc_buckets(capacity)) == NULL) {
+        return ENOMEM;
+    }
+
+    /* the cursors and the capacity are set before the bucket array
+       is published, the new bucket array is empty until migrating */
+    memset(htable->resize.cursors, 0, sizeof(int64_t) *
+            ob_shared_ctx_array.count);
+    htable->resize.done_count = 0;
+    __atomic_store_n(&htable->resize.capacity, capacity, __ATOMIC_RELEASE);
+    __atomic_store_n(&htable->resize.buckets, buckets, __ATOMIC_RELEASE);
+
+    logInfo("file: "__FILE__", line: %d, "
+            "object block count: %"PRId64", resize the hashtable "
+            "capacity from %"PRId64" to %"PRId64, __LINE__,
+            htable->count, htable->capacity, capacity);
+    return 0;
+}
+
+/* switch to the new bucket array with all locks held, no bucket
+   is migrated here so the pause is short */
+static void chain_resize_finish(OBHashtable *htable)
+{
+    OBSharedContext *ctx;
+    OBSharedContext *end;
+    OBEntry **old_buckets;
+    int64_t old_capacity;
+
+    end = ob_shared_ctx_array.contexts + ob_shared_ctx_array.count;
+    for (ctx=ob_shared_ctx_array.contexts; ctx<end; ctx++) {
+        OB_INDEX_SHARED_CTX_LOCK(htable, ctx);
+    }
+
+    old_buckets = htable->buckets;
+    old_capacity = htable->capacity;
+    htable->buckets = htable->resize.buckets;
+    __atomic_store_n(&htable->capacity, htable->resize.capacity,
+            __ATOMIC_RELEASE);
+    __atomic_store_n(&htable->resize.buckets, NULL, __ATOMIC_RELEASE);
+    retire_buffer(ob_shared_ctx_array.contexts, old_buckets);
+
+    for (ctx=ob_shared_ctx_array.contexts; ctx<end; ctx++) {
+        OB_INDEX_SHARED_CTX_UNLOCK(htable, ctx);
+    }
+
+    logInfo("file: "__FILE__", line: %d, "
+            "resize the hashtable capacity from %"PRId64" to %"PRId64
+            " done", __LINE__, old_capacity, htable->capacity);
+}
+
+static int chain_resize_task(void *args)
+{
+    OBHashtable *htable;
+    OBSharedContext *ctx;
+    OBSharedContext *end;
+    int64_t bucket_count;
+    int64_t migrated;
+
+    htable = (OBHashtable *)args;
+    if (htable->resize.buckets == NULL) {
+        if (htable->count <= htable->capacity) {
+            return 0;
+        }
+        if (chain_resize_start(htable) != 0) {
+            return 0;
+        }
+    }
+
+    bucket_count = htable->capacity / ob_shared_ctx_array.count;
+    end = ob_shared_ctx_array.contexts + ob_shared_ctx_array.count;
+    for (ctx=ob_shared_ctx_array.contexts; ctx<end; ctx++) {
+        for (migrated=0; migrated<OB_CHAIN_RESIZE_TICK_BUCKETS &&
+                htable->resize.cursors[OB_INDEX_CTX_INDEX(ctx)] <
+                bucket_count; migrated+=OB_CHAIN_RESIZE_BATCH_BUCKETS)
+        {
+            OB_INDEX_SHARED_CTX_LOCK(htable, ctx);
+            chain_migrate_buckets(htable, ctx,
+                    OB_CHAIN_RESIZE_BATCH_BUCKETS);
+            OB_INDEX_SHARED_CTX_UNLOCK(htable, ctx);
+        }
+    }
+
+    if (htable->resize.done_count == ob_shared_ctx_array.count) {
+        chain_resize_finish(htable);
+    }
+    return 0;
+}
+
+static int setup_schedule_tasks()
+{
+    ScheduleEntry schedule_entries[2];
+    ScheduleArray schedule_array;
+
+    INIT_SCHEDULE_ENTRY(schedule_entries[0], sched_generate_next_id(),
+            0, 0, 0, 1, free_retired_buffers, NULL);
+    schedule_array.count = 1;
+    if (g_ob_hashtable.type == OB_HASHTABLE_TYPE_CHAIN) {
+        INIT_SCHEDULE_ENTRY(schedule_entries[1], sched_generate_next_id(),
+                0, 0, 0, 1, chain_resize_task, &g_ob_hashtable);
+        schedule_array.count++;
     }
 
-    return uniq_skiplist_delete(ob->slices, slice);
+    schedule_array.entries = schedule_entries;
+    return sched_add_entries(&schedule_array);
+}
+
+int ob_index_get_shared_ctx_count()
+{
+    return ob_shared_ctx_array.count;
 }
 
-static inline int do_add_slice(OBHashtable *htable,
-        OBEntry *ob, OBSliceEntry *slice)
+int ob_index_walk_shared_ctx(OBHashtable *htable, const int ctx_index,
+        ob_index_walk_callback callback, void *args)
 {
+    OBSharedContext *ctx;
+    OBOpenShard *shard;
+    int64_t i;
     int result;
 
-    if ((result=uniq_skiplist_insert(ob->slices, slice)) != 0) {
-        return result;
+    if (ctx_index < 0 || ctx_index >= ob_shared_ctx_array.count) {
+        return EINVAL;
     }
-    if (htable->modify_sallocator) {
-        return storage_allocator_add_slice(slice, htable->modify_used_space);
+
+    /* read only, so the sequence for the lockless readers NOT changed */
+    result = 0;
+    ctx = ob_shared_ctx_array.contexts + ctx_index;
+    PTHREAD_MUTEX_LOCK(&ctx->lcp.lock);
+    if (htable->type == OB_HASHTABLE_TYPE_CHAIN) {
+        result = chain_walk_buckets(htable->buckets, ctx_index,
+                htable->capacity, ob_shared_ctx_array.count,
+                callback, args);
+        if (result == 0 && htable->resize.buckets != NULL) {
+            result = chain_walk_buckets(htable->resize.buckets, ctx_index,
+                    htable->resize.capacity, ob_shared_ctx_array.count,
+                    callback, args);
+        }
     } else {
-        return 0;
+        shard = htable->shards + ctx_index;
+        for (i=0; i<shard->capacity; i++) {
+            if (OB_OPEN_CTRL(shard, i) < 0) {
+                continue;
+            }
+            if ((result=callback(OB_OPEN_SLOT(shard, i), args)) != 0) {
+                break;
+            }
+        }
+    }
+    PTHREAD_MUTEX_UNLOCK(&ctx->lcp.lock);
+
+    return result;
+}
+
+int ob_index_init()
+{
+    int result;
+    if ((result=init_ob_shared_ctx_array()) != 0) {
+        return result;
+    }
+
+    if ((result=ob_index_init_htable_ex(&g_ob_hashtable, STORAGE_CFG.
+                    object_block.hashtable_capacity, true)) != 0)
+    {
+        return result;
     }
+
+    return setup_schedule_tasks();
+}
+
+void ob_index_destroy()
+{
 }
 
 static inline OBSliceEntry *slice_dup(OBSharedContext *ctx,
@@ -399,9 +1400,18 @@ static inline OBSliceEntry *slice_dup(OBSharedContext *ctx,
     slice->ob = src->ob;
     slice->type = src->type;
     slice->space = src->space;
+    //the CRC may be attached by the read of the whole piece
+    slice->has_crc = __atomic_load_n(&src->has_crc, __ATOMIC_ACQUIRE) &&
+        offset == src->ssize.offset && length == src->ssize.length;
+    slice->crc32 = src->crc32;
+    slice->compress = src->compress;
     extra_offset = offset - src->ssize.offset;
     if (extra_offset > 0) {
-        slice->space.offset += extra_offset;
+        if (src->compress.type == FS_COMPRESS_TYPE_NONE) {
+            slice->space.offset += extra_offset;
+        } else {  //the compressed data is decoded as a whole
+            slice->compress.offset += extra_offset;
+        }
         slice->ssize.offset = offset;
     } else {
         slice->ssize.offset = src->ssize.offset;
@@ -439,21 +1449,6 @@ static int add_to_slice_ptr_smart_array(OBSlicePtrSmartArray *array,
     return 0;
 }
 
-static inline int dup_slice_to_smart_array(OBSharedContext *ctx,
-        const OBSliceEntry *src_slice, const int offset,
-        const int length, OBSlicePtrSmartArray *array)
-{
-    OBSliceEntry *new_slice;
-
-    new_slice = slice_dup(ctx, src_slice, offset, length);
-    if (new_slice == NULL) {
-        return ENOMEM;
-    }
-
-    new_slice->space.size = length;  //for calculating trunk used bytes correctly
-    return add_to_slice_ptr_smart_array(array, new_slice);
-}
-
 #define INIT_SLICE_PTR_ARRAY(sarray) \
     do {   \
         sarray.count = 0;  \
@@ -469,121 +1464,598 @@ static inline int dup_slice_to_smart_array(OBSharedContext *ctx,
     } while (0)
 
 
-static int add_slice(OBHashtable *htable, OBSharedContext *ctx,
-        OBEntry *ob, OBSliceEntry *slice, int *inc_alloc)
+static inline void on_slice_removed(OBHashtable *htable, OBSliceEntry *slice)
 {
-    UniqSkiplistNode *node;
-    UniqSkiplistNode *previous;
-    OBSliceEntry *curr_slice;
-    OBSlicePtrSmartArray add_slice_array;
-    OBSlicePtrSmartArray del_slice_array;
-    int result;
-    int curr_end;
-    int slice_end;
-    int new_space_start;
-    int i;
+    if (htable->modify_sallocator) {
+        storage_allocator_delete_slice(slice,
+                htable->modify_used_space);
+        read_cache_invalidate(slice->space.id_info.id,
+                slice->space.offset, slice->space.size);
+    }
+}
 
-    *inc_alloc = 0;
-    node = uniq_skiplist_find_ge_node(ob->slices, (void *)slice);
-    if (node == NULL) {
-        previous = UNIQ_SKIPLIST_LEVEL0_TAIL_NODE(ob->slices);
-        if (previous == ob->slices->top) {
-            *inc_alloc += slice->ssize.length;
-            return do_add_slice(htable, ob, slice);
-        }
+static inline int on_slice_added(OBHashtable *htable, OBSliceEntry *slice)
+{
+    if (htable->modify_sallocator) {
+        return storage_allocator_add_slice(slice, htable->modify_used_space);
     } else {
-        previous = UNIQ_SKIPLIST_LEVEL0_PREV_NODE(node);
+        return 0;
     }
+}
 
-    INIT_SLICE_PTR_ARRAY(add_slice_array);
-    INIT_SLICE_PTR_ARRAY(del_slice_array);
-
-    new_space_start = slice->ssize.offset;
-    slice_end = slice->ssize.offset + slice->ssize.length;
-    if (previous != ob->slices->top) {
-        curr_slice = (OBSliceEntry *)previous->data;
-        curr_end = curr_slice->ssize.offset + curr_slice->ssize.length;
-        if (curr_end > slice->ssize.offset) {  //overlap
-            if ((result=add_to_slice_ptr_smart_array(&del_slice_array,
-                            curr_slice)) != 0)
-            {
-                return result;
-            }
+static int slice_map_to_skiplist(OBSharedContext *ctx, OBSliceMap *map)
+{
+    const int init_level_count = 4;
+    UniqSkiplist *skiplist;
+    OBSliceEntry **slices;
+    int old_alloc;
+    int result;
+    int i;
 
-            if ((result=dup_slice_to_smart_array(ctx, curr_slice,
-                            curr_slice->ssize.offset, slice->ssize.offset -
-                            curr_slice->ssize.offset, &add_slice_array)) != 0)
-            {
-                return result;
-            }
+    skiplist = uniq_skiplist_new(&ctx->factory, init_level_count);
+    if (skiplist == NULL) {
+        return ENOMEM;
+    }
 
-            new_space_start = curr_end;
-            if (curr_end > slice_end) {
-                if ((result=dup_slice_to_smart_array(ctx, curr_slice, slice_end,
-                                curr_end - slice_end, &add_slice_array)) != 0)
-                {
-                    return result;
-                }
+    slices = OB_SLICE_MAP_ARRAY(map);
+    for (i=0; i<map->count; i++) {
+        if ((result=uniq_skiplist_insert(skiplist, slices[i])) != 0) {
+            for (; i>0; i--) {  //keep the references
+                __sync_add_and_fetch(&slices[i - 1]->ref_count, 1);
             }
+            uniq_skiplist_free(skiplist);
+            return result;
         }
     }
 
-    if (node != NULL) {
-        do {
-            curr_slice = (OBSliceEntry *)node->data;
-            if (slice_end <= curr_slice->ssize.offset) {  //not overlap
-                break;
-            }
-
-            if ((result=add_to_slice_ptr_smart_array(&del_slice_array,
-                            curr_slice)) != 0)
-            {
-                return result;
-            }
+    old_alloc = map->alloc;
+    map->skiplist = skiplist;
+    map->alloc = -1;
+    if (old_alloc > 0) {
+        ctx->slice_map_bytes -= OB_SLICE_MAP_ARRAY_BYTES(old_alloc);
+        retire_buffer(ctx, slices);
+    }
+    return 0;
+}
 
-            if (curr_slice->ssize.offset > new_space_start) {
-                *inc_alloc += curr_slice->ssize.offset - new_space_start;
-            }
+static int slice_map_to_array(OBSharedContext *ctx, OBSliceMap *map)
+{
+    OBSliceEntry **array;
+    OBSliceEntry *slice;
+    UniqSkiplistIterator it;
+    int alloc;
+    int i;
 
-            curr_end = curr_slice->ssize.offset + curr_slice->ssize.length;
-            new_space_start = curr_end;
-            if (curr_end > slice_end) {
-                if ((result=dup_slice_to_smart_array(ctx, curr_slice,
-                                slice_end, curr_end - slice_end,
-                                &add_slice_array)) != 0)
-                {
-                    return result;
-                }
+    alloc = OB_SLICE_MAP_INIT_ALLOC;
+    while (alloc < map->count) {
+        alloc *= 2;
+    }
+    array = (OBSliceEntry **)fc_malloc(sizeof(OBSliceEntry *) * alloc);
+    if (array == NULL) {
+        return ENOMEM;
+    }
 
-                break;
+    /* the skiplist releases the references of the slices when free */
+    i = 0;
+    uniq_skiplist_iterator(map->skiplist, &it);
+    while ((slice=(OBSliceEntry *)uniq_skiplist_next(&it)) != NULL) {
+        __sync_add_and_fetch(&slice->ref_count, 1);
+        array[i++] = slice;
+    }
+    uniq_skiplist_free(map->skiplist);
+
+    ctx->slice_map_bytes += OB_SLICE_MAP_ARRAY_BYTES(alloc);
+    map->array = array;
+    map->alloc = alloc;
+    return 0;
+}
+
+static void slice_map_destroy(OBSharedContext *ctx, OBSliceMap *map)
+{
+    OBSliceEntry **slices;
+    int i;
+
+    if (map->alloc < 0) {
+        uniq_skiplist_free(map->skiplist);
+    } else {
+        slices = OB_SLICE_MAP_ARRAY(map);
+        for (i=0; i<map->count; i++) {
+            ob_index_free_slice(slices[i]);
+        }
+        if (map->alloc > 0) {
+            ctx->slice_map_bytes -= OB_SLICE_MAP_ARRAY_BYTES(map->alloc);
+            retire_buffer(ctx, map->array);
+        }
+    }
+
+    map->count = 0;
+    map->alloc = 0;
+}
+
+/* find the slices overlapped with [offset, end), the overlapped slices
+   are contiguous in the array so the array is referenced directly */
+static int slice_map_find_overlaps(OBSliceMap *map, const int offset,
+        const int end, OBSliceOverlaps *overlaps)
+{
+    OBSliceEntry **slices;
+    OBSliceEntry *slice;
+    OBSliceEntry target;
+    UniqSkiplistNode *node;
+    UniqSkiplistNode *previous;
+    int low;
+    int high;
+    int mid;
+    int result;
+
+    if (map->alloc >= 0) {
+        /* the slices are NOT overlapped, so the slice ends are sorted too,
+           search the first slice which end > offset */
+        slices = OB_SLICE_MAP_ARRAY(map);
+        low = 0;
+        high = map->count;
+        while (low < high) {
+            mid = (low + high) / 2;
+            if (slices[mid]->ssize.offset + slices[mid]->ssize.length
+                    > offset)
+            {
+                high = mid;
+            } else {
+                low = mid + 1;
+            }
+        }
+
+        INIT_SLICE_PTR_ARRAY(overlaps->holder);
+        overlaps->start = low;
+        overlaps->slices = slices + low;
+        for (high=low; high<map->count && slices[high]->
+                ssize.offset < end; high++)
+        {
+        }
+        overlaps->count = high - low;
+        return 0;
+    }
+
+    overlaps->start = 0;
+    INIT_SLICE_PTR_ARRAY(overlaps->holder);
+    target.ssize.offset = offset;
+    node = uniq_skiplist_find_ge_node(map->skiplist, &target);
+    if (node == NULL) {
+        previous = UNIQ_SKIPLIST_LEVEL0_TAIL_NODE(map->skiplist);
+    } else {
+        previous = UNIQ_SKIPLIST_LEVEL0_PREV_NODE(node);
+    }
+
+    if (previous != map->skiplist->top) {
+        slice = (OBSliceEntry *)previous->data;
+        if (slice->ssize.offset + slice->ssize.length > offset) {
+            if ((result=add_to_slice_ptr_smart_array(&overlaps->holder,
+                            slice)) != 0)
+            {
+                return result;
             }
+        }
+    }
 
+    if (node != NULL) {
+        do {
+            slice = (OBSliceEntry *)node->data;
+            if (slice->ssize.offset >= end) {
+                break;
+            }
+            if ((result=add_to_slice_ptr_smart_array(&overlaps->holder,
+                            slice)) != 0)
+            {
+                return result;
+            }
             node = UNIQ_SKIPLIST_LEVEL0_NEXT_NODE(node);
-        } while (node != ob->slices->factory->tail);
+        } while (node != map->skiplist->factory->tail);
+    }
+
+    overlaps->slices = overlaps->holder.slices;
+    overlaps->count = overlaps->holder.count;
+    return 0;
+}
+
+/* make sure the array can hold count slices */
+static int slice_map_reserve(OBSharedContext *ctx,
+        OBSliceMap *map, const int count)
+{
+    OBSliceEntry **array;
+    OBSliceEntry **old_array;
+    int old_alloc;
+    int alloc;
+
+    if (map->alloc == 0) {
+        if (count <= OB_SLICE_MAP_INLINE_COUNT) {
+            return 0;
+        }
+    } else if (map->alloc >= count) {
+        return 0;
+    }
+
+    alloc = (map->alloc > 0 ? map->alloc * 2 : OB_SLICE_MAP_INIT_ALLOC);
+    while (alloc < count) {
+        alloc *= 2;
+    }
+    array = (OBSliceEntry **)fc_malloc(sizeof(OBSliceEntry *) * alloc);
+    if (array == NULL) {
+        return ENOMEM;
+    }
+
+    memcpy(array, OB_SLICE_MAP_ARRAY(map), sizeof(OBSliceEntry *) *
+            map->count);
+    old_alloc = map->alloc;
+    old_array = map->array;
+    ctx->slice_map_bytes += OB_SLICE_MAP_ARRAY_BYTES(alloc);
+    map->array = array;
+    map->alloc = alloc;
+    if (old_alloc > 0) {
+        ctx->slice_map_bytes -= OB_SLICE_MAP_ARRAY_BYTES(old_alloc);
+        retire_buffer(ctx, old_array);
+    }
+    return 0;
+}
+
+/* make room for the replace, the map is NOT changed when fail */
+static int slice_map_prepare_replace(OBSharedContext *ctx, OBSliceMap *map,
+        OBSliceOverlaps *overlaps, const int new_count)
+{
+    int result;
+    int i;
+
+    if (map->alloc < 0) {
+        return 0;
+    }
+
+    if (new_count <= OB_SLICE_MAP_MAX_ARRAY_COUNT) {
+        if ((result=slice_map_reserve(ctx, map, new_count)) != 0) {
+            return result;
+        }
+        overlaps->slices = OB_SLICE_MAP_ARRAY(map) + overlaps->start;
+        return 0;
+    }
+
+    /* too fragmented, the overlapped slices referenced from
+       the array are copied before the array converted to skiplist */
+    for (i=0; i<overlaps->count; i++) {
+        if ((result=add_to_slice_ptr_smart_array(&overlaps->holder,
+                        overlaps->slices[i])) != 0)
+        {
+            return result;
+        }
+    }
+    if ((result=slice_map_to_skiplist(ctx, map)) != 0) {
+        return result;
+    }
+    overlaps->slices = overlaps->holder.slices;
+    return 0;
+}
+
+/* replace the overlapped slices with the sorted new slices */
+static int slice_map_replace(OBHashtable *htable, OBSharedContext *ctx,
+        OBSliceMap *map, OBSliceOverlaps *overlaps,
+        OBSliceEntry **adds, const int add_count)
+{
+    OBSliceEntry **slices;
+    int new_count;
+    int result;
+    int r;
+    int i;
+
+    for (i=0; i<overlaps->count; i++) {
+        on_slice_removed(htable, overlaps->slices[i]);
+    }
+
+    result = 0;
+    new_count = map->count - overlaps->count + add_count;
+    if (map->alloc < 0) {
+        for (i=0; i<overlaps->count; i++) {
+            uniq_skiplist_delete(map->skiplist, overlaps->slices[i]);
+        }
+        for (i=0; i<add_count; i++) {
+            if ((r=uniq_skiplist_insert(map->skiplist, adds[i])) != 0) {
+                result = r;
+                adds[i] = NULL;
+                new_count--;
+            }
+        }
+        map->count = new_count;
+        if (new_count <= OB_SLICE_MAP_MIN_SKIPLIST_COUNT) {
+            slice_map_to_array(ctx, map);
+        }
+    } else {
+        for (i=0; i<overlaps->count; i++) {
+            ob_index_free_slice(overlaps->slices[i]);
+        }
+
+        slices = OB_SLICE_MAP_ARRAY(map);
+        if (add_count != overlaps->count) {
+            memmove(slices + overlaps->start + add_count,
+                    slices + overlaps->start + overlaps->count,
+                    sizeof(OBSliceEntry *) * (map->count -
+                        (overlaps->start + overlaps->count)));
+        }
+        memcpy(slices + overlaps->start, adds,
+                sizeof(OBSliceEntry *) * add_count);
+        map->count = new_count;
+
+        if (map->alloc > 0 && new_count <= OB_SLICE_MAP_INLINE_COUNT) {
+            slices = map->array;
+            memcpy(map->inlines, slices, sizeof(OBSliceEntry *) * new_count);
+            ctx->slice_map_bytes -= OB_SLICE_MAP_ARRAY_BYTES(map->alloc);
+            map->alloc = 0;
+            retire_buffer(ctx, slices);
+        }
+    }
+
+    for (i=0; i<add_count; i++) {
+        if (adds[i] != NULL && (r=on_slice_added(htable, adds[i])) != 0) {
+            result = r;
+        }
+    }
+    return result;
+}
+
+static inline OBSliceEntry *slice_dup_piece(OBSharedContext *ctx,
+        const OBSliceEntry *src, const int offset, const int length)
+{
+    OBSliceEntry *slice;
+
+    if ((slice=slice_dup(ctx, src, offset, length)) == NULL) {
+        return NULL;
+    }
+
+    //for calculating trunk used bytes correctly
+    if (src->compress.type == FS_COMPRESS_TYPE_NONE) {
+        slice->space.size = length;
+    } else {
+        slice->space.size = FC_MAX(src->space.size *
+                length / src->ssize.length, 1);
+    }
+    return slice;
+}
+
+/* cut the parts out of the overlapped slices, the parts before
+   and after the range [offset, end) are kept */
+static int cut_overlaps(OBSharedContext *ctx, OBSliceOverlaps *overlaps,
+        const int offset, const int end, OBSliceEntry **head,
+        OBSliceEntry **tail)
+{
+    OBSliceEntry *first;
+    OBSliceEntry *last;
+    int last_end;
+
+    *head = *tail = NULL;
+    if (overlaps->count == 0) {
+        return 0;
     }
 
+    first = overlaps->slices[0];
+    if (first->ssize.offset < offset) {
+        if ((*head=slice_dup_piece(ctx, first, first->ssize.offset,
+                        offset - first->ssize.offset)) == NULL)
+        {
+            return ENOMEM;
+        }
+    }
+
+    last = overlaps->slices[overlaps->count - 1];
+    last_end = last->ssize.offset + last->ssize.length;
+    if (last_end > end) {
+        if ((*tail=slice_dup_piece(ctx, last, end,
+                        last_end - end)) == NULL)
+        {
+            if (*head != NULL) {
+                ob_index_free_slice(*head);
+                *head = NULL;
+            }
+            return ENOMEM;
+        }
+    }
+
+    return 0;
+}
+
+static inline void free_slice_pieces(OBSliceEntry *head, OBSliceEntry *tail)
+{
+    if (head != NULL) {
+        ob_index_free_slice(head);
+    }
+    if (tail != NULL) {
+        ob_index_free_slice(tail);
+    }
+}
+
+static int add_slice(OBHashtable *htable, OBSharedContext *ctx,
+        OBEntry *ob, OBSliceEntry *slice, int *inc_alloc)
+{
+    OBSliceOverlaps overlaps;
+    OBSliceEntry *adds[3];
+    OBSliceEntry *head;
+    OBSliceEntry *tail;
+    OBSliceEntry *curr_slice;
+    int result;
+    int add_count;
+    int slice_end;
+    int new_space_start;
+    int i;
+
+    *inc_alloc = 0;
+    slice_end = slice->ssize.offset + slice->ssize.length;
+    if ((result=slice_map_find_overlaps(&ob->slices, slice->ssize.offset,
+                    slice_end, &overlaps)) != 0)
+    {
+        FREE_SLICE_PTR_ARRAY(overlaps.holder);
+        return result;
+    }
+
+    new_space_start = slice->ssize.offset;
+    for (i=0; i<overlaps.count; i++) {
+        curr_slice = overlaps.slices[i];
+        if (curr_slice->ssize.offset > new_space_start) {
+            *inc_alloc += curr_slice->ssize.offset - new_space_start;
+        }
+        new_space_start = curr_slice->ssize.offset +
+            curr_slice->ssize.length;
+    }
     if (slice_end > new_space_start) {
         *inc_alloc += slice_end - new_space_start;
     }
 
-    for (i=0; i<del_slice_array.count; i++) {
-        do_delete_slice(htable, ob, del_slice_array.slices[i]);
+    if ((result=cut_overlaps(ctx, &overlaps, slice->ssize.offset,
+                    slice_end, &head, &tail)) != 0)
+    {
+        FREE_SLICE_PTR_ARRAY(overlaps.holder);
+        return result;
+    }
+
+    add_count = 0;
+    if (head != NULL) {
+        adds[add_count++] = head;
+    }
+    adds[add_count++] = slice;
+    if (tail != NULL) {
+        adds[add_count++] = tail;
+    }
+    if ((result=slice_map_prepare_replace(ctx, &ob->slices, &overlaps,
+                    ob->slices.count - overlaps.count + add_count)) == 0)
+    {
+        result = slice_map_replace(htable, ctx, &ob->slices,
+                &overlaps, adds, add_count);
+    } else {
+        free_slice_pieces(head, tail);
+    }
+    FREE_SLICE_PTR_ARRAY(overlaps.holder);
+    return result;
+}
+
+/* the slices are adjacent in the block and contiguous in the same trunk
+   file, the space of the left slice MUST have no padding */
+static inline bool slice_can_merge(const OBSliceEntry *left,
+        const OBSliceEntry *right)
+{
+    return left->type == right->type &&
+        left->compress.type == FS_COMPRESS_TYPE_NONE &&
+        right->compress.type == FS_COMPRESS_TYPE_NONE &&
+        left->ssize.offset + left->ssize.length == right->ssize.offset &&
+        left->space.store == right->space.store &&
+        left->space.id_info.id == right->space.id_info.id &&
+        left->space.size == left->ssize.length &&
+        left->space.offset + left->space.size == right->space.offset;
+}
+
+static OBSliceEntry *slice_merge(OBSharedContext *ctx,
+        OBSliceEntry **slices, const int count)
+{
+    OBSliceEntry *merged;
+    int i;
+
+    if ((merged=slice_dup(ctx, slices[0], slices[0]->ssize.offset,
+                    slices[0]->ssize.length)) == NULL)
+    {
+        return NULL;
+    }
+
+    for (i=1; i<count; i++) {
+        if (merged->has_crc && slices[i]->has_crc) {
+            merged->crc32 = fs_crc32c_combine(merged->crc32,
+                    slices[i]->crc32, slices[i]->ssize.length);
+        } else {
+            merged->has_crc = false;
+        }
+        merged->ssize.length += slices[i]->ssize.length;
+        merged->space.size += slices[i]->space.size;
+    }
+    return merged;
+}
+
+/* replace count slices of the overlaps from first with the merged slice,
+   return the merged slice, NULL for fail */
+static OBSliceEntry *merge_overlaps(OBHashtable *htable,
+        OBSharedContext *ctx, OBEntry *ob, OBSliceOverlaps *overlaps,
+        const int first, const int count)
+{
+    OBSliceEntry *merged;
+
+    if ((merged=slice_merge(ctx, overlaps->slices + first, count)) == NULL) {
+        return NULL;
+    }
+
+    overlaps->start += first;
+    overlaps->slices += first;
+    overlaps->count = count;
+    if (slice_map_prepare_replace(ctx, &ob->slices, overlaps,
+                ob->slices.count - count + 1) != 0)
+    {
+        ob_index_free_slice(merged);
+        return NULL;
+    }
+
+    slice_map_replace(htable, ctx, &ob->slices, overlaps, &merged, 1);
+    return merged;
+}
+
+/* merge the added slice with the adjacent slices which are contiguous
+   in the same trunk file, return the merged slice, NULL for NOT merged */
+static OBSliceEntry *merge_adjacent_slices(OBHashtable *htable,
+        OBSharedContext *ctx, OBEntry *ob, OBSliceEntry *slice)
+{
+    OBSliceOverlaps overlaps;
+    OBSliceEntry *merged;
+    int first;
+    int last;
+    int i;
+
+    if (!STORAGE_CFG.slice_merge.enabled || htable != &g_ob_hashtable ||
+            ob->reclaiming_count > 0 || slice->compress.type !=
+            FS_COMPRESS_TYPE_NONE)
+    {
+        return NULL;
+    }
+
+    //the left slice ends at the offset, the right slice starts at the end
+    if (slice_map_find_overlaps(&ob->slices, FC_MAX(slice->ssize.offset
+                    - 1, 0), slice->ssize.offset + slice->ssize.length
+                + 1, &overlaps) != 0)
+    {
+        FREE_SLICE_PTR_ARRAY(overlaps.holder);
+        return NULL;
+    }
+
+    for (i=0; i<overlaps.count && overlaps.slices[i]!=slice; i++) {
+    }
+    if (i == overlaps.count) {
+        FREE_SLICE_PTR_ARRAY(overlaps.holder);
+        return NULL;
     }
-    FREE_SLICE_PTR_ARRAY(del_slice_array);
 
-    for (i=0; i<add_slice_array.count; i++) {
-        do_add_slice(htable, ob, add_slice_array.slices[i]);
+    first = last = i;
+    if (i > 0 && slice_can_merge(overlaps.slices[i - 1], slice)) {
+        first = i - 1;
+    }
+    if (i + 1 < overlaps.count && slice_can_merge(slice,
+                overlaps.slices[i + 1]))
+    {
+        last = i + 1;
     }
-    FREE_SLICE_PTR_ARRAY(add_slice_array);
 
-    return do_add_slice(htable, ob, slice);
+    if (first == last) {
+        merged = NULL;
+    } else {
+        merged = merge_overlaps(htable, ctx, ob, &overlaps,
+                first, last - first + 1);
+    }
+    FREE_SLICE_PTR_ARRAY(overlaps.holder);
+    return merged;
 }
 
 #define CHECK_AND_WAIT_RECLAIM_DONE(ctx, ob) \
     do {  \
         if (!is_reclaim) {  \
             while (ob->reclaiming_count > 0) {  \
+                __sync_add_and_fetch(&ctx->seq, 1);  \
                 pthread_cond_wait(&ctx->lcp.cond, &ctx->lcp.lock); \
+                __sync_add_and_fetch(&ctx->seq, 1);  \
             } \
         } \
     } while (0)
@@ -603,28 +2075,304 @@ int ob_index_add_slice_ex(OBHashtable *htable, OBSliceEntry *slice,
     OB_INDEX_SET_HASHTABLE_CTX(htable, slice->ob->bkey);
     OB_INDEX_SHARED_CTX_LOCK(htable, ctx);
 
-    CHECK_AND_WAIT_RECLAIM_DONE(ctx, slice->ob);
-    result = add_slice(htable, ctx, slice->ob, slice, inc_alloc);
-    if (result == 0) {
-        __sync_add_and_fetch(&slice->ref_count, 1);
-        if (sn != NULL) {
-            *sn = __sync_add_and_fetch(&SLICE_BINLOG_SN, 1);
+    CHECK_AND_WAIT_RECLAIM_DONE(ctx, slice->ob);
+    result = add_slice(htable, ctx, slice->ob, slice, inc_alloc);
+    if (result == 0) {
+        __sync_add_and_fetch(&slice->ref_count, 1);
+        if (sn != NULL) {
+            *sn = __sync_add_and_fetch(&SLICE_BINLOG_SN, 1);
+        }
+    }
+    OB_INDEX_SHARED_CTX_UNLOCK(htable, ctx);
+
+    return result;
+}
+
+static inline int check_batch_slice(OBEntry *ob, OBSliceEntry *slice)
+{
+    if (slice->ob != ob) {
+        logError("file: "__FILE__", line: %d, "
+                "the slices of the batch MUST belong to the same "
+                "object block, block {oid: %"PRId64", offset: %"PRId64"} "
+                "!= {oid: %"PRId64", offset: %"PRId64"}", __LINE__,
+                slice->ob->bkey.oid, slice->ob->bkey.offset,
+                ob->bkey.oid, ob->bkey.offset);
+        return EINVAL;
+    }
+    return 0;
+}
+
+int ob_index_add_slices_ex(OBHashtable *htable, FSSliceSNPair *pairs,
+        const int count, const bool gen_sn, int *inc_alloc,
+        const bool is_reclaim)
+{
+    OBEntry *ob;
+    OBSliceEntry *merged;
+    FSSliceSNPair *pair;
+    FSSliceSNPair *end;
+    int result;
+    int inc;
+
+    *inc_alloc = 0;
+    if (count <= 0) {
+        return 0;
+    }
+
+    result = 0;
+    ob = pairs->slice->ob;
+    end = pairs + count;
+    OB_INDEX_SET_HASHTABLE_CTX(htable, ob->bkey);
+    OB_INDEX_SHARED_CTX_LOCK(htable, ctx);
+
+    CHECK_AND_WAIT_RECLAIM_DONE(ctx, ob);
+    for (pair=pairs; pair<end; pair++) {
+        if ((result=check_batch_slice(ob, pair->slice)) != 0) {
+            break;
+        }
+        if ((result=add_slice(htable, ctx, ob, pair->slice, &inc)) != 0) {
+            break;
+        }
+
+        __sync_add_and_fetch(&pair->slice->ref_count, 1);
+        if (gen_sn) {
+            pair->sn = __sync_add_and_fetch(&SLICE_BINLOG_SN, 1);
+        }
+        *inc_alloc += inc;
+
+        /* the merged slice takes the place of the pair,
+           so the merged form is written to the slice binlog */
+        if ((merged=merge_adjacent_slices(htable, ctx, ob,
+                        pair->slice)) != NULL)
+        {
+            __sync_add_and_fetch(&merged->ref_count, 1);
+            ob_index_free_slice(pair->slice);
+            pair->slice = merged;
+        }
+    }
+    OB_INDEX_SHARED_CTX_UNLOCK(htable, ctx);
+
+    return result;
+}
+
+int ob_index_add_slice_by_binlog(OBSliceEntry *slice)
+{
+    int result;
+    int inc_alloc;
+
+    OB_INDEX_SET_HASHTABLE_CTX(&g_ob_hashtable, slice->ob->bkey);
+    OB_INDEX_SHARED_CTX_LOCK(&g_ob_hashtable, ctx);
+    result = add_slice(&g_ob_hashtable, ctx, slice->ob, slice, &inc_alloc);
+    OB_INDEX_SHARED_CTX_UNLOCK(&g_ob_hashtable, ctx);
+
+    return result;
+}
+
+typedef struct {
+    int count;
+    int alloc;
+    FSBlockKey *bkeys;
+} OBBlockKeyArray;
+
+static bool ob_has_mergeable_slices(OBEntry *ob)
+{
+    OBSliceMapIterator it;
+    OBSliceEntry *previous;
+    OBSliceEntry *slice;
+
+    if (ob->slices.count < 2) {
+        return false;
+    }
+
+    ob_slice_map_iterator(&ob->slices, &it);
+    previous = ob_slice_map_next(&it);
+    while ((slice=ob_slice_map_next(&it)) != NULL) {
+        if (slice_can_merge(previous, slice)) {
+            return true;
+        }
+        previous = slice;
+    }
+    return false;
+}
+
+static int collect_merge_block(OBEntry *ob, void *args)
+{
+    OBBlockKeyArray *barray;
+    FSBlockKey *bkeys;
+    int alloc;
+
+    if (ob->reclaiming_count > 0 || !ob_has_mergeable_slices(ob)) {
+        return 0;
+    }
+
+    barray = (OBBlockKeyArray *)args;
+    if (barray->count == barray->alloc) {
+        alloc = (barray->alloc > 0 ? barray->alloc * 2 : 256);
+        bkeys = (FSBlockKey *)fc_malloc(sizeof(FSBlockKey) * alloc);
+        if (bkeys == NULL) {
+            return ENOMEM;
+        }
+        if (barray->bkeys != NULL) {
+            memcpy(bkeys, barray->bkeys, sizeof(FSBlockKey) *
+                    barray->count);
+            free(barray->bkeys);
+        }
+        barray->bkeys = bkeys;
+        barray->alloc = alloc;
+    }
+
+    barray->bkeys[barray->count++] = ob->bkey;
+    return 0;
+}
+
+static int check_alloc_slice_sn_pairs(FSSliceSNPairArray *sarray)
+{
+    FSSliceSNPair *pairs;
+    int alloc;
+
+    if (sarray->count < sarray->alloc) {
+        return 0;
+    }
+
+    alloc = (sarray->alloc > 0 ? sarray->alloc * 2 : 256);
+    pairs = (FSSliceSNPair *)fc_malloc(sizeof(FSSliceSNPair) * alloc);
+    if (pairs == NULL) {
+        return ENOMEM;
+    }
+    if (sarray->slice_sn_pairs != NULL) {
+        memcpy(pairs, sarray->slice_sn_pairs,
+                sizeof(FSSliceSNPair) * sarray->count);
+        free(sarray->slice_sn_pairs);
+    }
+    sarray->slice_sn_pairs = pairs;
+    sarray->alloc = alloc;
+    return 0;
+}
+
+static int merge_block_slices(OBSharedContext *ctx, OBEntry *ob,
+        FSSliceSNPairArray *sarray, int64_t *slice_count)
+{
+    OBSlicePtrSmartArray snapshot;
+    OBSliceOverlaps overlaps;
+    OBSliceMapIterator it;
+    OBSliceEntry *slice;
+    OBSliceEntry *merged;
+    FSSliceSNPair *pair;
+    int result;
+    int first;
+    int last;
+
+    /* the slices out of the merged runs are NOT changed,
+       so the snapshot is valid during the merge */
+    INIT_SLICE_PTR_ARRAY(snapshot);
+    ob_slice_map_iterator(&ob->slices, &it);
+    while ((slice=ob_slice_map_next(&it)) != NULL) {
+        if ((result=add_to_slice_ptr_smart_array(&snapshot, slice)) != 0) {
+            FREE_SLICE_PTR_ARRAY(snapshot);
+            return result;
+        }
+    }
+
+    result = 0;
+    first = 0;
+    while (first < snapshot.count) {
+        last = first;
+        while (last + 1 < snapshot.count && slice_can_merge(
+                    snapshot.slices[last], snapshot.slices[last + 1]))
+        {
+            last++;
+        }
+        if (last == first) {
+            first++;
+            continue;
+        }
+
+        if ((result=check_alloc_slice_sn_pairs(sarray)) != 0) {
+            break;
+        }
+        if ((result=slice_map_find_overlaps(&ob->slices, snapshot.
+                        slices[first]->ssize.offset, snapshot.slices[last]->
+                        ssize.offset + snapshot.slices[last]->ssize.length,
+                        &overlaps)) == 0 && overlaps.count == last - first + 1
+                && (merged=merge_overlaps(&g_ob_hashtable, ctx, ob,
+                        &overlaps, 0, overlaps.count)) != NULL)
+        {
+            __sync_add_and_fetch(&merged->ref_count, 1);
+            pair = sarray->slice_sn_pairs + sarray->count++;
+            pair->slice = merged;
+            pair->sn = __sync_add_and_fetch(&SLICE_BINLOG_SN, 1);
+            *slice_count += last - first + 1;
+        }
+        FREE_SLICE_PTR_ARRAY(overlaps.holder);
+        if (result != 0) {
+            break;
+        }
+        first = last + 1;
+    }
+
+    FREE_SLICE_PTR_ARRAY(snapshot);
+    return result;
+}
+
+int ob_index_merge_slices(const int ctx_index, FSSliceSNPairArray *sarray,
+        int64_t *slice_count)
+{
+    OBBlockKeyArray barray;
+    OBEntry *ob;
+    int result;
+    int i;
+
+    sarray->count = 0;
+    *slice_count = 0;
+    memset(&barray, 0, sizeof(barray));
+    if ((result=ob_index_walk_shared_ctx(&g_ob_hashtable, ctx_index,
+                    collect_merge_block, &barray)) == 0)
+    {
+        for (i=0; i<barray.count && result==0; i++) {
+            OB_INDEX_SET_HASHTABLE_CTX(&g_ob_hashtable, barray.bkeys[i]);
+            OB_INDEX_SHARED_CTX_LOCK(&g_ob_hashtable, ctx);
+            ob = get_ob_entry(&g_ob_hashtable, ctx,
+                    barray.bkeys + i, false);
+            if (ob != NULL && ob->reclaiming_count == 0) {
+                result = merge_block_slices(ctx, ob, sarray, slice_count);
+            }
+            OB_INDEX_SHARED_CTX_UNLOCK(&g_ob_hashtable, ctx);
         }
     }
-    OB_INDEX_SHARED_CTX_UNLOCK(htable, ctx);
 
+    if (barray.bkeys != NULL) {
+        free(barray.bkeys);
+    }
     return result;
 }
 
-int ob_index_add_slice_by_binlog(OBSliceEntry *slice)
+int ob_index_add_slices_by_binlog(OBSliceEntry **slices, const int count)
 {
+    OBEntry *ob;
+    OBSliceEntry **slice;
+    OBSliceEntry **end;
     int result;
     int inc_alloc;
 
-    OB_INDEX_SET_HASHTABLE_CTX(&g_ob_hashtable, slice->ob->bkey);
-    PTHREAD_MUTEX_LOCK(&ctx->lcp.lock);
-    result = add_slice(&g_ob_hashtable, ctx, slice->ob, slice, &inc_alloc);
-    PTHREAD_MUTEX_UNLOCK(&ctx->lcp.lock);
+    if (count <= 0) {
+        return 0;
+    }
+
+    result = 0;
+    ob = (*slices)->ob;
+    end = slices + count;
+    OB_INDEX_SET_HASHTABLE_CTX(&g_ob_hashtable, ob->bkey);
+    OB_INDEX_SHARED_CTX_LOCK(&g_ob_hashtable, ctx);
+    for (slice=slices; slice<end; slice++) {
+        if ((result=check_batch_slice(ob, *slice)) != 0) {
+            break;
+        }
+        if ((result=add_slice(&g_ob_hashtable, ctx, ob,
+                        *slice, &inc_alloc)) != 0)
+        {
+            break;
+        }
+    }
+    OB_INDEX_SHARED_CTX_UNLOCK(&g_ob_hashtable, ctx);
 
     return result;
 }
@@ -632,142 +2380,76 @@ int ob_index_add_slice_by_binlog(OBSliceEntry *slice)
 static int delete_slices(OBHashtable *htable, OBSharedContext *ctx, OBEntry *ob,
         const FSBlockSliceKeyInfo *bs_key, int *count, int *dec_alloc)
 {
-    OBSliceEntry target;
-    UniqSkiplistNode *node;
-    UniqSkiplistNode *previous;
+    OBSliceOverlaps overlaps;
+    OBSliceEntry *adds[2];
+    OBSliceEntry *head;
+    OBSliceEntry *tail;
     OBSliceEntry *curr_slice;
-    OBSlicePtrSmartArray add_slice_array;
-    OBSlicePtrSmartArray del_slice_array;
     int result;
-    int curr_end;
+    int add_count;
     int slice_end;
     int i;
 
     *dec_alloc = 0;
     *count = 0;
-    target.ssize = bs_key->slice;
-    node = uniq_skiplist_find_ge_node(ob->slices, &target);
-    if (node == NULL) {
-        previous = UNIQ_SKIPLIST_LEVEL0_TAIL_NODE(ob->slices);
-        if (previous == ob->slices->top) {
-            return ENOENT;
-        }
-    } else {
-        previous = UNIQ_SKIPLIST_LEVEL0_PREV_NODE(node);
-    }
-
-    INIT_SLICE_PTR_ARRAY(add_slice_array);
-    INIT_SLICE_PTR_ARRAY(del_slice_array);
-
     slice_end = bs_key->slice.offset + bs_key->slice.length;
-    if (previous != ob->slices->top) {
-        curr_slice = (OBSliceEntry *)previous->data;
-        curr_end = curr_slice->ssize.offset + curr_slice->ssize.length;
-        if (curr_end > bs_key->slice.offset) {  //overlap
-            if ((result=add_to_slice_ptr_smart_array(&del_slice_array,
-                            curr_slice)) != 0)
-            {
-                return result;
-            }
-
-            if ((result=dup_slice_to_smart_array(ctx, curr_slice,
-                            curr_slice->ssize.offset, bs_key->slice.offset -
-                            curr_slice->ssize.offset, &add_slice_array)) != 0)
-            {
-                return result;
-            }
-
-            if (curr_end > slice_end) {
-                if ((result=dup_slice_to_smart_array(ctx, curr_slice, slice_end,
-                                curr_end - slice_end, &add_slice_array)) != 0)
-                {
-                    return result;
-                }
-
-                *dec_alloc += bs_key->slice.length;
-            } else {
-                *dec_alloc += curr_end - bs_key->slice.offset;
-            }
-        }
-    }
-
-    if (node != NULL) {
-        do {
-            curr_slice = (OBSliceEntry *)node->data;
-            if (slice_end <= curr_slice->ssize.offset) {  //not overlap
-                break;
-            }
-
-            if ((result=add_to_slice_ptr_smart_array(&del_slice_array,
-                            curr_slice)) != 0)
-            {
-                return result;
-            }
-
-            curr_end = curr_slice->ssize.offset + curr_slice->ssize.length;
-            if (curr_end > slice_end) {
-                if ((result=dup_slice_to_smart_array(ctx, curr_slice,
-                                slice_end, curr_end - slice_end,
-                                &add_slice_array)) != 0)
-                {
-                    return result;
-                }
-
-                *dec_alloc += slice_end - curr_slice->ssize.offset;
-                break;
-            } else {
-                *dec_alloc += curr_slice->ssize.length;
-            }
-
-            node = UNIQ_SKIPLIST_LEVEL0_NEXT_NODE(node);
-        } while (node != ob->slices->factory->tail);
+    if ((result=slice_map_find_overlaps(&ob->slices, bs_key->slice.offset,
+                    slice_end, &overlaps)) != 0)
+    {
+        FREE_SLICE_PTR_ARRAY(overlaps.holder);
+        return result;
     }
-
-    if (del_slice_array.count == 0) {
+    if (overlaps.count == 0) {
+        FREE_SLICE_PTR_ARRAY(overlaps.holder);
         return ENOENT;
     }
 
-    *count = del_slice_array.count;
-    for (i=0; i<del_slice_array.count; i++) {
-        do_delete_slice(htable, ob, del_slice_array.slices[i]);
+    for (i=0; i<overlaps.count; i++) {
+        curr_slice = overlaps.slices[i];
+        *dec_alloc += FC_MIN(curr_slice->ssize.offset + curr_slice->
+                ssize.length, slice_end) - FC_MAX(curr_slice->
+                    ssize.offset, bs_key->slice.offset);
     }
-    FREE_SLICE_PTR_ARRAY(del_slice_array);
 
-    if (add_slice_array.count > 0) {
-        for (i=0; i<add_slice_array.count; i++) {
-            do_add_slice(htable, ob, add_slice_array.slices[i]);
-        }
-        FREE_SLICE_PTR_ARRAY(add_slice_array);
+    if ((result=cut_overlaps(ctx, &overlaps, bs_key->slice.offset,
+                    slice_end, &head, &tail)) != 0)
+    {
+        FREE_SLICE_PTR_ARRAY(overlaps.holder);
+        return result;
     }
 
-    return 0;
+    add_count = 0;
+    if (head != NULL) {
+        adds[add_count++] = head;
+    }
+    if (tail != NULL) {
+        adds[add_count++] = tail;
+    }
+    *count = overlaps.count;
+    if ((result=slice_map_prepare_replace(ctx, &ob->slices, &overlaps,
+                    ob->slices.count - overlaps.count + add_count)) == 0)
+    {
+        slice_map_replace(htable, ctx, &ob->slices,
+                &overlaps, adds, add_count);
+    } else {
+        free_slice_pieces(head, tail);
+        *count = 0;
+    }
+    FREE_SLICE_PTR_ARRAY(overlaps.holder);
+    return result;
 }
 
-
-#define OB_INDEX_DELETE_OB_ENTRY(ctx, bucket, ob, previous) \
-    do {  \
-        if (previous == NULL) {  \
-            *bucket = ob->next;  \
-        } else {  \
-            previous->next = ob->next;  \
-        } \
-        uniq_skiplist_free(ob->slices); \
-        fast_mblock_free_object(&ctx->ob_allocator, ob); \
-    } while (0)
-
-
 int ob_index_delete_slices_ex(OBHashtable *htable,
         const FSBlockSliceKeyInfo *bs_key, uint64_t *sn,
         int *dec_alloc, const bool is_reclaim)
 {
     OBEntry *ob;
-    OBEntry *previous;
     int result;
     int count;
 
-    OB_INDEX_SET_BUCKET_AND_CTX(htable, bs_key->block);
+    OB_INDEX_SET_HASHTABLE_CTX(htable, bs_key->block);
     OB_INDEX_SHARED_CTX_LOCK(htable, ctx);
-    ob = get_ob_entry_ex(ctx, bucket, &bs_key->block, false, &previous);
+    ob = get_ob_entry(htable, ctx, &bs_key->block, false);
     if (ob == NULL) {
         *dec_alloc = 0;
         result = ENOENT;
@@ -775,8 +2457,8 @@ int ob_index_delete_slices_ex(OBHashtable *htable,
         CHECK_AND_WAIT_RECLAIM_DONE(ctx, ob);
         result = delete_slices(htable, ctx, ob, bs_key, &count, dec_alloc);
         if (result == 0) {
-            if (uniq_skiplist_empty(ob->slices)) {
-                OB_INDEX_DELETE_OB_ENTRY(ctx, bucket, ob, previous);
+            if (ob_slice_map_empty(&ob->slices)) {
+                delete_ob_entry(htable, ctx, ob);
             }
 
             if (sn != NULL) {
@@ -794,28 +2476,24 @@ int ob_index_delete_block_ex(OBHashtable *htable,
         int *dec_alloc, const bool is_reclaim)
 {
     OBEntry *ob;
-    OBEntry *previous;
     OBSliceEntry *slice;
-    UniqSkiplistIterator it;
+    OBSliceMapIterator it;
     int result;
 
-    OB_INDEX_SET_BUCKET_AND_CTX(htable, *bkey);
+    OB_INDEX_SET_HASHTABLE_CTX(htable, *bkey);
 
     *dec_alloc = 0;
     OB_INDEX_SHARED_CTX_LOCK(htable, ctx);
-    ob = get_ob_entry_ex(ctx, bucket, bkey, false, &previous);
+    ob = get_ob_entry(htable, ctx, bkey, false);
     if (ob != NULL) {
         CHECK_AND_WAIT_RECLAIM_DONE(ctx, ob);
-        uniq_skiplist_iterator(ob->slices, &it);
-        while ((slice=(OBSliceEntry *)uniq_skiplist_next(&it)) != NULL) {
+        ob_slice_map_iterator(&ob->slices, &it);
+        while ((slice=ob_slice_map_next(&it)) != NULL) {
             *dec_alloc += slice->ssize.length;
-            if (htable->modify_sallocator) {
-                storage_allocator_delete_slice(slice,
-                        htable->modify_used_space);
-            }
+            on_slice_removed(htable, slice);
         }
 
-        OB_INDEX_DELETE_OB_ENTRY(ctx, bucket, ob, previous);
+        delete_ob_entry(htable, ctx, ob);
         if (*dec_alloc > 0) {
             if (sn != NULL) {
                 *sn = __sync_add_and_fetch(&SLICE_BINLOG_SN, 1);
@@ -879,159 +2557,195 @@ static inline int dup_slice_to_array(OBSharedContext *ctx,
     return add_to_slice_ptr_array(array, new_slice);
 }
 
-/*
-static void print_skiplist(OBEntry *ob)
+static int get_slices(OBSharedContext *ctx, OBEntry *ob,
+        const FSBlockSliceKeyInfo *bs_key, OBSlicePtrArray *sarray)
 {
-    UniqSkiplistIterator it;
-    OBSliceEntry *slice;
-    int count = 0;
+    OBSliceOverlaps overlaps;
+    OBSliceEntry *curr_slice;
+    int slice_end;
+    int curr_end;
+    int start;
+    int end;
+    int result;
+    int i;
 
-    logInfo("forward iterator:");
-    uniq_skiplist_iterator(ob->slices, &it);
-    while ((slice=(OBSliceEntry *)uniq_skiplist_next(&it)) != NULL) {
+    slice_end = bs_key->slice.offset + bs_key->slice.length;
+    if ((result=slice_map_find_overlaps(&ob->slices, bs_key->slice.offset,
+                    slice_end, &overlaps)) != 0)
+    {
+        FREE_SLICE_PTR_ARRAY(overlaps.holder);
+        return result;
+    }
 
-        ++count;
-        //if (count <= 1)
-        {
-            logInfo("%d. slice offset: %d, length: %d, end: %d",
-                    count, slice->ssize.offset, slice->ssize.length,
-                    slice->ssize.offset + slice->ssize.length);
+    for (i=0; i<overlaps.count; i++) {
+        curr_slice = overlaps.slices[i];
+        curr_end = curr_slice->ssize.offset + curr_slice->ssize.length;
+        start = FC_MAX(curr_slice->ssize.offset, bs_key->slice.offset);
+        end = FC_MIN(curr_end, slice_end);
+        if (start == curr_slice->ssize.offset && end == curr_end) {
+            __sync_add_and_fetch(&curr_slice->ref_count, 1);
+            result = add_to_slice_ptr_array(sarray, curr_slice);
+        } else {
+            result = dup_slice_to_array(ctx, curr_slice,
+                    start, end - start, sarray);
+        }
+        if (result != 0) {
+            break;
         }
     }
+    FREE_SLICE_PTR_ARRAY(overlaps.holder);
 
+    if (result != 0) {
+        return result;
+    }
+    return sarray->count > 0 ? 0 : ENOENT;
+}
 
-    {
-    UniqSkiplistNode *node;
-    logInfo("reverse iterator:");
-    node = UNIQ_SKIPLIST_LEVEL0_TAIL_NODE(ob->slices);
-    while (node != ob->slices->top) {
-        slice = (OBSliceEntry *)node->data;
+static void free_slices(OBSlicePtrArray *sarray)
+{
+    OBSliceEntry **pp;
+    OBSliceEntry **end;
 
-        //if (count <= 1)
-        {
-            logInfo("%d. slice offset: %d, length: %d, end: %d",
-                    count, slice->ssize.offset, slice->ssize.length,
-                    slice->ssize.offset + slice->ssize.length);
-        }
-        --count;
-        if (count < 0) {
-            break;
-        }
+    if (sarray->count == 0) {
+        return;
+    }
 
-        node = UNIQ_SKIPLIST_LEVEL0_PREV_NODE(node);
+    end = sarray->slices + sarray->count;
+    for (pp=sarray->slices; pp<end; pp++) {
+        ob_index_free_slice(*pp);
     }
+
+    sarray->count = 0;
+}
+
+/* hold the slice only when it is NOT freed */
+static inline bool slice_try_hold(OBSliceEntry *slice)
+{
+    int ref_count;
+
+    ref_count = __sync_add_and_fetch(&slice->ref_count, 0);
+    while (ref_count > 0) {
+        if (__sync_bool_compare_and_swap(&slice->ref_count,
+                    ref_count, ref_count + 1))
+        {
+            return true;
+        }
+        ref_count = __sync_add_and_fetch(&slice->ref_count, 0);
     }
+
+    return false;
 }
-*/
 
-static int get_slices(OBSharedContext *ctx, OBEntry *ob,
-        const FSBlockSliceKeyInfo *bs_key, OBSlicePtrArray *sarray)
+/* the lockless version of get_slices without the lock of the context,
+   return EAGAIN when the sequence changed and EBUSY when the locked
+   read is required */
+static int lockless_get_slices(OBHashtable *htable, OBSharedContext *ctx,
+        const FSBlockSliceKeyInfo *bs_key, OBSlicePtrArray *sarray,
+        const bool is_reclaim)
 {
-    UniqSkiplistNode *node;
-    UniqSkiplistNode *previous;
-    OBSliceEntry target;
+    OBEntry *ob;
+    OBSliceEntry **slices;
     OBSliceEntry *curr_slice;
+    int64_t seq;
+    int reclaiming_count;
+    int alloc;
+    int count;
     int slice_end;
     int curr_end;
-    int length;
+    int start;
+    int end;
+    int low;
+    int high;
+    int mid;
     int result;
 
-    //print_skiplist(ob);
-
-    target.ssize = bs_key->slice;
-
-    /*
-    logInfo("target slice.offset: %d, length: %d",
-            target.ssize.offset, target.ssize.length);
-            */
+    seq = __atomic_load_n(&ctx->seq, __ATOMIC_ACQUIRE);
+    if ((seq & 1) != 0) {
+        return EAGAIN;
+    }
 
-    node = uniq_skiplist_find_ge_node(ob->slices, &target);
-    if (node == NULL) {
-        previous = UNIQ_SKIPLIST_LEVEL0_TAIL_NODE(ob->slices);
+    if (htable->type == OB_HASHTABLE_TYPE_CHAIN) {
+        result = chain_lockless_get_ob_entry(htable, ctx,
+                seq, &bs_key->block, &ob);
     } else {
-        previous = UNIQ_SKIPLIST_LEVEL0_PREV_NODE(node);
+        result = open_lockless_get_ob_entry(htable, ctx,
+                seq, &bs_key->block, &ob);
+    }
+    if (result != 0) {
+        return result;
     }
 
-    slice_end = bs_key->slice.offset + bs_key->slice.length;
-
-    /*
-    logInfo("bs_key->slice.offset: %d, length: %d, slice_end: %d, ge "
-            "node: %p, top: %p", bs_key->slice.offset, bs_key->slice.length,
-            slice_end, node, ob->slices->top);
-            */
-
-    if (previous != ob->slices->top) {
-        curr_slice = (OBSliceEntry *)previous->data;
-        curr_end = curr_slice->ssize.offset + curr_slice->ssize.length;
-
-        /*
-        logInfo("previous slice.offset: %d, length: %d, curr_end: %d",
-                curr_slice->ssize.offset, curr_slice->ssize.length, curr_end);
-                */
-
-        if (curr_end > bs_key->slice.offset) {  //overlap
-            length = FC_MIN(curr_end, slice_end) - bs_key->slice.offset;
-            if ((result=dup_slice_to_array(ctx, curr_slice, bs_key->
-                            slice.offset, length, sarray)) != 0)
-            {
-                return result;
-            }
-        }
+    reclaiming_count = ob->reclaiming_count;
+    alloc = ob->slices.alloc;
+    count = ob->slices.count;
+    slices = (alloc > 0 ? ob->slices.array : ob->slices.inlines);
+    if (!lockless_read_valid(ctx, seq)) {
+        return EAGAIN;
+    }
+    if (alloc < 0 || (reclaiming_count > 0 && !is_reclaim)) {
+        return EBUSY;
     }
 
-    if (node == NULL) {
-        return sarray->count > 0 ? 0 : ENOENT;
+    /* search the first slice which end > offset as slice_map_find_overlaps */
+    slice_end = bs_key->slice.offset + bs_key->slice.length;
+    low = 0;
+    high = count;
+    while (low < high) {
+        mid = (low + high) / 2;
+        curr_slice = slices[mid];
+        if (!lockless_read_valid(ctx, seq)) {
+            return EAGAIN;
+        }
+        if (curr_slice->ssize.offset + curr_slice->ssize.length >
+                bs_key->slice.offset)
+        {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
     }
 
-    result = 0;
-    do {
-        curr_slice = (OBSliceEntry *)node->data;
-        if (slice_end <= curr_slice->ssize.offset) {  //not overlap
+    for (; low<count; low++) {
+        curr_slice = slices[low];
+        if (!lockless_read_valid(ctx, seq)) {
+            result = EAGAIN;
+            break;
+        }
+        if (curr_slice->ssize.offset >= slice_end) {
             break;
         }
 
         curr_end = curr_slice->ssize.offset + curr_slice->ssize.length;
-
-        /*
-        logInfo("current slice.offset: %d, length: %d, curr_end: %d",
-                curr_slice->ssize.offset, curr_slice->ssize.length, curr_end);
-                */
-
-        if (curr_end > slice_end) {  //the last slice
-            if ((result=dup_slice_to_array(ctx, curr_slice, curr_slice->
-                            ssize.offset, slice_end - curr_slice->
-                            ssize.offset, sarray)) != 0)
-            {
-                return result;
+        start = FC_MAX(curr_slice->ssize.offset, bs_key->slice.offset);
+        end = FC_MIN(curr_end, slice_end);
+        if (start == curr_slice->ssize.offset && end == curr_end) {
+            if (!slice_try_hold(curr_slice)) {
+                result = EAGAIN;
+                break;
             }
-        } else {
-            __sync_add_and_fetch(&curr_slice->ref_count, 1);
             if ((result=add_to_slice_ptr_array(sarray, curr_slice)) != 0) {
-                return result;
+                ob_index_free_slice(curr_slice);
+                break;
+            }
+        } else {
+            if ((result=dup_slice_to_array(ctx, curr_slice,
+                            start, end - start, sarray)) != 0)
+            {
+                break;
             }
         }
-
-        node = UNIQ_SKIPLIST_LEVEL0_NEXT_NODE(node);
-    } while (node != ob->slices->factory->tail);
-
-    return sarray->count > 0 ? 0 : ENOENT;
-}
-
-static void free_slices(OBSlicePtrArray *sarray)
-{
-    OBSliceEntry **pp;
-    OBSliceEntry **end;
-
-    if (sarray->count == 0) {
-        return;
     }
 
-    end = sarray->slices + sarray->count;
-    for (pp=sarray->slices; pp<end; pp++) {
-        ob_index_free_slice(*pp);
+    /* the held slices are the same as in the index
+       only when the sequence NOT changed */
+    if (result == 0 && !lockless_read_valid(ctx, seq)) {
+        result = EAGAIN;
     }
-
-    sarray->count = 0;
+    if (result != 0) {
+        free_slices(sarray);
+        return result;
+    }
+    return sarray->count > 0 ? 0 : ENOENT;
 }
 
 int ob_index_get_slices_ex(OBHashtable *htable,
@@ -1039,11 +2753,26 @@ int ob_index_get_slices_ex(OBHashtable *htable,
         OBSlicePtrArray *sarray, const bool is_reclaim)
 {
     OBEntry *ob;
+    int slot;
     int result;
+    int i;
 
-    OB_INDEX_SET_BUCKET_AND_CTX(htable, bs_key->block);
+    OB_INDEX_SET_HASHTABLE_CTX(htable, bs_key->block);
     sarray->count = 0;
 
+    slot = reader_enter(ctx);
+    for (i=0; i<OB_LOCKLESS_READ_TRIES; i++) {
+        result = lockless_get_slices(htable, ctx,
+                bs_key, sarray, is_reclaim);
+        if (result != EAGAIN) {
+            break;
+        }
+    }
+    reader_leave(ctx, slot);
+    if (result != EAGAIN && result != EBUSY) {
+        return result;
+    }
+
     /*
     logInfo("file: "__FILE__", line: %d, func: %s, "
             "block key: %"PRId64", offset: %"PRId64,
@@ -1051,7 +2780,7 @@ int ob_index_get_slices_ex(OBHashtable *htable,
             */
 
     OB_INDEX_SHARED_CTX_LOCK(htable, ctx);
-    ob = get_ob_entry(ctx, bucket, &bs_key->block, false);
+    ob = get_ob_entry(htable, ctx, &bs_key->block, false);
     if (ob == NULL) {
         result = ENOENT;
     } else {
@@ -1078,3 +2807,47 @@ void ob_index_get_ob_and_slice_counts(int64_t *ob_count, int64_t *slice_count)
         *slice_count += ctx->slice_allocator.info.element_used_count;
     }
 }
+
+static inline int64_t mblock_alloc_bytes(struct fast_mblock_man *mblock)
+{
+    return (int64_t)mblock->info.trunk_total_count * mblock->info.trunk_size;
+}
+
+void ob_index_get_memory_stat(FSIndexMemoryStat *stat)
+{
+    OBSharedContext *ctx;
+    OBSharedContext *end;
+    OBHashtable *htable;
+    int64_t resize_capacity;
+    int i;
+
+    memset(stat, 0, sizeof(*stat));
+    end = ob_shared_ctx_array.contexts + ob_shared_ctx_array.count;
+    for (ctx=ob_shared_ctx_array.contexts; ctx<end; ctx++) {
+        stat->ob_entries += mblock_alloc_bytes(&ctx->ob_allocator);
+        stat->slice_entries += mblock_alloc_bytes(&ctx->slice_allocator);
+        stat->slice_maps += ctx->slice_map_bytes + mblock_alloc_bytes(
+                &ctx->factory.skiplist_allocator);
+        for (i=0; i<ctx->factory.max_level_count; i++) {
+            stat->slice_maps += mblock_alloc_bytes(
+                    ctx->factory.node_allocators + i);
+        }
+    }
+
+    htable = &g_ob_hashtable;
+    if (htable->type == OB_HASHTABLE_TYPE_CHAIN) {
+        if (FC_ATOMIC_GET(htable->resize.buckets) != NULL) {
+            resize_capacity = FC_ATOMIC_GET(htable->resize.capacity);
+        } else {
+            resize_capacity = 0;
+        }
+        stat->hashtable = (FC_ATOMIC_GET(htable->capacity) +
+                resize_capacity) * sizeof(OBEntry *) +
+            sizeof(int64_t) * ob_shared_ctx_array.count;
+    } else {
+        for (i=0; i<ob_shared_ctx_array.count; i++) {
+            stat->hashtable += htable->shards[i].group_count *
+                sizeof(OBOpenGroup);
+        }
+    }
+}
@@ -28,6 +28,10 @@ extern "C" {
 #define ob_index_add_slice(slice, sn, inc_alloc, is_reclaim) \
     ob_index_add_slice_ex(&g_ob_hashtable, slice, sn, inc_alloc, is_reclaim)
 
+#define ob_index_add_slices(pairs, count, gen_sn, inc_alloc, is_reclaim) \
+    ob_index_add_slices_ex(&g_ob_hashtable, pairs, count, \
+            gen_sn, inc_alloc, is_reclaim)
+
 #define ob_index_delete_slices(bs_key, sn, dec_alloc, is_reclaim) \
     ob_index_delete_slices_ex(&g_ob_hashtable, bs_key, sn, dec_alloc, is_reclaim)
 
@@ -47,6 +51,17 @@ extern "C" {
     ob_index_init_htable_ex(ht, STORAGE_CFG.object_block.  \
             hashtable_capacity, false)
 
+#define OB_SLICE_MAP_ARRAY(map) ((map)->alloc == 0 ? \
+        (map)->inlines : (map)->array)
+
+    typedef int (*ob_index_walk_callback)(OBEntry *ob, void *args);
+
+    typedef struct {
+        const OBSliceMap *map;
+        int index;
+        UniqSkiplistIterator it;  //for skiplist
+    } OBSliceMapIterator;
+
     int ob_index_init();
     void ob_index_destroy();
 
@@ -54,9 +69,29 @@ extern "C" {
         const bool modify_sallocator);
     void ob_index_destroy_htable(OBHashtable *htable);
 
+    /* walk all object blocks of the hashtable without lock, the caller
+       MUST make sure that the hashtable is NOT modified concurrently,
+       the walk stops when the callback returns non-zero */
+    int ob_index_walk_htable(OBHashtable *htable,
+            ob_index_walk_callback callback, void *args);
+
+    int ob_index_get_shared_ctx_count();
+
+    /* walk the object blocks of one shared context with its lock held,
+       the callback MUST NOT modify the hashtable */
+    int ob_index_walk_shared_ctx(OBHashtable *htable, const int ctx_index,
+            ob_index_walk_callback callback, void *args);
+
     int ob_index_add_slice_ex(OBHashtable *htable, OBSliceEntry *slice,
             uint64_t *sn, int *inc_alloc, const bool is_reclaim);
 
+    /* add the slices of the same object block in order with one lock,
+       the sn of each pair is generated when gen_sn is true,
+       the slices before the failed one are kept in the index */
+    int ob_index_add_slices_ex(OBHashtable *htable, FSSliceSNPair *pairs,
+            const int count, const bool gen_sn, int *inc_alloc,
+            const bool is_reclaim);
+
     int ob_index_delete_slices_ex(OBHashtable *htable,
             const FSBlockSliceKeyInfo *bs_key, uint64_t *sn,
             int *dec_alloc, const bool is_reclaim);
@@ -94,6 +129,18 @@ extern "C" {
 
     int ob_index_add_slice_by_binlog(OBSliceEntry *slice);
 
+    //the slices MUST belong to the same object block
+    int ob_index_add_slices_by_binlog(OBSliceEntry **slices,
+            const int count);
+
+    /* merge the slices which are adjacent in the object block and
+       contiguous in the same trunk file for the shared context,
+       the merged slices with the generated sn are returned in sarray,
+       the caller MUST log them to the slice binlog and free them
+       slice_count: return the count of the slices merged */
+    int ob_index_merge_slices(const int ctx_index,
+            FSSliceSNPairArray *sarray, int64_t *slice_count);
+
     static inline int ob_index_delete_slices_by_binlog(
             const FSBlockSliceKeyInfo *bs_key)
     {
@@ -126,12 +173,56 @@ extern "C" {
         return fc_compare_int64(bkey1->offset, bkey2->offset);
     }
 
+    static inline const char *ob_index_get_hashtable_type_caption(
+            const int type)
+    {
+        switch (type) {
+            case OB_HASHTABLE_TYPE_CHAIN:
+                return "chain";
+            case OB_HASHTABLE_TYPE_OPEN_ADDRESSING:
+                return "open_addressing";
+            default:
+                return "unknown";
+        }
+    }
+
+    static inline bool ob_slice_map_empty(const OBSliceMap *map)
+    {
+        return map->count == 0;
+    }
+
+    static inline void ob_slice_map_iterator(const OBSliceMap *map,
+            OBSliceMapIterator *iterator)
+    {
+        iterator->map = map;
+        iterator->index = 0;
+        if (map->alloc < 0) {
+            uniq_skiplist_iterator(map->skiplist, &iterator->it);
+        }
+    }
+
+    /* return the next slice in offset order, NULL for the end */
+    static inline OBSliceEntry *ob_slice_map_next(OBSliceMapIterator *iterator)
+    {
+        if (iterator->map->alloc < 0) {
+            return (OBSliceEntry *)uniq_skiplist_next(&iterator->it);
+        }
+
+        if (iterator->index >= iterator->map->count) {
+            return NULL;
+        }
+        return OB_SLICE_MAP_ARRAY(iterator->map)[iterator->index++];
+    }
+
     OBEntry *ob_index_reclaim_lock(const FSBlockKey *bkey);
     void ob_index_reclaim_unlock(OBEntry *ob);
 
     void ob_index_get_ob_and_slice_counts(int64_t *ob_count,
             int64_t *slice_count);
 
+    //the allocated memory of the index, the values are approximate
+    void ob_index_get_memory_stat(FSIndexMemoryStat *stat);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,509 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/fc_list.h"
+#include "fastcommon/pthread_func.h"
+#include "sf/sf_global.h"
+#include "../server_global.h"
+#include "read_cache.h"
+
+#define READ_CACHE_REGION_BITS      20  //the hash unit of the trunk space
+#define READ_CACHE_SMALL_PERCENT    10  //the small FIFO of S3-FIFO
+#define READ_CACHE_MAX_FREQ          3
+#define READ_CACHE_GHOST_MIN_COUNT  64
+#define READ_CACHE_AVG_SLICE_SIZE   (64 * 1024)  //for the bucket count
+
+#define READ_CACHE_QUEUE_SMALL  'S'
+#define READ_CACHE_QUEUE_MAIN   'M'
+#define READ_CACHE_QUEUE_GHOST  'G'  //the evicted keys without data
+
+typedef struct read_cache_entry {
+    int64_t trunk_id;
+    int64_t offset;
+    int length;
+    volatile int ref_count;  //the cache holds one, freed when 0
+    char queue;
+    char freq;
+    char *data;  //NULL for ghost
+    struct read_cache_entry *next;  //for hashtable
+    struct fc_list_head dlink;      //for FIFO queue, the oldest first
+} ReadCacheEntry;
+
+typedef struct read_cache_queue {
+    int count;
+    int64_t bytes;
+    struct fc_list_head head;
+} ReadCacheQueue;
+
+typedef struct read_cache_shard {
+    pthread_mutex_t lock;
+    int64_t capacity;  //in bytes
+    ReadCacheQueue small;
+    ReadCacheQueue main;
+    ReadCacheQueue ghost;
+    struct {
+        int capacity;
+        ReadCacheEntry **buckets;
+    } htable;
+    struct {
+        int64_t hit_count;
+        int64_t miss_count;
+        int64_t evict_count;
+    } stat;
+} ReadCacheShard;
+
+typedef struct read_cache_context {
+    int count;
+    ReadCacheShard *shards;
+} ReadCacheContext;
+
+static ReadCacheContext read_cache_ctx = {0, NULL};
+volatile int64_t g_read_cache_version = 0;
+
+static inline uint64_t read_cache_region_hash(const int64_t trunk_id,
+        const int64_t region)
+{
+    return (uint64_t)trunk_id * 1000003 + (uint64_t)region;
+}
+
+static inline ReadCacheShard *read_cache_get_shard(const int64_t trunk_id,
+        const int64_t offset, ReadCacheEntry ***bucket)
+{
+    uint64_t hash_code;
+    ReadCacheShard *shard;
+
+    hash_code = read_cache_region_hash(trunk_id,
+            offset >> READ_CACHE_REGION_BITS);
+    shard = read_cache_ctx.shards + hash_code % read_cache_ctx.count;
+    *bucket = shard->htable.buckets + (hash_code / read_cache_ctx.count) %
+        shard->htable.capacity;
+    return shard;
+}
+
+static int init_shard(ReadCacheShard *shard, const int64_t capacity)
+{
+    int result;
+    int bytes;
+
+    if ((result=init_pthread_lock(&shard->lock)) != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "init_pthread_lock fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+
+    shard->capacity = capacity;
+    FC_INIT_LIST_HEAD(&shard->small.head);
+    FC_INIT_LIST_HEAD(&shard->main.head);
+    FC_INIT_LIST_HEAD(&shard->ghost.head);
+
+    //the ghost keys as many as the cached slices
+    shard->htable.capacity = 2 * (capacity / READ_CACHE_AVG_SLICE_SIZE);
+    if (shard->htable.capacity < 1024) {
+        shard->htable.capacity = 1024;
+    }
+    bytes = sizeof(ReadCacheEntry *) * shard->htable.capacity;
+    shard->htable.buckets = (ReadCacheEntry **)fc_malloc(bytes);
+    if (shard->htable.buckets == NULL) {
+        return ENOMEM;
+    }
+    memset(shard->htable.buckets, 0, bytes);
+    return 0;
+}
+
+int read_cache_init()
+{
+    int result;
+    int bytes;
+    int64_t capacity;
+    ReadCacheShard *shard;
+    ReadCacheShard *end;
+
+    if (STORAGE_CFG.read_cache.capacity <= 0) {
+        return 0;
+    }
+
+    bytes = sizeof(ReadCacheShard) * STORAGE_CFG.read_cache.shard_count;
+    read_cache_ctx.shards = (ReadCacheShard *)fc_malloc(bytes);
+    if (read_cache_ctx.shards == NULL) {
+        return ENOMEM;
+    }
+    memset(read_cache_ctx.shards, 0, bytes);
+
+    capacity = STORAGE_CFG.read_cache.capacity /
+        STORAGE_CFG.read_cache.shard_count;
+    end = read_cache_ctx.shards + STORAGE_CFG.read_cache.shard_count;
+    for (shard=read_cache_ctx.shards; shard<end; shard++) {
+        if ((result=init_shard(shard, capacity)) != 0) {
+            return result;
+        }
+    }
+
+    read_cache_ctx.count = STORAGE_CFG.read_cache.shard_count;
+    return 0;
+}
+
+static inline ReadCacheEntry *read_cache_find(ReadCacheEntry **bucket,
+        const int64_t trunk_id, const int64_t offset, const int length)
+{
+    ReadCacheEntry *entry;
+
+    entry = *bucket;
+    while (entry != NULL) {
+        if (entry->trunk_id == trunk_id && entry->offset == offset &&
+                entry->length == length)
+        {
+            return entry;
+        }
+        entry = entry->next;
+    }
+
+    return NULL;
+}
+
+static inline void read_cache_release(ReadCacheEntry *entry)
+{
+    if (__sync_sub_and_fetch(&entry->ref_count, 1) == 0) {
+        free(entry);
+    }
+}
+
+static inline ReadCacheQueue *read_cache_get_queue(
+        ReadCacheShard *shard, ReadCacheEntry *entry)
+{
+    switch (entry->queue) {
+        case READ_CACHE_QUEUE_SMALL:
+            return &shard->small;
+        case READ_CACHE_QUEUE_MAIN:
+            return &shard->main;
+        default:
+            return &shard->ghost;
+    }
+}
+
+static inline void read_cache_enqueue(ReadCacheShard *shard,
+        ReadCacheEntry *entry, const char queue_type)
+{
+    ReadCacheQueue *queue;
+
+    entry->queue = queue_type;
+    queue = read_cache_get_queue(shard, entry);
+    fc_list_add_tail(&entry->dlink, &queue->head);
+    queue->count++;
+    if (entry->data != NULL) {
+        queue->bytes += entry->length;
+    }
+}
+
+static inline void read_cache_dequeue(ReadCacheShard *shard,
+        ReadCacheEntry *entry)
+{
+    ReadCacheQueue *queue;
+
+    queue = read_cache_get_queue(shard, entry);
+    fc_list_del_init(&entry->dlink);
+    queue->count--;
+    if (entry->data != NULL) {
+        queue->bytes -= entry->length;
+    }
+}
+
+static void read_cache_remove(ReadCacheShard *shard, ReadCacheEntry *entry)
+{
+    ReadCacheEntry **bucket;
+    ReadCacheEntry **pp;
+
+    read_cache_get_shard(entry->trunk_id, entry->offset, &bucket);
+    for (pp=bucket; *pp!=NULL; pp=&(*pp)->next) {
+        if (*pp == entry) {
+            *pp = entry->next;
+            break;
+        }
+    }
+
+    read_cache_dequeue(shard, entry);
+    read_cache_release(entry);
+}
+
+static inline ReadCacheEntry *read_cache_alloc_entry(const int64_t trunk_id,
+        const int64_t offset, const int length, const char *data)
+{
+    ReadCacheEntry *entry;
+
+    entry = (ReadCacheEntry *)fc_malloc(sizeof(ReadCacheEntry) +
+            (data != NULL ? length : 0));
+    if (entry == NULL) {
+        return NULL;
+    }
+
+    entry->trunk_id = trunk_id;
+    entry->offset = offset;
+    entry->length = length;
+    entry->ref_count = 1;
+    entry->freq = 0;
+    if (data != NULL) {
+        entry->data = (char *)(entry + 1);
+        memcpy(entry->data, data, length);
+    } else {
+        entry->data = NULL;
+    }
+    return entry;
+}
+
+static inline void read_cache_insert(ReadCacheShard *shard,
+        ReadCacheEntry **bucket, ReadCacheEntry *entry,
+        const char queue_type)
+{
+    entry->next = *bucket;
+    *bucket = entry;
+    read_cache_enqueue(shard, entry, queue_type);
+}
+
+//keep the key only after the data evicted from the small FIFO
+static void read_cache_to_ghost(ReadCacheShard *shard,
+        ReadCacheEntry *entry)
+{
+    ReadCacheEntry **bucket;
+    ReadCacheEntry *ghost;
+    int max_count;
+
+    ghost = read_cache_alloc_entry(entry->trunk_id,
+            entry->offset, entry->length, NULL);
+    read_cache_remove(shard, entry);
+    if (ghost == NULL) {
+        return;
+    }
+
+    read_cache_get_shard(ghost->trunk_id, ghost->offset, &bucket);
+    read_cache_insert(shard, bucket, ghost, READ_CACHE_QUEUE_GHOST);
+    max_count = (shard->main.count > READ_CACHE_GHOST_MIN_COUNT ?
+            shard->main.count : READ_CACHE_GHOST_MIN_COUNT);
+    while (shard->ghost.count > max_count) {
+        read_cache_remove(shard, fc_list_first_entry(&shard->ghost.head,
+                    ReadCacheEntry, dlink));
+    }
+}
+
+/* S3-FIFO: the new slices enter the small FIFO, the ones accessed again
+   are promoted to the main FIFO, and the others leave their keys in the
+   ghost FIFO. the main FIFO reinserts the accessed ones as CLOCK */
+static void read_cache_evict(ReadCacheShard *shard)
+{
+    ReadCacheEntry *entry;
+
+    while (shard->small.bytes + shard->main.bytes > shard->capacity) {
+        if (shard->small.bytes > shard->capacity *
+                READ_CACHE_SMALL_PERCENT / 100 ||
+                fc_list_empty(&shard->main.head))
+        {
+            entry = fc_list_first_entry(&shard->small.head,
+                    ReadCacheEntry, dlink);
+            if (entry->freq > 0) {
+                read_cache_dequeue(shard, entry);
+                entry->freq = 0;
+                read_cache_enqueue(shard, entry, READ_CACHE_QUEUE_MAIN);
+            } else {
+                read_cache_to_ghost(shard, entry);
+                shard->stat.evict_count++;
+            }
+        } else {
+            entry = fc_list_first_entry(&shard->main.head,
+                    ReadCacheEntry, dlink);
+            if (entry->freq > 0) {
+                read_cache_dequeue(shard, entry);
+                entry->freq--;
+                read_cache_enqueue(shard, entry, READ_CACHE_QUEUE_MAIN);
+            } else {
+                read_cache_remove(shard, entry);
+                shard->stat.evict_count++;
+            }
+        }
+    }
+}
+
+bool read_cache_get(const OBSliceEntry *slice, char *buff)
+{
+    ReadCacheShard *shard;
+    ReadCacheEntry **bucket;
+    ReadCacheEntry *entry;
+
+    if (read_cache_ctx.count == 0) {
+        return false;
+    }
+
+    shard = read_cache_get_shard(slice->space.id_info.id,
+            slice->space.offset, &bucket);
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    entry = read_cache_find(bucket, slice->space.id_info.id,
+            slice->space.offset, slice->ssize.length);
+    if (entry != NULL && entry->data != NULL) {
+        if (entry->freq < READ_CACHE_MAX_FREQ) {
+            entry->freq++;
+        }
+        __sync_add_and_fetch(&entry->ref_count, 1);
+        shard->stat.hit_count++;
+    } else {
+        entry = NULL;
+        shard->stat.miss_count++;
+    }
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
+
+    if (entry == NULL) {
+        return false;
+    }
+
+    //copy without lock, the entry is freed by the last one
+    memcpy(buff, entry->data, entry->length);
+    read_cache_release(entry);
+    return true;
+}
+
+void read_cache_add(const OBSliceEntry *slice,
+        const char *data, const int64_t version)
+{
+    ReadCacheShard *shard;
+    ReadCacheEntry **bucket;
+    ReadCacheEntry *entry;
+    ReadCacheEntry *old;
+    char queue_type;
+
+    if (read_cache_ctx.count == 0) {
+        return;
+    }
+
+    shard = read_cache_get_shard(slice->space.id_info.id,
+            slice->space.offset, &bucket);
+    if (slice->ssize.length > shard->capacity / 4) {
+        return;
+    }
+
+    if ((entry=read_cache_alloc_entry(slice->space.id_info.id,
+                    slice->space.offset, slice->ssize.length,
+                    data)) == NULL)
+    {
+        return;
+    }
+
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    do {
+        //the trunk space maybe reused during the read
+        if (version != FC_ATOMIC_GET(g_read_cache_version)) {
+            break;
+        }
+
+        old = read_cache_find(bucket, entry->trunk_id,
+                entry->offset, entry->length);
+        if (old == NULL) {
+            queue_type = READ_CACHE_QUEUE_SMALL;
+        } else if (old->queue == READ_CACHE_QUEUE_GHOST) {
+            read_cache_remove(shard, old);
+            queue_type = READ_CACHE_QUEUE_MAIN;
+        } else {
+            break;  //already cached
+        }
+
+        read_cache_insert(shard, bucket, entry, queue_type);
+        read_cache_evict(shard);
+        entry = NULL;
+    } while (0);
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
+
+    if (entry != NULL) {
+        free(entry);
+    }
+}
+
+static void invalidate_region(const int64_t trunk_id, const int64_t region,
+        const int64_t offset, const int64_t end_offset)
+{
+    ReadCacheShard *shard;
+    ReadCacheEntry **bucket;
+    ReadCacheEntry *entry;
+    ReadCacheEntry *next;
+
+    shard = read_cache_get_shard(trunk_id, region <<
+            READ_CACHE_REGION_BITS, &bucket);
+    PTHREAD_MUTEX_LOCK(&shard->lock);
+    entry = *bucket;
+    while (entry != NULL) {
+        next = entry->next;
+        if (entry->trunk_id == trunk_id && entry->offset < end_offset &&
+                entry->offset + entry->length > offset)
+        {
+            read_cache_remove(shard, entry);
+        }
+        entry = next;
+    }
+    PTHREAD_MUTEX_UNLOCK(&shard->lock);
+}
+
+void read_cache_invalidate(const int64_t trunk_id,
+        const int64_t offset, const int64_t size)
+{
+    int64_t start_offset;
+    int64_t start_region;
+    int64_t end_region;
+    int64_t region;
+
+    if (read_cache_ctx.count == 0 || size <= 0) {
+        return;
+    }
+
+    //the cached slice starts at most one block before
+    start_offset = offset - FS_FILE_BLOCK_SIZE + 1;
+    if (start_offset < 0) {
+        start_offset = 0;
+    }
+    start_region = start_offset >> READ_CACHE_REGION_BITS;
+    end_region = (offset + size - 1) >> READ_CACHE_REGION_BITS;
+    for (region=start_region; region<=end_region; region++) {
+        invalidate_region(trunk_id, region, offset, offset + size);
+    }
+}
+
+void read_cache_invalidate_trunk(const int64_t trunk_id,
+        const int64_t trunk_size)
+{
+    /* refuse the adding of the reads before, and the zero copy sender
+       checks the version even when the read cache disabled */
+    __sync_add_and_fetch(&g_read_cache_version, 1);
+    if (read_cache_ctx.count == 0) {
+        return;
+    }
+
+    read_cache_invalidate(trunk_id, 0, trunk_size);
+}
+
+void read_cache_get_stat(FSReadCacheStat *stat)
+{
+    ReadCacheShard *shard;
+    ReadCacheShard *end;
+
+    memset(stat, 0, sizeof(*stat));
+    stat->capacity = STORAGE_CFG.read_cache.capacity;
+    end = read_cache_ctx.shards + read_cache_ctx.count;
+    for (shard=read_cache_ctx.shards; shard<end; shard++) {
+        PTHREAD_MUTEX_LOCK(&shard->lock);
+        stat->used += shard->small.bytes + shard->main.bytes;
+        stat->count += shard->small.count + shard->main.count;
+        stat->hit_count += shard->stat.hit_count;
+        stat->miss_count += shard->stat.miss_count;
+        stat->evict_count += shard->stat.evict_count;
+        PTHREAD_MUTEX_UNLOCK(&shard->lock);
+    }
+}
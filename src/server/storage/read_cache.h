@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef _READ_CACHE_H
+#define _READ_CACHE_H
+
+#include "../../common/fs_types.h"
+#include "storage_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    extern volatile int64_t g_read_cache_version;
+
+    /* the hot slice read cache keyed by the trunk space,
+       sharded and evicted by S3-FIFO */
+    int read_cache_init();
+
+    static inline int64_t read_cache_get_version()
+    {
+        return __sync_add_and_fetch(&g_read_cache_version, 0);
+    }
+
+    /* copy the cached data to the buffer on hit
+       return true for hit, false for miss */
+    bool read_cache_get(const OBSliceEntry *slice, char *buff);
+
+    /* version: the cache version when the read starts,
+       do NOT add when the version changed */
+    void read_cache_add(const OBSliceEntry *slice,
+            const char *data, const int64_t version);
+
+    //invalidate the cached data overlapped with the trunk space
+    void read_cache_invalidate(const int64_t trunk_id,
+            const int64_t offset, const int64_t size);
+
+    //call before the space of the trunk reused
+    void read_cache_invalidate_trunk(const int64_t trunk_id,
+            const int64_t trunk_size);
+
+    void read_cache_get_stat(FSReadCacheStat *stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
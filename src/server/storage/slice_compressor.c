@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#ifdef FS_WITH_LZ4
+#include <lz4.h>
+#endif
+#ifdef FS_WITH_ZSTD
+#include <zstd.h>
+#endif
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/fc_queue.h"
+#include "fastcommon/pthread_func.h"
+#include "sf/sf_global.h"
+#include "../server_global.h"
+#include "../dio/trunk_io_thread.h"
+#include "slice_compressor.h"
+
+/* the middle part of the large slice is compressed first for
+   detecting the incompressible data early */
+#define COMPRESS_SAMPLE_SIZE        (16 * 1024)
+#define COMPRESS_SAMPLE_MIN_LENGTH  (4 * COMPRESS_SAMPLE_SIZE)
+
+/* the compressed data is stored only when saving 1/8 at least */
+#define COMPRESS_MAX_OUT_LENGTH(length)  ((length) - (length) / 8)
+
+#define COMPRESSOR_BUFFER_MIN_SIZE  (256 * 1024)
+
+typedef struct {
+    char *buff;
+    int size;
+} CompressorBuffer;
+
+typedef struct {
+    struct fc_queue queue;
+} DecompressThread;
+
+typedef struct {
+    DecompressThread *threads;
+    int thread_count;
+    volatile int next_thread;  //for round robin
+} SliceCompressorContext;
+
+static SliceCompressorContext compressor_ctx;
+
+static __thread CompressorBuffer decode_buffer = {NULL, 0};
+static __thread CompressorBuffer read_buffer = {NULL, 0};
+static __thread CompressorBuffer load_buffer = {NULL, 0};
+
+#ifdef FS_WITH_ZSTD
+static __thread ZSTD_CCtx *zstd_cctx = NULL;
+static __thread ZSTD_DCtx *zstd_dctx = NULL;
+#endif
+
+static char *get_thread_buffer(CompressorBuffer *buffer, const int size)
+{
+    char *buff;
+    int alloc_size;
+
+    if (buffer->size >= size) {
+        return buffer->buff;
+    }
+
+    alloc_size = FC_MAX(size, COMPRESSOR_BUFFER_MIN_SIZE);
+    if ((buff=(char *)fc_malloc(alloc_size)) == NULL) {
+        return NULL;
+    }
+
+    if (buffer->buff != NULL) {
+        free(buffer->buff);
+    }
+    buffer->buff = buff;
+    buffer->size = alloc_size;
+    return buff;
+}
+
+int slice_compressor_get_type(const char *name)
+{
+    if (name == NULL || *name == '\0' || strcasecmp(name, "none") == 0) {
+        return FS_COMPRESS_TYPE_NONE;
+    } else if (strcasecmp(name, "lz4") == 0) {
+#ifdef FS_WITH_LZ4
+        return FS_COMPRESS_TYPE_LZ4;
+#else
+        return -EOPNOTSUPP;
+#endif
+    } else if (strcasecmp(name, "zstd") == 0) {
+#ifdef FS_WITH_ZSTD
+        return FS_COMPRESS_TYPE_ZSTD;
+#else
+        return -EOPNOTSUPP;
+#endif
+    } else {
+        return -ENOENT;
+    }
+}
+
+const char *slice_compressor_get_caption(const int type)
+{
+    switch (type) {
+        case FS_COMPRESS_TYPE_NONE:
+            return "none";
+        case FS_COMPRESS_TYPE_LZ4:
+            return "lz4";
+        case FS_COMPRESS_TYPE_ZSTD:
+            return "zstd";
+        default:
+            return "unknown";
+    }
+}
+
+/* return the compressed length, 0 for fail or the capacity is not enough */
+static int do_compress(const int type, const int level, const char *data,
+        const int length, char *out_buff, const int capacity)
+{
+#ifdef FS_WITH_ZSTD
+    size_t bytes;
+#endif
+
+    switch (type) {
+#ifdef FS_WITH_LZ4
+        case FS_COMPRESS_TYPE_LZ4:
+            return LZ4_compress_default(data, out_buff, length, capacity);
+#endif
+#ifdef FS_WITH_ZSTD
+        case FS_COMPRESS_TYPE_ZSTD:
+            if (zstd_cctx == NULL && (zstd_cctx=ZSTD_createCCtx()) == NULL) {
+                logError("file: "__FILE__", line: %d, "
+                        "ZSTD_createCCtx fail", __LINE__);
+                return 0;
+            }
+            bytes = ZSTD_compressCCtx(zstd_cctx, out_buff,
+                    capacity, data, length, level);
+            return ZSTD_isError(bytes) ? 0 : bytes;
+#endif
+        default:
+            return 0;
+    }
+}
+
+int slice_compressor_compress(const int type, const char *data,
+        const int length, char **out_buff, int *out_length)
+{
+    const int sample_level = 1;
+    char sample_buff[COMPRESS_MAX_OUT_LENGTH(COMPRESS_SAMPLE_SIZE)];
+    char *buff;
+    int capacity;
+
+    if (length >= COMPRESS_SAMPLE_MIN_LENGTH) {
+        if (do_compress(type, sample_level, data + (length -
+                        COMPRESS_SAMPLE_SIZE) / 2, COMPRESS_SAMPLE_SIZE,
+                    sample_buff, sizeof(sample_buff)) == 0)
+        {
+            return ENODATA;
+        }
+    }
+
+    capacity = COMPRESS_MAX_OUT_LENGTH(length);
+    if ((buff=(char *)fc_malloc(capacity)) == NULL) {
+        return ENOMEM;
+    }
+
+    if ((*out_length=do_compress(type, STORAGE_CFG.compression.zstd_level,
+                    data, length, buff, capacity)) == 0)
+    {
+        free(buff);
+        return ENODATA;
+    }
+
+    *out_buff = buff;
+    return 0;
+}
+
+#ifdef FS_WITH_ZSTD
+/* the streaming decompression stops when the output buffer is full,
+   so the tail of the frame after the slice window is NOT decoded */
+static int zstd_decompress(const char *data, const int length,
+        char *out_buff, const int out_length)
+{
+    ZSTD_inBuffer input;
+    ZSTD_outBuffer output;
+    size_t last_pos;
+    size_t ret;
+
+    if (zstd_dctx == NULL && (zstd_dctx=ZSTD_createDCtx()) == NULL) {
+        logError("file: "__FILE__", line: %d, "
+                "ZSTD_createDCtx fail", __LINE__);
+        return -1;
+    }
+
+    ZSTD_DCtx_reset(zstd_dctx, ZSTD_reset_session_only);
+    input.src = data;
+    input.size = length;
+    input.pos = 0;
+    output.dst = out_buff;
+    output.size = out_length;
+    output.pos = 0;
+    do {
+        last_pos = output.pos;
+        ret = ZSTD_decompressStream(zstd_dctx, &output, &input);
+        if (ZSTD_isError(ret)) {
+            return -1;
+        }
+    } while (ret != 0 && output.pos < output.size &&
+            (output.pos > last_pos || input.pos < input.size));
+
+    return output.pos;
+}
+#endif
+
+int slice_compressor_decompress(const OBSliceEntry *slice,
+        const char *data, char *dest)
+{
+    int raw_length;
+    int bytes;
+    char *out_buff;
+
+    raw_length = slice->compress.offset + slice->ssize.length;
+    if (slice->compress.offset == 0) {
+        out_buff = dest;
+    } else if ((out_buff=get_thread_buffer(&decode_buffer,
+                    raw_length)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    switch (slice->compress.type) {
+#ifdef FS_WITH_LZ4
+        case FS_COMPRESS_TYPE_LZ4:
+            bytes = LZ4_decompress_safe_partial(data, out_buff,
+                    slice->compress.length, raw_length, raw_length);
+            break;
+#endif
+#ifdef FS_WITH_ZSTD
+        case FS_COMPRESS_TYPE_ZSTD:
+            bytes = zstd_decompress(data, slice->compress.length,
+                    out_buff, raw_length);
+            break;
+#endif
+        default:
+            logError("file: "__FILE__", line: %d, "
+                    "unsupported compress type: %d (%s)", __LINE__,
+                    slice->compress.type, slice_compressor_get_caption(
+                        slice->compress.type));
+            return EOPNOTSUPP;
+    }
+
+    if (bytes != raw_length) {
+        logError("file: "__FILE__", line: %d, "
+                "decompress slice fail, oid: %"PRId64", "
+                "block offset: %"PRId64", slice offset: %d, length: %d, "
+                "compress type: %s, compressed length: %d, "
+                "decompressed bytes: %d != expect: %d", __LINE__,
+                slice->ob->bkey.oid, slice->ob->bkey.offset,
+                slice->ssize.offset, slice->ssize.length,
+                slice_compressor_get_caption(slice->compress.type),
+                slice->compress.length, bytes, raw_length);
+        return EIO;
+    }
+
+    if (out_buff != dest) {
+        memcpy(dest, out_buff + slice->compress.offset,
+                slice->ssize.length);
+    }
+    return 0;
+}
+
+static int pread_data(const int fd, const char *filename,
+        char *buff, const int length, const int64_t offset)
+{
+    int result;
+    int done;
+    ssize_t bytes;
+
+    done = 0;
+    while (done < length) {
+        if ((bytes=pread(fd, buff + done, length - done,
+                        offset + done)) < 0)
+        {
+            result = errno != 0 ? errno : EIO;
+            if (result == EINTR) {
+                continue;
+            }
+            logError("file: "__FILE__", line: %d, "
+                    "read file \"%s\" fail, offset: %"PRId64", "
+                    "errno: %d, error info: %s", __LINE__, filename,
+                    offset + done, result, STRERROR(result));
+            return result;
+        } else if (bytes == 0) {
+            logError("file: "__FILE__", line: %d, "
+                    "read file \"%s\" fail, offset: %"PRId64", "
+                    "reach the end of file", __LINE__,
+                    filename, offset + done);
+            return ENODATA;
+        }
+
+        done += bytes;
+    }
+
+    return 0;
+}
+
+/* the trunk fd of the O_DIRECT path is NOT used because the
+   compressed data is not aligned */
+static int read_compressed_data(const OBSliceEntry *slice, char *buff)
+{
+    TrunkFDCacheEntry *entry;
+    char trunk_filename[PATH_MAX];
+    int fd;
+    int result;
+
+    trunk_io_thread_get_filename(&slice->space,
+            trunk_filename, sizeof(trunk_filename));
+    if (!PATHS_BY_INDEX_PPTR[slice->space.store->index]->direct_io &&
+            (entry=trunk_fd_cache_get(slice->space.id_info.id)) != NULL)
+    {
+        result = pread_data(entry->pair.fd, trunk_filename, buff,
+                slice->compress.length, slice->space.offset);
+        trunk_fd_cache_release(entry);
+        return result;
+    }
+
+    if ((fd=open(trunk_filename, O_RDONLY)) < 0) {
+        result = errno != 0 ? errno : EACCES;
+        logError("file: "__FILE__", line: %d, "
+                "open file \"%s\" fail, errno: %d, error info: %s",
+                __LINE__, trunk_filename, result, STRERROR(result));
+        return result;
+    }
+
+    result = pread_data(fd, trunk_filename, buff,
+            slice->compress.length, slice->space.offset);
+    close(fd);
+    return result;
+}
+
+int slice_compressor_load_slice(const OBSliceEntry *slice, char **data)
+{
+    char *compressed;
+    int result;
+
+    if ((compressed=get_thread_buffer(&read_buffer,
+                    slice->compress.length)) == NULL)
+    {
+        return ENOMEM;
+    }
+    if ((*data=get_thread_buffer(&load_buffer,
+                    slice->ssize.length)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    if ((result=read_compressed_data(slice, compressed)) != 0) {
+        return result;
+    }
+    return slice_compressor_decompress(slice, compressed, *data);
+}
+
+FSDecompressTask *slice_compressor_alloc_task(OBSliceEntry *slice,
+        char *dest, fs_decompress_done_func done, void *arg)
+{
+    FSDecompressTask *task;
+
+    task = (FSDecompressTask *)fc_malloc(sizeof(FSDecompressTask) +
+            slice->compress.length);
+    if (task == NULL) {
+        return NULL;
+    }
+
+    task->slice = slice;
+    task->dest = dest;
+    task->result = 0;
+    task->done = done;
+    task->arg = arg;
+    return task;
+}
+
+void slice_compressor_push(FSDecompressTask *task)
+{
+    DecompressThread *thread;
+
+    thread = compressor_ctx.threads + (unsigned int)__sync_fetch_and_add(
+            &compressor_ctx.next_thread, 1) % compressor_ctx.thread_count;
+    fc_queue_push(&thread->queue, task);
+}
+
+static void *decompress_thread_func(void *arg)
+{
+    DecompressThread *thread;
+    FSDecompressTask *head;
+    FSDecompressTask *task;
+
+    thread = (DecompressThread *)arg;
+    while (SF_G_CONTINUE_FLAG) {
+        head = (FSDecompressTask *)fc_queue_pop_all(&thread->queue);
+        while (head != NULL) {
+            task = head;
+            head = head->next;
+
+            task->result = slice_compressor_decompress(
+                    task->slice, task->data, task->dest);
+            task->done(task);
+        }
+    }
+
+    return NULL;
+}
+
+/* the decompress threads are always started because the compressed
+   slices are kept after the compression disabled */
+int slice_compressor_init()
+{
+    int result;
+    int bytes;
+    pthread_t tid;
+    DecompressThread *thread;
+    DecompressThread *end;
+
+    compressor_ctx.thread_count = STORAGE_CFG.compression.decompress_threads;
+    bytes = sizeof(DecompressThread) * compressor_ctx.thread_count;
+    if ((compressor_ctx.threads=(DecompressThread *)fc_malloc(
+                    bytes)) == NULL)
+    {
+        return ENOMEM;
+    }
+    memset(compressor_ctx.threads, 0, bytes);
+
+    end = compressor_ctx.threads + compressor_ctx.thread_count;
+    for (thread=compressor_ctx.threads; thread<end; thread++) {
+        if ((result=fc_queue_init(&thread->queue, (long)
+                        (&((FSDecompressTask *)NULL)->next))) != 0)
+        {
+            return result;
+        }
+
+        if ((result=fc_create_thread(&tid, decompress_thread_func,
+                        thread, SF_G_THREAD_STACK_SIZE)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
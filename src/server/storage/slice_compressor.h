@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//slice_compressor.h
+
+#ifndef _SLICE_COMPRESSOR_H_
+#define _SLICE_COMPRESSOR_H_
+
+#include "storage_types.h"
+
+struct fs_decompress_task;
+typedef void (*fs_decompress_done_func)(struct fs_decompress_task *task);
+
+typedef struct fs_decompress_task {
+    OBSliceEntry *slice;
+    char *dest;   //the output buffer of the slice data
+    int result;
+    fs_decompress_done_func done;  //called in the decompress thread
+    void *arg;
+    struct fs_decompress_task *next;  //for queue
+    char data[0];  //the compressed data read from the trunk file
+} FSDecompressTask;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int slice_compressor_init();
+
+    /* return FS_COMPRESS_TYPE_xxx, -ENOENT for unknown name and
+       -EOPNOTSUPP when the server is built without the codec */
+    int slice_compressor_get_type(const char *name);
+
+    const char *slice_compressor_get_caption(const int type);
+
+    /* compress the slice data to the new allocated buffer,
+       return ENODATA when the data is incompressible */
+    int slice_compressor_compress(const int type, const char *data,
+            const int length, char **out_buff, int *out_length);
+
+    /* decompress the data of the slice window to the dest buffer */
+    int slice_compressor_decompress(const OBSliceEntry *slice,
+            const char *data, char *dest);
+
+    /* read and decompress the slice in the calling thread,
+       the output data is valid until the next call of the same thread */
+    int slice_compressor_load_slice(const OBSliceEntry *slice, char **data);
+
+    FSDecompressTask *slice_compressor_alloc_task(OBSliceEntry *slice,
+            char *dest, fs_decompress_done_func done, void *arg);
+
+    static inline void slice_compressor_free_task(FSDecompressTask *task)
+    {
+        free(task);
+    }
+
+    /* decompress the data of the task in the decompress thread */
+    void slice_compressor_push(FSDecompressTask *task);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/sched_thread.h"
+#include "sf/sf_global.h"
+#include "../server_global.h"
+#include "../shared_thread_pool.h"
+#include "../binlog/slice_binlog.h"
+#include "object_block_index.h"
+#include "slice_merge.h"
+
+typedef struct {
+    volatile bool in_progress;
+    FSSliceSNPairArray sarray;  //the merged slices of one shared context
+} SliceMergeContext;
+
+static SliceMergeContext merge_ctx;
+
+/* every merged slice MUST be logged because the binlog writer
+   writes the records in the order of the sn */
+static int log_merged_slices(FSSliceSNPairArray *sarray)
+{
+    FSSliceSNPair *pair;
+    FSSliceSNPair *end;
+    int result;
+    int r;
+
+    result = 0;
+    end = sarray->slice_sn_pairs + sarray->count;
+    for (pair=sarray->slice_sn_pairs; pair<end; pair++) {
+        if ((r=slice_binlog_log_add_slice(pair->slice, g_current_time,
+                        pair->sn, 0, BINLOG_SOURCE_MERGE)) != 0)
+        {
+            result = r;
+        }
+        ob_index_free_slice(pair->slice);
+    }
+    sarray->count = 0;
+    return result;
+}
+
+static void merge_thread_run(void *arg, void *thread_data)
+{
+    int64_t start_time;
+    int64_t slice_count;
+    int64_t total_slices;
+    int64_t merged_slices;
+    int ctx_count;
+    int result;
+    int r;
+    int i;
+
+    start_time = get_current_time_ms();
+    total_slices = merged_slices = 0;
+    result = 0;
+    ctx_count = ob_index_get_shared_ctx_count();
+    for (i=0; i<ctx_count && SF_G_CONTINUE_FLAG; i++) {
+        r = ob_index_merge_slices(i, &merge_ctx.sarray, &slice_count);
+        total_slices += slice_count;
+        merged_slices += merge_ctx.sarray.count;
+        if ((result=log_merged_slices(&merge_ctx.sarray)) == 0) {
+            result = r;
+        }
+        if (result != 0) {
+            break;
+        }
+    }
+
+    if (result != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "merge slices fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+    } else if (total_slices > 0) {
+        logInfo("file: "__FILE__", line: %d, "
+                "merge slices done, %"PRId64" slices merged to "
+                "%"PRId64", time used: %"PRId64" ms", __LINE__,
+                total_slices, merged_slices,
+                get_current_time_ms() - start_time);
+    }
+
+    merge_ctx.in_progress = false;
+}
+
+static int merge_schedule_func(void *args)
+{
+    if (__sync_bool_compare_and_swap(&merge_ctx.in_progress, false, true)) {
+        if (shared_thread_pool_run(merge_thread_run, NULL) != 0) {
+            merge_ctx.in_progress = false;
+        }
+    }
+
+    return 0;
+}
+
+int slice_merge_init()
+{
+    ScheduleEntry schedule_entry;
+    ScheduleArray schedule_array;
+
+    if (!STORAGE_CFG.slice_merge.enabled ||
+            STORAGE_CFG.slice_merge.interval <= 0)
+    {
+        return 0;
+    }
+
+    INIT_SCHEDULE_ENTRY(schedule_entry, sched_generate_next_id(),
+            0, 0, 0, STORAGE_CFG.slice_merge.interval,
+            merge_schedule_func, NULL);
+    schedule_array.count = 1;
+    schedule_array.entries = &schedule_entry;
+    return sched_add_entries(&schedule_array);
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//slice_merge.h
+
+#ifndef _SLICE_MERGE_H
+#define _SLICE_MERGE_H
+
+#include "storage_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* merge the slices which are adjacent in the object block and
+       contiguous in the same trunk file every slice_merge_interval
+       seconds, the merged slices are written to the slice binlog */
+    int slice_merge_init();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,12 +19,15 @@
 #include "fastcommon/logger.h"
 #include "sf/sf_global.h"
 #include "../common/fs_proto.h"
+#include "../common/fs_crc32c.h"
 #include "../server_global.h"
 #include "../data_thread.h"
 #include "../dio/trunk_io_thread.h"
 #include "../binlog/slice_binlog.h"
 #include "../binlog/replica_binlog.h"
 #include "storage_allocator.h"
+#include "read_cache.h"
+#include "slice_compressor.h"
 #include "slice_op.h"
 
 static int realloc_slice_sn_pairs(FSSliceSNPairArray *parray,
@@ -121,8 +124,6 @@ int fs_log_slice_write(FSSliceOpContext *op_ctx)
 
 void fs_write_finish(FSSliceOpContext *op_ctx)
 {
-    FSSliceSNPair *slice_sn_pair;
-    FSSliceSNPair *slice_sn_end;
     int result;
     int inc_alloc;
 
@@ -131,19 +132,12 @@ void fs_write_finish(FSSliceOpContext *op_ctx)
             break;
         }
 
-        slice_sn_end = op_ctx->update.sarray.slice_sn_pairs +
-            op_ctx->update.sarray.count;
-        for (slice_sn_pair=op_ctx->update.sarray.slice_sn_pairs;
-                slice_sn_pair<slice_sn_end; slice_sn_pair++)
-        {
-            if ((result=ob_index_add_slice(slice_sn_pair->slice,
-                            &slice_sn_pair->sn, &inc_alloc, op_ctx->
-                            info.source == BINLOG_SOURCE_RECLAIM)) != 0)
-            {
-                op_ctx->result = result;
-                break;
-            }
-            op_ctx->update.space_changed += inc_alloc;
+        result = ob_index_add_slices(op_ctx->update.sarray.slice_sn_pairs,
+                op_ctx->update.sarray.count, true, &inc_alloc,
+                op_ctx->info.source == BINLOG_SOURCE_RECLAIM);
+        op_ctx->update.space_changed += inc_alloc;
+        if (result != 0) {
+            op_ctx->result = result;
         }
 
         if (op_ctx->result == 0) {
@@ -166,6 +160,10 @@ static void slice_write_done(struct trunk_io_buffer *record, const int result)
     } else {
         op_ctx->result = result;
     }
+    if (op_ctx->compress_buff != NULL) {  //only one slice when compressed
+        free(op_ctx->compress_buff);
+        op_ctx->compress_buff = NULL;
+    }
 
     /*
     logInfo("slice_write_done result: %d, offset: %d, length: %d, "
@@ -270,19 +268,111 @@ static int fs_slice_alloc(const FSBlockSliceKeyInfo *bs_key,
     return result;
 }
 
+static void set_slice_checksums(FSSliceOpContext *op_ctx)
+{
+    FSSliceSNPair *slice_sn_pair;
+    FSSliceSNPair *slice_sn_end;
+    OBSliceEntry *slice;
+    char *ps;
+
+    ps = op_ctx->info.buff;
+    slice_sn_end = op_ctx->update.sarray.slice_sn_pairs +
+        op_ctx->update.sarray.count;
+    for (slice_sn_pair=op_ctx->update.sarray.slice_sn_pairs;
+            slice_sn_pair<slice_sn_end; slice_sn_pair++)
+    {
+        slice = slice_sn_pair->slice;
+        slice->crc32 = fs_crc32c(0, ps, slice->ssize.length);
+        slice->has_crc = true;
+        ps += slice->ssize.length;
+    }
+}
+
+/* compress the slice data when the selected path enabled compression,
+   the compressed data is stored on this path as one contiguous space.
+   return ENODATA for storing the raw data */
+static int fs_slice_compress_alloc(FSSliceOpContext *op_ctx,
+        const bool reclaim_alloc)
+{
+    FSBlockSliceKeyInfo *bs_key;
+    FSTrunkAllocator *allocator;
+    FSTrunkSpaceInfo space;
+    OBSliceEntry *slice;
+    int compress_type;
+    int compress_length;
+    int result;
+
+    op_ctx->compress_buff = NULL;
+    bs_key = &op_ctx->info.bs_key;
+    if (bs_key->slice.length < STORAGE_CFG.compression.min_size) {
+        return ENODATA;
+    }
+
+    allocator = storage_allocator_select(FS_BLOCK_HASH_CODE(
+                bs_key->block), !reclaim_alloc);
+    if (allocator == NULL || allocator->path_info->compress_type ==
+            FS_COMPRESS_TYPE_NONE)
+    {
+        return ENODATA;
+    }
+
+    //the compression is optional, store the raw data on any failure
+    compress_type = allocator->path_info->compress_type;
+    if ((result=slice_compressor_compress(compress_type,
+                    op_ctx->info.buff, bs_key->slice.length,
+                    &op_ctx->compress_buff, &compress_length)) != 0)
+    {
+        if (result != ENODATA) {
+            logWarning("file: "__FILE__", line: %d, "
+                    "compress slice fail, store the raw data, "
+                    "errno: %d, error info: %s",
+                    __LINE__, result, STRERROR(result));
+        }
+        return ENODATA;
+    }
+
+    //the compressed data can't be split, try the next trunk of the path
+    if (storage_allocator_contiguous_alloc(allocator,
+                compress_length, &space) == 0)
+    {
+        if ((slice=alloc_init_slice(&bs_key->block, &space,
+                        OB_SLICE_TYPE_FILE, bs_key->slice.offset,
+                        bs_key->slice.length)) == NULL)
+        {
+            result = ENOMEM;
+        } else {
+            slice->compress.type = compress_type;
+            slice->compress.length = compress_length;
+            slice->compress.offset = 0;
+            op_ctx->update.sarray.slice_sn_pairs[0].slice = slice;
+            op_ctx->update.sarray.count = 1;
+            return 0;
+        }
+    } else {
+        result = ENODATA;
+    }
+
+    free(op_ctx->compress_buff);
+    op_ctx->compress_buff = NULL;
+    return result;
+}
+
 int fs_slice_write(FSSliceOpContext *op_ctx)
 {
     FSSliceSNPair *slice_sn_pair;
     FSSliceSNPair *slice_sn_end;
+    bool reclaim_alloc;
     int result;
 
     op_ctx->done_bytes = 0;
     op_ctx->update.space_changed = 0;
-    if ((result=fs_slice_alloc(&op_ctx->info.bs_key, OB_SLICE_TYPE_FILE,
-                    op_ctx->info.source == BINLOG_SOURCE_RECLAIM,
-                    op_ctx->update.sarray.slice_sn_pairs,
-                    &op_ctx->update.sarray.count)) != 0)
-    {
+    reclaim_alloc = (op_ctx->info.source == BINLOG_SOURCE_RECLAIM);
+    if ((result=fs_slice_compress_alloc(op_ctx, reclaim_alloc)) == ENODATA) {
+        result = fs_slice_alloc(&op_ctx->info.bs_key, OB_SLICE_TYPE_FILE,
+                reclaim_alloc, op_ctx->update.sarray.slice_sn_pairs,
+                &op_ctx->update.sarray.count);
+    }
+    if (result != 0) {
         op_ctx->result = result;
         op_ctx->rw_done_callback(op_ctx, op_ctx->arg);
         return result;
@@ -290,10 +380,21 @@ int fs_slice_write(FSSliceOpContext *op_ctx)
 
     op_ctx->result = 0;
     op_ctx->counter = op_ctx->update.sarray.count;
+    if (STORAGE_CFG.slice_checksum.enabled) {
+        set_slice_checksums(op_ctx);  //the checksum of the raw data
+    }
+
     if (op_ctx->update.sarray.count == 1) {
         result = io_thread_push_slice_op(FS_IO_TYPE_WRITE_SLICE,
+                            op_ctx->info.io_class,
                             op_ctx->update.sarray.slice_sn_pairs[0].slice,
-                            op_ctx->info.buff, slice_write_done, op_ctx);
+                            (op_ctx->compress_buff != NULL ?
+                             op_ctx->compress_buff : op_ctx->info.buff),
+                            slice_write_done, op_ctx);
+        if (result != 0 && op_ctx->compress_buff != NULL) {
+            free(op_ctx->compress_buff);
+            op_ctx->compress_buff = NULL;
+        }
     } else {
         int length;
         char *ps;
@@ -306,8 +407,8 @@ int fs_slice_write(FSSliceOpContext *op_ctx)
         {
             length = slice_sn_pair->slice->ssize.length;
             if ((result=io_thread_push_slice_op(FS_IO_TYPE_WRITE_SLICE,
-                            slice_sn_pair->slice, ps, slice_write_done,
-                            op_ctx)) != 0)
+                            op_ctx->info.io_class, slice_sn_pair->slice,
+                            ps, slice_write_done, op_ctx)) != 0)
             {
                 break;
             }
@@ -399,8 +500,6 @@ int fs_slice_allocate(FSSliceOpContext *op_ctx)
     int inc;
     int n;
     int k;
-    FSSliceSNPair *slice_sn_pair;
-    FSSliceSNPair *slice_sn_end;
 
     op_ctx->update.sarray.count = 0;
     op_ctx->update.space_changed = 0;
@@ -463,19 +562,10 @@ int fs_slice_allocate(FSSliceOpContext *op_ctx)
         return result;
     }
 
-    slice_sn_end = op_ctx->update.sarray.slice_sn_pairs +
-        op_ctx->update.sarray.count;
-    for (slice_sn_pair=op_ctx->update.sarray.slice_sn_pairs;
-            slice_sn_pair<slice_sn_end; slice_sn_pair++)
-    {
-        if ((result=ob_index_add_slice(slice_sn_pair->slice,
-                        &slice_sn_pair->sn, &inc, op_ctx->info.
-                        source == BINLOG_SOURCE_RECLAIM)) != 0)
-        {
-            break;
-        }
-        op_ctx->update.space_changed += inc;
-    }
+    result = ob_index_add_slices(op_ctx->update.sarray.slice_sn_pairs,
+            op_ctx->update.sarray.count, true, &inc, op_ctx->info.
+            source == BINLOG_SOURCE_RECLAIM);
+    op_ctx->update.space_changed += inc;
     if (result == 0) {
         set_data_version(op_ctx);
     }
@@ -554,9 +644,135 @@ static void do_read_done(OBSliceEntry *slice, FSSliceOpContext *op_ctx,
     }
 }
 
+static inline bool slice_need_verify(FSSliceOpContext *op_ctx,
+        OBSliceEntry *slice)
+{
+    if (!__atomic_load_n(&slice->has_crc, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    if (op_ctx->info.source == BINLOG_SOURCE_RECLAIM) {
+        return STORAGE_CFG.slice_checksum.verify_on_reclaim;
+    } else {
+        return STORAGE_CFG.slice_checksum.verify_on_read;
+    }
+}
+
+static int slice_verify_checksum(FSSliceOpContext *op_ctx,
+        OBSliceEntry *slice, const char *data)
+{
+    uint32_t crc32;
+    char trunk_filename[PATH_MAX];
+
+    crc32 = fs_crc32c(0, data, slice->ssize.length);
+    if (crc32 == slice->crc32) {
+        return 0;
+    }
+
+    trunk_io_thread_get_filename(&slice->space,
+            trunk_filename, sizeof(trunk_filename));
+    logError("file: "__FILE__", line: %d, "
+            "slice checksum mismatch, oid: %"PRId64", "
+            "block offset: %"PRId64", slice offset: %d, length: %d, "
+            "trunk file: %s, offset: %"PRId64", expect crc32: %08x, "
+            "actual crc32: %08x", __LINE__, op_ctx->info.bs_key.block.oid,
+            op_ctx->info.bs_key.block.offset, slice->ssize.offset,
+            slice->ssize.length, trunk_filename, slice->space.offset,
+            slice->crc32, crc32);
+    return EIO;
+}
+
+/* the piece cut from the written slice has no CRC, attach the CRC of
+   the data read to the index entry when the read covers the whole piece,
+   so the later reads and reclaims verify it. the read copy of a part is
+   referred by this read only and skipped */
+static void slice_attach_checksum(OBSliceEntry *slice, const char *data)
+{
+    if (!STORAGE_CFG.slice_checksum.enabled ||
+            __atomic_load_n(&slice->has_crc, __ATOMIC_ACQUIRE) ||
+            __sync_add_and_fetch(&slice->ref_count, 0) <= 1)
+    {
+        return;
+    }
+
+    slice->crc32 = fs_crc32c(0, data, slice->ssize.length);
+    __atomic_store_n(&slice->has_crc, true, __ATOMIC_RELEASE);
+}
+
+static void slice_decompress_done(FSDecompressTask *task)
+{
+    FSSliceOpContext *op_ctx;
+    int result;
+
+    op_ctx = (FSSliceOpContext *)task->arg;
+    result = task->result;
+    if (result == 0) {
+        if (slice_need_verify(op_ctx, task->slice)) {
+            result = slice_verify_checksum(op_ctx,
+                    task->slice, task->dest);
+        } else {
+            slice_attach_checksum(task->slice, task->dest);
+        }
+    }
+    do_read_done(task->slice, op_ctx, result);
+    slice_compressor_free_task(task);
+}
+
+static void compressed_read_done(struct trunk_io_buffer *record,
+        const int result)
+{
+    FSDecompressTask *task;
+
+    task = (FSDecompressTask *)record->notify.arg;
+    if (result == 0) {  //decompress out of the disk IO thread
+        slice_compressor_push(task);
+    } else {
+        task->result = result;
+        slice_decompress_done(task);
+    }
+}
+
+static int compressed_slice_read(FSSliceOpContext *op_ctx,
+        OBSliceEntry *slice, char *buff)
+{
+    FSDecompressTask *task;
+    int result;
+
+    if ((task=slice_compressor_alloc_task(slice, buff,
+                    slice_decompress_done, op_ctx)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    if ((result=io_thread_push_slice_op(FS_IO_TYPE_READ_SLICE,
+                    op_ctx->info.io_class, slice, task->data,
+                    compressed_read_done, task)) != 0)
+    {
+        slice_compressor_free_task(task);
+    }
+    return result;
+}
+
 static void slice_read_done(struct trunk_io_buffer *record, const int result)
 {
-    do_read_done(record->slice, (FSSliceOpContext *)record->notify.arg, result);
+    FSSliceOpContext *op_ctx;
+    int r;
+
+    op_ctx = (FSSliceOpContext *)record->notify.arg;
+    r = result;
+    if (r == 0) {
+        if (slice_need_verify(op_ctx, record->slice)) {
+            r = slice_verify_checksum(op_ctx, record->slice,
+                    record->data.str);
+        } else {
+            slice_attach_checksum(record->slice, record->data.str);
+        }
+    }
+    if (r == 0 && op_ctx->info.io_class == FS_IO_CLASS_FOREGROUND) {
+        read_cache_add(record->slice, record->data.str,
+                op_ctx->cache_version);
+    }
+    do_read_done(record->slice, op_ctx, r);
 }
 
 int fs_slice_read(FSSliceOpContext *op_ctx)
@@ -586,6 +802,7 @@ int fs_slice_read(FSSliceOpContext *op_ctx)
     op_ctx->result = 0;
     op_ctx->done_bytes = 0;
     op_ctx->counter = op_ctx->slice_ptr_array.count;
+    op_ctx->cache_version = read_cache_get_version();
     ps = op_ctx->info.buff;
     offset = op_ctx->info.bs_key.slice.offset;
     end = op_ctx->slice_ptr_array.slices + op_ctx->slice_ptr_array.count;
@@ -609,8 +826,17 @@ int fs_slice_read(FSSliceOpContext *op_ctx)
         if ((*pp)->type == OB_SLICE_TYPE_ALLOC) {
             memset(ps, 0, (*pp)->ssize.length);
             do_read_done(*pp, op_ctx, 0);
+        } else if ((*pp)->compress.type != FS_COMPRESS_TYPE_NONE) {
+            //the read cache is keyed by the space, skip the compressed
+            if ((result=compressed_slice_read(op_ctx, *pp, ps)) != 0) {
+                ob_index_free_slice(*pp);
+                break;
+            }
+        } else if (read_cache_get(*pp, ps)) {
+            do_read_done(*pp, op_ctx, 0);
         } else if ((result=io_thread_push_slice_op(FS_IO_TYPE_READ_SLICE,
-                        *pp, ps, slice_read_done, op_ctx)) != 0)
+                        op_ctx->info.io_class, *pp, ps,
+                        slice_read_done, op_ctx)) != 0)
         {
             ob_index_free_slice(*pp);
             break;
@@ -97,6 +97,23 @@ extern "C" {
         FSTrunkAllocator **allocator;
         int result;
 
+        /* the normal writes land on the write cache paths first without
+           waiting, and the reclaim writes go to the store paths only */
+        if (is_normal && g_allocator_mgr->write_cache.all.count > 0) {
+            avail_array = (FSTrunkAllocatorPtrArray *)
+                g_allocator_mgr->write_cache.avail;
+            if (avail_array->count > 0) {
+                allocator = avail_array->allocators +
+                    blk_hc % avail_array->count;
+                if (trunk_freelist_alloc_space(*allocator,
+                            &(*allocator)->freelist, blk_hc, size,
+                            spaces, count, false) == 0)
+                {
+                    return 0;
+                }
+            }
+        }
+
         do {
             avail_array = (FSTrunkAllocatorPtrArray *)
                 g_allocator_mgr->store_path.avail;
@@ -132,6 +149,40 @@ extern "C" {
                 size, spaces, count, is_normal);
     }
 
+    /* the allocator which the write of the block tries first,
+       NULL when no available path */
+    static inline FSTrunkAllocator *storage_allocator_select(
+            const uint32_t blk_hc, const bool is_normal)
+    {
+        FSTrunkAllocatorPtrArray *avail_array;
+
+        if (is_normal && g_allocator_mgr->write_cache.all.count > 0) {
+            avail_array = (FSTrunkAllocatorPtrArray *)
+                g_allocator_mgr->write_cache.avail;
+            if (avail_array->count > 0) {
+                return avail_array->allocators[blk_hc %
+                    avail_array->count];
+            }
+        }
+
+        avail_array = (FSTrunkAllocatorPtrArray *)
+            g_allocator_mgr->store_path.avail;
+        if (avail_array->count == 0) {
+            return NULL;
+        }
+        return avail_array->allocators[blk_hc % avail_array->count];
+    }
+
+    /* allocate the space which can NOT be split (such as the compressed
+       slice) from the selected allocator, so the data lands on its path */
+    static inline int storage_allocator_contiguous_alloc(
+            FSTrunkAllocator *allocator, const int size,
+            FSTrunkSpaceInfo *space)
+    {
+        return trunk_freelist_alloc_contiguous(allocator,
+                &allocator->freelist, size, space);
+    }
+
 #define storage_allocator_normal_alloc(blk_hc, size, spaces, count) \
     storage_allocator_normal_alloc_ex(blk_hc, size, spaces, count, true)
 
@@ -149,6 +200,13 @@ extern "C" {
         return trunk_allocator_add_slice(allocator, slice);
     }
 
+    static inline FSTrunkFileInfo *storage_allocator_pin_trunk(
+            const FSTrunkSpaceInfo *space)
+    {
+        return trunk_allocator_pin(g_allocator_mgr->allocator_ptr_array.
+                allocators[space->store->index], space->id_info.id);
+    }
+
     static inline int storage_allocator_delete_slice(OBSliceEntry *slice,
             const bool modify_used_space)
     {
@@ -210,6 +268,14 @@ extern "C" {
         return result;
     }
 
+    static inline bool storage_allocator_is_write_cache(
+            FSTrunkAllocator *allocator)
+    {
+        return allocator >= g_allocator_mgr->write_cache.all.allocators &&
+            allocator < g_allocator_mgr->write_cache.all.allocators +
+            g_allocator_mgr->write_cache.all.count;
+    }
+
     static inline int storage_allocator_avail_count()
     {
         return g_allocator_mgr->store_path.avail->count;
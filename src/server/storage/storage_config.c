@@ -24,6 +24,10 @@
 #include "../server_types.h"
 #include "../server_global.h"
 #include "store_path_index.h"
+#include "../../common/fs_crc32c.h"
+#include "durability.h"
+#include "slice_compressor.h"
+#include "object_block_index.h"
 #include "storage_config.h"
 
 static int load_one_path(FSStorageConfig *storage_cfg,
@@ -185,6 +189,31 @@ void storage_config_stat_path_spaces(FSClusterServerSpaceStat *ss)
     *ss = stat;
 }
 
+static int get_compress_type_item(IniFullContext *ini_ctx,
+        const char *section_name, const int default_type, char *type)
+{
+    char *name;
+    int result;
+
+    name = iniGetStrValue(section_name, "compression", ini_ctx->context);
+    if (name == NULL || *name == '\0') {
+        *type = default_type;
+        return 0;
+    }
+
+    if ((result=slice_compressor_get_type(name)) < 0) {
+        logError("file: "__FILE__", line: %d, "
+                "config file: %s, section: %s, item \"compression\": %s "
+                "is %s", __LINE__, ini_ctx->filename, section_name != NULL ?
+                section_name : "global", name, result == -EOPNOTSUPP ?
+                "NOT supported by this build" : "invalid");
+        return EINVAL;
+    }
+
+    *type = result;
+    return 0;
+}
+
 static int load_paths(FSStorageConfig *storage_cfg, IniFullContext *ini_ctx,
         const char *section_name_prefix, const char *item_name,
         FSStoragePathArray *parray, const bool required)
@@ -239,6 +268,16 @@ static int load_paths(FSStorageConfig *storage_cfg, IniFullContext *ini_ctx,
             parray->paths[i].read_thread_count = 1;
         }
 
+        parray->paths[i].direct_io = iniGetBoolValue(section_name,
+                "direct_io", ini_ctx->context, false);
+
+        if ((result=get_compress_type_item(ini_ctx, section_name,
+                        storage_cfg->compression.type,
+                        &parray->paths[i].compress_type)) != 0)
+        {
+            return result;
+        }
+
         if ((result=iniGetPercentValue(ini_ctx, "prealloc_space",
                         &parray->paths[i].prealloc_space.ratio,
                         storage_cfg->prealloc_space.ratio_per_path)) != 0)
@@ -264,19 +303,416 @@ static int load_paths(FSStorageConfig *storage_cfg, IniFullContext *ini_ctx,
     return 0;
 }
 
+static int get_io_size_item(IniFullContext *ini_ctx, const char *item_name,
+        const int default_value, const int max_value, int *value)
+{
+    int result;
+    char *str;
+    int64_t bytes;
+
+    str = iniGetStrValue(NULL, item_name, ini_ctx->context);
+    if (str == NULL || *str == '\0') {
+        bytes = default_value;
+    } else if ((result=parse_bytes(str, 1, &bytes)) != 0) {
+        return result;
+    }
+
+    if (bytes < 0) {
+        bytes = 0;
+    } else if (bytes > max_value) {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s, %s: %"PRId64" is too large, set to %d",
+                __LINE__, ini_ctx->filename, item_name, bytes, max_value);
+        bytes = max_value;
+    }
+
+    *value = bytes;
+    return 0;
+}
+
+typedef struct {
+    const char *name;
+    int default_weight;
+    bool can_limit;  //only the background classes can be limited
+} FSIOClassDefine;
+
+static FSIOClassDefine io_class_defines[FS_IO_CLASS_COUNT] = {
+    {"foreground",  100, false},
+    {"replication", 100, false},
+    {"recovery",     20, true},
+    {"reclaim",      10, true},
+    {"maintenance",  50, true}
+};
+
+const char *storage_config_get_io_class_caption(const int io_class)
+{
+    if (io_class >= 0 && io_class < FS_IO_CLASS_COUNT) {
+        return io_class_defines[io_class].name;
+    }
+    return "unknown";
+}
+
+static int load_io_class_items(FSStorageConfig *storage_cfg,
+        IniFullContext *ini_ctx)
+{
+    FSIOClassDefine *def;
+    char item_name[64];
+    char *str;
+    int result;
+    int i;
+
+    for (i=0; i<FS_IO_CLASS_COUNT; i++) {
+        def = io_class_defines + i;
+        sprintf(item_name, "io_weight_%s", def->name);
+        storage_cfg->io_classes[i].weight = iniGetIntValue(NULL,
+                item_name, ini_ctx->context, def->default_weight);
+        if (storage_cfg->io_classes[i].weight <= 0) {
+            storage_cfg->io_classes[i].weight = def->default_weight;
+        } else if (storage_cfg->io_classes[i].weight >
+                FS_MAX_IO_CLASS_WEIGHT)
+        {
+            logWarning("file: "__FILE__", line: %d, "
+                    "config file: %s, %s: %d is too large, set to %d",
+                    __LINE__, ini_ctx->filename, item_name,
+                    storage_cfg->io_classes[i].weight,
+                    FS_MAX_IO_CLASS_WEIGHT);
+            storage_cfg->io_classes[i].weight = FS_MAX_IO_CLASS_WEIGHT;
+        }
+
+        storage_cfg->io_classes[i].max_bandwidth = 0;
+        storage_cfg->io_classes[i].max_iops = 0;
+        if (!def->can_limit) {
+            continue;
+        }
+
+        sprintf(item_name, "io_max_bandwidth_%s", def->name);
+        str = iniGetStrValue(NULL, item_name, ini_ctx->context);
+        if (str != NULL && *str != '\0') {
+            if ((result=parse_bytes(str, 1, &storage_cfg->
+                            io_classes[i].max_bandwidth)) != 0)
+            {
+                return result;
+            }
+            if (storage_cfg->io_classes[i].max_bandwidth < 0) {
+                storage_cfg->io_classes[i].max_bandwidth = 0;
+            }
+        }
+
+        sprintf(item_name, "io_max_iops_%s", def->name);
+        storage_cfg->io_classes[i].max_iops = iniGetIntValue(NULL,
+                item_name, ini_ctx->context, 0);
+        if (storage_cfg->io_classes[i].max_iops < 0) {
+            storage_cfg->io_classes[i].max_iops = 0;
+        }
+    }
+
+    return 0;
+}
+
+static void io_classes_to_log(FSStorageConfig *storage_cfg)
+{
+    char buff[1024];
+    int len;
+    int i;
+
+    len = 0;
+    for (i=0; i<FS_IO_CLASS_COUNT; i++) {
+        len += snprintf(buff + len, sizeof(buff) - len,
+                "%s%s: {weight: %d", (i > 0 ? ", " : ""),
+                io_class_defines[i].name, storage_cfg->io_classes[i].weight);
+        if (io_class_defines[i].can_limit) {
+            len += snprintf(buff + len, sizeof(buff) - len,
+                    ", max_bandwidth: %"PRId64" KB/s, max_iops: %d",
+                    storage_cfg->io_classes[i].max_bandwidth / 1024,
+                    storage_cfg->io_classes[i].max_iops);
+        }
+        len += snprintf(buff + len, sizeof(buff) - len, "}");
+    }
+
+    logInfo("storage config, io classes: {%s}", buff);
+}
+
+static int load_read_cache_items(FSStorageConfig *storage_cfg,
+        IniFullContext *ini_ctx)
+{
+    int result;
+    char *str;
+    int64_t bytes;
+
+    str = iniGetStrValue(NULL, "read_cache_size", ini_ctx->context);
+    if (str == NULL || *str == '\0') {
+        bytes = 0;
+    } else if ((result=parse_bytes(str, 1, &bytes)) != 0) {
+        return result;
+    }
+    storage_cfg->read_cache.capacity = (bytes > 0 ? bytes : 0);
+
+    storage_cfg->read_cache.shard_count = iniGetIntValue(NULL,
+            "read_cache_shard_count", ini_ctx->context,
+            FS_DEFAULT_READ_CACHE_SHARD_COUNT);
+    if (storage_cfg->read_cache.shard_count <= 0) {
+        storage_cfg->read_cache.shard_count =
+            FS_DEFAULT_READ_CACHE_SHARD_COUNT;
+    } else if (storage_cfg->read_cache.shard_count >
+            FS_MAX_READ_CACHE_SHARD_COUNT)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s, read_cache_shard_count: %d "
+                "is too large, set to %d", __LINE__, ini_ctx->filename,
+                storage_cfg->read_cache.shard_count,
+                FS_MAX_READ_CACHE_SHARD_COUNT);
+        storage_cfg->read_cache.shard_count = FS_MAX_READ_CACHE_SHARD_COUNT;
+    }
+
+    return 0;
+}
+
+static int load_zero_copy_items(FSStorageConfig *storage_cfg,
+        IniFullContext *ini_ctx)
+{
+    int result;
+
+    storage_cfg->zero_copy_read.enabled = iniGetBoolValue(NULL,
+            "zero_copy_read", ini_ctx->context, false);
+#ifndef OS_LINUX
+    if (storage_cfg->zero_copy_read.enabled) {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s, item \"zero_copy_read\" is true, "
+                "but sendfile to socket NOT supported by this OS, "
+                "set to false", __LINE__, ini_ctx->filename);
+        storage_cfg->zero_copy_read.enabled = false;
+    }
+#endif
+
+    if ((result=get_io_size_item(ini_ctx, "zero_copy_read_min_size",
+                    FS_DEFAULT_ZERO_COPY_READ_MIN_SIZE, FS_FILE_BLOCK_SIZE,
+                    &storage_cfg->zero_copy_read.min_size)) != 0)
+    {
+        return result;
+    }
+
+    storage_cfg->zero_copy_read.thread_count = iniGetIntValue(NULL,
+            "zero_copy_send_threads", ini_ctx->context,
+            FS_DEFAULT_ZERO_COPY_SEND_THREADS);
+    if (storage_cfg->zero_copy_read.thread_count <= 0) {
+        storage_cfg->zero_copy_read.thread_count =
+            FS_DEFAULT_ZERO_COPY_SEND_THREADS;
+    } else if (storage_cfg->zero_copy_read.thread_count >
+            FS_MAX_ZERO_COPY_SEND_THREADS)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s, zero_copy_send_threads: %d "
+                "is too large, set to %d", __LINE__, ini_ctx->filename,
+                storage_cfg->zero_copy_read.thread_count,
+                FS_MAX_ZERO_COPY_SEND_THREADS);
+        storage_cfg->zero_copy_read.thread_count =
+            FS_MAX_ZERO_COPY_SEND_THREADS;
+    }
+
+    return 0;
+}
+
+static int load_compression_items(FSStorageConfig *storage_cfg,
+        IniFullContext *ini_ctx)
+{
+    int result;
+
+    if ((result=get_compress_type_item(ini_ctx, NULL,
+                    FS_COMPRESS_TYPE_NONE, &storage_cfg->
+                    compression.type)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=get_io_size_item(ini_ctx, "compress_min_size",
+                    FS_DEFAULT_COMPRESS_MIN_SIZE, FS_FILE_BLOCK_SIZE,
+                    &storage_cfg->compression.min_size)) != 0)
+    {
+        return result;
+    }
+
+    storage_cfg->compression.zstd_level = iniGetIntValue(NULL,
+            "compress_zstd_level", ini_ctx->context,
+            FS_DEFAULT_COMPRESS_ZSTD_LEVEL);
+
+    storage_cfg->compression.decompress_threads = iniGetIntValue(NULL,
+            "decompress_threads", ini_ctx->context,
+            FS_DEFAULT_DECOMPRESS_THREADS);
+    if (storage_cfg->compression.decompress_threads <= 0) {
+        storage_cfg->compression.decompress_threads =
+            FS_DEFAULT_DECOMPRESS_THREADS;
+    } else if (storage_cfg->compression.decompress_threads >
+            FS_MAX_DECOMPRESS_THREADS)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s, decompress_threads: %d "
+                "is too large, set to %d", __LINE__, ini_ctx->filename,
+                storage_cfg->compression.decompress_threads,
+                FS_MAX_DECOMPRESS_THREADS);
+        storage_cfg->compression.decompress_threads =
+            FS_MAX_DECOMPRESS_THREADS;
+    }
+
+    return 0;
+}
+
+static int load_durability_items(FSStorageConfig *storage_cfg,
+        IniFullContext *ini_ctx)
+{
+    char *mode;
+
+    mode = iniGetStrValue(NULL, "durability_mode", ini_ctx->context);
+    if (mode == NULL || *mode == '\0' || strcasecmp(mode, "none") == 0) {
+        storage_cfg->durability.mode = FS_DURABILITY_MODE_NONE;
+    } else if (strcasecmp(mode, "periodic") == 0) {
+        storage_cfg->durability.mode = FS_DURABILITY_MODE_PERIODIC;
+    } else if (strcasecmp(mode, "group_commit") == 0) {
+        storage_cfg->durability.mode = FS_DURABILITY_MODE_GROUP_COMMIT;
+    } else {
+        logError("file: "__FILE__", line: %d, "
+                "config file: %s, invalid durability_mode: %s, "
+                "expect: none, periodic or group_commit",
+                __LINE__, ini_ctx->filename, mode);
+        return EINVAL;
+    }
+
+    storage_cfg->durability.sync_interval_ms = iniGetIntValue(NULL,
+            "sync_interval_ms", ini_ctx->context,
+            FS_DEFAULT_SYNC_INTERVAL_MS);
+    if (storage_cfg->durability.sync_interval_ms <= 0) {
+        storage_cfg->durability.sync_interval_ms =
+            FS_DEFAULT_SYNC_INTERVAL_MS;
+    }
+
+    storage_cfg->durability.group_commit_window_ms = iniGetIntValue(NULL,
+            "group_commit_window_ms", ini_ctx->context,
+            FS_DEFAULT_GROUP_COMMIT_WINDOW_MS);
+    if (storage_cfg->durability.group_commit_window_ms < 0) {
+        storage_cfg->durability.group_commit_window_ms = 0;
+    } else if (storage_cfg->durability.group_commit_window_ms >
+            FS_MAX_GROUP_COMMIT_WINDOW_MS)
+    {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s, group_commit_window_ms: %d "
+                "is too large, set to %d", __LINE__, ini_ctx->filename,
+                storage_cfg->durability.group_commit_window_ms,
+                FS_MAX_GROUP_COMMIT_WINDOW_MS);
+        storage_cfg->durability.group_commit_window_ms =
+            FS_MAX_GROUP_COMMIT_WINDOW_MS;
+    }
+
+    return 0;
+}
+
 static int load_global_items(FSStorageConfig *storage_cfg,
         IniFullContext *ini_ctx)
 {
     int result;
     char *tf_size;
     char *discard_size;
+    char *type;
     int64_t trunk_file_size;
     int64_t discard_remain_space_size;
 
-    storage_cfg->fd_cache_capacity_per_read_thread = iniGetIntValue(NULL,
-            "fd_cache_capacity_per_read_thread", ini_ctx->context, 256);
-    if (storage_cfg->fd_cache_capacity_per_read_thread <= 0) {
-        storage_cfg->fd_cache_capacity_per_read_thread = 256;
+    storage_cfg->fd_cache_capacity = iniGetIntValue(NULL,
+            "fd_cache_capacity", ini_ctx->context, 1024);
+    if (storage_cfg->fd_cache_capacity <= 0) {
+        storage_cfg->fd_cache_capacity = 1024;
+    }
+
+    storage_cfg->io_uring.enabled = iniGetBoolValue(NULL,
+            "use_io_uring", ini_ctx->context, false);
+#ifndef FS_USE_IO_URING
+    if (storage_cfg->io_uring.enabled) {
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s, item \"use_io_uring\" is true, "
+                "but io_uring NOT supported by this build, "
+                "set to false", __LINE__, ini_ctx->filename);
+        storage_cfg->io_uring.enabled = false;
+    }
+#endif
+
+    storage_cfg->io_uring.queue_depth = iniGetIntValue(NULL,
+            "io_depth_per_thread", ini_ctx->context,
+            FS_DEFAULT_IO_DEPTH_PER_THREAD);
+    if (storage_cfg->io_uring.queue_depth <= 0) {
+        storage_cfg->io_uring.queue_depth = FS_DEFAULT_IO_DEPTH_PER_THREAD;
+    } else if (storage_cfg->io_uring.queue_depth > FS_MAX_IO_DEPTH_PER_THREAD) {
+        logWarning("file: "__FILE__", line: %d, "
+                "io_depth_per_thread: %d is too large, set to %d",
+                __LINE__, storage_cfg->io_uring.queue_depth,
+                FS_MAX_IO_DEPTH_PER_THREAD);
+        storage_cfg->io_uring.queue_depth = FS_MAX_IO_DEPTH_PER_THREAD;
+    }
+
+    if ((result=get_io_size_item(ini_ctx, "io_merge_max_size",
+                    FS_DEFAULT_IO_MERGE_MAX_SIZE, FS_MAX_IO_MERGE_MAX_SIZE,
+                    &storage_cfg->io_merge_max_size)) != 0)
+    {
+        return result;
+    }
+    if ((result=get_io_size_item(ini_ctx, "read_merge_gap_size",
+                    FS_DEFAULT_READ_MERGE_GAP_SIZE, FS_MAX_READ_MERGE_GAP_SIZE,
+                    &storage_cfg->read_merge_gap_size)) != 0)
+    {
+        return result;
+    }
+    if ((result=get_io_size_item(ini_ctx, "read_ahead_size",
+                    FS_DEFAULT_READ_AHEAD_SIZE, FS_MAX_READ_AHEAD_SIZE,
+                    &storage_cfg->read_ahead_size)) != 0)
+    {
+        return result;
+    }
+
+    if ((result=load_io_class_items(storage_cfg, ini_ctx)) != 0) {
+        return result;
+    }
+
+    if ((result=load_durability_items(storage_cfg, ini_ctx)) != 0) {
+        return result;
+    }
+
+    if ((result=load_read_cache_items(storage_cfg, ini_ctx)) != 0) {
+        return result;
+    }
+
+    if ((result=load_zero_copy_items(storage_cfg, ini_ctx)) != 0) {
+        return result;
+    }
+
+    storage_cfg->slice_checksum.enabled = iniGetBoolValue(NULL,
+            "slice_checksum", ini_ctx->context, true);
+    storage_cfg->slice_checksum.verify_on_read = iniGetBoolValue(NULL,
+            "checksum_verify_on_read", ini_ctx->context, false);
+    storage_cfg->slice_checksum.verify_on_reclaim = iniGetBoolValue(NULL,
+            "checksum_verify_on_reclaim", ini_ctx->context, true);
+    fs_crc32c_init();
+
+    storage_cfg->slice_merge.enabled = iniGetBoolValue(NULL,
+            "slice_merge", ini_ctx->context, true);
+    storage_cfg->slice_merge.interval = iniGetIntValue(NULL,
+            "slice_merge_interval", ini_ctx->context, 3600);
+    if (storage_cfg->slice_merge.interval < 0) {
+        storage_cfg->slice_merge.interval = 0;
+    }
+
+    if ((result=load_compression_items(storage_cfg, ini_ctx)) != 0) {
+        return result;
+    }
+
+    type = iniGetStrValue(NULL, "object_block_hashtable_type",
+            ini_ctx->context);
+    if (type == NULL || *type == '\0' || strcasecmp(type, "chain") == 0) {
+        storage_cfg->object_block.hashtable_type = OB_HASHTABLE_TYPE_CHAIN;
+    } else if (strcasecmp(type, "open_addressing") == 0) {
+        storage_cfg->object_block.hashtable_type =
+            OB_HASHTABLE_TYPE_OPEN_ADDRESSING;
+    } else {
+        logError("file: "__FILE__", line: %d, "
+                "config file: %s, invalid object_block_hashtable_type: %s, "
+                "expect: chain or open_addressing",
+                __LINE__, ini_ctx->filename, type);
+        return EINVAL;
     }
 
     storage_cfg->object_block.hashtable_capacity = iniGetInt64Value(NULL,
@@ -299,6 +735,13 @@ static int load_global_items(FSStorageConfig *storage_cfg,
                 __LINE__, ini_ctx->filename, storage_cfg->
                 object_block.shared_locks_count, 163);
         storage_cfg->object_block.shared_locks_count = 163;
+    } else if (storage_cfg->object_block.shared_locks_count > 65536) {
+        //the slice entry records the shared context index in 16 bits
+        logWarning("file: "__FILE__", line: %d, "
+                "config file: %s, item \"object_block_shared_locks_count\": %d "
+                "is too large, set to max: %d", __LINE__, ini_ctx->filename,
+                storage_cfg->object_block.shared_locks_count, 65536);
+        storage_cfg->object_block.shared_locks_count = 65536;
     }
 
     storage_cfg->write_threads_per_path = iniGetIntValue(NULL,
@@ -312,6 +755,8 @@ static int load_global_items(FSStorageConfig *storage_cfg,
     if (storage_cfg->read_threads_per_path <= 0) {
         storage_cfg->read_threads_per_path = 1;
     }
+    storage_cfg->read_work_stealing = iniGetBoolValue(NULL,
+            "read_work_stealing", ini_ctx->context, true);
 
     if ((result=iniGetPercentValue(ini_ctx, "prealloc_space_per_path",
                     &storage_cfg->prealloc_space.ratio_per_path, 0.05)) != 0)
@@ -626,13 +1071,16 @@ static void log_paths(FSStoragePathArray *parray, const char *caption)
         long_to_comma_str(p->prealloc_space.value /
                 (1024 * 1024), prealloc_space_buff);
         logInfo("  path %d: %s, index: %d, write_threads: %d, "
-                "read_threads: %d, prealloc_space ratio: %.2f%%, "
+                "read_threads: %d, direct_io: %d, compression: %s, "
+                "prealloc_space ratio: %.2f%%, "
                 "reserved_space ratio: %.2f%%, "
                 "avail_space: %s MB, prealloc_space: %s MB, "
                 "reserved_space: %s MB",
                 (int)(p - parray->paths + 1), p->store.path.str,
                 p->store.index, p->write_thread_count,
-                p->read_thread_count, p->prealloc_space.ratio * 100.00,
+                p->read_thread_count, p->direct_io,
+                slice_compressor_get_caption(p->compress_type),
+                p->prealloc_space.ratio * 100.00,
                 p->reserved_space.ratio * 100.00,
                 avail_space_buff, prealloc_space_buff,
                 reserved_space_buff);
@@ -642,8 +1090,22 @@ static void log_paths(FSStoragePathArray *parray, const char *caption)
 void storage_config_to_log(FSStorageConfig *storage_cfg)
 {
     logInfo("storage config, write_threads_per_path: %d, "
-            "read_threads_per_path: %d, "
-            "fd_cache_capacity_per_read_thread: %d, "
+            "read_threads_per_path: %d, read_work_stealing: %d, "
+            "fd_cache_capacity: %d, "
+            "use_io_uring: %d, io_depth_per_thread: %d, "
+            "io_merge_max_size: %d, read_merge_gap_size: %d, "
+            "read_ahead_size: %d, read_cache_size: %"PRId64" MB, "
+            "read_cache_shard_count: %d, "
+            "zero_copy_read: %d, zero_copy_read_min_size: %d KB, "
+            "zero_copy_send_threads: %d, "
+            "slice_checksum: %d (%s), checksum_verify_on_read: %d, "
+            "checksum_verify_on_reclaim: %d, "
+            "slice_merge: %d, slice_merge_interval: %d s, "
+            "compression: %s, compress_min_size: %d KB, "
+            "compress_zstd_level: %d, decompress_threads: %d, "
+            "durability_mode: %s, sync_interval_ms: %d, "
+            "group_commit_window_ms: %d, "
+            "object_block_hashtable_type: %s, "
             "object_block_hashtable_capacity: %"PRId64", "
             "object_block_shared_locks_count: %d, "
             "prealloc_space: {ratio_per_path: %.2f%%, "
@@ -653,15 +1115,38 @@ void storage_config_to_log(FSStorageConfig *storage_cfg)
             "trunk_file_size: %"PRId64" MB, "
             "max_trunk_files_per_subdir: %d, "
             "discard_remain_space_size: %d, "
-#if 0
-            / * "write_cache_to_hd: { on_usage: %.2f%%, start_time: %02d:%02d, "
-            "end_time: %02d:%02d }, "  */
-#endif
+            "write_cache_to_hd: { on_usage: %.2f%%, start_time: %02d:%02d, "
+            "end_time: %02d:%02d }, "
             "reclaim_trunks_on_path_usage: %.2f%%, "
             "never_reclaim_on_trunk_usage: %.2f%%",
             storage_cfg->write_threads_per_path,
             storage_cfg->read_threads_per_path,
-            storage_cfg->fd_cache_capacity_per_read_thread,
+            storage_cfg->read_work_stealing,
+            storage_cfg->fd_cache_capacity,
+            storage_cfg->io_uring.enabled,
+            storage_cfg->io_uring.queue_depth,
+            storage_cfg->io_merge_max_size,
+            storage_cfg->read_merge_gap_size,
+            storage_cfg->read_ahead_size,
+            storage_cfg->read_cache.capacity / (1024 * 1024),
+            storage_cfg->read_cache.shard_count,
+            storage_cfg->zero_copy_read.enabled,
+            storage_cfg->zero_copy_read.min_size / 1024,
+            storage_cfg->zero_copy_read.thread_count,
+            storage_cfg->slice_checksum.enabled, fs_crc32c_impl_name(),
+            storage_cfg->slice_checksum.verify_on_read,
+            storage_cfg->slice_checksum.verify_on_reclaim,
+            storage_cfg->slice_merge.enabled,
+            storage_cfg->slice_merge.interval,
+            slice_compressor_get_caption(storage_cfg->compression.type),
+            storage_cfg->compression.min_size / 1024,
+            storage_cfg->compression.zstd_level,
+            storage_cfg->compression.decompress_threads,
+            durability_get_mode_caption(storage_cfg->durability.mode),
+            storage_cfg->durability.sync_interval_ms,
+            storage_cfg->durability.group_commit_window_ms,
+            ob_index_get_hashtable_type_caption(
+                storage_cfg->object_block.hashtable_type),
             storage_cfg->object_block.hashtable_capacity,
             storage_cfg->object_block.shared_locks_count,
             storage_cfg->prealloc_space.ratio_per_path * 100.00,
@@ -674,16 +1159,15 @@ void storage_config_to_log(FSStorageConfig *storage_cfg)
             storage_cfg->trunk_file_size / (1024 * 1024),
             storage_cfg->max_trunk_files_per_subdir,
             storage_cfg->discard_remain_space_size,
-            /*
             storage_cfg->write_cache_to_hd.on_usage * 100.00,
             storage_cfg->write_cache_to_hd.start_time.hour,
             storage_cfg->write_cache_to_hd.start_time.minute,
             storage_cfg->write_cache_to_hd.end_time.hour,
             storage_cfg->write_cache_to_hd.end_time.minute,
-            */
             storage_cfg->reclaim_trunks_on_path_usage * 100.00,
             storage_cfg->never_reclaim_on_trunk_usage * 100.00);
 
+    io_classes_to_log(storage_cfg);
     log_paths(&storage_cfg->write_cache, "write cache paths");
     log_paths(&storage_cfg->store_path, "store paths");
 }
@@ -32,6 +32,8 @@ typedef struct {
     int write_thread_count;
     int read_thread_count;
     int prealloc_trunks;
+    bool direct_io;  //open trunk files with O_DIRECT
+    char compress_type;  //FS_COMPRESS_TYPE_xxx for the new slices
     struct {
         int64_t value;
         double ratio;
@@ -77,13 +79,56 @@ typedef struct {
 
     int write_threads_per_path;
     int read_threads_per_path;
+    bool read_work_stealing;  //the idle readers steal from the busy siblings
     double reserved_space_per_disk;
     int max_trunk_files_per_subdir;
     int64_t trunk_file_size;
     int discard_remain_space_size;
     int trunk_prealloc_threads;
-    int fd_cache_capacity_per_read_thread;
+    int fd_cache_capacity;  //shared by all disk IO threads
     struct {
+        bool enabled;
+        int queue_depth;  //max in-flight requests per IO thread
+    } io_uring;
+    int io_merge_max_size;    //0 for disable merge
+    int read_merge_gap_size;  //the max hole between the merged reads
+    int read_ahead_size;      //0 for disable read ahead
+    struct {
+        int64_t capacity;  //in bytes, 0 for disable the read cache
+        int shard_count;
+    } read_cache;
+    struct {
+        bool enabled;  //send the trunk data to the socket by sendfile
+        int min_size;  //the min read length for zero copy
+        int thread_count;
+    } zero_copy_read;
+    struct {
+        bool enabled;  //calculate the CRC32C of the slice on write
+        bool verify_on_read;
+        bool verify_on_reclaim;
+    } slice_checksum;
+    struct {
+        bool enabled;  //merge the adjacent and contiguous slices
+        int interval;  //of the background merge in seconds, 0 for disable
+    } slice_merge;
+    struct {
+        char type;     //the default of the paths, FS_COMPRESS_TYPE_xxx
+        int min_size;  //the min slice length to compress
+        int zstd_level;
+        int decompress_threads;
+    } compression;
+    struct {
+        int weight;  //the share of the weighted fair queueing
+        int64_t max_bandwidth;  //bytes per second per path, 0 for unlimited
+        int max_iops;  //per path, 0 for unlimited
+    } io_classes[FS_IO_CLASS_COUNT];  //indexed by FS_IO_CLASS_xxx
+    struct {
+        int mode;  //FS_DURABILITY_MODE_xxx
+        int sync_interval_ms;        //for periodic mode
+        int group_commit_window_ms;  //for group commit mode
+    } durability;
+    struct {
+        int hashtable_type;  //OB_HASHTABLE_TYPE_xxx
         int shared_locks_count;
         int64_t hashtable_capacity;
     } object_block;
@@ -111,6 +156,8 @@ extern "C" {
 
     void storage_config_to_log(FSStorageConfig *storage_cfg);
 
+    const char *storage_config_get_io_class_caption(const int io_class);
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,6 +25,18 @@
 #define FS_MAX_SPLIT_COUNT_PER_SPACE_ALLOC   2
 #define FS_SLICE_SN_PARRAY_INIT_ALLOC_COUNT  4
 
+#define FS_COMPRESS_TYPE_NONE  0
+#define FS_COMPRESS_TYPE_LZ4   1
+#define FS_COMPRESS_TYPE_ZSTD  2
+
+#define OB_HASHTABLE_TYPE_CHAIN            0
+#define OB_HASHTABLE_TYPE_OPEN_ADDRESSING  1
+
+/* the data length in the trunk file */
+#define FS_SLICE_IO_LENGTH(slice) ((slice)->compress.type ==  \
+        FS_COMPRESS_TYPE_NONE ? (slice)->ssize.length :  \
+        (slice)->compress.length)
+
 struct ob_slice_entry;
 struct fs_data_operation;
 struct fs_slice_op_context;
@@ -67,36 +79,97 @@ typedef enum ob_slice_type {
     OB_SLICE_TYPE_ALLOC = 'A'  /* allocate slice (index and space allocate only) */
 } OBSliceType;
 
+struct ob_retired_buffer;
 typedef struct {
     UniqSkiplistFactory factory;
     struct fast_mblock_man ob_allocator;    //for ob_entry
     struct fast_mblock_man slice_allocator; //for slice_entry
     pthread_lock_cond_pair_t lcp;   //for lock and notify
+    volatile int64_t seq;  //odd when the lock held, for the lockless reads
+    volatile int readers[2];  //the lockless readers by the epoch slot
+    int64_t slice_map_bytes;  //the slice arrays of the blocks, for stat
+    struct {
+        struct ob_retired_buffer *head;
+        struct ob_retired_buffer *tail;
+    } retired;  //the freed buffers which the lockless readers may access
 } OBSharedContext;
 
+#define OB_SLICE_MAP_INLINE_COUNT  2
+
+/* the sorted slices of the object block: inline for the small count,
+   the sorted array for more, and the skiplist only when fragmented */
+typedef struct ob_slice_map {
+    int count;
+    int alloc;  //0 for inline, -1 for skiplist, > 0 for the array
+    union {
+        struct ob_slice_entry *inlines[OB_SLICE_MAP_INLINE_COUNT];
+        struct ob_slice_entry **array;
+        UniqSkiplist *skiplist;  //the element is OBSliceEntry
+    };
+} OBSliceMap;
+
 typedef struct ob_entry {
     FSBlockKey bkey;
     int reclaiming_count;
-    UniqSkiplist *slices;  //the element is OBSliceEntry
-    struct ob_entry *next; //for hashtable
+    OBSliceMap slices;
+    struct ob_entry *next; //for chain hashtable only, MUST be the last field
 } OBEntry;
 
+#define OB_OPEN_GROUP_SIZE  7
+
+/* the group of the open addressing hashtable is in one cache line,
+   the control byte is the 7 bits hash tag of the used slot */
 typedef struct {
-    int64_t count;
-    int64_t capacity;
-    OBEntry **buckets;
+    int8_t ctrls[OB_OPEN_GROUP_SIZE + 1];  //the last byte for padding
+    OBEntry *slots[OB_OPEN_GROUP_SIZE];
+} OBOpenGroup;
+
+/* the open addressing sub table, one shard per shared context */
+typedef struct {
+    int64_t group_count;  //power of 2
+    int64_t capacity;     //slot count
+    int64_t count;        //used slots
+    int64_t deleted;      //deleted slots (tombstones)
+    OBOpenGroup *groups;
+} OBOpenShard;
+
+/* the chain hashtable grows online: the buckets of each shared context
+   are migrated to the new bucket array incrementally under its lock */
+typedef struct {
+    OBEntry **buckets;   //the new buckets, NULL when NOT resizing
+    volatile int64_t capacity;
+    int64_t *cursors;    //the migrated bucket count of each shared context
+    volatile int done_count;  //the shared contexts which migration done
+} OBChainResizeInfo;
+
+typedef struct {
+    int type;  //OB_HASHTABLE_TYPE_xxx
+    volatile int64_t count;  //the object block count, for chain only
+    volatile int64_t capacity;
+    OBEntry **buckets;     //for chain
+    OBChainResizeInfo resize;  //for chain
+    OBOpenShard *shards;   //for open addressing
     bool modify_sallocator; //if modify storage allocator
     bool modify_used_space; //if modify used space
 } OBHashtable;
 
+/* the fields are ordered without padding, 96 bytes for 64 bits OS,
+   there are hundreds of millions of slices for the large node */
 typedef struct ob_slice_entry {
     OBEntry *ob;
-    OBSliceType type;    //in file or memory as fallocate
     volatile int ref_count;
+    uint32_t crc32;      //CRC32C of the slice data
     FSSliceSize ssize;
+    struct {
+        int length;  //the compressed data length in the space
+        int offset;  //the slice offset in the decompressed data
+        char type;   //FS_COMPRESS_TYPE_xxx
+    } compress;
+    char type;           //OBSliceType: in file or memory as fallocate
+    bool has_crc;        //false when the slice is a part of the written one
+    uint16_t ctx_index;  //the shared context of the allocator for free
     FSTrunkSpaceInfo space;
     struct fc_list_head dlink;  //used in trunk entry for trunk reclaiming
-    struct fast_mblock_man *allocator; //for free
 } OBSliceEntry;
 
 typedef struct ob_slice_ptr_array {
@@ -114,6 +187,7 @@ typedef struct fs_slice_op_context {
     volatile short counter;
     short result;
     int done_bytes;
+    int64_t cache_version;  //the read cache version when the read starts
 
     struct {
         bool deal_done;  //for continue deal check
@@ -122,6 +196,7 @@ typedef struct fs_slice_op_context {
             bool log_replica;  //false for trunk reclaim
         } write_binlog;
         char source;           //for binlog write
+        char io_class;         //FS_IO_CLASS_xxx for disk IO scheduler
         int data_group_id;
         uint64_t data_version;  //for replica binlog
         uint64_t sn;            //for slice binlog
@@ -132,6 +207,8 @@ typedef struct fs_slice_op_context {
         char *buff;  //read or write buffer
     } info;
 
+    char *compress_buff;  //the compressed data of the slice write
+
     struct {
         int space_changed;  //increase /decrease space in bytes for slice operate
         FSSliceSNPairArray sarray;
@@ -157,6 +234,8 @@ typedef struct fs_trunk_file_info {
     } used;
     int64_t size;        //file size
     int64_t free_start;  //free space offset
+    volatile int pin_count;  //the zero copy senders of the trunk data
+    time_t sealed_time;  //removed from the freelist, for write cache migration
 
     struct {
         struct fs_trunk_file_info *next;
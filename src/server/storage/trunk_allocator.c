@@ -167,6 +167,8 @@ int trunk_allocator_add(FSTrunkAllocator *allocator,
     trunk_info->used.bytes = 0;
     trunk_info->used.count = 0;
     trunk_info->free_start = 0;
+    trunk_info->sealed_time = 0;
+    trunk_info->pin_count = 0;
     PTHREAD_MUTEX_UNLOCK(&allocator->freelist.lcp.lock);
 
     PTHREAD_MUTEX_LOCK(&allocator->trunks.lock);
@@ -206,6 +208,12 @@ FSTrunkFreelistType trunk_allocator_add_to_freelist(
 {
     FSTrunkFreelist *freelist;
 
+    //the reclaim freelist is for the store paths only
+    if (storage_allocator_is_write_cache(allocator)) {
+        trunk_freelist_add(&allocator->freelist, trunk_info);
+        return fs_freelist_type_normal;
+    }
+
     PTHREAD_MUTEX_LOCK(&g_allocator_mgr->reclaim_freelist.lcp.lock);
     if (g_allocator_mgr->reclaim_freelist.count < g_allocator_mgr->
             reclaim_freelist.water_mark_trunks)
@@ -289,6 +297,24 @@ int trunk_allocator_delete_slice(FSTrunkAllocator *allocator,
     return result;
 }
 
+FSTrunkFileInfo *trunk_allocator_pin(FSTrunkAllocator *allocator,
+        const int64_t trunk_id)
+{
+    FSTrunkFileInfo target;
+    FSTrunkFileInfo *trunk_info;
+
+    target.id_info.id = trunk_id;
+    PTHREAD_MUTEX_LOCK(&allocator->trunks.lock);
+    if ((trunk_info=(FSTrunkFileInfo *)uniq_skiplist_find(
+                    allocator->trunks.by_id, &target)) != NULL)
+    {
+        __sync_add_and_fetch(&trunk_info->pin_count, 1);
+    }
+    PTHREAD_MUTEX_UNLOCK(&allocator->trunks.lock);
+
+    return trunk_info;
+}
+
 static bool can_add_to_freelist(FSTrunkFileInfo *trunk_info)
 {
     int64_t remain_size;
@@ -117,6 +117,17 @@ extern "C" {
     FSTrunkFreelistType trunk_allocator_add_to_freelist(
             FSTrunkAllocator *allocator, FSTrunkFileInfo *trunk_info);
 
+    /* pin the trunk for reading the data out of the slice index,
+       the reclaim waits the pinned trunk before reusing its space
+       return NULL when the trunk not exist */
+    FSTrunkFileInfo *trunk_allocator_pin(FSTrunkAllocator *allocator,
+            const int64_t trunk_id);
+
+    static inline void trunk_allocator_unpin(FSTrunkFileInfo *trunk_info)
+    {
+        __sync_sub_and_fetch(&trunk_info->pin_count, 1);
+    }
+
     void trunk_allocator_deal_on_ready(FSTrunkAllocator *allocator);
 
     static inline bool trunk_allocator_is_available(FSTrunkAllocator *allocator)
@@ -100,6 +100,11 @@ void trunk_freelist_add(FSTrunkFreelist *freelist,
     int64_t avail_bytes;
 
     PTHREAD_MUTEX_LOCK(&freelist->lcp.lock);
+    if (trunk_info->allocator->path_info->direct_io) {
+        //the free start maybe unaligned when direct_io changed to true
+        trunk_info->free_start = FC_MIN(FS_DIRECT_IO_ALIGN(
+                    trunk_info->free_start), trunk_info->size);
+    }
     trunk_info->alloc.next = NULL;
     if (freelist->head == NULL) {
         freelist->head = trunk_info;
@@ -127,6 +132,7 @@ static void trunk_freelist_remove(FSTrunkFreelist *freelist)
         freelist->tail = NULL;
     }
     freelist->count--;
+    trunk_info->sealed_time = g_current_time;
 
     fs_set_trunk_status(trunk_info, FS_TRUNK_STATUS_REPUSH);
     push_trunk_util_event_force(trunk_info->allocator,
@@ -186,7 +192,11 @@ int trunk_freelist_alloc_space(struct fs_trunk_allocator
     FSTrunkSpaceInfo *space_info;
     FSTrunkFileInfo *trunk_info;
 
-    aligned_size = MEM_ALIGN(size);
+    if (allocator->path_info->direct_io) {
+        aligned_size = FS_DIRECT_IO_ALIGN(size);
+    } else {
+        aligned_size = MEM_ALIGN(size);
+    }
     space_info = spaces;
 
     PTHREAD_MUTEX_LOCK(&freelist->lcp.lock);
@@ -261,3 +271,44 @@ int trunk_freelist_alloc_space(struct fs_trunk_allocator
 
     return result;
 }
+
+int trunk_freelist_alloc_contiguous(struct fs_trunk_allocator
+        *allocator, FSTrunkFreelist *freelist, const int size,
+        FSTrunkSpaceInfo *space)
+{
+    int aligned_size;
+    int result;
+    FSTrunkFileInfo *trunk_info;
+
+    if (allocator->path_info->direct_io) {
+        aligned_size = FS_DIRECT_IO_ALIGN(size);
+    } else {
+        aligned_size = MEM_ALIGN(size);
+    }
+
+    result = ENOSPC;
+    PTHREAD_MUTEX_LOCK(&freelist->lcp.lock);
+    /* the tail of the head trunk is kept for the split allocations,
+       the trunk after the head is removed when it becomes the head */
+    for (trunk_info=freelist->head; trunk_info!=NULL;
+            trunk_info=trunk_info->alloc.next)
+    {
+        if (FS_TRUNK_AVAIL_SPACE(trunk_info) < aligned_size) {
+            continue;
+        }
+
+        TRUNK_ALLOC_SPACE(trunk_info, space, aligned_size);
+        if (trunk_info == freelist->head && FS_TRUNK_AVAIL_SPACE(
+                    trunk_info) < STORAGE_CFG.discard_remain_space_size)
+        {
+            trunk_freelist_remove(freelist);
+            __sync_sub_and_fetch(&trunk_info->allocator->path_info->
+                    trunk_stat.avail, FS_TRUNK_AVAIL_SPACE(trunk_info));
+        }
+        result = 0;
+        break;
+    }
+    PTHREAD_MUTEX_UNLOCK(&freelist->lcp.lock);
+
+    return result;
+}
@@ -45,6 +45,12 @@ extern "C" {
             const uint32_t blk_hc, const int size,
             FSTrunkSpaceInfo *spaces, int *count, const bool is_normal);
 
+    /* allocate one contiguous space from the first trunk which has enough
+       space without waiting, return ENOSPC when no such trunk */
+    int trunk_freelist_alloc_contiguous(struct fs_trunk_allocator
+            *allocator, FSTrunkFreelist *freelist, const int size,
+            FSTrunkSpaceInfo *space);
+
 #ifdef __cplusplus
 }
 #endif
@@ -26,12 +26,14 @@
 #include "../server_global.h"
 #include "../dio/trunk_io_thread.h"
 #include "storage_allocator.h"
+#include "read_cache.h"
 #include "trunk_reclaim.h"
 #include "trunk_maker.h"
 
 struct trunk_maker_thread_info;
 typedef struct trunk_maker_task {
     bool urgent;
+    bool migrate;  //migrate a trunk of the write cache to the store paths
     FSTrunkAllocator *allocator;
     struct {
         trunk_allocate_done_callback callback;
@@ -231,17 +233,67 @@ static int do_prealloc_trunk(TrunkMakerThreadInfo *thread,
     return prealloc_trunk_finish(task->allocator, &space, freelist_type);
 }
 
-static int do_reclaim_trunk(TrunkMakerThreadInfo *thread,
-        TrunkMakerTask *task, FSTrunkFreelistType *freelist_type)
+static int reclaim_trunk(TrunkMakerThreadInfo *thread,
+        FSTrunkAllocator *allocator, FSTrunkFileInfo *trunk,
+        const char *caption, FSTrunkFreelistType *freelist_type)
 {
-    double ratio_thredhold;
-    FSTrunkFileInfo *trunk;
     int64_t used_bytes;
     int64_t time_used;
     char time_buff[64];
     char time_prompt[64];
     int result;
 
+    used_bytes = __sync_fetch_and_add(&trunk->used.bytes, 0);
+    if (used_bytes > 0) {
+        int64_t start_time_us;
+        start_time_us = get_current_time_us();
+        fs_set_trunk_status(trunk, FS_TRUNK_STATUS_RECLAIMING);
+        result = trunk_reclaim(allocator, trunk, &thread->reclaim_ctx);
+        time_used = (get_current_time_us() - start_time_us) / 1000;
+    } else {
+        time_used = 0;
+        result = 0;
+    }
+
+    long_to_comma_str(time_used, time_buff);
+    sprintf(time_prompt, "time used: %s ms", time_buff);
+    logInfo("file: "__FILE__", line: %d, "
+            "path index: %d, %s trunk id: %"PRId64", "
+            "last used bytes: %"PRId64", current used bytes: %"PRId64", "
+            "last usage ratio: %.2f%%, result: %d, %s", __LINE__,
+            allocator->path_info->store.index, caption, trunk->id_info.id,
+            used_bytes, trunk->used.bytes, 100.00 * (double)used_bytes /
+            (double)trunk->size, result, time_prompt);
+
+    if (result == 0) {
+        read_cache_invalidate_trunk(trunk->id_info.id, trunk->size);
+
+        //the zero copy senders may still send the data of the trunk
+        while (__sync_add_and_fetch(&trunk->pin_count, 0) > 0 &&
+                SF_G_CONTINUE_FLAG)
+        {
+            fc_sleep_ms(10);
+        }
+        PTHREAD_MUTEX_LOCK(&allocator->freelist.lcp.lock);
+        trunk->free_start = 0;
+        PTHREAD_MUTEX_UNLOCK(&allocator->freelist.lcp.lock);
+
+        uniq_skiplist_delete(allocator->trunks.by_size, trunk);
+        *freelist_type = trunk_allocator_add_to_freelist(allocator, trunk);
+    } else {
+        fs_set_trunk_status(trunk, FS_TRUNK_STATUS_NONE); //rollback status
+    }
+
+    return result;
+}
+
+static int do_reclaim_trunk(TrunkMakerThreadInfo *thread,
+        TrunkMakerTask *task, FSTrunkFreelistType *freelist_type)
+{
+    double ratio_thredhold;
+    FSTrunkFileInfo *trunk;
+    int64_t used_bytes;
+
     if (task->urgent || g_current_time - task->allocator->
             reclaim.last_deal_time > 10)
     {
@@ -276,40 +328,51 @@ static int do_reclaim_trunk(TrunkMakerThreadInfo *thread,
         return ENOENT;
     }
 
-    if (used_bytes > 0) {
-        int64_t start_time_us;
-        start_time_us = get_current_time_us();
-        fs_set_trunk_status(trunk, FS_TRUNK_STATUS_RECLAIMING);
-        result = trunk_reclaim(task->allocator, trunk,
-                &thread->reclaim_ctx);
-        time_used = (get_current_time_us() - start_time_us) / 1000;
-    } else {
-        time_used = 0;
-        result = 0;
+    return reclaim_trunk(thread, task->allocator, trunk,
+            "reclaiming", freelist_type);
+}
+
+/* the coldest trunk of the write cache is the earliest full one,
+   the less used one goes first when the same */
+static FSTrunkFileInfo *get_coldest_trunk(FSTrunkAllocator *allocator)
+{
+    UniqSkiplistIterator it;
+    FSTrunkFileInfo *trunk;
+    FSTrunkFileInfo *coldest;
+
+    coldest = NULL;
+    uniq_skiplist_iterator(allocator->trunks.by_size, &it);
+    while ((trunk=(FSTrunkFileInfo *)uniq_skiplist_next(&it)) != NULL) {
+        if (__sync_add_and_fetch(&trunk->status, 0) !=
+                FS_TRUNK_STATUS_NONE)
+        {
+            continue;
+        }
+
+        if (coldest == NULL || trunk->sealed_time < coldest->sealed_time) {
+            coldest = trunk;
+        }
     }
 
-    long_to_comma_str(time_used, time_buff);
-    sprintf(time_prompt, "time used: %s ms", time_buff);
-    logInfo("file: "__FILE__", line: %d, "
-            "path index: %d, reclaiming trunk id: %"PRId64", "
-            "last used bytes: %"PRId64", current used bytes: %"PRId64", "
-            "last usage ratio: %.2f%%, result: %d, %s", __LINE__, task->
-            allocator->path_info->store.index, trunk->id_info.id,
-            used_bytes, trunk->used.bytes, 100.00 * (double)used_bytes /
-            (double)trunk->size, result, time_prompt);
+    return coldest;
+}
 
-    if (result == 0) {
-        PTHREAD_MUTEX_LOCK(&task->allocator->freelist.lcp.lock);
-        trunk->free_start = 0;
-        PTHREAD_MUTEX_UNLOCK(&task->allocator->freelist.lcp.lock);
+/* migrate the slices of the coldest trunk to the store paths, the
+   reclaim writes never allocate space from the write cache */
+static int do_migrate_trunk(TrunkMakerThreadInfo *thread,
+        TrunkMakerTask *task, FSTrunkFreelistType *freelist_type)
+{
+    FSTrunkFileInfo *trunk;
 
-        uniq_skiplist_delete(task->allocator->trunks.by_size, trunk);
-        *freelist_type = trunk_allocator_add_to_freelist(task->allocator, trunk);
-    } else {
-        fs_set_trunk_status(trunk, FS_TRUNK_STATUS_NONE); //rollback status
+    *freelist_type = fs_freelist_type_none;
+    task->allocator->reclaim.last_deal_time = g_current_time;
+    deal_trunk_util_change_events(task->allocator);
+    if ((trunk=get_coldest_trunk(task->allocator)) == NULL) {
+        return ENOENT;
     }
 
-    return result;
+    return reclaim_trunk(thread, task->allocator, trunk,
+            "migrating", freelist_type);
 }
 
 static int do_allocate_trunk(TrunkMakerThreadInfo *thread, TrunkMakerTask *task,
@@ -360,8 +423,13 @@ static void deal_allocate_task(TrunkMakerThreadInfo *thread,
     FSTrunkFreelistType freelist_type;
 
     do {
-        result = do_allocate_trunk(thread, task,
-                &freelist_type, &is_new_trunk);
+        if (task->migrate) {
+            is_new_trunk = false;
+            result = do_migrate_trunk(thread, task, &freelist_type);
+        } else {
+            result = do_allocate_trunk(thread, task,
+                    &freelist_type, &is_new_trunk);
+        }
         if (task->notify.callback != NULL) {
             task->notify.callback(task->allocator, result,
                     is_new_trunk, task->notify.arg);
@@ -462,8 +530,9 @@ int trunk_maker_init()
     return 0;
 }
 
-int trunk_maker_allocate_ex(FSTrunkAllocator *allocator, const bool urgent,
-        const bool need_lock, trunk_allocate_done_callback callback, void *arg)
+static int trunk_maker_push_task(FSTrunkAllocator *allocator,
+        const bool urgent, const bool migrate, const bool need_lock,
+        trunk_allocate_done_callback callback, void *arg)
 {
     TrunkMakerThreadInfo *thread;
     TrunkMakerTask *task;
@@ -477,6 +546,7 @@ int trunk_maker_allocate_ex(FSTrunkAllocator *allocator, const bool urgent,
     }
 
     task->urgent = urgent;
+    task->migrate = migrate;
     task->allocator = allocator;
     task->notify.callback = callback;
     task->notify.arg = arg;
@@ -484,3 +554,21 @@ int trunk_maker_allocate_ex(FSTrunkAllocator *allocator, const bool urgent,
     fc_queue_push(&thread->queue, task);
     return 0;
 }
+
+int trunk_maker_allocate_ex(FSTrunkAllocator *allocator, const bool urgent,
+        const bool need_lock, trunk_allocate_done_callback callback, void *arg)
+{
+    const bool migrate = false;
+    return trunk_maker_push_task(allocator, urgent,
+            migrate, need_lock, callback, arg);
+}
+
+int trunk_maker_migrate(FSTrunkAllocator *allocator,
+        trunk_allocate_done_callback callback, void *arg)
+{
+    const bool urgent = false;
+    const bool migrate = true;
+    const bool need_lock = true;
+    return trunk_maker_push_task(allocator, urgent,
+            migrate, need_lock, callback, arg);
+}
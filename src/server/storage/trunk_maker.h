@@ -39,6 +39,10 @@ extern "C" {
 #define trunk_maker_allocate(allocator) \
     trunk_maker_allocate_ex(allocator, false, true, NULL, NULL)
 
+    //migrate the coldest trunk of the write cache path to the store paths
+    int trunk_maker_migrate(FSTrunkAllocator *allocator,
+            trunk_allocate_done_callback callback, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -47,6 +47,7 @@ int trunk_reclaim_init_ctx(TrunkReclaimContext *rctx)
 
     ob_index_init_slice_ptr_array(&rctx->op_ctx.slice_ptr_array);
     rctx->op_ctx.info.source = BINLOG_SOURCE_RECLAIM;
+    rctx->op_ctx.info.io_class = FS_IO_CLASS_RECLAIM;
     rctx->op_ctx.info.write_binlog.log_replica = false;
     rctx->op_ctx.info.data_version = 0;
     rctx->op_ctx.info.myself = NULL;
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include <time.h>
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/sched_thread.h"
+#include "sf/sf_global.h"
+#include "../server_global.h"
+#include "storage_allocator.h"
+#include "trunk_maker.h"
+#include "write_cache_migrator.h"
+
+#define WRITE_CACHE_MIGRATE_CHECK_INTERVAL  5
+#define WRITE_CACHE_MIGRATE_USAGE_GAP    0.05  //stop under on_usage - gap
+
+typedef struct write_cache_migrator_info {
+    FSTrunkAllocator *allocator;
+    volatile int migrating;  //a migrate task in the trunk maker
+    bool by_usage;           //triggered by the usage of the cache
+    volatile int64_t migrated_trunks;  //since triggered by the usage
+} WriteCacheMigratorInfo;
+
+typedef struct write_cache_migrator_array {
+    int count;
+    WriteCacheMigratorInfo *migrators;
+} WriteCacheMigratorArray;
+
+static WriteCacheMigratorArray migrator_array = {0, NULL};
+
+//the used ratio of the cache capacity include the free disk space
+static double get_cache_usage(FSStoragePathInfo *path_info)
+{
+    int64_t disk_avail;
+    int64_t capacity;
+
+    storage_config_calc_path_avail_space(path_info);
+    disk_avail = path_info->space_stat.avail -
+        path_info->reserved_space.value;
+    if (disk_avail < 0) {
+        disk_avail = 0;
+    }
+
+    capacity = __sync_add_and_fetch(&path_info->trunk_stat.total, 0) +
+        disk_avail;
+    if (capacity <= 0) {
+        return 0.00;
+    }
+    return (double)__sync_add_and_fetch(&path_info->
+            trunk_stat.used, 0) / (double)capacity;
+}
+
+static bool in_migrate_time_window()
+{
+    struct tm tm_current;
+    time_t current_time;
+    int current;
+    int start;
+    int end;
+
+    start = STORAGE_CFG.write_cache_to_hd.start_time.hour * 60 +
+        STORAGE_CFG.write_cache_to_hd.start_time.minute;
+    end = STORAGE_CFG.write_cache_to_hd.end_time.hour * 60 +
+        STORAGE_CFG.write_cache_to_hd.end_time.minute;
+    if (start == end) {
+        return false;
+    }
+
+    current_time = g_current_time;
+    localtime_r(&current_time, &tm_current);
+    current = tm_current.tm_hour * 60 + tm_current.tm_min;
+    if (start < end) {
+        return current >= start && current < end;
+    } else {  //cross midnight
+        return current >= start || current < end;
+    }
+}
+
+static bool need_migrate(WriteCacheMigratorInfo *migrator)
+{
+    double usage;
+
+    usage = get_cache_usage(migrator->allocator->path_info);
+    if (usage >= STORAGE_CFG.write_cache_to_hd.on_usage) {
+        if (!migrator->by_usage) {
+            migrator->by_usage = true;
+            logInfo("file: "__FILE__", line: %d, "
+                    "write cache path: %s, usage: %.2f%% reach %.2f%%, "
+                    "start migrating to the store paths", __LINE__,
+                    migrator->allocator->path_info->store.path.str,
+                    usage * 100.00, STORAGE_CFG.write_cache_to_hd.
+                    on_usage * 100.00);
+        }
+    } else if (usage < STORAGE_CFG.write_cache_to_hd.on_usage -
+            WRITE_CACHE_MIGRATE_USAGE_GAP && migrator->by_usage)
+    {
+        migrator->by_usage = false;
+        logInfo("file: "__FILE__", line: %d, "
+                "write cache path: %s, usage: %.2f%%, stop migrating, "
+                "migrated trunk count: %"PRId64, __LINE__,
+                migrator->allocator->path_info->store.path.str,
+                usage * 100.00, __sync_fetch_and_and(
+                    &migrator->migrated_trunks, 0));
+    }
+
+    return migrator->by_usage || in_migrate_time_window();
+}
+
+static void migrate_done_callback(FSTrunkAllocator *allocator,
+        const int result, const bool is_new_trunk, void *arg)
+{
+    WriteCacheMigratorInfo *migrator;
+
+    migrator = (WriteCacheMigratorInfo *)arg;
+    if (result == 0) {
+        __sync_add_and_fetch(&migrator->migrated_trunks, 1);
+
+        //migrate the next trunk one by one until not needed
+        if (SF_G_CONTINUE_FLAG && need_migrate(migrator) &&
+                trunk_maker_migrate(allocator, migrate_done_callback,
+                    migrator) == 0)
+        {
+            return;
+        }
+    } else if (result != ENOENT) {
+        logWarning("file: "__FILE__", line: %d, "
+                "write cache path: %s, migrate trunk fail, "
+                "errno: %d, error info: %s", __LINE__,
+                allocator->path_info->store.path.str,
+                result, STRERROR(result));
+    }
+
+    __sync_bool_compare_and_swap(&migrator->migrating, 1, 0);
+}
+
+static int check_migrate_func(void *args)
+{
+    WriteCacheMigratorInfo *migrator;
+    WriteCacheMigratorInfo *end;
+    int result;
+
+    end = migrator_array.migrators + migrator_array.count;
+    for (migrator=migrator_array.migrators; migrator<end; migrator++) {
+        if (__sync_add_and_fetch(&migrator->migrating, 0) != 0 ||
+                !need_migrate(migrator))
+        {
+            continue;
+        }
+
+        if (!__sync_bool_compare_and_swap(&migrator->migrating, 0, 1)) {
+            continue;
+        }
+        if ((result=trunk_maker_migrate(migrator->allocator,
+                        migrate_done_callback, migrator)) != 0)
+        {
+            __sync_bool_compare_and_swap(&migrator->migrating, 1, 0);
+        }
+    }
+
+    return 0;
+}
+
+static int setup_check_migrate_schedule()
+{
+    ScheduleArray scheduleArray;
+    ScheduleEntry scheduleEntry;
+
+    INIT_SCHEDULE_ENTRY(scheduleEntry, sched_generate_next_id(),
+            TIME_NONE, TIME_NONE, TIME_NONE,
+            WRITE_CACHE_MIGRATE_CHECK_INTERVAL,
+            check_migrate_func, NULL);
+    scheduleArray.entries = &scheduleEntry;
+    scheduleArray.count = 1;
+    return sched_add_entries(&scheduleArray);
+}
+
+int write_cache_migrator_init()
+{
+    FSTrunkAllocator *allocator;
+    WriteCacheMigratorInfo *migrator;
+    int bytes;
+    int i;
+
+    if (g_allocator_mgr->write_cache.all.count == 0) {
+        return 0;
+    }
+
+    migrator_array.count = g_allocator_mgr->write_cache.all.count;
+    bytes = sizeof(WriteCacheMigratorInfo) * migrator_array.count;
+    migrator_array.migrators = (WriteCacheMigratorInfo *)fc_malloc(bytes);
+    if (migrator_array.migrators == NULL) {
+        return ENOMEM;
+    }
+    memset(migrator_array.migrators, 0, bytes);
+
+    allocator = g_allocator_mgr->write_cache.all.allocators;
+    migrator = migrator_array.migrators;
+    for (i=0; i<migrator_array.count; i++) {
+        migrator[i].allocator = allocator + i;
+    }
+
+    return setup_check_migrate_schedule();
+}
@@ -0,0 +1,668 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+#ifdef OS_LINUX
+#include <sys/sendfile.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+#include "fastcommon/shared_func.h"
+#include "fastcommon/logger.h"
+#include "fastcommon/fast_mblock.h"
+#include "fastcommon/fc_queue.h"
+#include "fastcommon/fc_list.h"
+#include "fastcommon/sched_thread.h"
+#include "fastcommon/pthread_func.h"
+#include "sf/sf_global.h"
+#include "sf/sf_nio.h"
+#include "common/fs_proto.h"
+#include "storage/object_block_index.h"
+#include "storage/storage_allocator.h"
+#include "storage/read_cache.h"
+#include "dio/trunk_io_thread.h"
+#include "zero_copy_sender.h"
+
+#ifdef OS_LINUX
+
+#define ZERO_COPY_ZERO_BUFFER_SIZE  (64 * 1024)
+#define ZERO_COPY_EPOLL_EVENTS      256
+#define ZERO_COPY_EPOLL_TIMEOUT_MS  1000
+
+#define ZERO_COPY_EXTENT_NONE    0
+#define ZERO_COPY_EXTENT_BUFFER  1
+#define ZERO_COPY_EXTENT_ZEROS   2
+#define ZERO_COPY_EXTENT_FILE    3
+
+typedef struct zero_copy_extent {
+    int type;     //ZERO_COPY_EXTENT_xxx
+    int length;   //the remain length to send
+    bool more;    //more data after this extent
+    const char *buff;  //for the buffer extent
+    int fd;            //for the file extent
+    int64_t offset;    //the file offset of the file extent
+    TrunkFDCacheEntry *fd_entry;  //NULL for the fd opened by self
+} ZeroCopyExtent;
+
+/* the progress of the send task, the thread switches to the other
+   tasks when the socket is NOT writable */
+typedef struct zero_copy_send_task {
+    struct fast_task_info *task;
+    int sock;  //dup of the task socket, not reused when the task closed
+    bool attached;   //if the socket attached to the epoll
+    int slice_index; //the next slice to send
+    int offset;      //the block offset of the next extent
+    int end_offset;
+    time_t expires;  //for the network timeout when waiting
+    FSProtoHeader header;
+    ZeroCopyExtent extent;
+    OBSlicePtrArray sarray;
+    struct {
+        FSTrunkFileInfo **trunks;
+        int alloc;
+        int count;
+    } pins;  //the trunks of the slices, pinned against the reclaim
+    struct fc_list_head dlink;  //for the waiting list
+    struct zero_copy_send_task *next;  //for the queue
+} ZeroCopySendTask;
+
+typedef struct zero_copy_send_thread {
+    struct fc_queue queue;
+    int epoll_fd;
+    int notify_fd;  //eventfd to wake up the thread for the new tasks
+    struct fc_list_head waiting;  //in the order of the expires
+} ZeroCopySendThread;
+
+typedef struct zero_copy_sender_context {
+    struct fast_mblock_man allocator;  //element: ZeroCopySendTask
+    ZeroCopySendThread *threads;
+    int thread_count;
+    volatile int next_thread;  //for round robin
+} ZeroCopySenderContext;
+
+static ZeroCopySenderContext zero_copy_ctx;
+static char zero_buffer[ZERO_COPY_ZERO_BUFFER_SIZE];
+
+static inline void set_buffer_extent(ZeroCopyExtent *extent,
+        const char *buff, const int length, const bool more)
+{
+    extent->type = ZERO_COPY_EXTENT_BUFFER;
+    extent->buff = buff;
+    extent->length = length;
+    extent->more = more;
+}
+
+static inline void set_zeros_extent(ZeroCopyExtent *extent,
+        const int length, const bool more)
+{
+    extent->type = ZERO_COPY_EXTENT_ZEROS;
+    extent->buff = zero_buffer;
+    extent->length = length;
+    extent->more = more;
+}
+
+static void release_extent(ZeroCopyExtent *extent)
+{
+    if (extent->type == ZERO_COPY_EXTENT_FILE) {
+        if (extent->fd_entry != NULL) {
+            trunk_fd_cache_release(extent->fd_entry);
+            extent->fd_entry = NULL;
+        } else {
+            close(extent->fd);
+        }
+    }
+
+    extent->type = ZERO_COPY_EXTENT_NONE;
+    extent->length = 0;
+}
+
+/* the trunk fd of the O_DIRECT path is NOT used because sendfile
+   reads through the page cache */
+static int set_slice_extent(ZeroCopyExtent *extent,
+        OBSliceEntry *slice, const bool more)
+{
+    char trunk_filename[PATH_MAX];
+    int result;
+
+    if (!PATHS_BY_INDEX_PPTR[slice->space.store->index]->direct_io &&
+            (extent->fd_entry=trunk_fd_cache_get(
+                slice->space.id_info.id)) != NULL)
+    {
+        extent->fd = extent->fd_entry->pair.fd;
+    } else {
+        trunk_io_thread_get_filename(&slice->space,
+                trunk_filename, sizeof(trunk_filename));
+        if ((extent->fd=open(trunk_filename, O_RDONLY)) < 0) {
+            result = errno != 0 ? errno : EACCES;
+            logError("file: "__FILE__", line: %d, "
+                    "open file \"%s\" fail, errno: %d, error info: %s",
+                    __LINE__, trunk_filename, result, STRERROR(result));
+            return result;
+        }
+    }
+
+    extent->type = ZERO_COPY_EXTENT_FILE;
+    extent->offset = slice->space.offset;
+    extent->length = slice->ssize.length;
+    extent->more = more;
+    return 0;
+}
+
+/* the holes and the unwritten ranges are sent as zeros,
+   the extent type is none when all sent */
+static int next_extent(ZeroCopySendTask *st)
+{
+    OBSliceEntry *slice;
+    int hole_len;
+
+    if (st->slice_index < st->sarray.count) {
+        slice = st->sarray.slices[st->slice_index];
+        hole_len = slice->ssize.offset - st->offset;
+        if (hole_len > 0) {
+            st->offset = slice->ssize.offset;
+            set_zeros_extent(&st->extent, hole_len, true);
+            return 0;
+        }
+
+        st->slice_index++;
+        st->offset = slice->ssize.offset + slice->ssize.length;
+        if (slice->type == OB_SLICE_TYPE_ALLOC) {
+            set_zeros_extent(&st->extent, slice->ssize.length,
+                    st->offset < st->end_offset);
+            return 0;
+        }
+        return set_slice_extent(&st->extent, slice,
+                st->offset < st->end_offset);
+    }
+
+    if (st->end_offset > st->offset) {
+        set_zeros_extent(&st->extent, st->end_offset - st->offset, false);
+        st->offset = st->end_offset;
+    }
+    return 0;
+}
+
+/* send by the non-blocking socket,
+   return EAGAIN when the socket is NOT writable */
+static int send_extent(const int sock, ZeroCopyExtent *extent)
+{
+    int result;
+    int flags;
+    int length;
+    off_t file_offset;
+    ssize_t bytes;
+
+    while (extent->length > 0) {
+        if (extent->type == ZERO_COPY_EXTENT_FILE) {
+            file_offset = extent->offset;
+            bytes = sendfile(sock, extent->fd,
+                    &file_offset, extent->length);
+            if (bytes == 0) {
+                return ENODATA;  //the trunk file is truncated
+            }
+        } else {
+            length = extent->length;
+            if (extent->type == ZERO_COPY_EXTENT_ZEROS &&
+                    length > ZERO_COPY_ZERO_BUFFER_SIZE)
+            {
+                length = ZERO_COPY_ZERO_BUFFER_SIZE;
+            }
+
+            flags = MSG_NOSIGNAL;
+#ifdef MSG_MORE
+            if (extent->more || length < extent->length) {
+                flags |= MSG_MORE;
+            }
+#endif
+            bytes = send(sock, extent->buff, length, flags);
+        }
+
+        if (bytes < 0) {
+            result = errno != 0 ? errno : EIO;
+            if (result == EINTR) {
+                continue;
+            } else if (result == EAGAIN || result == EWOULDBLOCK) {
+                return EAGAIN;
+            }
+            return result;
+        }
+
+        extent->length -= bytes;
+        if (extent->type == ZERO_COPY_EXTENT_FILE) {
+            extent->offset += bytes;
+        } else if (extent->type == ZERO_COPY_EXTENT_BUFFER) {
+            extent->buff += bytes;
+        }
+    }
+
+    return 0;
+}
+
+static int send_extents(ZeroCopySendTask *st)
+{
+    int result;
+
+    while (1) {
+        if ((result=send_extent(st->sock, &st->extent)) != 0) {
+            return result;
+        }
+
+        release_extent(&st->extent);
+        if ((result=next_extent(st)) != 0) {
+            return result;
+        }
+        if (st->extent.type == ZERO_COPY_EXTENT_NONE) {
+            return 0;
+        }
+    }
+}
+
+static void free_slices(ZeroCopySendTask *st)
+{
+    OBSliceEntry **pp;
+    OBSliceEntry **end;
+    int i;
+
+    for (i=0; i<st->pins.count; i++) {
+        trunk_allocator_unpin(st->pins.trunks[i]);
+    }
+    st->pins.count = 0;
+
+    end = st->sarray.slices + st->sarray.count;
+    for (pp=st->sarray.slices; pp<end; pp++) {
+        ob_index_free_slice(*pp);
+    }
+    st->sarray.count = 0;
+}
+
+static int pin_trunk(ZeroCopySendTask *st, OBSliceEntry *slice)
+{
+    FSTrunkFileInfo **trunks;
+    int alloc;
+
+    if (st->pins.count == st->pins.alloc) {
+        alloc = (st->pins.alloc > 0 ? st->pins.alloc * 2 : 8);
+        if ((trunks=(FSTrunkFileInfo **)fc_malloc(sizeof(
+                            FSTrunkFileInfo *) * alloc)) == NULL)
+        {
+            return ENOMEM;
+        }
+        if (st->pins.trunks != NULL) {
+            memcpy(trunks, st->pins.trunks, sizeof(FSTrunkFileInfo *) *
+                    st->pins.count);
+            free(st->pins.trunks);
+        }
+        st->pins.trunks = trunks;
+        st->pins.alloc = alloc;
+    }
+
+    if ((st->pins.trunks[st->pins.count]=storage_allocator_pin_trunk(
+                    &slice->space)) == NULL)
+    {
+        return ENOENT;
+    }
+    st->pins.count++;
+    return 0;
+}
+
+/* get the slices and pin their trunks, the trunk space is NOT reused
+   until unpinned because the reclaim increases the read cache version
+   before waiting the pinned trunks.
+   return EOPNOTSUPP for reading by the normal path */
+static int get_and_pin_slices(ZeroCopySendTask *st)
+{
+    struct fast_task_info *task;
+    OBSliceEntry **pp;
+    OBSliceEntry **end;
+    int64_t version;
+    int result;
+
+    task = st->task;
+    version = read_cache_get_version();
+    if ((result=ob_index_get_slices(&OP_CTX_INFO.bs_key,
+                    &st->sarray, false)) != 0)
+    {
+        return result;
+    }
+
+    end = st->sarray.slices + st->sarray.count;
+    for (pp=st->sarray.slices; pp<end; pp++) {
+        if ((*pp)->type == OB_SLICE_TYPE_ALLOC) {
+            continue;
+        }
+
+        /* the compressed data can't be sent by sendfile, the normal path
+           decompresses it out of the IO thread */
+        if ((*pp)->compress.type != FS_COMPRESS_TYPE_NONE ||
+                pin_trunk(st, *pp) != 0)
+        {
+            result = EOPNOTSUPP;
+            break;
+        }
+    }
+
+    //the trunk maybe reclaimed before pinned
+    if (result == 0 && read_cache_get_version() != version) {
+        result = EOPNOTSUPP;
+    }
+    if (result != 0) {
+        free_slices(st);
+    }
+    return result;
+}
+
+static void finish_send_task(ZeroCopySendThread *thread,
+        ZeroCopySendTask *st, int result)
+{
+    struct fast_task_info *task;
+
+    task = st->task;
+    if (result != 0) {
+        logError("file: "__FILE__", line: %d, "
+                "client ip: %s, send slice fail, "
+                "oid: %"PRId64", block offset: %"PRId64", "
+                "slice offset: %d, length: %d, "
+                "errno: %d, error info: %s",
+                __LINE__, task->client_ip,
+                OP_CTX_INFO.bs_key.block.oid,
+                OP_CTX_INFO.bs_key.block.offset,
+                OP_CTX_INFO.bs_key.slice.offset,
+                OP_CTX_INFO.bs_key.slice.length,
+                result, STRERROR(result));
+
+        //the response is broken, close the connection
+        result = (result > 0 ? -1 * result : result);
+    }
+
+    release_extent(&st->extent);
+    free_slices(st);
+
+    /* the dup socket shares the file description with the task socket,
+       so the close does NOT detach it from the epoll */
+    if (st->attached) {
+        epoll_ctl(thread->epoll_fd, EPOLL_CTL_DEL, st->sock, NULL);
+    }
+    close(st->sock);
+
+    TASK_ARG->context.need_response = false;
+    RESPONSE_STATUS = result;
+    sf_nio_notify(task, SF_NIO_STAGE_CONTINUE);
+    sf_release_task(task);
+    fast_mblock_free_object(&zero_copy_ctx.allocator, st);
+}
+
+static void continue_send_task(ZeroCopySendThread *thread,
+        ZeroCopySendTask *st)
+{
+    struct epoll_event ev;
+    int result;
+
+    if ((result=send_extents(st)) != EAGAIN) {
+        finish_send_task(thread, st, result);
+        return;
+    }
+
+    //edge triggered, notified when the socket becomes writable
+    if (!st->attached) {
+        ev.events = EPOLLOUT | EPOLLET;
+        ev.data.ptr = st;
+        if (epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, st->sock, &ev) != 0) {
+            result = errno != 0 ? errno : ENOMEM;
+            logError("file: "__FILE__", line: %d, "
+                    "epoll_ctl fail, errno: %d, error info: %s",
+                    __LINE__, result, STRERROR(result));
+            finish_send_task(thread, st, result);
+            return;
+        }
+        st->attached = true;
+    }
+
+    st->expires = g_current_time + SF_G_NETWORK_TIMEOUT;
+    fc_list_add_tail(&st->dlink, &thread->waiting);
+}
+
+static void start_send_task(ZeroCopySendThread *thread,
+        ZeroCopySendTask *st)
+{
+    struct fast_task_info *task;
+
+    task = st->task;
+    memset(&st->header, 0, sizeof(st->header));
+    SF_PROTO_SET_HEADER(&st->header, FS_SERVICE_PROTO_SLICE_READ_RESP,
+            OP_CTX_INFO.bs_key.slice.length);
+    set_buffer_extent(&st->extent, (const char *)&st->header,
+            sizeof(st->header), true);
+    st->attached = false;
+    st->slice_index = 0;
+    st->offset = OP_CTX_INFO.bs_key.slice.offset;
+    st->end_offset = st->offset + OP_CTX_INFO.bs_key.slice.length;
+    continue_send_task(thread, st);
+}
+
+static void check_timeout(ZeroCopySendThread *thread)
+{
+    ZeroCopySendTask *st;
+
+    while (!fc_list_empty(&thread->waiting)) {
+        st = fc_list_first_entry(&thread->waiting, ZeroCopySendTask, dlink);
+        if (st->expires > g_current_time) {
+            break;
+        }
+
+        fc_list_del_init(&st->dlink);
+        finish_send_task(thread, st, ETIMEDOUT);
+    }
+}
+
+static void *zero_copy_send_thread_func(void *arg)
+{
+    ZeroCopySendThread *thread;
+    ZeroCopySendTask *head;
+    ZeroCopySendTask *st;
+    struct epoll_event events[ZERO_COPY_EPOLL_EVENTS];
+    uint64_t n;
+    int count;
+    int i;
+
+    thread = (ZeroCopySendThread *)arg;
+    while (SF_G_CONTINUE_FLAG) {
+        count = epoll_wait(thread->epoll_fd, events,
+                ZERO_COPY_EPOLL_EVENTS, ZERO_COPY_EPOLL_TIMEOUT_MS);
+        for (i=0; i<count; i++) {
+            if (events[i].data.ptr == NULL) {  //the notify of new tasks
+                if (read(thread->notify_fd, &n, sizeof(n)) < 0) {
+                    //the counter of the eventfd is reset already
+                }
+                continue;
+            }
+
+            st = (ZeroCopySendTask *)events[i].data.ptr;
+            fc_list_del_init(&st->dlink);
+            continue_send_task(thread, st);
+        }
+
+        head = (ZeroCopySendTask *)fc_queue_try_pop_all(&thread->queue);
+        while (head != NULL) {
+            st = head;
+            head = head->next;
+            start_send_task(thread, st);
+        }
+
+        check_timeout(thread);
+    }
+
+    return NULL;
+}
+
+int zero_copy_sender_push(struct fast_task_info *task)
+{
+    ZeroCopySendTask *st;
+    ZeroCopySendThread *thread;
+    uint64_t n;
+    int result;
+
+    if ((st=(ZeroCopySendTask *)fast_mblock_alloc_object(
+                    &zero_copy_ctx.allocator)) == NULL)
+    {
+        return ENOMEM;
+    }
+
+    st->task = task;
+    if ((result=get_and_pin_slices(st)) != 0) {
+        if (result != EOPNOTSUPP) {
+            RESPONSE.error.length = snprintf(RESPONSE.error.message,
+                    sizeof(RESPONSE.error.message),
+                    "%s", STRERROR(result));
+            if (result == ENOENT) {
+                TASK_ARG->context.log_level = LOG_NOTHING;
+            }
+        }
+        fast_mblock_free_object(&zero_copy_ctx.allocator, st);
+        return result;
+    }
+
+    if ((st->sock=dup(task->event.fd)) < 0) {
+        result = errno != 0 ? errno : EMFILE;
+        logError("file: "__FILE__", line: %d, "
+                "dup socket fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        free_slices(st);
+        fast_mblock_free_object(&zero_copy_ctx.allocator, st);
+        return result;
+    }
+
+    thread = zero_copy_ctx.threads + (unsigned int)__sync_fetch_and_add(
+            &zero_copy_ctx.next_thread, 1) % zero_copy_ctx.thread_count;
+    fc_queue_push(&thread->queue, st);
+
+    n = 1;
+    if (write(thread->notify_fd, &n, sizeof(n)) < 0) {
+        //the thread checks the queue at the epoll timeout
+    }
+    return 0;
+}
+
+static int send_task_alloc_init(ZeroCopySendTask *st, void *args)
+{
+    st->extent.type = ZERO_COPY_EXTENT_NONE;
+    st->extent.fd_entry = NULL;
+    st->pins.trunks = NULL;
+    st->pins.alloc = st->pins.count = 0;
+    ob_index_init_slice_ptr_array(&st->sarray);
+    FC_INIT_LIST_HEAD(&st->dlink);
+    return 0;
+}
+
+static int init_send_thread(ZeroCopySendThread *thread)
+{
+    struct epoll_event ev;
+    int result;
+
+    FC_INIT_LIST_HEAD(&thread->waiting);
+    if ((result=fc_queue_init(&thread->queue, (long)
+                    (&((ZeroCopySendTask *)NULL)->next))) != 0)
+    {
+        return result;
+    }
+
+    if ((thread->epoll_fd=epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+            (thread->notify_fd=eventfd(0, EFD_NONBLOCK |
+                                       EFD_CLOEXEC)) < 0)
+    {
+        result = errno != 0 ? errno : EMFILE;
+        logError("file: "__FILE__", line: %d, "
+                "create epoll or eventfd fail, errno: %d, "
+                "error info: %s", __LINE__, result, STRERROR(result));
+        return result;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD,
+                thread->notify_fd, &ev) != 0)
+    {
+        result = errno != 0 ? errno : ENOMEM;
+        logError("file: "__FILE__", line: %d, "
+                "epoll_ctl fail, errno: %d, error info: %s",
+                __LINE__, result, STRERROR(result));
+        return result;
+    }
+
+    return 0;
+}
+
+int zero_copy_sender_init()
+{
+    int result;
+    int bytes;
+    pthread_t tid;
+    ZeroCopySendThread *thread;
+    ZeroCopySendThread *end;
+
+    if (!STORAGE_CFG.zero_copy_read.enabled) {
+        return 0;
+    }
+
+    if ((result=fast_mblock_init_ex1(&zero_copy_ctx.allocator,
+                    "zero_copy_stask", sizeof(ZeroCopySendTask), 1024, 0,
+                    (fast_mblock_alloc_init_func)send_task_alloc_init,
+                    NULL, true)) != 0)
+    {
+        return result;
+    }
+
+    zero_copy_ctx.thread_count = STORAGE_CFG.zero_copy_read.thread_count;
+    bytes = sizeof(ZeroCopySendThread) * zero_copy_ctx.thread_count;
+    if ((zero_copy_ctx.threads=(ZeroCopySendThread *)fc_malloc(
+                    bytes)) == NULL)
+    {
+        return ENOMEM;
+    }
+    memset(zero_copy_ctx.threads, 0, bytes);
+
+    end = zero_copy_ctx.threads + zero_copy_ctx.thread_count;
+    for (thread=zero_copy_ctx.threads; thread<end; thread++) {
+        if ((result=init_send_thread(thread)) != 0) {
+            return result;
+        }
+
+        if ((result=fc_create_thread(&tid, zero_copy_send_thread_func,
+                        thread, SF_G_THREAD_STACK_SIZE)) != 0)
+        {
+            return result;
+        }
+    }
+
+    return 0;
+}
+
+#else
+
+//the zero copy read is disabled by the config loader
+int zero_copy_sender_push(struct fast_task_info *task)
+{
+    return EOPNOTSUPP;
+}
+
+int zero_copy_sender_init()
+{
+    return 0;
+}
+
+#endif
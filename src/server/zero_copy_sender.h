@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2020 YuQing <384681@qq.com>
+ *
+ * This program is free software: you can use, redistribute, and/or modify
+ * it under the terms of the GNU Affero General Public License, version 3
+ * or later ("AGPL"), as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+//zero_copy_sender.h
+
+#ifndef _ZERO_COPY_SENDER_H_
+#define _ZERO_COPY_SENDER_H_
+
+#include "server_global.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    int zero_copy_sender_init();
+
+    /* buffer_size: the max read length without zero copy
+       the data can NOT be verified by checksum when zero copy */
+    static inline bool zero_copy_sender_can_send(const int read_length,
+            const int buffer_size)
+    {
+        return STORAGE_CFG.zero_copy_read.enabled &&
+            !STORAGE_CFG.slice_checksum.verify_on_read &&
+            (read_length >= STORAGE_CFG.zero_copy_read.min_size ||
+             read_length > buffer_size);
+    }
+
+    /* send the slice read response of the task by the sender thread:
+       the response header and the data sent by sendfile from the trunk
+       files directly, the holes and the unwritten ranges are sent as zeros.
+       the task is notified with need_response false after done.
+       return EOPNOTSUPP for reading by the normal path, such as
+       for the compressed slices */
+    int zero_copy_sender_push(struct fast_task_info *task);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif